@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bytecode.h"
+
+// Function prototypes
+ParseResult runBytecode(const BytecodeProgram* program, int entryPoint, const char* input, int length,
+                        const void* const** handlers);
+int productionWords(const CompiledTable* compiled, int production, bool shift);
+
+// The interpreter, started at an entry point's stub. Called with handlers, it only hands out its
+// handler addresses for threading
+ParseResult runBytecode(const BytecodeProgram* program, int entryPoint, const char* input, int length,
+                        const void* const** handlers) {
+    ParseResult result = {false, -1, 0};
+#if defined(__GNUC__)
+    static const void* const labels[BYTECODE_NUM_OPCODES] = {
+        &&doMatch, &&doShift, &&doCall, &&doJump, &&doSwitch, &&doDecide, &&doReturn, &&doAccept
+    };
+    if (handlers != NULL) {
+        *handlers = labels;
+        return result;
+    }
+#define NEXT() goto *(const void*)*pc
+#else
+    if (handlers != NULL) {
+        *handlers = NULL;
+        return result;
+    }
+#define NEXT() goto dispatch
+#endif
+    
+    const CompiledTable* compiled = program->compiled;
+    const intptr_t* code = program->code;
+    const intptr_t* returns[MAX_PARSE_STACK];
+    int depth = 0;
+    const intptr_t* pc = code + 3 * entryPoint;
+    int pos = 0;
+    int tokenOffset;
+    int token = nextToken(compiled, input, length, &pos, &tokenOffset);
+    result.numTokens = 1;
+    NEXT();
+    
+#if !defined(__GNUC__)
+dispatch:
+    switch (*pc) {
+        case BYTECODE_MATCH: goto doMatch;
+        case BYTECODE_SHIFT: goto doShift;
+        case BYTECODE_CALL: goto doCall;
+        case BYTECODE_JUMP: goto doJump;
+        case BYTECODE_SWITCH: goto doSwitch;
+        case BYTECODE_DECIDE: goto doDecide;
+        case BYTECODE_RETURN: goto doReturn;
+        case BYTECODE_ACCEPT: goto doAccept;
+        default: goto reject;
+    }
+#endif
+    
+doMatch:
+    if (token != pc[1]) goto reject;
+    pc += 2;
+    token = nextToken(compiled, input, length, &pos, &tokenOffset);
+    result.numTokens++;
+    NEXT();
+    
+doShift:
+    pc++;
+    token = nextToken(compiled, input, length, &pos, &tokenOffset);
+    result.numTokens++;
+    NEXT();
+    
+doCall:
+    if (depth == MAX_PARSE_STACK) goto reject;
+    returns[depth++] = pc + 2;
+    pc = code + pc[1];
+    NEXT();
+    
+doJump:
+    pc = code + pc[1];
+    NEXT();
+    
+doSwitch:
+    if (token < 0 || pc[1 + token] == 0) goto reject;
+    pc = code + pc[1 + token];
+    NEXT();
+    
+doDecide:
+    pc = code + program->productionCode[predictProduction(compiled, (int)pc[1], input, length, pos, token)];
+    NEXT();
+    
+doReturn:
+    pc = returns[--depth];
+    NEXT();
+    
+doAccept:
+    if (token != compiled->endMarker) goto reject;
+    result.accepted = true;
+    return result;
+    
+reject:
+    result.errorOffset = tokenOffset;
+    return result;
+#undef NEXT
+}
+
+// Words of a production's code: a match (or shift) per terminal, a call per non-terminal, with a
+// final non-terminal jumped to instead of returning afterwards
+int productionWords(const CompiledTable* compiled, int production, bool shift) {
+    int n = compiled->productionLength[production];
+    const int* rhs = compiled->rhsSymbols + compiled->productionStart[production];
+    int words = 0;
+    for (int i = 0; i < n; i++) {
+        words += i == 0 && shift ? 1 : 2;
+    }
+    if (n == 0 || rhs[n - 1] < compiled->numTerminals) words++;
+    return words;
+}
+
+BytecodeProgram* compileBytecode(const CompiledTable* compiled) {
+    const int numTerminals = compiled->numTerminals;
+    const int numNonTerminals = compiled->numNonTerminals;
+    BytecodeProgram* program = (BytecodeProgram*)malloc(sizeof(BytecodeProgram));
+    int* entry = (int*)malloc((compiled->numProductions + 1) * sizeof(int));
+    if (program == NULL || entry == NULL) {
+        free(program);
+        free(entry);
+        return NULL;
+    }
+    program->compiled = compiled;
+    program->code = NULL;
+    program->nonTerminalCode = (int*)malloc((numNonTerminals + 1) * sizeof(int));
+    program->productionCode = (int*)malloc((compiled->numProductions + 1) * sizeof(int));
+    int* productionCode = program->productionCode;
+    if (program->nonTerminalCode == NULL || productionCode == NULL) {
+        free(entry);
+        freeBytecode(program);
+        return NULL;
+    }
+    
+    // A production selected by one lookahead only, which is its first symbol, need not match it
+    // again. entry[p] is that lookahead (-2 for several), then whether p starts with a shift
+    for (int p = 0; p < compiled->numProductions; p++) {
+        entry[p] = -1;
+    }
+    for (int n = 0; n < numNonTerminals; n++) {
+        for (int t = 0; t < numTerminals; t++) {
+            int p = tableCell(compiled, n, t);
+            if (p >= 0) entry[p] = entry[p] == -1 ? t : -2;
+        }
+    }
+    for (int p = 0; p < compiled->numProductions; p++) {
+        bool shift = compiled->productionLength[p] > 0 &&
+                     compiled->rhsSymbols[compiled->productionStart[p]] == entry[p];
+        entry[p] = shift;
+    }
+    
+    // Lay out an entry stub per entry point (call its non-terminal, accept), then each non-terminal's
+    // switch followed by its productions, then a decide instruction for each contested cell
+    int size = 3 * compiled->numEntryPoints;
+    for (int n = 0; n < numNonTerminals; n++) {
+        program->nonTerminalCode[n] = size;
+        size += 1 + numTerminals;
+        for (int p = 0; p < compiled->numProductions; p++) {
+            if (compiled->productionLhs[p] != n) continue;
+            productionCode[p] = size;
+            size += productionWords(compiled, p, entry[p]);
+        }
+    }
+    int decisionCode = size;
+    size += 2 * compiled->numDecisions;
+    program->codeSize = size;
+    program->code = (intptr_t*)malloc(size * sizeof(intptr_t));
+    if (program->code == NULL) {
+        free(entry);
+        freeBytecode(program);
+        return NULL;
+    }
+    
+    const void* const* handlers;
+    runBytecode(NULL, 0, NULL, 0, &handlers);
+#define OPCODE(op) (handlers != NULL ? (intptr_t)handlers[op] : (intptr_t)(op))
+    intptr_t* code = program->code;
+    for (int e = 0; e < compiled->numEntryPoints; e++) {
+        code[3 * e] = OPCODE(BYTECODE_CALL);
+        code[3 * e + 1] = program->nonTerminalCode[compiled->entryPoints[e] - numTerminals];
+        code[3 * e + 2] = OPCODE(BYTECODE_ACCEPT);
+    }
+    for (int n = 0; n < numNonTerminals; n++) {
+        intptr_t* at = code + program->nonTerminalCode[n];
+        *at++ = OPCODE(BYTECODE_SWITCH);
+        for (int t = 0; t < numTerminals; t++) {
+            int p = tableCell(compiled, n, t);
+            int d = p >= 0 && compiled->contested[p] ? findDecision(compiled, n, t) : -1;
+            *at++ = d != -1 ? decisionCode + 2 * d : p >= 0 ? productionCode[p] : 0;
+        }
+        for (int p = 0; p < compiled->numProductions; p++) {
+            if (compiled->productionLhs[p] != n) continue;
+            int length = compiled->productionLength[p];
+            const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+            for (int i = 0; i < length; i++) {
+                if (rhs[i] < numTerminals) {
+                    if (i == 0 && entry[p]) {
+                        *at++ = OPCODE(BYTECODE_SHIFT);
+                    } else {
+                        *at++ = OPCODE(BYTECODE_MATCH);
+                        *at++ = rhs[i];
+                    }
+                } else {
+                    *at++ = OPCODE(i == length - 1 ? BYTECODE_JUMP : BYTECODE_CALL);
+                    *at++ = program->nonTerminalCode[rhs[i] - numTerminals];
+                }
+            }
+            if (length == 0 || rhs[length - 1] < numTerminals) {
+                *at++ = OPCODE(BYTECODE_RETURN);
+            }
+        }
+    }
+    for (int d = 0; d < compiled->numDecisions; d++) {
+        code[decisionCode + 2 * d] = OPCODE(BYTECODE_DECIDE);
+        code[decisionCode + 2 * d + 1] = d;
+    }
+#undef OPCODE
+    
+    free(entry);
+    return program;
+}
+
+void freeBytecode(BytecodeProgram* program) {
+    if (program == NULL) return;
+    free(program->code);
+    free(program->nonTerminalCode);
+    free(program->productionCode);
+    free(program);
+}
+
+ParseResult parseInputBytecode(const BytecodeProgram* program, const char* input, int length) {
+    return runBytecode(program, 0, input, length, NULL);
+}
+
+ParseResult parseInputBytecodeFrom(const BytecodeProgram* program, int entryPoint, const char* input, int length) {
+    return runBytecode(program, entryPoint, input, length, NULL);
+}
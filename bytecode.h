@@ -0,0 +1,45 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdint.h>
+#include "parser.h"
+
+// Instructions of a compiled grammar. Each is one opcode word followed by its operands
+typedef enum {
+    BYTECODE_MATCH,              // terminal: the lookahead has to be it; move to the next token
+    BYTECODE_SHIFT,              // Move to the next token (a terminal the lookahead switch already checked)
+    BYTECODE_CALL,               // target: parse the non-terminal whose code starts at target, then go on
+    BYTECODE_JUMP,               // target: a call in tail position, which returns where this code would
+    BYTECODE_SWITCH,             // numTerminals targets: go to the production for the lookahead, 0 if none
+    BYTECODE_DECIDE,             // decision: go to the production predictProduction chooses (contested cells)
+    BYTECODE_RETURN,
+    BYTECODE_ACCEPT,             // The lookahead has to be $
+    BYTECODE_NUM_OPCODES
+} BytecodeOpcode;
+
+// A parse table compiled into one recursive-descent procedure per non-terminal: a switch on the
+// lookahead, then each production's symbols as matches and calls. With GCC or Clang the opcode
+// words hold the address of their handler in the interpreter (direct threading, dispatched with
+// computed goto); other compilers get the opcode numbers and a switch
+typedef struct {
+    const CompiledTable* compiled;
+    intptr_t* code;
+    int codeSize;                // Words
+    int* nonTerminalCode;        // Where each non-terminal's procedure starts
+    int* productionCode;         // Where each production's code starts
+} BytecodeProgram;
+
+// Compile a table into bytecode. The program reads the table's tokens, so the table has to
+// outlive it. NULL if out of memory
+BytecodeProgram* compileBytecode(const CompiledTable* compiled);
+void freeBytecode(BytecodeProgram* program);
+
+// Run the program over input. Same result as parseInput, except that a parse nesting calls
+// deeper than MAX_PARSE_STACK is rejected
+ParseResult parseInputBytecode(const BytecodeProgram* program, const char* input, int length);
+
+// Run the program from one of the table's entry points (see parseInputFrom); entry point 0 is the
+// start symbol
+ParseResult parseInputBytecodeFrom(const BytecodeProgram* program, int entryPoint, const char* input, int length);
+
+#endif
@@ -1,1649 +1,706 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <stdbool.h>
-#include <locale.h>
-
-
-#define MAX_PRODS 100        // Maximum number of productions
-#define MAX_SYMBOLS 100      // Maximum number of symbols in the grammar
-#define MAX_RHS 50           // Maximum number of RHS alternatives per production
-#define MAX_PROD_LEN 100     // Maximum length of a production
-#define MAX_LINE_LEN 256     // Maximum line length in input file
-#define MAX_TERMINALS 100    // Maximum number of terminals
-#define MAX_NON_TERMINALS 50 // Maximum number of non-terminals
-#define EPSILON "ε"          // Epsilon symbol
-
-// Structure for a production rule
-typedef struct {
-    char lhs[20];                  // Left-hand side non-terminal
-    char rhs[MAX_RHS][MAX_PROD_LEN]; // Right-hand side alternatives
-    int numRHS;                    // Number of RHS alternatives
-} Production;
-
-// Structure for a grammar
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "ll1.h"
+#include "parser.h"
+#include "daemon.h"
+#include "registry.h"
+#include "pipeline.h"
+#include "lockstep.h"
+#include "bytecode.h"
+#include "profile.h"
+
+#define MAX_BATCH_FILES 4096 // Maximum number of grammar files in one batch
+#define MAX_PATH_LEN 512     // Maximum length of a file path
+
+// Result of analyzing one grammar file in batch mode
 typedef struct {
-    Production productions[MAX_PRODS];
-    int numProductions;
-    char terminals[MAX_TERMINALS][20];
-    int numTerminals;
-    char nonTerminals[MAX_NON_TERMINALS][20];
-    int numNonTerminals;
-    char startSymbol[20];
-} Grammar;
+    char grammarFile[MAX_PATH_LEN];
+    char outputFile[MAX_PATH_LEN];
+    bool ok;
+    int numConflicts;
+    double seconds;
+} BatchJob;
 
-// Structure for FIRST and FOLLOW sets
 typedef struct {
-    char symbol[20];
-    char elements[MAX_TERMINALS][20];
-    int numElements;
-} Set;
+    BatchJob* jobs;
+    int numJobs;
+    int nextJob;             // Next job to hand out, guarded by lock
+    pthread_mutex_t lock;
+} BatchQueue;
 
-// Structure for LL(1) parsing table
+// What the daemon's reload thread republishes on SIGHUP
 typedef struct {
-    char nonTerminal[20];
-    char terminal[20];
-    char production[MAX_PROD_LEN];
-} ParseTableEntry;
-
-typedef struct {
-    ParseTableEntry entries[MAX_NON_TERMINALS * MAX_TERMINALS];
-    int numEntries;
-    char terminals[MAX_TERMINALS][20];
-    int numTerminals;
-    char nonTerminals[MAX_NON_TERMINALS][20];
-    int numNonTerminals;
-} ParseTable;
+    GrammarRegistry* registry;
+    char** grammarFiles;
+    int numGrammars;
+    int numThreads;
+    bool compress;
+    atomic_bool stop;        // Set before the last SIGHUP, when the daemon shuts down
+} ReloadJob;
 
 // Function prototypes
-Grammar readGrammarFromFile(const char* filename);
-void displayGrammar(Grammar grammar);
-Grammar leftFactoring(Grammar grammar);
-Grammar leftRecursionRemoval(Grammar grammar);
-Set* computeFirstSets(Grammar grammar);
-Set* computeFollowSets(Grammar grammar, Set* firstSets);
-ParseTable constructLL1Table(Grammar grammar, Set* firstSets, Set* followSets);
-void displayFirstSets(Set* firstSets, int numNonTerminals);
-void displayFollowSets(Set* followSets, int numNonTerminals);
-void displayParseTable(ParseTable table);
-bool isTerminal(Grammar grammar, const char* symbol);
-bool isNonTerminal(Grammar grammar, const char* symbol);
-void addToSet(Set* set, const char* element);
-bool isInSet(Set set, const char* element);
-char** splitString(const char* str, const char* delimiter, int* count);
-char* trimString(char* str);
-void addNewProduction(Grammar* grammar, const char* lhs, char rhs[][MAX_PROD_LEN], int numRHS);
-bool hasCommonPrefix(char* rhs1, char* rhs2, char* prefix);
-char* getPrefix(char* rhs1, char* rhs2);
-void removePrefix(char* str, const char* prefix, char* result);
-bool hasDirectLeftRecursion(Production prod);
-char* getSymbol(const char* rhs, int* pos);
-void freeSet(Set* set, int count);
-void writeOutputToFile(Grammar original, Grammar leftFactored, Grammar withoutLeftRecursion, 
-                      Set* firstSets, Set* followSets, ParseTable parseTable, const char* filename);
-
-int main() {
-    Grammar grammar = readGrammarFromFile("g1.txt");
-    printf("Original Grammar:\n");
-    displayGrammar(grammar);
-    
-    // Left Factoring
-    Grammar leftFactoredGrammar = leftFactoring(grammar);
-    printf("\nGrammar after Left Factoring:\n");
-    displayGrammar(leftFactoredGrammar);
-    
-    // Left Recursion Removal
-    Grammar grammarWithoutLeftRecursion = leftRecursionRemoval(leftFactoredGrammar);
-    printf("\nGrammar after Left Recursion Removal:\n");
-    displayGrammar(grammarWithoutLeftRecursion);
-    
-    // Compute FIRST sets
-    Set* firstSets = computeFirstSets(grammarWithoutLeftRecursion);
-    printf("\nFIRST Sets:\n");
-    displayFirstSets(firstSets, grammarWithoutLeftRecursion.numNonTerminals);
-    
-    // Compute FOLLOW sets
-    Set* followSets = computeFollowSets(grammarWithoutLeftRecursion, firstSets);
-    printf("\nFOLLOW Sets:\n");
-    displayFollowSets(followSets, grammarWithoutLeftRecursion.numNonTerminals);
-    
-    // Construct LL(1) parsing table
-    ParseTable parseTable = constructLL1Table(grammarWithoutLeftRecursion, firstSets, followSets);
-    printf("\nLL(1) Parsing Table:\n");
-    displayParseTable(parseTable);
-    
-    // Write output to file
-    writeOutputToFile(grammar, leftFactoredGrammar, grammarWithoutLeftRecursion, 
-                     firstSets, followSets, parseTable, "output.txt");
-    
-    // Free allocated memory
-    freeSet(firstSets, grammarWithoutLeftRecursion.numNonTerminals);
-    freeSet(followSets, grammarWithoutLeftRecursion.numNonTerminals);
-    
-    return 0;
+double elapsedSeconds(struct timespec start);
+int compareJobs(const void* a, const void* b);
+int collectBatchFiles(const char* path, const char* outputDir, BatchJob* jobs);
+void* batchWorker(void* arg);
+int runBatch(const char* path, const char* outputDir, int numThreads);
+int serveGrammars(const char* socketPath, char** grammarFiles, int numGrammars, int numThreads, bool compress);
+void* reloadGrammars(void* arg);
+void reportCompression(const GrammarAnalysis* analysis);
+bool layOutByProfile(GrammarAnalysis* analysis, const char* profileFile);
+char* readWholeFile(const char* path, long* length);
+int parseDocument(const char* grammarFile, const char* inputFile, const char* entry, const char* profileFile,
+                  int numThreads, bool pipelined, bool compress, bool bytecode, bool lazy);
+int benchmarkMessages(const char* grammarFile, const char* messagesFile, const char* profileFile);
+int profileInputs(const char* grammarFile, const char* profileFile, char** inputFiles, int numInputs);
+
+double elapsedSeconds(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
 }
 
-
-/*
-Grammar readGrammarFromFile(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    Grammar grammar;
-    grammar.numProductions = 0;
-    grammar.numTerminals = 0;
-    grammar.numNonTerminals = 0;
-
-    if (file == NULL) {
-        printf("Error opening file: %s\n", filename);
-        return grammar;
-    }
-
-    char line[MAX_LINE_LEN];
-    int lineNum = 0;
-
-    while (fgets(line, MAX_LINE_LEN, file) != NULL) {
-        line[strcspn(line, "\n")] = 0;  // Remove newline character
-        if (strlen(line) == 0) continue; // Skip empty lines
-
-        printf("\nProcessing Line %d: %s\n", lineNum + 1, line);  // Debugging
-
-        char* trimmedLine = trimString(line);
-
-        // Split line into LHS and RHS
-        char* arrow = strstr(trimmedLine, "->");
-        if (arrow == NULL) {
-            printf("Invalid grammar format at line %d\n", lineNum + 1);
-            continue;
-        }
-
-        // Extract LHS
-        *arrow = '\0';
-        char* lhs = trimString(trimmedLine);
-        printf("  - Found LHS: %s\n", lhs);  // Debugging
-
-        // Ensure LHS is a non-terminal (it must be uppercase)
-        if (isupper(lhs[0])) {
-            bool found = false;
-            for (int i = 0; i < grammar.numNonTerminals; i++) {
-                if (strcmp(grammar.nonTerminals[i], lhs) == 0) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                strcpy(grammar.nonTerminals[grammar.numNonTerminals], lhs);
-                printf("  - Added Non-Terminal: %s\n", lhs);  // Debugging
-                grammar.numNonTerminals++;
-
-                // The first non-terminal is the start symbol
-                if (grammar.numNonTerminals == 1) {
-                    strcpy(grammar.startSymbol, lhs);
-                    printf("  - Start Symbol Set: %s\n", lhs);  // Debugging
-                }
-            }
-        } else {
-            printf("  - ERROR: LHS is not an uppercase non-terminal: %s\n", lhs);  // Debugging
-        }
-
-        // Extract RHS
-        char* rhsStr = trimString(arrow + 2);
-        printf("  - Found RHS: %s\n", rhsStr);  // Debugging
-
-        // Split RHS by '|'
-        int numAlternatives;
-        char** alternatives = splitString(rhsStr, "|", &numAlternatives);
-
-        // Create a new production
-        Production* prod = &grammar.productions[grammar.numProductions];
-        strcpy(prod->lhs, lhs);
-        prod->numRHS = numAlternatives;
-
-        for (int i = 0; i < numAlternatives; i++) {
-            char* trimmedAlt = trimString(alternatives[i]);
-            strcpy(prod->rhs[i], trimmedAlt);
-            printf("  - Added RHS Alternative: %s\n", trimmedAlt);  // Debugging
-
-            // **NEW FIX: Correctly handle uppercase followed by lowercase (Aa case)**
-            int pos = 0;
-            while (trimmedAlt[pos] != '\0') {
-                char symbol[3] = {trimmedAlt[pos], '\0', '\0'};  // Single character symbol
-
-                // If next character exists and is lowercase, handle it separately
-                if (isupper(trimmedAlt[pos]) && islower(trimmedAlt[pos + 1])) {
-                    symbol[0] = trimmedAlt[pos];   // First uppercase letter
-                    symbol[1] = '\0';             // Ensure single-character symbol
-
-                    // Add non-terminal
-                    bool foundNT = false;
-                    for (int j = 0; j < grammar.numNonTerminals; j++) {
-                        if (strcmp(grammar.nonTerminals[j], symbol) == 0) {
-                            foundNT = true;
-                            break;
-                        }
-                    }
-                    if (!foundNT) {
-                        strcpy(grammar.nonTerminals[grammar.numNonTerminals], symbol);
-                        grammar.numNonTerminals++;
-                        printf("  - Added Non-Terminal: %s\n", symbol);  // Debugging
-                    }
-
-                    // Now handle the lowercase letter as a terminal
-                    symbol[0] = trimmedAlt[pos + 1];  
-                    symbol[1] = '\0';  
-
-                    bool foundT = false;
-                    for (int j = 0; j < grammar.numTerminals; j++) {
-                        if (strcmp(grammar.terminals[j], symbol) == 0) {
-                            foundT = true;
-                            break;
-                        }
-                    }
-                    if (!foundT) {
-                        strcpy(grammar.terminals[grammar.numTerminals], symbol);
-                        grammar.numTerminals++;
-                        printf("  - Added Terminal: %s\n", symbol);  // Debugging
-                    }
-                    pos += 2;  // Move ahead since we processed two characters
-                    continue;
-                }
-
-                // If it's a non-terminal (uppercase)
-                if (isupper(symbol[0])) {
-                    bool foundNT = false;
-                    for (int j = 0; j < grammar.numNonTerminals; j++) {
-                        if (strcmp(grammar.nonTerminals[j], symbol) == 0) {
-                            foundNT = true;
-                            break;
-                        }
-                    }
-                    if (!foundNT) {
-                        strcpy(grammar.nonTerminals[grammar.numNonTerminals], symbol);
-                        grammar.numNonTerminals++;
-                        printf("  - Added Non-Terminal: %s\n", symbol);  // Debugging
-                    }
-                } else {  // It's a terminal
-                    bool foundT = false;
-                    for (int j = 0; j < grammar.numTerminals; j++) {
-                        if (strcmp(grammar.terminals[j], symbol) == 0) {
-                            foundT = true;
-                            break;
-                        }
-                    }
-                    if (!foundT) {
-                        strcpy(grammar.terminals[grammar.numTerminals], symbol);
-                        grammar.numTerminals++;
-                        printf("  - Added Terminal: %s\n", symbol);  // Debugging
-                    }
-                }
-                pos++;  // Move to the next character
-            }
-            free(trimmedAlt);
-        }
-
-        grammar.numProductions++;
-
-        // Free allocated memory
-        for (int i = 0; i < numAlternatives; i++) {
-            free(alternatives[i]);
-        }
-        free(alternatives);
-        free(trimmedLine);
-        free(lhs);
-        free(rhsStr);
-
-        lineNum++;
-    }
-
-    fclose(file);
-    return grammar;
+int compareJobs(const void* a, const void* b) {
+    return strcmp(((const BatchJob*)a)->grammarFile, ((const BatchJob*)b)->grammarFile);
 }
-*/
-
-
-Grammar readGrammarFromFile(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    Grammar grammar;
-    grammar.numProductions = 0;
-    grammar.numTerminals = 0;
-    grammar.numNonTerminals = 0;
-
-    if (file == NULL) {
-        printf("Error opening file: %s\n", filename);
-        return grammar;
-    }
-
-    char line[MAX_LINE_LEN];
-    int lineNum = 0;
-
-    while (fgets(line, MAX_LINE_LEN, file) != NULL) {
-        line[strcspn(line, "\n")] = 0;  // Remove newline character
-        if (strlen(line) == 0) continue; // Skip empty lines
-
-        printf("\nProcessing Line %d: %s\n", lineNum + 1, line);  // Debugging
-
-        char* trimmedLine = trimString(line);
-
-        // Split line into LHS and RHS
-        char* arrow = strstr(trimmedLine, "->");
-        if (arrow == NULL) {
-            printf("Invalid grammar format at line %d\n", lineNum + 1);
-            continue;
-        }
-
-        // Extract LHS
-        *arrow = '\0';
-        char* lhs = trimString(trimmedLine);
-        printf("  - Found LHS: %s\n", lhs);  // Debugging
-
-        // Ensure LHS is a non-terminal (must be uppercase)
-        if (isupper(lhs[0])) {
-            bool found = false;
-            for (int i = 0; i < grammar.numNonTerminals; i++) {
-                if (strcmp(grammar.nonTerminals[i], lhs) == 0) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                strcpy(grammar.nonTerminals[grammar.numNonTerminals], lhs);
-                printf("  - Added Non-Terminal: %s\n", lhs);  // Debugging
-                grammar.numNonTerminals++;
-
-                // The first non-terminal is the start symbol
-                if (grammar.numNonTerminals == 1) {
-                    strcpy(grammar.startSymbol, lhs);
-                    printf("  - Start Symbol Set: %s\n", lhs);  // Debugging
-                }
-            }
-        } else {
-            printf("  - ERROR: LHS is not an uppercase non-terminal: %s\n", lhs);  // Debugging
-        }
-
-        // Extract RHS
-        char* rhsStr = trimString(arrow + 2);
-        printf("  - Found RHS: %s\n", rhsStr);  // Debugging
 
-        // Split RHS by '|'
-        int numAlternatives;
-        char** alternatives = splitString(rhsStr, "|", &numAlternatives);
-
-        // Create a new production
-        Production* prod = &grammar.productions[grammar.numProductions];
-        strcpy(prod->lhs, lhs);
-        prod->numRHS = numAlternatives;
-
-        for (int i = 0; i < numAlternatives; i++) {
-            char* trimmedAlt = trimString(alternatives[i]);
-            strcpy(prod->rhs[i], trimmedAlt);
-            printf("  - Added RHS Alternative: %s\n", trimmedAlt);  // Debugging
-
-            // **NEW FIX: Properly handle uppercase and lowercase character sequences**
-            int pos = 0;
-            while (trimmedAlt[pos] != '\0') {
-                char symbol[3] = {trimmedAlt[pos], '\0', '\0'};  // Single character symbol
-
-                // If uppercase, treat as non-terminal
-                if (isupper(symbol[0])) {
-                    bool foundNT = false;
-                    for (int j = 0; j < grammar.numNonTerminals; j++) {
-                        if (strcmp(grammar.nonTerminals[j], symbol) == 0) {
-                            foundNT = true;
-                            break;
-                        }
-                    }
-                    if (!foundNT) {
-                        strcpy(grammar.nonTerminals[grammar.numNonTerminals], symbol);
-                        grammar.numNonTerminals++;
-                        printf("  - Added Non-Terminal: %s\n", symbol);  // Debugging
-                    }
-                } 
-                // If lowercase or special symbol, treat as terminal
-                else {
-                    bool foundT = false;
-                    for (int j = 0; j < grammar.numTerminals; j++) {
-                        if (strcmp(grammar.terminals[j], symbol) == 0) {
-                            foundT = true;
-                            break;
-                        }
-                    }
-                    if (!foundT) {
-                        strcpy(grammar.terminals[grammar.numTerminals], symbol);
-                        grammar.numTerminals++;
-                        printf("  - Added Terminal: %s\n", symbol);  // Debugging
-                    }
-                }
-                pos++;  // Move to the next character
-            }
-            free(trimmedAlt);
-        }
-
-        grammar.numProductions++;
-
-        // Free allocated memory
-        for (int i = 0; i < numAlternatives; i++) {
-            free(alternatives[i]);
-        }
-        free(alternatives);
-        free(trimmedLine);
-        free(lhs);
-        free(rhsStr);
-
-        lineNum++;
-    }
-
-    fclose(file);
-    return grammar;
-}
-
-
-// Display the grammar
-void displayGrammar(Grammar grammar) {
-    printf("Productions:\n");
-    for (int i = 0; i < grammar.numProductions; i++) {
-        Production prod = grammar.productions[i];
-        printf("%s -> ", prod.lhs);
-        for (int j = 0; j < prod.numRHS; j++) {
-            printf("%s", prod.rhs[j]);
-            if (j < prod.numRHS - 1) {
-                printf(" | ");
-            }
-        }
-        printf("\n");
-    }
-    
-    printf("\nNon-terminals: ");
-    for (int i = 0; i < grammar.numNonTerminals; i++) {
-        printf("%s", grammar.nonTerminals[i]);
-        if (i < grammar.numNonTerminals - 1) {
-            printf(", ");
-        }
-    }
-    
-    printf("\nTerminals: ");
-    for (int i = 0; i < grammar.numTerminals; i++) {
-        printf("%s", grammar.terminals[i]);
-        if (i < grammar.numTerminals - 1) {
-            printf(", ");
-        }
-    }
-    
-    printf("\nStart Symbol: %s\n", grammar.startSymbol);
-}
-
-// Get the common prefix of two strings
-bool hasCommonPrefix(char* rhs1, char* rhs2, char* prefix) {
-    int i = 0;
-    while (rhs1[i] != '\0' && rhs2[i] != '\0' && rhs1[i] == rhs2[i]) {
-        prefix[i] = rhs1[i];
-        i++;
-    }
-    prefix[i] = '\0';
-    return i > 0;
-}
-
-// Extract a symbol from a string at a given position
-
-
-char* getSymbol(const char* rhs, int* pos) {
-    char* symbol = (char*)malloc(MAX_PROD_LEN);
-    int i = 0;
-    
-    // Skip whitespace
-    while (rhs[*pos] != '\0' && isspace(rhs[*pos])) {
-        (*pos)++;
-    }
-    
-    if (rhs[*pos] == '\0') {
-        //free(symbol);
-        return NULL;
-    }
-    
-    // Check if it's a multi-character symbol (non-terminal)
-    if (isalpha(rhs[*pos]) && isupper(rhs[*pos])) {
-        while (rhs[*pos] != '\0' && (isalnum(rhs[*pos]) || rhs[*pos] == '_' || rhs[*pos] == '\'')) {
-            symbol[i++] = rhs[*pos];
-            (*pos)++;
-        }
-    } 
-    // Single character symbol (terminal)
-    else {
-        symbol[i++] = rhs[*pos];
-        (*pos)++;
-    }
-    
-    symbol[i] = '\0';
-    return symbol;
+// Fill jobs from a directory of grammars or a file listing one grammar path per line
+int collectBatchFiles(const char* path, const char* outputDir, BatchJob* jobs) {
+    int numJobs = 0;
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        printf("Error opening batch input: %s\n", path);
+        return -1;
+    }
+    
+    if (S_ISDIR(info.st_mode)) {
+        DIR* dir = opendir(path);
+        if (dir == NULL) {
+            printf("Error opening directory: %s\n", path);
+            return -1;
+        }
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL && numJobs < MAX_BATCH_FILES) {
+            if (entry->d_name[0] == '.') continue;
+            snprintf(jobs[numJobs].grammarFile, MAX_PATH_LEN, "%s/%s", path, entry->d_name);
+            struct stat fileInfo;
+            if (stat(jobs[numJobs].grammarFile, &fileInfo) == 0 && S_ISREG(fileInfo.st_mode)) {
+                numJobs++;
+            }
+        }
+        closedir(dir);
+        qsort(jobs, numJobs, sizeof(BatchJob), compareJobs);
+    } else {
+        FILE* list = fopen(path, "r");
+        if (list == NULL) {
+            printf("Error opening file: %s\n", path);
+            return -1;
+        }
+        char line[MAX_PATH_LEN];
+        while (fgets(line, MAX_PATH_LEN, list) != NULL && numJobs < MAX_BATCH_FILES) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (strlen(line) == 0) continue;
+            strcpy(jobs[numJobs++].grammarFile, line);
+        }
+        fclose(list);
+    }
+    
+    // Each grammar gets its own output file named after it
+    for (int i = 0; i < numJobs; i++) {
+        const char* base = strrchr(jobs[i].grammarFile, '/');
+        base = base == NULL ? jobs[i].grammarFile : base + 1;
+        snprintf(jobs[i].outputFile, MAX_PATH_LEN, "%s/%s.out", outputDir, base);
+    }
+    return numJobs;
 }
 
-
-
-
-
-
-char* getSymbol1(const char* rhs, int* pos) {
-    char* symbol = (char*)malloc(MAX_PROD_LEN);
-    
-    // Skip whitespace
-    while (rhs[*pos] != '\0' && isspace(rhs[*pos])) {
-        (*pos)++;
-    }
-    
-    if (rhs[*pos] == '\0') {
-        free(symbol);
-        return NULL;
-    }
-
-    // Check if the symbol is epsilon (UTF-8 encoding 0xCE 0xB5)
-    if ((unsigned char)rhs[*pos] == 0xCE && (unsigned char)rhs[*pos + 1] == 0xB5) {
-        strcpy(symbol, EPSILON);
-        (*pos) += 2; // Move past the two-byte UTF-8 character
-        return symbol;
-    }
-
-    free(symbol);
-    return NULL;
-}
-
-
-// Implementation of left factoring
-Grammar leftFactoring(Grammar grammar) {
-    Grammar result = grammar;
-    result.numProductions = 0;
+// Worker: take grammar files off the queue until it is empty
+void* batchWorker(void* arg) {
+    BatchQueue* queue = (BatchQueue*)arg;
     
-    for (int i = 0; i < grammar.numProductions; i++) {
-        Production prod = grammar.productions[i];
+    while (true) {
+        pthread_mutex_lock(&queue->lock);
+        int index = queue->nextJob++;
+        pthread_mutex_unlock(&queue->lock);
+        if (index >= queue->numJobs) break;
         
-        // Check if we need left factoring for this production
-        bool needsFactoring = false;
-        for (int j = 0; j < prod.numRHS; j++) {
-            for (int k = j + 1; k < prod.numRHS; k++) {
-                char prefix[MAX_PROD_LEN] = "";
-                if (hasCommonPrefix(prod.rhs[j], prod.rhs[k], prefix) && strlen(prefix) > 0) {
-                    needsFactoring = true;
-                    break;
-                }
-            }
-            if (needsFactoring) break;
-        }
+        BatchJob* job = &queue->jobs[index];
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
         
-        if (!needsFactoring) {
-            // No factoring needed, add as is
-            result.productions[result.numProductions] = prod;
-            result.numProductions++;
-        } else {
-            // Group RHS alternatives by their common prefixes
-            bool processed[MAX_RHS] = {false};
-            
-            for (int j = 0; j < prod.numRHS; j++) {
-                if (processed[j]) continue;
-                
-                char prefix[MAX_PROD_LEN] = "";
-                char newRHS[MAX_RHS][MAX_PROD_LEN];
-                int numNewRHS = 0;
-                
-                // Find all RHS with the same prefix
-                for (int k = j; k < prod.numRHS; k++) {
-                    if (processed[k]) continue;
-                    
-                    if (j == k) {
-                        // First occurrence, use it as a prefix candidate
-                        int pos = 0;
-                        char* symbol = getSymbol(prod.rhs[j], &pos);
-                        strcpy(prefix, symbol);
-                        free(symbol);
-                    } else {
-                        // Check if this RHS has the same prefix
-                        int pos1 = 0, pos2 = 0;
-                        char* symbol1 = getSymbol(prod.rhs[j], &pos1);
-                        char* symbol2 = getSymbol(prod.rhs[k], &pos2);
-                        
-                        if (strcmp(symbol1, symbol2) != 0) {
-                            free(symbol1);
-                            free(symbol2);
-                            continue;
-                        }
-                        free(symbol1);
-                        free(symbol2);
-                    }
-                    
-                    // Extract the remainder after the prefix
-                    char remainder[MAX_PROD_LEN] = "";
-                    int pos = 0;
-                    char* firstSymbol = getSymbol(prod.rhs[k], &pos);
-                    
-                    // Skip first symbol (prefix)
-                    if (strlen(prod.rhs[k]) > strlen(firstSymbol)) {
-                        strcpy(remainder, prod.rhs[k] + pos);
-                    } else if (strlen(prod.rhs[k]) == strlen(firstSymbol)) {
-                        strcpy(remainder, EPSILON);
-                    }
-                    free(firstSymbol);
-                    
-                    strcpy(newRHS[numNewRHS++], remainder);
-                    processed[k] = true;
-                }
-                
-                if (numNewRHS > 0) {
-                    // Create a new production with the common prefix
-                    char newLHS[MAX_PROD_LEN];
-                    sprintf(newLHS, "%s'", prod.lhs);
-                    
-                    // Make sure the new non-terminal is not already in use
-                    int suffix = 1;
-                    char tempLHS[MAX_PROD_LEN];
-                    strcpy(tempLHS, newLHS);
-                    while (isNonTerminal(result, tempLHS)) {
-                        sprintf(tempLHS, "%s'%d", prod.lhs, suffix++);
-                    }
-                    strcpy(newLHS, tempLHS);
-                    
-                    // Add the new non-terminal to the grammar
-                    strcpy(result.nonTerminals[result.numNonTerminals], newLHS);
-                    result.numNonTerminals++;
-                    
-                    // Create the factored production
-                    char factoredRHS[MAX_PROD_LEN];
-                    sprintf(factoredRHS, "%s %s", prefix, newLHS);
-                    
-                    // Add the main production
-                    strcpy(result.productions[result.numProductions].lhs, prod.lhs);
-                    strcpy(result.productions[result.numProductions].rhs[0], factoredRHS);
-                    result.productions[result.numProductions].numRHS = 1;
-                    result.numProductions++;
-                    
-                    // Add the new production for the factored part
-                    strcpy(result.productions[result.numProductions].lhs, newLHS);
-                    for (int k = 0; k < numNewRHS; k++) {
-                        strcpy(result.productions[result.numProductions].rhs[k], newRHS[k]);
-                    }
-                    result.productions[result.numProductions].numRHS = numNewRHS;
-                    result.numProductions++;
-                }
-            }
-            
-            // Add any unfactored alternatives
-            char unfactoredRHS[MAX_RHS][MAX_PROD_LEN];
-            int numUnfactored = 0;
-            
-            for (int j = 0; j < prod.numRHS; j++) {
-                if (!processed[j]) {
-                    strcpy(unfactoredRHS[numUnfactored++], prod.rhs[j]);
-                }
-            }
-            
-            if (numUnfactored > 0) {
-                strcpy(result.productions[result.numProductions].lhs, prod.lhs);
-                for (int j = 0; j < numUnfactored; j++) {
-                    strcpy(result.productions[result.numProductions].rhs[j], unfactoredRHS[j]);
-                }
-                result.productions[result.numProductions].numRHS = numUnfactored;
-                result.numProductions++;
-            }
-        }
+        GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromFile(job->grammarFile), 1);
+        job->ok = analysis != NULL;
+        job->numConflicts = 0;
+        if (analysis != NULL) {
+            job->numConflicts = analysis->parseTable.numConflicts;
+            writeOutputToFile(analysis->original, analysis->leftFactored, analysis->withoutLeftRecursion,
+                              analysis->simplified, analysis->firstSets, analysis->followSets,
+                              analysis->parseTable, job->outputFile);
+            freeGrammarAnalysis(analysis);
+        }
+        job->seconds = elapsedSeconds(start);
     }
-    
-    return result;
-}
-
-// Check if a production has direct left recursion
-bool hasDirectLeftRecursion(Production prod) {
-    for (int i = 0; i < prod.numRHS; i++) {
-        int pos = 0;
-        char* firstSymbol = getSymbol(prod.rhs[i], &pos);
-        
-        if (firstSymbol != NULL && strcmp(firstSymbol, prod.lhs) == 0) {
-            free(firstSymbol);
-            return true;
-        }
-        
-        if (firstSymbol != NULL) {
-            free(firstSymbol);
-        }
-    }
-    
-    return false;
+    return NULL;
 }
 
-// Implementation of left recursion removal
-Grammar leftRecursionRemoval(Grammar grammar) {
-    Grammar result = grammar;
-    result.numProductions = 0;
-    
-    // For each non-terminal
-    for (int i = 0; i < grammar.numNonTerminals; i++) {
-        char nonTerminal[20];
-        strcpy(nonTerminal, grammar.nonTerminals[i]);
-        
-        // Find the production for this non-terminal
-        Production* prod = NULL;
-        for (int j = 0; j < grammar.numProductions; j++) {
-            if (strcmp(grammar.productions[j].lhs, nonTerminal) == 0) {
-                prod = &grammar.productions[j];
-                break;
-            }
-        }
-        
-        if (prod == NULL) continue;
-        
-        // Check if this production has direct left recursion
-        if (!hasDirectLeftRecursion(*prod)) {
-            // No left recursion, add as is
-            result.productions[result.numProductions++] = *prod;
+// Analyze every grammar under path on numThreads workers and print a summary
+int runBatch(const char* path, const char* outputDir, int numThreads) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    BatchQueue queue;
+    queue.jobs = (BatchJob*)malloc(MAX_BATCH_FILES * sizeof(BatchJob));
+    queue.numJobs = collectBatchFiles(path, outputDir, queue.jobs);
+    queue.nextJob = 0;
+    if (queue.numJobs < 0) {
+        free(queue.jobs);
+        return 1;
+    }
+    pthread_mutex_init(&queue.lock, NULL);
+    
+    if (numThreads > MAX_THREADS) numThreads = MAX_THREADS;
+    pthread_t threads[MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < numThreads; i++) {
+        if (pthread_create(&threads[started], NULL, batchWorker, &queue) == 0) {
+            started++;
+        }
+    }
+    batchWorker(&queue);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&queue.lock);
+    
+    // Summary
+    int numFailed = 0, numConflicted = 0, totalConflicts = 0;
+    double totalSeconds = 0;
+    for (int i = 0; i < queue.numJobs; i++) {
+        BatchJob* job = &queue.jobs[i];
+        if (!job->ok) {
+            printf("%-40s FAILED\n", job->grammarFile);
+            numFailed++;
             continue;
         }
-        
-        // Separate recursive and non-recursive parts
-        char recursiveParts[MAX_RHS][MAX_PROD_LEN];
-        char nonRecursiveParts[MAX_RHS][MAX_PROD_LEN];
-        int numRecursive = 0;
-        int numNonRecursive = 0;
-        
-        for (int j = 0; j < prod->numRHS; j++) {
-            int pos = 0;
-            char* firstSymbol = getSymbol(prod->rhs[j], &pos);
-            
-            if (firstSymbol != NULL && strcmp(firstSymbol, prod->lhs) == 0) {
-                // This is a recursive part, extract the suffix
-                char suffix[MAX_PROD_LEN] = "";
-                if (strlen(prod->rhs[j]) > strlen(firstSymbol)) {
-                    strcpy(suffix, prod->rhs[j] + pos);
-                }
-                strcpy(recursiveParts[numRecursive++], suffix);
-            } else {
-                // This is a non-recursive part
-                strcpy(nonRecursiveParts[numNonRecursive++], prod->rhs[j]);
-            }
-            
-            if (firstSymbol != NULL) {
-                free(firstSymbol);
-            }
-        }
-        
-        // Create a new non-terminal for the recursive part
-        char newNonTerminal[20];
-        sprintf(newNonTerminal, "%s'", nonTerminal);
-        
-        // Make sure the new non-terminal is not already in use
-        int suffix = 1;
-        char tempNT[MAX_PROD_LEN];
-        strcpy(tempNT, newNonTerminal);
-        while (isNonTerminal(result, tempNT)) {
-            sprintf(tempNT, "%s'%d", nonTerminal, suffix++);
-        }
-        strcpy(newNonTerminal, tempNT);
-        
-        // Add the new non-terminal to the grammar
-        strcpy(result.nonTerminals[result.numNonTerminals], newNonTerminal);
-        result.numNonTerminals++;
-        
-        // Create the non-recursive production
-        strcpy(result.productions[result.numProductions].lhs, nonTerminal);
-        for (int j = 0; j < numNonRecursive; j++) {
-            char newRHS[MAX_PROD_LEN];
-            if (strcmp(nonRecursiveParts[j], EPSILON) == 0) {
-                strcpy(newRHS, newNonTerminal);
-            } else {
-                sprintf(newRHS, "%s %s", nonRecursiveParts[j], newNonTerminal);
-            }
-            strcpy(result.productions[result.numProductions].rhs[j], newRHS);
-        }
-        result.productions[result.numProductions].numRHS = numNonRecursive;
-        result.numProductions++;
-        
-        // Create the recursive production
-        strcpy(result.productions[result.numProductions].lhs, newNonTerminal);
-        for (int j = 0; j < numRecursive; j++) {
-            char newRHS[MAX_PROD_LEN];
-            if (strcmp(recursiveParts[j], "") == 0) {
-                sprintf(newRHS, "%s", newNonTerminal);
-            } else {
-                sprintf(newRHS, "%s %s", recursiveParts[j], newNonTerminal);
-            }
-            strcpy(result.productions[result.numProductions].rhs[j], newRHS);
-        }
-        // Add epsilon to the recursive production
-        strcpy(result.productions[result.numProductions].rhs[numRecursive], EPSILON);
-        result.productions[result.numProductions].numRHS = numRecursive + 1;
-        result.numProductions++;
+        printf("%-40s %8.3f ms  %d conflicts -> %s\n", job->grammarFile, job->seconds * 1000,
+               job->numConflicts, job->outputFile);
+        totalSeconds += job->seconds;
+        totalConflicts += job->numConflicts;
+        if (job->numConflicts > 0) numConflicted++;
     }
+    printf("\nGrammars: %d analyzed, %d failed, %d not LL(1) (%d conflicts)\n",
+           queue.numJobs - numFailed, numFailed, numConflicted, totalConflicts);
+    printf("Time: %.3f ms analysis, %.3f ms wall on %d threads\n",
+           totalSeconds * 1000, elapsedSeconds(start) * 1000, numThreads);
     
-    return result;
+    free(queue.jobs);
+    return numFailed > 0 ? 1 : 0;
 }
 
-// Check if a symbol is a terminal
-bool isTerminal(Grammar grammar, const char* symbol) {
-    for (int i = 0; i < grammar.numTerminals; i++) {
-        if (strcmp(grammar.terminals[i], symbol) == 0) {
-            return true;
+// Analyze and publish each grammar, then serve parse requests for them. SIGHUP reloads every
+// grammar file on a second thread while requests keep being answered with the old versions
+int serveGrammars(const char* socketPath, char** grammarFiles, int numGrammars, int numThreads, bool compress) {
+    GrammarRegistry* registry = createGrammarRegistry();
+    if (registry == NULL) return 1;
+    if (numGrammars > REGISTRY_MAX_GRAMMARS) numGrammars = REGISTRY_MAX_GRAMMARS;
+    
+    int status = 0;
+    for (int i = 0; i < numGrammars; i++) {
+        GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromFile(grammarFiles[i]), numThreads);
+        if (analysis == NULL) {
+            printf("No productions read from %s\n", grammarFiles[i]);
+            status = 1;
+            break;
         }
-    }
-    return false;
-}
-
-// Check if a symbol is a non-terminal
-bool isNonTerminal(Grammar grammar, const char* symbol) {
-    for (int i = 0; i < grammar.numNonTerminals; i++) {
-        if (strcmp(grammar.nonTerminals[i], symbol) == 0) {
-            return true;
+        if (analysis->parseTable.numConflicts > 0) {
+            printf("Warning: %s is not LL(1), %d conflicts\n", grammarFiles[i], analysis->parseTable.numConflicts);
         }
-    }
-    return false;
-}
-
-// Add an element to a set if not already present
-void addToSet(Set* set, const char* element) {
-    for (int i = 0; i < set->numElements; i++) {
-        if (strcmp(set->elements[i], element) == 0) {
-            return;
+        int index = publishGrammar(registry, grammarFiles[i], analysis, compress);
+        if (index == -1) {
+            status = 1;
+            break;
         }
+        printf("Grammar %d: %s\n", index, grammarFiles[i]);
     }
-    strcpy(set->elements[set->numElements], element);
-    set->numElements++;
-}
-
-// Check if an element is in a set
-bool isInSet(Set set, const char* element) {
-    for (int i = 0; i < set.numElements; i++) {
-        if (strcmp(set.elements[i], element) == 0) {
-            return true;
-        }
-    }
-    return false;
-}
-
-// Compute the FIRST sets for all non-terminals
-Set* computeFirstSets(Grammar grammar) {
-    Set* firstSets = (Set*)malloc(grammar.numNonTerminals * sizeof(Set));
     
-    // Initialize FIRST sets
-    for (int i = 0; i < grammar.numNonTerminals; i++) {
-        strcpy(firstSets[i].symbol, grammar.nonTerminals[i]);
-        firstSets[i].numElements = 0;
-    }
-    
-    bool changes = true;
-    
-    // Continue until no more changes
-    while (changes) {
-        changes = false;
+    if (status == 0) {
+        ReloadJob job = {registry, grammarFiles, numGrammars, numThreads, compress, false};
         
-        // For each production
-        for (int i = 0; i < grammar.numProductions; i++) {
-            Production prod = grammar.productions[i];
-            
-            // Find the index of this non-terminal in firstSets
-            int ntIndex = -1;
-            for (int j = 0; j < grammar.numNonTerminals; j++) {
-                if (strcmp(firstSets[j].symbol, prod.lhs) == 0) {
-                    ntIndex = j;
-                    break;
-                }
-            }
-            
-            if (ntIndex == -1) continue;
-            
-            // For each RHS
-            for (int j = 0; j < prod.numRHS; j++) {
-                int pos = 0;
-                char* symbol = getSymbol(prod.rhs[j], &pos);
-                
-                if (symbol == NULL) continue;
-                
-                // If it's epsilon
-                if (strcmp(symbol, EPSILON) == 0) {
-                    // Add epsilon to FIRST(prod.lhs)
-                    int prevSize = firstSets[ntIndex].numElements;
-                    addToSet(&firstSets[ntIndex], EPSILON);
-                    if (prevSize < firstSets[ntIndex].numElements) {
-                        changes = true;
-                    }
-                }
-                // If it's a terminal
-                else if (isTerminal(grammar, symbol)) {
-                    // Add symbol to FIRST(prod.lhs)
-                    int prevSize = firstSets[ntIndex].numElements;
-                    addToSet(&firstSets[ntIndex], symbol);
-                    if (prevSize < firstSets[ntIndex].numElements) {
-                        changes = true;
-                    }
-                }
-                // If it's a non-terminal
-                else if (isNonTerminal(grammar, symbol)) {
-                    // Find FIRST(symbol)
-                    int symbolIndex = -1;
-                    for (int k = 0; k < grammar.numNonTerminals; k++) {
-                        if (strcmp(firstSets[k].symbol, symbol) == 0) {
-                            symbolIndex = k;
-                            break;
-                        }
-                    }
-                    
-                    if (symbolIndex != -1) {
-                        // Add all elements of FIRST(symbol) except epsilon to FIRST(prod.lhs)
-                        int prevSize = firstSets[ntIndex].numElements;
-                        for (int k = 0; k < firstSets[symbolIndex].numElements; k++) {
-                            if (strcmp(firstSets[symbolIndex].elements[k], EPSILON) != 0) {
-                                addToSet(&firstSets[ntIndex], firstSets[symbolIndex].elements[k]);
-                            }
-                        }
-                        if (prevSize < firstSets[ntIndex].numElements) {
-                            changes = true;
-                        }
-                        
-                        // Check if FIRST(symbol) contains epsilon
-                        bool hasEpsilon = false;
-                        for (int k = 0; k < firstSets[symbolIndex].numElements; k++) {
-                            if (strcmp(firstSets[symbolIndex].elements[k], EPSILON) == 0) {
-                                hasEpsilon = true;
-                                break;
-                            }
-                        }
-                        
-                        // If FIRST(symbol) doesn't contain epsilon, we're done
-                        if (!hasEpsilon) {
-                            free(symbol);
-                            break;
-                        }
-                        
-                        // Otherwise, continue to the next symbol
-                        free(symbol);
-                        symbol = getSymbol(prod.rhs[j], &pos);
-                        if (symbol == NULL) {
-                            // End of production, add epsilon to FIRST(prod.lhs)
-                            int prevSize = firstSets[ntIndex].numElements;
-                            addToSet(&firstSets[ntIndex], EPSILON);
-                            if (prevSize < firstSets[ntIndex].numElements) {
-                                changes = true;
-                            }
-                            break;
-                        }
-                    }
-                }
-                
-                free(symbol);
-                break; // Only consider the first symbol
-            }
-        }
-    }
-    
-    return firstSets;
-}
-
-// Compute the FOLLOW sets for all non-terminals
-Set* computeFollowSets(Grammar grammar, Set* firstSets) {
-    Set* followSets = (Set*)malloc(grammar.numNonTerminals * sizeof(Set));
-    
-    // Initialize FOLLOW sets
-    for (int i = 0; i < grammar.numNonTerminals; i++) {
-        strcpy(followSets[i].symbol, grammar.nonTerminals[i]);
-        followSets[i].numElements = 0;
+        // Only the reload thread takes SIGHUP, and only the daemon's thread SIGINT and SIGTERM
+        sigset_t allSignals, reloadSignal;
+        sigfillset(&allSignals);
+        sigemptyset(&reloadSignal);
+        sigaddset(&reloadSignal, SIGHUP);
+        pthread_sigmask(SIG_SETMASK, &allSignals, NULL);
+        pthread_t reloader;
+        bool reloading = pthread_create(&reloader, NULL, reloadGrammars, &job) == 0;
+        pthread_sigmask(SIG_SETMASK, &reloadSignal, NULL);
         
-        // Add $ to FOLLOW(S) where S is the start symbol
-        if (strcmp(grammar.nonTerminals[i], grammar.startSymbol) == 0) {
-            addToSet(&followSets[i], "$");
-        }
-    }
-    
-    bool changes = true;
-    
-    // Continue until no more changes
-    while (changes) {
-        changes = false;
+        status = runDaemon(socketPath, registry);
         
-        // For each production
-        for (int i = 0; i < grammar.numProductions; i++) {
-            Production prod = grammar.productions[i];
-            
-            // Find the index of this non-terminal in followSets
-            int lhsIndex = -1;
-            for (int j = 0; j < grammar.numNonTerminals; j++) {
-                if (strcmp(followSets[j].symbol, prod.lhs) == 0) {
-                    lhsIndex = j;
-                    break;
-                }
-            }
-            
-            if (lhsIndex == -1) continue;
-            
-            // For each RHS
-            for (int j = 0; j < prod.numRHS; j++) {
-                char* rhs = prod.rhs[j];
-                int rhsLen = strlen(rhs);
-                
-                // For each symbol in RHS
-                int pos = 0;
-                while (pos < rhsLen) {
-                    char* symbol = getSymbol(rhs, &pos);
-                    
-                    if (symbol == NULL) break;
-                    
-                    // If it's a non-terminal
-                    if (isNonTerminal(grammar, symbol)) {
-                        // Find the index of this non-terminal in followSets
-                        int ntIndex = -1;
-                        for (int k = 0; k < grammar.numNonTerminals; k++) {
-                            if (strcmp(followSets[k].symbol, symbol) == 0) {
-                                ntIndex = k;
-                                break;
-                            }
-                        }
-                        
-                        if (ntIndex == -1) {
-                            free(symbol);
-                            continue;
-                        }
-                        
-                        // Get the next symbol
-                        int savedPos = pos;
-                        char* nextSymbol = getSymbol(rhs, &pos);
-                        
-                        // If there's no next symbol
-                        if (nextSymbol == NULL) {
-                            // Add FOLLOW(LHS) to FOLLOW(symbol)
-                            int prevSize = followSets[ntIndex].numElements;
-                            for (int k = 0; k < followSets[lhsIndex].numElements; k++) {
-                                addToSet(&followSets[ntIndex], followSets[lhsIndex].elements[k]);
-                            }
-                            if (prevSize < followSets[ntIndex].numElements) {
-                                changes = true;
-                            }
-                        } else {
-                            // If next symbol is a terminal
-                            if (isTerminal(grammar, nextSymbol)) {
-                                // Add nextSymbol to FOLLOW(symbol)
-                                int prevSize = followSets[ntIndex].numElements;
-                                addToSet(&followSets[ntIndex], nextSymbol);
-                                if (prevSize < followSets[ntIndex].numElements) {
-                                    changes = true;
-                                }
-                            }
-                            // If next symbol is a non-terminal
-                            else if (isNonTerminal(grammar, nextSymbol)) {
-                                // Find FIRST(nextSymbol)
-                                int nextIndex = -1;
-                                for (int k = 0; k < grammar.numNonTerminals; k++) {
-                                    if (strcmp(firstSets[k].symbol, nextSymbol) == 0) {
-                                        nextIndex = k;
-                                        break;
-                                    }
-                                }
-                                
-                                if (nextIndex != -1) {
-                                    // Add FIRST(nextSymbol) - {epsilon} to FOLLOW(symbol)
-                                    int prevSize = followSets[ntIndex].numElements;
-                                    for (int k = 0; k < firstSets[nextIndex].numElements; k++) {
-                                        if (strcmp(firstSets[nextIndex].elements[k], EPSILON) != 0) {
-                                            addToSet(&followSets[ntIndex], firstSets[nextIndex].elements[k]);
-                                        }
-                                    }
-                                    if (prevSize < followSets[ntIndex].numElements) {
-                                        changes = true;
-                                    }
-                                    
-                                    // If FIRST(nextSymbol) contains epsilon
-                                    bool hasEpsilon = false;
-                                    for (int k = 0; k < firstSets[nextIndex].numElements; k++) {
-                                        if (strcmp(firstSets[nextIndex].elements[k], EPSILON) == 0) {
-                                            hasEpsilon = true;
-                                            break;
-                                        }
-                                    }
-                                    
-                                    if (hasEpsilon) {
-                                        // Add FOLLOW(LHS) to FOLLOW(symbol)
-                                        int prevSize = followSets[ntIndex].numElements;
-                                        for (int k = 0; k < followSets[lhsIndex].numElements; k++) {
-                                            addToSet(&followSets[ntIndex], followSets[lhsIndex].elements[k]);
-                                        }
-                                        if (prevSize < followSets[ntIndex].numElements) {
-                                            changes = true;
-                                        }
-                                    }
-                                }
-                            }
-                            
-                            free(nextSymbol);
-                            pos = savedPos; // Restore position for the outer loop
-                        }
-                    }
-                    
-                    free(symbol);
-                }
-            }
+        if (reloading) {
+            atomic_store(&job.stop, true);
+            pthread_kill(reloader, SIGHUP);
+            pthread_join(reloader, NULL);
         }
     }
-    
-    return followSets;
+    freeGrammarRegistry(registry);
+    return status;
 }
 
-// Construct the LL(1) parsing table
-/*
-ParseTable constructLL1Table(Grammar grammar, Set* firstSets, Set* followSets) {
-    ParseTable table;
-    table.numEntries = 0;
-    
-    // Copy terminals and non-terminals
-    table.numTerminals = grammar.numTerminals;
-    for (int i = 0; i < grammar.numTerminals; i++) {
-        strcpy(table.terminals[i], grammar.terminals[i]);
-    }
-    
-    // Add $ as a terminal
-    strcpy(table.terminals[table.numTerminals], "$");
-    table.numTerminals++;
-    
-    table.numNonTerminals = grammar.numNonTerminals;
-    for (int i = 0; i < grammar.numNonTerminals; i++) {
-        strcpy(table.nonTerminals[i], grammar.nonTerminals[i]);
-    }
-    
-    // For each production
-    for (int i = 0; i < grammar.numProductions; i++) {
-        Production prod = grammar.productions[i];
-        
-        // Find the index of this non-terminal in firstSets
-        int ntIndex = -1;
-        for (int j = 0; j < grammar.numNonTerminals; j++) {
-            if (strcmp(firstSets[j].symbol, prod.lhs) == 0) {
-                ntIndex = j;
-                break;
-            }
-        }
-        
-        if (ntIndex == -1) continue;
+// Wait for SIGHUP, then analyze every grammar file again and publish the new versions. A file that
+// no longer reads keeps its old version
+void* reloadGrammars(void* arg) {
+    ReloadJob* job = (ReloadJob*)arg;
+    sigset_t reloadSignal;
+    sigemptyset(&reloadSignal);
+    sigaddset(&reloadSignal, SIGHUP);
+    
+    while (true) {
+        int signal;
+        if (sigwait(&reloadSignal, &signal) != 0 || atomic_load(&job->stop)) return NULL;
         
-        // For each RHS
-        for (int j = 0; j < prod.numRHS; j++) {
-            char* rhs = prod.rhs[j];
-            
-            // Get the first symbol of RHS
-            int pos = 0;
-            char* firstSymbol = getSymbol(rhs, &pos);
-            
-            // If RHS is epsilon or starts with a terminal
-            if (firstSymbol == NULL || strcmp(firstSymbol, EPSILON) == 0 || isTerminal(grammar, firstSymbol)) {
-                if (firstSymbol == NULL || strcmp(firstSymbol, EPSILON) == 0) {
-                    // For each terminal in FOLLOW(LHS)
-                    for (int k = 0; k < followSets[ntIndex].numElements; k++) {
-                        char* terminal = followSets[ntIndex].elements[k];
-                        
-                        // Add entry to the parsing table
-                        strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
-                        strcpy(table.entries[table.numEntries].terminal, terminal);
-                        
-                        if (strcmp(rhs, EPSILON) == 0) {
-                            strcpy(table.entries[table.numEntries].production, EPSILON);
-                        } else {
-                            strcpy(table.entries[table.numEntries].production, rhs);
-                        }
-                        
-                        table.numEntries++;
-                    }
-                } else {
-                    // Add entry to the parsing table
-                    strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
-                    strcpy(table.entries[table.numEntries].terminal, firstSymbol);
-                    strcpy(table.entries[table.numEntries].production, rhs);
-                    table.numEntries++;
-                }
-            }
-            // If RHS starts with a non-terminal
-            else if (isNonTerminal(grammar, firstSymbol)) {
-                // Find FIRST(firstSymbol)
-                int symbolIndex = -1;
-                for (int k = 0; k < grammar.numNonTerminals; k++) {
-                    if (strcmp(firstSets[k].symbol, firstSymbol) == 0) {
-                        symbolIndex = k;
-                        break;
-                    }
-                }
-                
-                if (symbolIndex != -1) {
-                    // For each terminal in FIRST(firstSymbol)
-                    for (int k = 0; k < firstSets[symbolIndex].numElements; k++) {
-                        char* terminal = firstSets[symbolIndex].elements[k];
-                        
-                        // Skip epsilon
-                        if (strcmp(terminal, EPSILON) == 0) continue;
-                        
-                        // Add entry to the parsing table
-                        strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
-                        strcpy(table.entries[table.numEntries].terminal, terminal);
-                        strcpy(table.entries[table.numEntries].production, rhs);
-                        table.numEntries++;
-                    }
-                    
-                    // Check if FIRST(firstSymbol) contains epsilon
-                    bool hasEpsilon = false;
-                    for (int k = 0; k < firstSets[symbolIndex].numElements; k++) {
-                        if (strcmp(firstSets[symbolIndex].elements[k], EPSILON) == 0) {
-                            hasEpsilon = true;
-                            break;
-                        }
-                    }
-                    
-                    if (hasEpsilon) {
-                        // For each terminal in FOLLOW(LHS)
-                        for (int k = 0; k < followSets[ntIndex].numElements; k++) {
-                            char* terminal = followSets[ntIndex].elements[k];
-                            
-                            // Add entry to the parsing table
-                            strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
-                            strcpy(table.entries[table.numEntries].terminal, terminal);
-                            strcpy(table.entries[table.numEntries].production, rhs);
-                            table.numEntries++;
-                        }
-                    }
-                }
-            }
-            
-            if (firstSymbol != NULL) {
-                free(firstSymbol);
+        for (int i = 0; i < job->numGrammars; i++) {
+            GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromFile(job->grammarFiles[i]), job->numThreads);
+            if (analysis == NULL) {
+                printf("No productions read from %s, keeping the old version\n", job->grammarFiles[i]);
+            } else if (publishGrammar(job->registry, job->grammarFiles[i], analysis, job->compress) == -1) {
+                printf("Error compiling %s, keeping the old version\n", job->grammarFiles[i]);
+            } else {
+                printf("Reloaded %s\n", job->grammarFiles[i]);
             }
         }
+        synchronizeGrammars(job->registry);
+        fflush(stdout);
     }
-    
-    return table;
 }
-*/
-
-// Function to correctly read epsilon as a UTF-8 character
-
-
-ParseTable constructLL1Table(Grammar grammar, Set* firstSets, Set* followSets) {
-    ParseTable table;
-    table.numEntries = 0;
-    
-    // Copy terminals and non-terminals
-    table.numTerminals = grammar.numTerminals;
-    printf("Initializing parse table with %d terminals\n", grammar.numTerminals);
-    
-    for (int i = 0; i < grammar.numTerminals; i++) {
-        strcpy(table.terminals[i], grammar.terminals[i]);
-        printf("Terminal[%d]: %s\n", i, table.terminals[i]);
-    }
-    
-    // Add $ as a terminal
-    strcpy(table.terminals[table.numTerminals], "$");
-    printf("Added terminal: $\n");
-    table.numTerminals++;
-    
-    table.numNonTerminals = grammar.numNonTerminals;
-    printf("Initializing parse table with %d non-terminals\n", grammar.numNonTerminals);
-    
-    for (int i = 0; i < grammar.numNonTerminals; i++) {
-        strcpy(table.nonTerminals[i], grammar.nonTerminals[i]);
-        printf("Non-terminal[%d]: %s\n", i, table.nonTerminals[i]);
-    }
-    
-    // For each production
-    for (int i = 0; i < grammar.numProductions; i++) {
-        Production prod = grammar.productions[i];
-        printf("\nProcessing production: %s -> ...\n", prod.lhs);
-        
-        // Find the index of this non-terminal in firstSets
-        int ntIndex = -1;
-        for (int j = 0; j < grammar.numNonTerminals; j++) {
-            if (strcmp(firstSets[j].symbol, prod.lhs) == 0) {
-                ntIndex = j;
-                break;
-            }
-        }
-        
-        if (ntIndex == -1) {
-            printf("Error: Non-terminal %s not found in firstSets!\n", prod.lhs);
-            continue;
-        }
-        
-        // For each RHS
-        for (int j = 0; j < prod.numRHS; j++) {
-            char* rhs = prod.rhs[j];
-            printf("  Processing RHS: %s\n", rhs);
-            
-            // Get the first symbol of RHS
-              int pos = 0;
-             char* firstSymbol = getSymbol(rhs, &pos);
-            
-            if (strcmp(rhs, EPSILON) == 0) {
-             printf("RHS is epsilon...\n");
-              //pos += strlen(EPSILON); // Skip epsilon
-              firstSymbol = getSymbol1(rhs, &pos);
-              }           
-              else {
-                firstSymbol = getSymbol(rhs, &pos);
-                  } 
-            
-            //int pos = 0;
-            //char* firstSymbol = getSymbol(rhs, &pos);
-            printf("Extracted first symbol: '%s' from RHS: '%s'\n", firstSymbol ? firstSymbol : "NULL", rhs);
 
-            
-            
-            if (firstSymbol == NULL || strcmp(firstSymbol, EPSILON) == 0 || isTerminal(grammar, firstSymbol)) {
-                if (firstSymbol == NULL || strcmp(firstSymbol, EPSILON) == 0) {
-                    printf("  RHS is epsilon. Adding entries from FOLLOW(%s)\n", prod.lhs);
-                    
-                    // For each terminal in FOLLOW(LHS)
-                    for (int k = 0; k < followSets[ntIndex].numElements; k++) {
-                        char* terminal = followSets[ntIndex].elements[k];
-                        printf("    Adding table entry: [%s, %s] -> %s\n", prod.lhs, terminal, EPSILON);
-                        
-                        strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
-                        strcpy(table.entries[table.numEntries].terminal, terminal);
-                        strcpy(table.entries[table.numEntries].production, EPSILON);
-                        table.numEntries++;
-                    }
-                } else {
-                    printf("  RHS starts with terminal %s. Adding table entry.\n", firstSymbol);
-                    
-                    // Add entry to the parsing table
-                    strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
-                    strcpy(table.entries[table.numEntries].terminal, firstSymbol);
-                    strcpy(table.entries[table.numEntries].production, rhs);
-                    printf("    Added table entry: [%s, %s] -> %s\n", prod.lhs, firstSymbol, rhs);
-                    table.numEntries++;
-                }
-            } else if (isNonTerminal(grammar, firstSymbol)) {
-                printf("  RHS starts with non-terminal %s. Finding FIRST(%s)\n", firstSymbol, firstSymbol);
-                
-                // Find FIRST(firstSymbol)
-                int symbolIndex = -1;
-                for (int k = 0; k < grammar.numNonTerminals; k++) {
-                    if (strcmp(firstSets[k].symbol, firstSymbol) == 0) {
-                        symbolIndex = k;
-                        break;
-                    }
-                }
-                
-                if (symbolIndex != -1) {
-                    printf("  FIRST(%s) found. Adding entries.\n", firstSymbol);
-                    
-                    // For each terminal in FIRST(firstSymbol)
-                    for (int k = 0; k < firstSets[symbolIndex].numElements; k++) {
-                        char* terminal = firstSets[symbolIndex].elements[k];
-                        if (strcmp(terminal, EPSILON) == 0) continue;
-                        
-                        printf("    Adding table entry: [%s, %s] -> %s\n", prod.lhs, terminal, rhs);
-                        strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
-                        strcpy(table.entries[table.numEntries].terminal, terminal);
-                        strcpy(table.entries[table.numEntries].production, rhs);
-                        table.numEntries++;
-                    }
-                    
-                    // Check if FIRST(firstSymbol) contains epsilon
-                    bool hasEpsilon = false;
-                    for (int k = 0; k < firstSets[symbolIndex].numElements; k++) {
-                        if (strcmp(firstSets[symbolIndex].elements[k], EPSILON) == 0) {
-                            hasEpsilon = true;
-                            break;
-                        }
-                    }
-                    
-                    if (hasEpsilon) {
-                        printf("  FIRST(%s) contains epsilon. Adding FOLLOW(%s) entries.\n", firstSymbol, prod.lhs);
-                        
-                        // For each terminal in FOLLOW(LHS)
-                        for (int k = 0; k < followSets[ntIndex].numElements; k++) {
-                            char* terminal = followSets[ntIndex].elements[k];
-                            printf("    Adding table entry: [%s, %s] -> %s\n", prod.lhs, terminal, rhs);
-                            
-                            strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
-                            strcpy(table.entries[table.numEntries].terminal, terminal);
-                            strcpy(table.entries[table.numEntries].production, rhs);
-                            table.numEntries++;
-                        }
-                    }
-                }
-            }
-            
-            if (firstSymbol != NULL) {
-                free(firstSymbol);
-            }
-        }
-    }
-    
-    printf("\nParse table construction complete. Total entries: %d\n", table.numEntries);
-    return table;
+// Print how much the row-displacement encoding saves on the analyzed grammar's table
+void reportCompression(const GrammarAnalysis* analysis) {
+    CompiledTable* compiled = compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    if (compiled == NULL) return;
+    
+    size_t dense = denseTableBytes(compiled);
+    compressCompiledTable(compiled);
+    size_t compressed = compressedTableBytes(compiled);
+    printf("\nCompressed parse table: %zu bytes (dense %zu bytes, ratio %.2f, comb vector %d slots)\n",
+           compressed, dense, compressed > 0 ? (double)dense / compressed : 0.0, compiled->combSize);
+    freeCompiledTable(compiled);
 }
 
-// Display the FIRST sets
-void displayFirstSets(Set* firstSets, int numNonTerminals) {
-    for (int i = 0; i < numNonTerminals; i++) {
-        printf("FIRST(%s) = { ", firstSets[i].symbol);
-        for (int j = 0; j < firstSets[i].numElements; j++) {
-            printf("%s", firstSets[i].elements[j]);
-            if (j < firstSets[i].numElements - 1) {
-                printf(", ");
-            }
-        }
-        printf(" }\n");
+// Renumber an analyzed grammar's symbols and productions by the usage a profile file records, then
+// rebuild its sets and table in that order
+bool layOutByProfile(GrammarAnalysis* analysis, const char* profileFile) {
+    if (!orderGrammarByProfile(&analysis->simplified, &analysis->parseTable, profileFile)) {
+        printf("Error reading profile file: %s\n", profileFile);
+        return false;
     }
+    reanalyzeGrammar(analysis, 1);
+    return true;
 }
 
-// Display the FOLLOW sets
-void displayFollowSets(Set* followSets, int numNonTerminals) {
-    for (int i = 0; i < numNonTerminals; i++) {
-        printf("FOLLOW(%s) = { ", followSets[i].symbol);
-        for (int j = 0; j < followSets[i].numElements; j++) {
-            printf("%s", followSets[i].elements[j]);
-            if (j < followSets[i].numElements - 1) {
-                printf(", ");
-            }
-        }
-        printf(" }\n");
+char* readWholeFile(const char* path, long* length) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+    fseek(file, 0, SEEK_END);
+    *length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = (char*)malloc(*length + 1);
+    if (text != NULL && fread(text, 1, *length, file) != (size_t)*length) {
+        free(text);
+        text = NULL;
     }
+    fclose(file);
+    if (text != NULL) text[*length] = '\0';
+    return text;
 }
 
-// Display the parsing table
-void displayParseTable(ParseTable table) {
-    printf("%-10s | ", "");
-    for (int i = 0; i < table.numTerminals; i++) {
-        printf("%-10s | ", table.terminals[i]);
-    }
-    printf("\n");
-    
-    for (int i = 0; i < (table.numTerminals + 1) * 13; i++) {
-        printf("-");
-    }
-    printf("\n");
-    
-    for (int i = 0; i < table.numNonTerminals; i++) {
-        printf("%-10s | ", table.nonTerminals[i]);
-        
-        for (int j = 0; j < table.numTerminals; j++) {
-            bool found = false;
-            
-            for (int k = 0; k < table.numEntries; k++) {
-                if (strcmp(table.entries[k].nonTerminal, table.nonTerminals[i]) == 0 &&
-                    strcmp(table.entries[k].terminal, table.terminals[j]) == 0) {
-                    printf("%-10s | ", table.entries[k].production);
-                    found = true;
-                    break;
-                }
-            }
-            
-            if (!found) {
-                printf("%-10s | ", "");
-            }
-        }
-        
-        printf("\n");
-    }
+// Parse one input file with the grammar's table, analyzing the grammar on numThreads threads; pipelined,
+// the lexer runs on a thread of its own, with bytecode the table is compiled to bytecode first, and lazily it only builds the rows the
+// input reaches. With an entry, the input is parsed as a fragment derived from that non-terminal;
+// with a profile file, the table is laid out by it
+int parseDocument(const char* grammarFile, const char* inputFile, const char* entry, const char* profileFile,
+                  int numThreads, bool pipelined, bool compress, bool bytecode, bool lazy) {
+    CompiledTable* compiled;
+    if (lazy) {
+        Grammar read = readGrammarFromFile(grammarFile);
+        if (read.numProductions == 0) {
+            printf("No productions read from %s\n", grammarFile);
+            freeGrammar(&read);
+            return 1;
+        }
+        Grammar grammar = transformGrammar(read);
+        freeGrammar(&read);
+        if (grammar.numProductions == 0) {
+            freeGrammar(&grammar);
+            return 1;
+        }
+        if (profileFile != NULL && !orderGrammarByProfile(&grammar, NULL, profileFile)) {
+            printf("Error reading profile file: %s\n", profileFile);
+            freeGrammar(&grammar);
+            return 1;
+        }
+        compiled = compileLazyParseTable(&grammar);
+        freeGrammar(&grammar);
+    } else {
+        GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromFile(grammarFile), numThreads);
+        if (analysis == NULL) {
+            printf("No productions read from %s\n", grammarFile);
+            return 1;
+        }
+        if (profileFile != NULL && !layOutByProfile(analysis, profileFile)) {
+            freeGrammarAnalysis(analysis);
+            return 1;
+        }
+        compiled = compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+        freeGrammarAnalysis(analysis);
+    }
+    if (compiled == NULL) return 1;
+    int entryPoint = entry != NULL ? findEntryPoint(compiled, entry) : 0;
+    if (entryPoint == -1) {
+        printf("%s is not an entry symbol of %s\n", entry, grammarFile);
+        freeCompiledTable(compiled);
+        return 1;
+    }
+    if (compress) {
+        compressCompiledTable(compiled);
+    }
+    
+    long length;
+    char* input = readWholeFile(inputFile, &length);
+    if (input == NULL || length > 0x7FFFFFFF) {
+        printf("Error reading input file: %s\n", inputFile);
+        free(input);
+        freeCompiledTable(compiled);
+        return 1;
+    }
+    
+    BytecodeProgram* program = NULL;
+    if (bytecode) {
+        program = compileBytecode(compiled);
+        if (program == NULL) {
+            free(input);
+            freeCompiledTable(compiled);
+            return 1;
+        }
+    }
+    
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ParseResult result;
+    if (program != NULL) {
+        result = parseInputBytecodeFrom(program, entryPoint, input, (int)length);
+    } else if (lazy) {
+        result = parseInputLazy(compiled, entryPoint, input, (int)length);
+    } else if (entryPoint != 0) {
+        result = parseInputFrom(compiled, entryPoint, input, (int)length);
+    } else if (pipelined) {
+        result = parseInputPipelined(compiled, input, (int)length);
+    } else {
+        result = parseInput(compiled, input, (int)length);
+    }
+    double seconds = elapsedSeconds(start);
+    
+    if (result.accepted) {
+        printf("Accepted: %d tokens", result.numTokens);
+    } else {
+        printf("Rejected at offset %d after %d tokens", result.errorOffset, result.numTokens);
+    }
+    const char* mode = program != NULL ? ", bytecode" : entryPoint == 0 && pipelined ? ", pipelined" : "";
+    printf(" in %.3f s (%.1f MB/s%s%s)\n", seconds, seconds > 0 ? length / seconds / 1e6 : 0.0, mode,
+           entryPoint != 0 ? ", fragment" : "");
+    if (lazy) {
+        printf("Table rows built: %d of %d\n", builtTableRows(compiled), compiled->numNonTerminals);
+    }
+    
+    freeBytecode(program);
+    free(input);
+    freeCompiledTable(compiled);
+    return result.accepted ? 0 : 2;
 }
 
-// Split a string by a delimiter
-char** splitString(const char* str, const char* delimiter, int* count) {
-    char* copy = strdup(str);
-    *count = 0;
-    
-    // Count the number of tokens
-    char* tmp = copy;
-    char* token = strtok(tmp, delimiter);
-    while (token != NULL) {
-        (*count)++;
-        token = strtok(NULL, delimiter);
-    }
-    
-    // Allocate memory for the result
-    char** result = (char**)malloc((*count) * sizeof(char*));
-    
-    // Split the string
-    free(copy);
-    copy = strdup(str);
-    tmp = copy;
-    token = strtok(tmp, delimiter);
-    int i = 0;
-    while (token != NULL) {
-        result[i] = strdup(token);
-        i++;
-        token = strtok(NULL, delimiter);
-    }
-    
-    free(copy);
-    return result;
+// Parse every line of the messages file, once per message with parseInput, then in lockstep and
+// with the bytecode interpreter, and compare the time and the results. With a profile file, the
+// table is laid out by it
+int benchmarkMessages(const char* grammarFile, const char* messagesFile, const char* profileFile) {
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromFile(grammarFile), 1);
+    if (analysis == NULL) {
+        printf("No productions read from %s\n", grammarFile);
+        return 1;
+    }
+    if (profileFile != NULL && !layOutByProfile(analysis, profileFile)) {
+        freeGrammarAnalysis(analysis);
+        return 1;
+    }
+    CompiledTable* compiled = compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    freeGrammarAnalysis(analysis);
+    if (compiled == NULL) return 1;
+    
+    long length;
+    char* text = readWholeFile(messagesFile, &length);
+    if (text == NULL) {
+        printf("Error reading messages file: %s\n", messagesFile);
+        freeCompiledTable(compiled);
+        return 1;
+    }
+    
+    // One message per line
+    int count = 0;
+    for (long i = 0; i < length; i++) {
+        if (text[i] == '\n') count++;
+    }
+    count++;
+    const char** messages = malloc(count * sizeof(char*));
+    int* lengths = malloc(count * sizeof(int));
+    ParseResult* scalar = malloc(count * sizeof(ParseResult));
+    ParseResult* lockstep = malloc(count * sizeof(ParseResult));
+    ParseResult* bytecode = malloc(count * sizeof(ParseResult));
+    count = 0;
+    for (char* line = text; line < text + length;) {
+        char* end = memchr(line, '\n', text + length - line);
+        if (end == NULL) end = text + length;
+        messages[count] = line;
+        lengths[count++] = end - line;
+        line = end + 1;
+    }
+    
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        scalar[i] = parseInput(compiled, messages[i], lengths[i]);
+    }
+    double scalarSeconds = elapsedSeconds(start);
+    
+    LockstepTable* lanes = compileLockstepTable(compiled);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (lanes != NULL) {
+        parseInputsLockstep(lanes, messages, lengths, count, lockstep);
+    }
+    double lockstepSeconds = elapsedSeconds(start);
+    
+    BytecodeProgram* program = compileBytecode(compiled);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count && program != NULL; i++) {
+        bytecode[i] = parseInputBytecode(program, messages[i], lengths[i]);
+    }
+    double bytecodeSeconds = elapsedSeconds(start);
+    
+    int accepted = 0, mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        if (scalar[i].accepted) accepted++;
+        if (lanes != NULL && (scalar[i].accepted != lockstep[i].accepted ||
+                              scalar[i].errorOffset != lockstep[i].errorOffset ||
+                              scalar[i].numTokens != lockstep[i].numTokens)) {
+            mismatches++;
+        } else if (program != NULL && (scalar[i].accepted != bytecode[i].accepted ||
+                                       scalar[i].errorOffset != bytecode[i].errorOffset)) {
+            mismatches++;
+        }
+    }
+    printf("%d messages, %d accepted\n", count, accepted);
+    printf("One at a time: %.3f s (%.0f messages/s)\n", scalarSeconds, scalarSeconds > 0 ? count / scalarSeconds : 0.0);
+    if (lanes != NULL) {
+        printf("Lockstep x%d:   %.3f s (%.0f messages/s)\n", LOCKSTEP_LANES, lockstepSeconds,
+               lockstepSeconds > 0 ? count / lockstepSeconds : 0.0);
+    }
+    if (program != NULL) {
+        printf("Bytecode:      %.3f s (%.0f messages/s)\n", bytecodeSeconds,
+               bytecodeSeconds > 0 ? count / bytecodeSeconds : 0.0);
+    }
+    if (mismatches > 0) {
+        printf("Results differ on %d messages\n", mismatches);
+    }
+    
+    free(messages);
+    free(lengths);
+    free(scalar);
+    free(lockstep);
+    free(bytecode);
+    freeLockstepTable(lanes);
+    freeBytecode(program);
+    free(text);
+    freeCompiledTable(compiled);
+    return mismatches > 0 ? 1 : 0;
 }
 
-// Trim whitespace from a string
-char* trimString(char* str) {
-    char* result = strdup(str);
-    
-    // Trim leading whitespace
-    while (*result && isspace(*result)) {
-        result++;
-    }
-    
-    // Trim trailing whitespace
-    char* end = result + strlen(result) - 1;
-    while (end > result && isspace(*end)) {
-        *end = '\0';
-        end--;
+// Parse each input file with profiling, adding to the counts already in the profile file, then
+// print the report and write the file back
+int profileInputs(const char* grammarFile, const char* profileFile, char** inputFiles, int numInputs) {
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromFile(grammarFile), 1);
+    if (analysis == NULL) {
+        printf("No productions read from %s\n", grammarFile);
+        return 1;
+    }
+    CompiledTable* compiled = compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    freeGrammarAnalysis(analysis);
+    if (compiled == NULL) return 1;
+    ParseProfile* profile = createParseProfile(compiled);
+    if (profile == NULL) {
+        freeCompiledTable(compiled);
+        return 1;
+    }
+    readParseProfile(profileFile, compiled, profile);
+    
+    int status = 0;
+    for (int i = 0; i < numInputs; i++) {
+        long length;
+        char* input = readWholeFile(inputFiles[i], &length);
+        if (input == NULL || length > 0x7FFFFFFF) {
+            printf("Error reading input file: %s\n", inputFiles[i]);
+            free(input);
+            status = 1;
+            continue;
+        }
+        ParseResult result = parseInputProfile(compiled, input, (int)length, profile);
+        if (!result.accepted) {
+            printf("%s: rejected at offset %d\n", inputFiles[i], result.errorOffset);
+        }
+        free(input);
     }
     
-    return result;
+    writeProfileReport(stdout, compiled, profile);
+    if (!writeParseProfile(profileFile, compiled, profile)) status = 1;
+    freeParseProfile(profile);
+    freeCompiledTable(compiled);
+    return status;
 }
 
-// Free memory allocated for sets
-void freeSet(Set* set, int count) {
-    free(set);
-}
-
-// Write output to a file
-void writeOutputToFile(Grammar original, Grammar leftFactored, Grammar withoutLeftRecursion, 
-    Set* firstSets, Set* followSets, ParseTable parseTable, const char* filename)
-{
-    FILE* file = fopen(filename, "w");
-    
-    if (file == NULL) {
-        printf("Error opening file: %s\n", filename);
-        return;
+// Command-line front end:
+//   cc [-j threads] [-c] [grammar file] [output file]
+//   cc -b <list file | directory> [-o output directory] [-j threads]
+//   cc -d <socket path> [-c] <grammar file>...
+//   cc -p <input file> [-j threads] [[-t | -x] [-c] | -l] [-e entry symbol] [-P profile file] [grammar file]
+//   cc -m <messages file> [-P profile file] [grammar file]
+//   cc -P <profile file> <grammar file> <input file>...
+// -c uses the compressed (row displacement) table and reports its size; -x parses with bytecode;
+// -t lexes on a second thread, which has yet to show a speedup, so -j does not turn it on;
+// -l builds the table's rows lazily, as the input reaches them; -e parses the input as a fragment
+// derived from one of the grammar's %entry non-terminals; -P profiles the parses of the input files,
+// adding to the counts the profile file already holds, and with -p or -m numbers the grammar's symbols
+// and productions by that profile instead, hottest first
+int main(int argc, char* argv[]) {
+    const char* grammarFile = "g1.txt";
+    const char* outputFile = "output.txt";
+    const char* batchPath = NULL;
+    const char* socketPath = NULL;
+    const char* inputFile = NULL;
+    const char* messagesFile = NULL;
+    const char* entry = NULL;
+    const char* profileFile = NULL;
+    char* positional[256];
+    const char* outputDir = ".";
+    int numThreads = 1;
+    int numPositional = 0;
+    bool compress = false;
+    bool bytecode = false;
+    bool lazy = false;
+    bool pipelined = false;
+    
+    // -j N solves FIRST/FOLLOW and builds the table on N threads, or analyzes N grammars at once with -b
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (strcmp(argv[i], "-c") == 0) {
+            compress = true;
+        } else if (strcmp(argv[i], "-x") == 0) {
+            bytecode = true;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            lazy = true;
+        } else if (strcmp(argv[i], "-t") == 0) {
+            pipelined = true;
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            inputFile = argv[++i];
+        } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            messagesFile = argv[++i];
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            entry = argv[++i];
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            profileFile = argv[++i];
+        } else if (numPositional < 256) {
+            positional[numPositional++] = argv[i];
+        }
+    }
+    if (numThreads < 1) numThreads = 1;
+    if (numPositional > 0) grammarFile = positional[0];
+    if (numPositional > 1) outputFile = positional[1];
+    
+    if (batchPath != NULL) {
+        return runBatch(batchPath, outputDir, numThreads);
+    }
+    if (socketPath != NULL) {
+        if (numPositional == 0) {
+            printf("Usage: cc -d <socket path> <grammar file>...\n");
+            return 1;
+        }
+        return serveGrammars(socketPath, positional, numPositional, numThreads, compress);
+    }
+    if (inputFile != NULL) {
+        // The compressed table, the bytecode and the lexer thread's parser need every row up front
+        if (lazy && (compress || bytecode || pipelined)) {
+            printf("-l cannot be combined with -c, -x or -t\n");
+            return 1;
+        }
+        return parseDocument(grammarFile, inputFile, entry, profileFile, numThreads, pipelined, compress, bytecode, lazy);
+    }
+    if (messagesFile != NULL) {
+        return benchmarkMessages(grammarFile, messagesFile, profileFile);
+    }
+    if (profileFile != NULL) {
+        if (numPositional < 2) {
+            printf("Usage: cc -P <profile file> <grammar file> <input file>...\n");
+            return 1;
+        }
+        return profileInputs(grammarFile, profileFile, positional + 1, numPositional - 1);
+    }
+    
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromFile(grammarFile), numThreads);
+    if (analysis == NULL) {
+        printf("No productions read from %s\n", grammarFile);
+        return 1;
     }
-
-    printf("Debug: Writing to %s\n", filename); // Debug message
     
-    // Write original grammar
-    fprintf(file, "Original Grammar:\n");
-    for (int i = 0; i < original.numProductions; i++) {
-        Production prod = original.productions[i];
-        fprintf(file, "%s -> ", prod.lhs);
-        for (int j = 0; j < prod.numRHS; j++) {
-            fprintf(file, "%s", prod.rhs[j]);
-            if (j < prod.numRHS - 1) {
-                fprintf(file, " | ");
-            }
-        }
-        fprintf(file, "\n");
-    }
-
-    // Write left factored grammar
-    fprintf(file, "\nGrammar after Left Factoring:\n");
-    for (int i = 0; i < leftFactored.numProductions; i++) {
-        Production prod = leftFactored.productions[i];
-        fprintf(file, "%s -> ", prod.lhs);
-        for (int j = 0; j < prod.numRHS; j++) {
-            fprintf(file, "%s", prod.rhs[j]);
-            if (j < prod.numRHS - 1) {
-                fprintf(file, " | ");
-            }
-        }
-        fprintf(file, "\n");
-    }
+    printf("Original Grammar:\n");
+    displayGrammar(analysis->original);
     
-    // Write grammar without left recursion
-    fprintf(file, "\nGrammar after Left Recursion Removal:\n");
-    for (int i = 0; i < withoutLeftRecursion.numProductions; i++) {
-        Production prod = withoutLeftRecursion.productions[i];
-        fprintf(file, "%s -> ", prod.lhs);
-        for (int j = 0; j < prod.numRHS; j++) {
-            fprintf(file, "%s", prod.rhs[j]);
-            if (j < prod.numRHS - 1) {
-                fprintf(file, " | ");
-            }
-        }
-        fprintf(file, "\n");
-    }
+    printf("\nGrammar after Left Factoring:\n");
+    displayGrammar(analysis->leftFactored);
     
-    // Write FIRST sets
-    fprintf(file, "\nFIRST Sets:\n");
-    for (int i = 0; i < withoutLeftRecursion.numNonTerminals; i++) {
-        fprintf(file, "FIRST(%s) = { ", firstSets[i].symbol);
-        for (int j = 0; j < firstSets[i].numElements; j++) {
-            fprintf(file, "%s", firstSets[i].elements[j]);
-            if (j < firstSets[i].numElements - 1) {
-                fprintf(file, ", ");
-            }
-        }
-        fprintf(file, " }\n");
-    }
+    printf("\nGrammar after Left Recursion Removal:\n");
+    displayGrammar(analysis->withoutLeftRecursion);
     
-    // Write FOLLOW sets
-    fprintf(file, "\nFOLLOW Sets:\n");
-    for (int i = 0; i < withoutLeftRecursion.numNonTerminals; i++) {
-        fprintf(file, "FOLLOW(%s) = { ", followSets[i].symbol);
-        for (int j = 0; j < followSets[i].numElements; j++) {
-            fprintf(file, "%s", followSets[i].elements[j]);
-            if (j < followSets[i].numElements - 1) {
-                fprintf(file, ", ");
-            }
-        }
-        fprintf(file, " }\n");
-    }
+    printf("\nGrammar after Simplification:\n");
+    displayGrammar(analysis->simplified);
     
-    // Write LL(1) parsing table
-    fprintf(file, "\nLL(1) Parsing Table:\n");
+    printf("\nFIRST Sets:\n");
+    displayFirstSets(analysis->firstSets, analysis->simplified.numNonTerminals);
     
-    fprintf(file, "%-10s | ", "");
-    for (int i = 0; i < parseTable.numTerminals; i++) {
-        fprintf(file, "%-10s | ", parseTable.terminals[i]);
-    }
-    fprintf(file, "\n");
+    printf("\nFOLLOW Sets:\n");
+    displayFollowSets(analysis->followSets, analysis->simplified.numNonTerminals);
     
-    for (int i = 0; i < (parseTable.numTerminals + 1) * 13; i++) {
-        fprintf(file, "-");
+    printf("\nLL(1) Parsing Table:\n");
+    displayParseTable(analysis->parseTable);
+    if (compress) {
+        reportCompression(analysis);
     }
-    fprintf(file, "\n");
     
-    for (int i = 0; i < parseTable.numNonTerminals; i++) {
-        fprintf(file, "%-10s | ", parseTable.nonTerminals[i]);
-        
-        for (int j = 0; j < parseTable.numTerminals; j++) {
-            bool found = false;
-            
-            for (int k = 0; k < parseTable.numEntries; k++) {
-                if (strcmp(parseTable.entries[k].nonTerminal, parseTable.nonTerminals[i]) == 0 &&
-                    strcmp(parseTable.entries[k].terminal, parseTable.terminals[j]) == 0) {
-                    fprintf(file, "%-10s | ", parseTable.entries[k].production);
-                    found = true;
-                    break;
-                }
-            }
-            
-            if (!found) {
-                fprintf(file, "%-10s | ", "");
-            }
-        }
-        
-        fprintf(file, "\n");
-    }
+    // Write output to file
+    writeOutputToFile(analysis->original, analysis->leftFactored, analysis->withoutLeftRecursion,
+                      analysis->simplified, analysis->firstSets, analysis->followSets,
+                      analysis->parseTable, outputFile);
     
-    fclose(file);
+    freeGrammarAnalysis(analysis);
+    return 0;
 }
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "daemon.h"
+#include "incremental.h"
+
+// Buffered state of one client connection, in the daemon's list of open ones
+typedef struct Connection {
+    int fd;
+    char* in;            // Received bytes not yet handled
+    int inLength;
+    int inCapacity;
+    char* out;           // Responses not yet sent
+    int outLength;
+    int outSent;
+    int outCapacity;
+    uint32_t events;     // Events the connection is registered for
+    Document document;   // Opened with REQUEST_OPEN, changed by REQUEST_EDIT
+    bool hasDocument;
+    int documentGrammar;
+    int documentVersion; // Version of the grammar the document was parsed with
+    struct Connection* previous;
+    struct Connection* next;
+} Connection;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+// Function prototypes
+void handleStopSignal(int signal);
+int setNonBlocking(int fd);
+bool reserveBuffer(char** buffer, int* capacity, int needed);
+void closeConnection(int epollFd, Connection** connections, Connection* connection);
+bool appendResponse(Connection* connection, int status, uint32_t errorOffset);
+uint32_t readUint32(const unsigned char* bytes);
+bool isValidRequest(const Connection* connection, const unsigned char* payload, uint32_t length, int numGrammars);
+bool reopenDocument(Connection* connection, const GrammarVersion* grammar);
+ParseResult handleRequest(Connection* connection, const GrammarVersion* grammar, const char* payload, int length);
+bool handleFrames(Connection* connection, GrammarRegistry* registry, int reader);
+bool flushConnection(int epollFd, Connection* connection);
+bool readConnection(Connection* connection);
+
+void handleStopSignal(int signal) {
+    (void)signal;
+    stopRequested = 1;
+}
+
+int setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags == -1 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Grow a buffer so it holds at least needed bytes. False if out of memory, leaving it as it was
+bool reserveBuffer(char** buffer, int* capacity, int needed) {
+    if (needed <= *capacity) return true;
+    int newCapacity = *capacity > 0 ? *capacity : 4096;
+    while (newCapacity < needed) newCapacity *= 2;
+    char* grown = (char*)realloc(*buffer, newCapacity);
+    if (grown == NULL) return false;
+    *buffer = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+void closeConnection(int epollFd, Connection** connections, Connection* connection) {
+    if (connection->previous != NULL) {
+        connection->previous->next = connection->next;
+    } else {
+        *connections = connection->next;
+    }
+    if (connection->next != NULL) connection->next->previous = connection->previous;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+    close(connection->fd);
+    free(connection->in);
+    free(connection->out);
+    if (connection->hasDocument) closeDocument(&connection->document);
+    free(connection);
+}
+
+bool appendResponse(Connection* connection, int status, uint32_t errorOffset) {
+    unsigned char frame[9] = {0, 0, 0, 5, (unsigned char)status,
+                              (unsigned char)(errorOffset >> 24), (unsigned char)(errorOffset >> 16),
+                              (unsigned char)(errorOffset >> 8), (unsigned char)errorOffset};
+    if (!reserveBuffer(&connection->out, &connection->outCapacity, connection->outLength + (int)sizeof(frame))) {
+        return false;
+    }
+    memcpy(connection->out + connection->outLength, frame, sizeof(frame));
+    connection->outLength += sizeof(frame);
+    return true;
+}
+
+// Big-endian, as every integer on the wire
+uint32_t readUint32(const unsigned char* bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+bool isValidRequest(const Connection* connection, const unsigned char* payload, uint32_t length, int numGrammars) {
+    if (length < 2 || payload[1] >= numGrammars) return false;
+    if (payload[0] == REQUEST_PARSE || payload[0] == REQUEST_OPEN) return true;
+    if (payload[0] != REQUEST_EDIT || length < 10 || !connection->hasDocument) return false;
+    
+    uint32_t start = readUint32(payload + 2);
+    uint32_t removed = readUint32(payload + 6);
+    uint32_t documentLength = (uint32_t)connection->document.length;
+    return start <= documentLength && removed <= documentLength - start;
+}
+
+// Parse the connection's document from scratch with a grammar, replacing its old tree, which may
+// have been built with a version that is gone now. False if out of memory
+bool reopenDocument(Connection* connection, const GrammarVersion* grammar) {
+    Document document;
+    bool opened = openDocument(&document, grammar->compiled, connection->document.text, connection->document.length);
+    closeDocument(&connection->document);
+    connection->document = document;
+    connection->documentVersion = grammar->version;
+    connection->hasDocument = opened;
+    if (!opened) closeDocument(&connection->document);
+    return opened;
+}
+
+// Run one valid request. Edits reparse the connection's document incrementally, unless its
+// grammar has been republished since, in which case the document is parsed again first
+ParseResult handleRequest(Connection* connection, const GrammarVersion* grammar, const char* payload, int length) {
+    const unsigned char* bytes = (const unsigned char*)payload;
+    if (bytes[0] == REQUEST_OPEN) {
+        if (connection->hasDocument) closeDocument(&connection->document);
+        connection->hasDocument = openDocument(&connection->document, grammar->compiled, payload + 2, length - 2);
+        connection->documentGrammar = bytes[1];
+        connection->documentVersion = grammar->version;
+        if (!connection->hasDocument) {
+            closeDocument(&connection->document);
+            return (ParseResult){false, 0, 0};
+        }
+        return connection->document.result;
+    }
+    if (bytes[0] == REQUEST_EDIT) {
+        if (grammar->version != connection->documentVersion && !reopenDocument(connection, grammar)) {
+            return (ParseResult){false, 0, 0};
+        }
+        return editDocument(&connection->document, (int)readUint32(bytes + 2), (int)readUint32(bytes + 6),
+                            payload + 10, length - 10);
+    }
+    return parseInput(grammar->compiled, payload + 2, length - 2);
+}
+
+// Answer the complete frames in the input buffer, in order, until DAEMON_MAX_PENDING response bytes
+// are waiting to be sent. Returns true if it stopped there with frames left. A frame that is too
+// large, or running out of memory for a response, leaves inLength at -1 so the caller drops the connection
+bool handleFrames(Connection* connection, GrammarRegistry* registry, int reader) {
+    int numGrammars = atomic_load_explicit(&registry->numGrammars, memory_order_acquire);
+    int consumed = 0;
+    bool full = false;
+    
+    while (connection->inLength - consumed >= 4) {
+        uint32_t length = readUint32((const unsigned char*)connection->in + consumed);
+        if (length > DAEMON_MAX_FRAME) {
+            connection->inLength = -1;
+            return false;
+        }
+        if ((uint32_t)(connection->inLength - consumed - 4) < length) break;
+        if (connection->outLength - connection->outSent >= DAEMON_MAX_PENDING) {
+            full = true;
+            break;
+        }
+        
+        const char* payload = connection->in + consumed + 4;
+        bool appended;
+        if (!isValidRequest(connection, (const unsigned char*)payload, length, numGrammars)) {
+            appended = appendResponse(connection, RESPONSE_BAD_REQUEST, 0xFFFFFFFFu);
+        } else {
+            // Whatever version is current now stays allocated until the request is answered
+            int index = payload[0] == REQUEST_EDIT ? connection->documentGrammar : (unsigned char)payload[1];
+            beginGrammarRead(registry, reader);
+            ParseResult result = handleRequest(connection, readGrammar(registry, index), payload, (int)length);
+            endGrammarRead(registry, reader);
+            appended = appendResponse(connection, result.accepted ? RESPONSE_ACCEPTED : RESPONSE_REJECTED,
+                                      result.accepted ? 0xFFFFFFFFu : (uint32_t)result.errorOffset);
+        }
+        if (!appended) {
+            connection->inLength = -1;
+            return false;
+        }
+        consumed += 4 + length;
+    }
+    
+    memmove(connection->in, connection->in + consumed, connection->inLength - consumed);
+    connection->inLength -= consumed;
+    return full;
+}
+
+// Send pending responses; returns false if the connection failed
+bool flushConnection(int epollFd, Connection* connection) {
+    while (connection->outSent < connection->outLength) {
+        ssize_t sent = send(connection->fd, connection->out + connection->outSent,
+                            connection->outLength - connection->outSent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            break;
+        }
+        connection->outSent += sent;
+    }
+    
+    int pending = connection->outLength - connection->outSent;
+    if (pending == 0) {
+        connection->outLength = connection->outSent = 0;
+    }
+    
+    // Only wait for writability while something is queued, and stop reading while too much is
+    uint32_t events = (pending < DAEMON_MAX_PENDING ? EPOLLIN : 0) | (pending > 0 ? EPOLLOUT : 0);
+    if (events != connection->events) {
+        struct epoll_event event;
+        event.events = events;
+        event.data.ptr = connection;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->events = events;
+    }
+    return true;
+}
+
+// Read what is available, up to a buffer that holds the largest frame; returns false on end of
+// stream or error. Anything left is read on the next EPOLLIN
+bool readConnection(Connection* connection) {
+    while (connection->inLength < DAEMON_MAX_FRAME + 4) {
+        if (!reserveBuffer(&connection->in, &connection->inCapacity, connection->inLength + DAEMON_READ_CHUNK)) {
+            return false;
+        }
+        ssize_t received = read(connection->fd, connection->in + connection->inLength, DAEMON_READ_CHUNK);
+        if (received > 0) {
+            connection->inLength += received;
+            if (received < DAEMON_READ_CHUNK) return true;
+            continue;
+        }
+        if (received == 0) return false;
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    return true;
+}
+
+int runDaemon(const char* socketPath, GrammarRegistry* registry) {
+    int reader = registerGrammarReader(registry);
+    if (reader == -1) {
+        printf("No grammar reader slot left for the daemon\n");
+        return 1;
+    }
+    
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        printf("Socket path too long: %s\n", socketPath);
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath);
+    
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath);
+    if (listenFd < 0 || bind(listenFd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(listenFd, SOMAXCONN) < 0 || setNonBlocking(listenFd) < 0) {
+        printf("Error listening on %s: %s\n", socketPath, strerror(errno));
+        if (listenFd >= 0) close(listenFd);
+        return 1;
+    }
+    
+    int epollFd = epoll_create1(0);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;       // NULL marks the listening socket
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleStopSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    
+    printf("Serving %d grammar(s) on %s\n", atomic_load(&registry->numGrammars), socketPath);
+    fflush(stdout);
+    
+    struct epoll_event events[DAEMON_MAX_EVENTS];
+    Connection* connections = NULL;
+    while (!stopRequested) {
+        int numEvents = epoll_wait(epollFd, events, DAEMON_MAX_EVENTS, -1);
+        if (numEvents < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        
+        for (int i = 0; i < numEvents; i++) {
+            Connection* connection = (Connection*)events[i].data.ptr;
+            
+            if (connection == NULL) {
+                int fd;
+                while ((fd = accept(listenFd, NULL, NULL)) >= 0) {
+                    setNonBlocking(fd);
+                    connection = (Connection*)calloc(1, sizeof(Connection));
+                    if (connection == NULL) {
+                        close(fd);
+                        continue;
+                    }
+                    connection->fd = fd;
+                    connection->events = EPOLLIN;
+                    connection->next = connections;
+                    if (connections != NULL) connections->previous = connection;
+                    connections = connection;
+                    event.events = EPOLLIN;
+                    event.data.ptr = connection;
+                    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+                }
+                continue;
+            }
+            
+            // Answer whatever arrived, even if the client has already shut down its side. Frames
+            // held back while the output was full are answered as it drains
+            bool open = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                open = readConnection(connection);
+            }
+            bool more = true;
+            while (more) {
+                more = handleFrames(connection, registry, reader);
+                if (connection->inLength < 0) {
+                    connection->inLength = 0;
+                    open = false;
+                    more = false;
+                }
+                if (!flushConnection(epollFd, connection)) {
+                    open = false;
+                    more = false;
+                }
+                if (connection->outLength - connection->outSent >= DAEMON_MAX_PENDING) more = false;
+            }
+            if (!open) {
+                closeConnection(epollFd, &connections, connection);
+            }
+        }
+    }
+    
+    while (connections != NULL) {
+        closeConnection(epollFd, &connections, connections);
+    }
+    close(epollFd);
+    close(listenFd);
+    unlink(socketPath);
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "registry.h"
+
+#define DAEMON_MAX_EVENTS 64         // Events handled per epoll_wait
+#define DAEMON_MAX_FRAME (1 << 20)   // Largest request payload accepted
+#define DAEMON_READ_CHUNK 65536      // Bytes read per read() call
+#define DAEMON_MAX_PENDING (1 << 20) // Unsent response bytes at which a connection stops being read
+
+// Wire protocol. Every message is a frame: a 4-byte big-endian payload length, then the payload.
+// Request payload:  u8 opcode, u8 grammar index, then by opcode
+//   REQUEST_PARSE:  input bytes
+//   REQUEST_OPEN:   document bytes, kept as the connection's document (replacing any before it)
+//   REQUEST_EDIT:   u32 start, u32 bytes removed, bytes inserted; applied to the connection's
+//                   document, which is reparsed incrementally (the grammar index is not used).
+//                   A document whose grammar was republished is parsed again with the new version
+// Response payload: u8 status, u32 big-endian byte offset of the error (0xFFFFFFFF if accepted)
+// Requests may be pipelined; responses come back in request order on the same connection. A client
+// that does not read its responses is not read from either once DAEMON_MAX_PENDING bytes are queued
+enum {
+    REQUEST_PARSE = 1,
+    REQUEST_OPEN = 2,
+    REQUEST_EDIT = 3
+};
+
+enum {
+    RESPONSE_ACCEPTED = 0,
+    RESPONSE_REJECTED = 1,
+    RESPONSE_BAD_REQUEST = 2
+};
+
+// Serve parse requests for the registry's grammars on a Unix domain socket until SIGINT/SIGTERM.
+// Grammar index i is the registry's index i. Each request parses with the version current when it
+// is handled, so grammars can be republished from another thread while the daemon runs.
+// Connections still open at shutdown are closed. Returns 0 on a clean shutdown
+int runDaemon(const char* socketPath, GrammarRegistry* registry);
+
+#endif
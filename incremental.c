@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "incremental.h"
+
+// An entry of the parse stack; symbol -1 marks where the node's subtree ends
+typedef struct {
+    int symbol;
+    int node;
+    int firstToken;
+} DocumentFrame;
+
+// A path from the old root down to the last node looked at. Reuse queries come in token order,
+// so the cursor only moves forward through the old tree
+typedef struct {
+    int node;
+    int start;                   // Index of the node's first token
+} CursorFrame;
+
+typedef struct {
+    CursorFrame* frames;
+    int depth;
+    int capacity;
+} ReuseCursor;
+
+// Function prototypes
+bool reserveArray(void** array, int* capacity, int needed, size_t size);
+int allocateDocumentNodes(Document* document, int count);
+bool lexDocument(Document* document);
+void moveTokenGap(Document* document, int index);
+bool reserveTokenGap(Document* document, int needed);
+TokenDamage composeDamage(const TokenDamage* first, const TokenDamage* then);
+bool isReusable(int start, int numTokens, const TokenDamage* damage);
+int findReusable(ReuseCursor* cursor, const Document* document, int symbol, int token, const TokenDamage* damage);
+int resumeParse(Document* document, int oldRoot, int last, DocumentFrame** frames, int* capacity, int* top,
+                ReuseCursor* cursor);
+bool parseDocumentTokens(Document* document, int oldRoot, const TokenDamage* damage);
+void compactDocument(Document* document);
+
+// Grow an array to hold at least needed elements
+bool reserveArray(void** array, int* capacity, int needed, size_t size) {
+    if (needed <= *capacity) return true;
+    int newCapacity = *capacity > 0 ? *capacity : 256;
+    while (newCapacity < needed) newCapacity *= 2;
+    void* grown = realloc(*array, newCapacity * size);
+    if (grown == NULL) return false;
+    *array = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+// Index of count new consecutive nodes, -1 if out of memory
+int allocateDocumentNodes(Document* document, int count) {
+    if (!reserveArray((void**)&document->nodes, &document->nodeCapacity, document->numNodes + count,
+                      sizeof(DocumentNode))) {
+        return -1;
+    }
+    int first = document->numNodes;
+    document->numNodes += count;
+    return first;
+}
+
+bool lexDocument(Document* document) {
+    document->numTokens = 0;
+    document->gapStart = 0;
+    int pos = 0;
+    while (true) {
+        if (!reserveArray((void**)&document->tokens, &document->tokenCapacity, document->numTokens + 1,
+                          sizeof(DocumentToken))) {
+            return false;
+        }
+        DocumentToken* token = &document->tokens[document->numTokens++];
+        token->terminal = nextToken(document->compiled, document->text, document->length, &pos, &token->offset);
+        token->end = pos;
+        document->gapStart = document->numTokens;
+        if (token->terminal == document->compiled->endMarker) return true;
+    }
+}
+
+// Move the gap in front of token index, converting the offsets of the tokens it passes over
+void moveTokenGap(Document* document, int index) {
+    DocumentToken* tokens = document->tokens;
+    int gap = document->tokenCapacity - document->numTokens;
+    int gapStart = document->gapStart;
+    int length = document->length;
+    if (index < gapStart) {
+        memmove(tokens + index + gap, tokens + index, (gapStart - index) * sizeof(DocumentToken));
+        for (int i = index + gap; i < gapStart + gap; i++) {
+            tokens[i].offset -= length;
+            tokens[i].end -= length;
+        }
+    } else if (index > gapStart) {
+        memmove(tokens + gapStart, tokens + gapStart + gap, (index - gapStart) * sizeof(DocumentToken));
+        for (int i = gapStart; i < index; i++) {
+            tokens[i].offset += length;
+            tokens[i].end += length;
+        }
+    }
+    document->gapStart = index;
+}
+
+// Grow the gap to hold at least needed tokens, keeping the tokens after it at the end
+bool reserveTokenGap(Document* document, int needed) {
+    int after = document->numTokens - document->gapStart;
+    int oldCapacity = document->tokenCapacity;
+    if (!reserveArray((void**)&document->tokens, &document->tokenCapacity, document->numTokens + needed,
+                      sizeof(DocumentToken))) {
+        return false;
+    }
+    memmove(document->tokens + document->tokenCapacity - after, document->tokens + oldCapacity - after,
+            after * sizeof(DocumentToken));
+    return true;
+}
+
+// The damage of one edit followed by another: a token is unchanged if neither edit touched it
+TokenDamage composeDamage(const TokenDamage* first, const TokenDamage* then) {
+    TokenDamage damage;
+    damage.prefixEnd = first->prefixEnd < then->prefixEnd ? first->prefixEnd : then->prefixEnd;
+    damage.oldSuffix = then->oldSuffix - first->shift > first->oldSuffix ? then->oldSuffix - first->shift : first->oldSuffix;
+    damage.shift = first->shift + then->shift;
+    return damage;
+}
+
+// An old subtree parses the same way again if its tokens and its lookahead are all unchanged
+bool isReusable(int start, int numTokens, const TokenDamage* damage) {
+    return start + numTokens < damage->prefixEnd || start >= damage->oldSuffix;
+}
+
+// The old node for symbol at new token index token, if it can be reused, otherwise -1
+int findReusable(ReuseCursor* cursor, const Document* document, int symbol, int token, const TokenDamage* damage) {
+    int old;
+    if (token < damage->prefixEnd) {
+        old = token;
+    } else if (token - damage->shift >= damage->oldSuffix) {
+        old = token - damage->shift;
+    } else {
+        return -1;
+    }
+    const DocumentNode* nodes = document->nodes;
+    
+    // Climb to the nearest node around the old position; ε nodes hold nothing to descend into
+    while (cursor->depth > 0) {
+        const CursorFrame* top = &cursor->frames[cursor->depth - 1];
+        int size = nodes[top->node].numTokens;
+        if (size > 0 && top->start <= old && old < top->start + size) break;
+        cursor->depth--;
+    }
+    if (cursor->depth == 0) return -1;
+    
+    // Then descend to a node for the symbol starting there
+    while (true) {
+        const CursorFrame* top = &cursor->frames[cursor->depth - 1];
+        const DocumentNode* node = &nodes[top->node];
+        if (top->start == old && node->symbol == symbol) {
+            return isReusable(top->start, node->numTokens, damage) ? top->node : -1;
+        }
+        
+        int child = node->firstChild;
+        int start = top->start;
+        while (child != -1) {
+            int size = nodes[child].numTokens;
+            if (size == 0 ? start == old && nodes[child].symbol == symbol : old < start + size) break;
+            start += size;
+            child = nodes[child].nextSibling;
+        }
+        if (child == -1) return -1;
+        
+        if (!reserveArray((void**)&cursor->frames, &cursor->capacity, cursor->depth + 1, sizeof(CursorFrame))) {
+            return -1;
+        }
+        cursor->frames[cursor->depth++] = (CursorFrame){child, start};
+    }
+}
+
+// Rebuild the parse stack as it stood once the old parse had matched token last, which the edit
+// left in place along with every token before it. The path from the root down to that token is
+// copied, sharing the subtrees left of it; the right siblings along the path go on the stack to
+// be parsed again, and the cursor is left on the old path. The new root, or -1 if out of memory
+int resumeParse(Document* document, int oldRoot, int last, DocumentFrame** frames, int* capacity, int* top,
+                ReuseCursor* cursor) {
+    int root = allocateDocumentNodes(document, 1);
+    if (root == -1) return -1;
+    document->nodes[root] = document->nodes[oldRoot];
+    
+    int node = root;
+    int start = 0;
+    while (document->nodes[node].production != -1) {
+        int count = 0;
+        for (int child = document->nodes[node].firstChild; child != -1; child = document->nodes[child].nextSibling) {
+            count++;
+        }
+        int first = allocateDocumentNodes(document, count);
+        if (first == -1 || !reserveArray((void**)frames, capacity, *top + count + 1, sizeof(DocumentFrame)) ||
+            !reserveArray((void**)&cursor->frames, &cursor->capacity, cursor->depth + 1, sizeof(CursorFrame))) {
+            return -1;
+        }
+        
+        DocumentNode* nodes = document->nodes;
+        int child = nodes[node].firstChild;
+        nodes[node].firstChild = first;
+        (*frames)[(*top)++] = (DocumentFrame){-1, node, start};
+        int path = -1;
+        int childStart = start;
+        for (int i = 0; i < count; i++) {
+            nodes[first + i] = nodes[child];
+            nodes[first + i].nextSibling = i + 1 < count ? first + i + 1 : -1;
+            if (path == -1 && last < childStart + nodes[child].numTokens) {
+                path = first + i;
+                start = childStart;
+                cursor->frames[cursor->depth++] = (CursorFrame){child, childStart};
+            } else if (path == -1) {
+                document->reusedSubtrees++;
+            } else {
+                nodes[first + i].production = -1;
+                nodes[first + i].firstChild = -1;
+                nodes[first + i].numTokens = 0;
+            }
+            childStart += nodes[child].numTokens;
+            child = nodes[child].nextSibling;
+        }
+        for (int i = first + count - 1; i > path; i--) {
+            (*frames)[(*top)++] = (DocumentFrame){nodes[i].symbol, i, 0};
+        }
+        node = path;
+    }
+    return root;
+}
+
+// Parse the token array into a new tree. Wherever a non-terminal is about to be expanded, an old
+// node for it that isReusable is taken over instead: the new node copies its production and
+// children, and the parse skips its tokens. Contested cells are decided by predictProduction; as
+// a decision looks up to MAX_LOOKAHEAD tokens ahead, that many tokens before the edit count as
+// changed too
+bool parseDocumentTokens(Document* document, int oldRoot, const TokenDamage* edit) {
+    const CompiledTable* compiled = document->compiled;
+    const int numTerminals = compiled->numTerminals;
+    TokenDamage lookahead = *edit;
+    if (compiled->numDecisions > 0) {
+        lookahead.prefixEnd = lookahead.prefixEnd > MAX_LOOKAHEAD - 1 ? lookahead.prefixEnd - (MAX_LOOKAHEAD - 1) : 0;
+    }
+    const TokenDamage* damage = &lookahead;
+    DocumentFrame* frames = NULL;
+    int capacity = 0;
+    int top = 0;
+    ReuseCursor cursor = {NULL, 0, 0};
+    
+    document->result = (ParseResult){false, -1, 1};
+    document->reusedSubtrees = 0;
+    int root = -1;
+    int k = 0;
+    if (oldRoot != -1 && reserveArray((void**)&cursor.frames, &cursor.capacity, 1, sizeof(CursorFrame))) {
+        cursor.frames[cursor.depth++] = (CursorFrame){oldRoot, 0};
+    }
+    if (reserveArray((void**)&frames, &capacity, 2, sizeof(DocumentFrame))) {
+        frames[top++] = (DocumentFrame){compiled->endMarker, -1, 0};
+        if (cursor.depth > 0 && damage->prefixEnd > 0) {
+            // Everything up to the last unchanged token parses as before
+            root = resumeParse(document, oldRoot, damage->prefixEnd - 1, &frames, &capacity, &top, &cursor);
+            k = damage->prefixEnd;
+        } else if ((root = allocateDocumentNodes(document, 1)) != -1) {
+            document->nodes[root] = (DocumentNode){compiled->startSymbol, -1, -1, -1, 0};
+            frames[top++] = (DocumentFrame){compiled->startSymbol, root, 0};
+        }
+    }
+    bool ok = root != -1;
+    
+    while (ok && top > 0) {
+        DocumentFrame frame = frames[--top];
+        int token = documentToken(document, k).terminal;
+        
+        if (frame.symbol == -1) {
+            document->nodes[frame.node].numTokens = k - frame.firstToken;
+            continue;
+        }
+        
+        if (frame.symbol < numTerminals) {
+            if (frame.symbol != token) {
+                ok = false;
+            } else if (token == compiled->endMarker) {
+                document->result.accepted = true;
+                break;
+            } else {
+                document->nodes[frame.node].numTokens = 1;
+                k++;
+            }
+            continue;
+        }
+        
+        int old = cursor.depth > 0 ? findReusable(&cursor, document, frame.symbol, k, damage) : -1;
+        if (old != -1) {
+            DocumentNode* node = &document->nodes[frame.node];
+            node->production = document->nodes[old].production;
+            node->firstChild = document->nodes[old].firstChild;
+            node->numTokens = document->nodes[old].numTokens;
+            k += node->numTokens;
+            document->reusedSubtrees++;
+            continue;
+        }
+        
+        int p = token >= 0 ? tableCell(compiled, frame.symbol - numTerminals, token) : -1;
+        if (p < 0) {
+            ok = false;
+            continue;
+        }
+        if (compiled->contested[p]) {
+            int d = findDecision(compiled, frame.symbol - numTerminals, token);
+            if (d != -1) {
+                p = predictProduction(compiled, d, document->text, document->length, documentToken(document, k).end, token);
+            }
+        }
+        int n = compiled->productionLength[p];
+        int first = n > 0 ? allocateDocumentNodes(document, n) : -1;
+        if ((n > 0 && first == -1) || !reserveArray((void**)&frames, &capacity, top + n + 1, sizeof(DocumentFrame))) {
+            ok = false;
+            continue;
+        }
+        
+        const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+        document->nodes[frame.node].production = p;
+        document->nodes[frame.node].firstChild = first;
+        frames[top++] = (DocumentFrame){-1, frame.node, k};
+        for (int i = n - 1; i >= 0; i--) {
+            document->nodes[first + i] = (DocumentNode){rhs[i], -1, -1, i + 1 < n ? first + i + 1 : -1, 0};
+            frames[top++] = (DocumentFrame){rhs[i], first + i, k};
+        }
+    }
+    
+    document->result.numTokens = k + 1;
+    if (document->result.accepted) {
+        document->root = root;
+        document->base = root;
+        document->baseDamage = (TokenDamage){INT_MAX, 0, 0};
+    } else {
+        // The base tree stays what the next edit reuses; the nodes of this parse are garbage
+        document->result.errorOffset = documentToken(document, k).offset;
+        document->root = -1;
+    }
+    free(frames);
+    free(cursor.frames);
+    return document->result.accepted;
+}
+
+// Copy the base tree to a fresh array, breadth first, dropping nodes no edit reaches any more
+void compactDocument(Document* document) {
+    DocumentNode* nodes = malloc(document->numNodes * sizeof(DocumentNode));
+    if (nodes == NULL) return;
+    
+    nodes[0] = document->nodes[document->base];
+    int count = 1;
+    for (int i = 0; i < count; i++) {
+        int child = nodes[i].firstChild;
+        if (child == -1) continue;
+        nodes[i].firstChild = count;
+        while (child != -1) {
+            int next = document->nodes[child].nextSibling;
+            nodes[count] = document->nodes[child];
+            nodes[count].nextSibling = next != -1 ? count + 1 : -1;
+            count++;
+            child = next;
+        }
+    }
+    
+    free(document->nodes);
+    document->nodes = nodes;
+    document->nodeCapacity = document->numNodes;
+    document->numNodes = count;
+    document->liveNodes = count;
+    document->root = document->root == document->base ? 0 : -1;
+    document->base = 0;
+}
+
+bool openDocument(Document* document, const CompiledTable* compiled, const char* text, int length) {
+    memset(document, 0, sizeof(Document));
+    document->compiled = compiled;
+    document->root = -1;
+    document->base = -1;
+    if (!reserveArray((void**)&document->text, &document->textCapacity, length + 1, 1)) return false;
+    memcpy(document->text, text, length);
+    document->text[length] = '\0';
+    document->length = length;
+    if (!lexDocument(document)) return false;
+    document->relexedTokens = document->numTokens;
+    
+    TokenDamage damage = {0, INT_MAX, 0};
+    parseDocumentTokens(document, -1, &damage);
+    document->liveNodes = document->numNodes;
+    return true;
+}
+
+ParseResult editDocument(Document* document, int start, int removed, const char* insert, int inserted) {
+    const CompiledTable* compiled = document->compiled;
+    if (start < 0) start = 0;
+    if (start > document->length) start = document->length;
+    if (removed < 0) removed = 0;
+    if (removed > document->length - start) removed = document->length - start;
+    int delta = inserted - removed;
+    
+    // Relex from the token before the first one reaching the edit: a word next to the edit may
+    // merge with it or stop spelling a keyword
+    int low = 0, high = document->numTokens - 1;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (documentToken(document, mid).end < start) low = mid + 1; else high = mid;
+    }
+    int first = low > 0 ? low - 1 : 0;
+    int pos = first > 0 ? documentToken(document, first - 1).end : 0;
+    
+    if (!reserveArray((void**)&document->text, &document->textCapacity, document->length + delta + 1, 1)) {
+        return document->result;
+    }
+    // Tokens from first on count from the end of the text, which the edit does not move
+    moveTokenGap(document, first);
+    memmove(document->text + start + inserted, document->text + start + removed, document->length - start - removed);
+    memcpy(document->text + start, insert, inserted);
+    document->length += delta;
+    document->text[document->length] = '\0';
+    
+    // Lex until a token starts past the edit, with the byte before it unchanged too, at the
+    // shifted offset of an old token; from there on the old tokens are what lexing would give
+    DocumentToken* fresh = NULL;
+    int numFresh = 0, freshCapacity = 0;
+    int old = first;
+    while (true) {
+        int offset;
+        int terminal = nextToken(compiled, document->text, document->length, &pos, &offset);
+        if (offset > start + inserted) {
+            while (old < document->numTokens && documentToken(document, old).offset < offset) old++;
+            if (old < document->numTokens && documentToken(document, old).offset == offset) break;
+        }
+        if (!reserveArray((void**)&fresh, &freshCapacity, numFresh + 1, sizeof(DocumentToken))) {
+            free(fresh);
+            document->root = -1;
+            document->base = -1;
+            lexDocument(document);
+            return document->result = (ParseResult){false, -1, 0};
+        }
+        fresh[numFresh++] = (DocumentToken){terminal, offset, pos};
+        if (terminal == compiled->endMarker) {
+            old = document->numTokens;
+            break;
+        }
+    }
+    
+    // Splice the relexed tokens into the gap in place of the old ones between first and old
+    if (!reserveTokenGap(document, numFresh)) {
+        free(fresh);
+        document->root = -1;
+        document->base = -1;
+        lexDocument(document);
+        return document->result = (ParseResult){false, -1, 0};
+    }
+    document->numTokens -= old - first;
+    if (numFresh > 0) memcpy(document->tokens + first, fresh, numFresh * sizeof(DocumentToken));
+    document->gapStart += numFresh;
+    document->numTokens += numFresh;
+    document->relexedTokens = numFresh;
+    free(fresh);
+    
+    // Reparse against the base tree, with the damage of every edit since it parsed
+    TokenDamage damage = {first, old, first + numFresh - old};
+    int base = document->base;
+    if (base == -1) {
+        document->numNodes = 0;
+    } else {
+        document->baseDamage = composeDamage(&document->baseDamage, &damage);
+    }
+    parseDocumentTokens(document, base, base == -1 ? &damage : &document->baseDamage);
+    if (base == -1) {
+        document->liveNodes = document->numNodes;
+    } else if (document->numNodes > 2 * document->liveNodes + 1024) {
+        compactDocument(document);
+    }
+    return document->result;
+}
+
+void closeDocument(Document* document) {
+    free(document->text);
+    free(document->tokens);
+    free(document->nodes);
+    memset(document, 0, sizeof(Document));
+    document->root = -1;
+    document->base = -1;
+}
@@ -0,0 +1,76 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "parser.h"
+
+// A node of a document's tree. Nodes record how many tokens they cover instead of where they
+// start, so a subtree reused after an edit elsewhere needs no updating: a node's first token is
+// the sum of the sizes of everything before it in a walk from the root
+typedef struct {
+    int symbol;                  // Stack symbol: a terminal, or numTerminals + non-terminal
+    int production;              // -1 for a token
+    int firstChild;
+    int nextSibling;
+    int numTokens;               // 1 for a token, 0 for an ε expansion
+} DocumentNode;
+
+typedef struct {
+    int terminal;                // -1 for a byte no terminal is spelled with
+    int offset;
+    int end;
+} DocumentToken;
+
+// Where a document's tokens changed: tokens before prefixEnd kept their index, tokens from
+// oldSuffix on moved to index + shift, and the ones in between were replaced
+typedef struct {
+    int prefixEnd;
+    int oldSuffix;
+    int shift;
+} TokenDamage;
+
+// A document kept parsed across edits. The tree's nodes share one array; an edit adds new nodes
+// for the part it reparses, and the array is compacted when too many are unreachable
+typedef struct {
+    const CompiledTable* compiled;
+    char* text;
+    int length;
+    int textCapacity;
+    DocumentToken* tokens;       // A gap buffer ending with $ at offset length; see documentToken
+    int numTokens;
+    int tokenCapacity;
+    int gapStart;                // Index of the first token stored after the gap
+    DocumentNode* nodes;
+    int numNodes;
+    int nodeCapacity;
+    int liveNodes;               // Size of the tree after the last full parse or compaction
+    int root;                    // -1 while the text does not parse
+    int base;                    // The last tree that parsed, which edits reuse subtrees of; -1 if none
+    TokenDamage baseDamage;      // How the tokens changed since base was parsed
+    ParseResult result;
+    int reusedSubtrees;          // Subtrees the last parse took over from the previous tree
+    int relexedTokens;           // Tokens the last edit lexed
+} Document;
+
+// Token index of a document. Tokens from gapStart on sit at the end of the array with their
+// offsets counted from the end of the text, so an edit only moves the tokens between the gap and
+// itself, and none after it
+static inline DocumentToken documentToken(const Document* document, int index) {
+    if (index < document->gapStart) return document->tokens[index];
+    DocumentToken token = document->tokens[index + document->tokenCapacity - document->numTokens];
+    token.offset += document->length;
+    token.end += document->length;
+    return token;
+}
+
+// Lex and parse a whole text. False if out of memory
+bool openDocument(Document* document, const CompiledTable* compiled, const char* text, int length);
+
+// Replace removed bytes at start with inserted bytes from insert, then relex from the token
+// before the edit until the tokens line up with the old ones again, and reparse reusing every
+// old subtree whose tokens, and the lookahead token after them, lie outside the relexed span.
+// Subtrees are reused from the last tree that parsed, however many edits ago
+ParseResult editDocument(Document* document, int start, int removed, const char* insert, int inserted);
+
+void closeDocument(Document* document);
+
+#endif
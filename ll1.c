@@ -0,0 +1,3119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "ll1.h"
+#include "phash.h"
+#include "scan.h"
+
+// Define LL1_DEBUG to trace grammar loading and table construction on stdout
+#ifdef LL1_DEBUG
+#define debugPrintf(...) printf(__VA_ARGS__)
+#else
+#define debugPrintf(...) ((void)0)
+#endif
+
+// One row of the parsing table, built independently of the others. Its cells are written straight
+// into the table, numbered within the row until the rows are merged
+typedef struct {
+    ParseTableEntry* entries;
+    int numEntries;
+    int entryCapacity;
+    TableConflict* conflicts;
+    int numConflicts;                  // May exceed MAX_CONFLICTS; only the first ones are kept
+    int conflictCapacity;
+} TableRow;
+
+// A grammar's alternatives as symbol numbers, for solving the FIRST and FOLLOW equations on bitsets.
+// Terminal t is symbol t and non-terminal n is symbol numTerminals + n; in a set, bit t stands for
+// terminal t and the two bits after the terminals for $ and ε
+typedef struct {
+    int numTerminals;
+    int numNonTerminals;
+    int words;                         // 64-bit words per set
+    int numAlternatives;               // Every alternative, in production order
+    int* lhs;                          // Non-terminal of each alternative, -1 if its left-hand side is not one
+    const char** text;                 // Each alternative as written
+    int* symbolStart;                  // Symbols of alternative a: symbols[symbolStart[a]] .. symbols[symbolStart[a + 1] - 1]
+    int* symbols;                      // -1 for a symbol the grammar does not list
+    int* alternativeStart;             // Alternatives of non-terminal n: byLhs[alternativeStart[n]] .. byLhs[alternativeStart[n + 1] - 1]
+    int* byLhs;
+    bool* nullable;
+    const Grammar* grammar;            // Symbol names are looked up in its hashes
+} EncodedGrammar;
+
+// What one set includes besides its own elements: node v's set includes the sets of
+// edges[edgeStart[v]] .. edges[edgeStart[v + 1] - 1]
+typedef struct {
+    int numNodes;
+    int* edgeStart;
+    int* edges;
+} DependencyGraph;
+
+// The strongly connected components of a dependency graph, in the order Tarjan's algorithm emits
+// them (each after every component it reads from), plus the state shared by the worker threads
+typedef struct {
+    const DependencyGraph* graph;
+    uint64_t* sets;                    // One per node, words long, solved in place
+    int words;
+    int numComponents;
+    int* componentOf;
+    int* memberStart;                  // Members of component c: members[memberStart[c]] .. members[memberStart[c + 1] - 1]
+    int* members;
+    int* dependentStart;               // Components that read component c's sets, likewise
+    int* dependents;
+    int* pending;                      // Components each one still waits for
+    int* ready;                        // Queue of components whose dependencies are done
+    int readyHead;
+    int readyTail;
+    int numDone;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} SccSchedule;
+
+// The productions of each non-terminal: those of n are production[start[n]] .. production[start[n + 1] - 1]
+typedef struct {
+    int* start;
+    int* production;
+} ProductionIndex;
+
+#define EBNF_MAX_SPREAD 8    // Most alternatives one EBNF sequence is distributed into
+
+// Reads the right-hand side of an EBNF rule ("A ::= ..."), turning it into plain alternatives
+typedef struct {
+    Grammar* grammar;
+    const char* lhs;
+    const char* text;
+    int pos;
+    int numHelpers;
+    int lineNum;
+    char helperLine[MAX_RHS * (MAX_PROD_LEN + 3) + 32]; // A helper's rule, built by addEbnfHelper
+} EbnfReader;
+
+// Internal helpers
+void* growArray(void* array, int* capacity, int count, size_t size);
+void initGrammar(Grammar* grammar);
+int addProduction(Grammar* grammar, const char* lhs);
+bool addAlternative(Production* prod, const char* rhs);
+bool addRuleAlternative(Grammar* grammar, const char* lhs, const char* rhs);
+bool addTerminal(Grammar* grammar, const char* name);
+bool addNonTerminal(Grammar* grammar, const char* name);
+void truncateProductions(Grammar* grammar, int count);
+bool copySymbols(Grammar* to, const Grammar* from);
+PerfectHash* hashNames(char (*names)[20], int count);
+int findName(const PerfectHash* hash, char (*names)[20], int count, const char* symbol);
+bool addGrammarLine(Grammar* grammar, char* line, int lineNum);
+void addEntrySymbols(Grammar* grammar, const char* names, int lineNum);
+bool nameEbnfHelper(EbnfReader* reader, int helper, char* name);
+bool appendEbnfSymbol(char* alternative, const char* symbol);
+bool addEbnfHelper(EbnfReader* reader, char alternatives[][MAX_PROD_LEN], int numAlternatives, bool loop, char* name);
+int expandEbnfItem(EbnfReader* reader, char out[][MAX_PROD_LEN]);
+int expandEbnfAlternatives(EbnfReader* reader, char out[][MAX_PROD_LEN]);
+bool expandEbnf(Grammar* grammar, const char* lhs, const char* rhs, char* out, int lineNum);
+bool classifyGrammarSymbols(Grammar* grammar);
+Grammar grammarTooLarge(Grammar* result, const char* step);
+bool indexProductions(const Grammar* grammar, ProductionIndex* index);
+void freeProductionIndex(ProductionIndex* index);
+bool newNonTerminalName(const Grammar* grammar, const char* base, char* name);
+bool factorAlternatives(Grammar* result, const char* lhs, const char* base, char (*alternatives)[MAX_PROD_LEN],
+                        int numAlternatives);
+bool encodeGrammar(const Grammar* grammar, EncodedGrammar* encoded);
+void freeEncodedGrammar(EncodedGrammar* encoded);
+int encodedSymbol(const EncodedGrammar* encoded, const char* name);
+void bitsFromSets(const EncodedGrammar* encoded, const Set* sets, uint64_t* bits);
+Set* setsFromBits(const Grammar* grammar, const EncodedGrammar* encoded, const uint64_t* bits);
+bool addFirstOfAlternative(const EncodedGrammar* encoded, const uint64_t* first, int a, int from, uint64_t* set);
+bool buildDependencyGraph(DependencyGraph* graph, int numNodes, const int* pairs, int numPairs);
+bool findComponents(SccSchedule* schedule);
+void freeSccSchedule(SccSchedule* schedule);
+void solveComponent(SccSchedule* schedule, int c);
+bool solveDependencies(const DependencyGraph* graph, uint64_t* sets, int words, int numThreads);
+void buildTableRow(const EncodedGrammar* encoded, const uint64_t* first, const uint64_t* follow,
+                   ParseTable* table, int row, uint64_t* select, TableRow* result);
+char** splitString(const char* str, const char* delimiter, int* count);
+char* trimString(char* str);
+bool hasCommonPrefix(char* rhs1, char* rhs2, char* prefix);
+bool hasDirectLeftRecursion(Production prod);
+int splitSymbols(const char* rhs, char symbols[][20], int maxSymbols);
+bool joinSymbols(char symbols[][20], int numSymbols, char* rhs);
+bool renameInAlternative(const Grammar* grammar, const char* rhs, const int* renameTo, char* renamed, bool* uses);
+void removeNonTerminals(Grammar* grammar, const bool* removed);
+void removeUnusedTerminals(Grammar* grammar);
+void removeUselessSymbols(Grammar* grammar);
+bool collapseUnitProductions(Grammar* grammar);
+bool mergeIdenticalNonTerminals(Grammar* grammar);
+void analyzeSimplifiedGrammar(GrammarAnalysis* analysis, int numThreads);
+
+/*
+Grammar readGrammarFromFile(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    Grammar grammar;
+    grammar.numProductions = 0;
+    grammar.numTerminals = 0;
+    grammar.numNonTerminals = 0;
+
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        return grammar;
+    }
+
+    char line[MAX_LINE_LEN];
+    int lineNum = 0;
+
+    while (fgets(line, MAX_LINE_LEN, file) != NULL) {
+        line[strcspn(line, "\n")] = 0;  // Remove newline character
+        if (strlen(line) == 0) continue; // Skip empty lines
+
+        printf("\nProcessing Line %d: %s\n", lineNum + 1, line);  // Debugging
+
+        char* trimmedLine = trimString(line);
+
+        // Split line into LHS and RHS
+        char* arrow = strstr(trimmedLine, "->");
+        if (arrow == NULL) {
+            printf("Invalid grammar format at line %d\n", lineNum + 1);
+            continue;
+        }
+
+        // Extract LHS
+        *arrow = '\0';
+        char* lhs = trimString(trimmedLine);
+        printf("  - Found LHS: %s\n", lhs);  // Debugging
+
+        // Ensure LHS is a non-terminal (it must be uppercase)
+        if (isupper(lhs[0])) {
+            bool found = false;
+            for (int i = 0; i < grammar.numNonTerminals; i++) {
+                if (strcmp(grammar.nonTerminals[i], lhs) == 0) {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                strcpy(grammar.nonTerminals[grammar.numNonTerminals], lhs);
+                printf("  - Added Non-Terminal: %s\n", lhs);  // Debugging
+                grammar.numNonTerminals++;
+
+                // The first non-terminal is the start symbol
+                if (grammar.numNonTerminals == 1) {
+                    strcpy(grammar.startSymbol, lhs);
+                    printf("  - Start Symbol Set: %s\n", lhs);  // Debugging
+                }
+            }
+        } else {
+            printf("  - ERROR: LHS is not an uppercase non-terminal: %s\n", lhs);  // Debugging
+        }
+
+        // Extract RHS
+        char* rhsStr = trimString(arrow + 2);
+        printf("  - Found RHS: %s\n", rhsStr);  // Debugging
+
+        // Split RHS by '|'
+        int numAlternatives;
+        char** alternatives = splitString(rhsStr, "|", &numAlternatives);
+
+        // Create a new production
+        Production* prod = &grammar.productions[grammar.numProductions];
+        strcpy(prod->lhs, lhs);
+        prod->numRHS = numAlternatives;
+
+        for (int i = 0; i < numAlternatives; i++) {
+            char* trimmedAlt = trimString(alternatives[i]);
+            strcpy(prod->rhs[i], trimmedAlt);
+            printf("  - Added RHS Alternative: %s\n", trimmedAlt);  // Debugging
+
+            // **NEW FIX: Correctly handle uppercase followed by lowercase (Aa case)**
+            int pos = 0;
+            while (trimmedAlt[pos] != '\0') {
+                char symbol[3] = {trimmedAlt[pos], '\0', '\0'};  // Single character symbol
+
+                // If next character exists and is lowercase, handle it separately
+                if (isupper(trimmedAlt[pos]) && islower(trimmedAlt[pos + 1])) {
+                    symbol[0] = trimmedAlt[pos];   // First uppercase letter
+                    symbol[1] = '\0';             // Ensure single-character symbol
+
+                    // Add non-terminal
+                    bool foundNT = false;
+                    for (int j = 0; j < grammar.numNonTerminals; j++) {
+                        if (strcmp(grammar.nonTerminals[j], symbol) == 0) {
+                            foundNT = true;
+                            break;
+                        }
+                    }
+                    if (!foundNT) {
+                        strcpy(grammar.nonTerminals[grammar.numNonTerminals], symbol);
+                        grammar.numNonTerminals++;
+                        printf("  - Added Non-Terminal: %s\n", symbol);  // Debugging
+                    }
+
+                    // Now handle the lowercase letter as a terminal
+                    symbol[0] = trimmedAlt[pos + 1];  
+                    symbol[1] = '\0';  
+
+                    bool foundT = false;
+                    for (int j = 0; j < grammar.numTerminals; j++) {
+                        if (strcmp(grammar.terminals[j], symbol) == 0) {
+                            foundT = true;
+                            break;
+                        }
+                    }
+                    if (!foundT) {
+                        strcpy(grammar.terminals[grammar.numTerminals], symbol);
+                        grammar.numTerminals++;
+                        printf("  - Added Terminal: %s\n", symbol);  // Debugging
+                    }
+                    pos += 2;  // Move ahead since we processed two characters
+                    continue;
+                }
+
+                // If it's a non-terminal (uppercase)
+                if (isupper(symbol[0])) {
+                    bool foundNT = false;
+                    for (int j = 0; j < grammar.numNonTerminals; j++) {
+                        if (strcmp(grammar.nonTerminals[j], symbol) == 0) {
+                            foundNT = true;
+                            break;
+                        }
+                    }
+                    if (!foundNT) {
+                        strcpy(grammar.nonTerminals[grammar.numNonTerminals], symbol);
+                        grammar.numNonTerminals++;
+                        printf("  - Added Non-Terminal: %s\n", symbol);  // Debugging
+                    }
+                } else {  // It's a terminal
+                    bool foundT = false;
+                    for (int j = 0; j < grammar.numTerminals; j++) {
+                        if (strcmp(grammar.terminals[j], symbol) == 0) {
+                            foundT = true;
+                            break;
+                        }
+                    }
+                    if (!foundT) {
+                        strcpy(grammar.terminals[grammar.numTerminals], symbol);
+                        grammar.numTerminals++;
+                        printf("  - Added Terminal: %s\n", symbol);  // Debugging
+                    }
+                }
+                pos++;  // Move to the next character
+            }
+            free(trimmedAlt);
+        }
+
+        grammar.numProductions++;
+
+        // Free allocated memory
+        for (int i = 0; i < numAlternatives; i++) {
+            free(alternatives[i]);
+        }
+        free(alternatives);
+        free(trimmedLine);
+        free(lhs);
+        free(rhsStr);
+
+        lineNum++;
+    }
+
+    fclose(file);
+    return grammar;
+}
+*/
+
+
+// Grow an array to hold at least count elements, doubling it. Returns the array, moved if need be,
+// or NULL if there is no memory for it, leaving the array as it was
+void* growArray(void* array, int* capacity, int count, size_t size) {
+    if (count <= *capacity && array != NULL) return array;
+    int grown = *capacity > 0 ? *capacity * 2 : 8;
+    if (grown < count) grown = count;
+    void* larger = realloc(array, (size_t)grown * size);
+    if (larger != NULL) *capacity = grown;
+    return larger;
+}
+
+// An empty grammar that owns nothing yet
+void initGrammar(Grammar* grammar) {
+    memset(grammar, 0, sizeof(Grammar));
+}
+
+// Add a production with no alternatives yet. Returns its index, -1 if there is no memory for it
+int addProduction(Grammar* grammar, const char* lhs) {
+    Production* productions = growArray(grammar->productions, &grammar->productionCapacity,
+                                        grammar->numProductions + 1, sizeof(Production));
+    if (productions == NULL) return -1;
+    grammar->productions = productions;
+    Production* prod = &productions[grammar->numProductions];
+    memset(prod, 0, sizeof(Production));
+    snprintf(prod->lhs, sizeof(prod->lhs), "%s", lhs);
+    return grammar->numProductions++;
+}
+
+// Append an alternative. False if the production has MAX_RHS already, or the alternative does not fit
+// in MAX_PROD_LEN
+bool addAlternative(Production* prod, const char* rhs) {
+    if (prod->numRHS == MAX_RHS || strlen(rhs) >= MAX_PROD_LEN) return false;
+    char (*alternatives)[MAX_PROD_LEN] = growArray(prod->rhs, &prod->rhsCapacity, prod->numRHS + 1,
+                                                   sizeof(*prod->rhs));
+    if (alternatives == NULL) return false;
+    prod->rhs = alternatives;
+    strcpy(prod->rhs[prod->numRHS++], rhs);
+    return true;
+}
+
+// Append an alternative for lhs to the last production if that is lhs's and has room, otherwise to
+// a new production. False if the alternative does not fit in MAX_PROD_LEN
+bool addRuleAlternative(Grammar* grammar, const char* lhs, const char* rhs) {
+    if (strlen(rhs) >= MAX_PROD_LEN) return false;
+    int last = grammar->numProductions - 1;
+    if (last == -1 || strcmp(grammar->productions[last].lhs, lhs) != 0 || grammar->productions[last].numRHS == MAX_RHS) {
+        last = addProduction(grammar, lhs);
+        if (last == -1) return false;
+    }
+    return addAlternative(&grammar->productions[last], rhs);
+}
+
+// Append a name. Once the names added since the last hash outnumber the hashed ones, the hash is
+// rebuilt, so each name is hashed a constant number of times on average
+bool addTerminal(Grammar* grammar, const char* name) {
+    char (*terminals)[20] = growArray(grammar->terminals, &grammar->terminalCapacity, grammar->numTerminals + 1,
+                                      sizeof(*terminals));
+    if (terminals == NULL) return false;
+    grammar->terminals = terminals;
+    snprintf(terminals[grammar->numTerminals++], 20, "%s", name);
+    int hashed = grammar->terminalHash != NULL ? grammar->terminalHash->numKeys : 0;
+    if (grammar->numTerminals - hashed > hashed + 8) {
+        freePerfectHash(grammar->terminalHash);
+        grammar->terminalHash = hashNames(grammar->terminals, grammar->numTerminals);
+    }
+    return true;
+}
+
+bool addNonTerminal(Grammar* grammar, const char* name) {
+    char (*nonTerminals)[20] = growArray(grammar->nonTerminals, &grammar->nonTerminalCapacity,
+                                         grammar->numNonTerminals + 1, sizeof(*nonTerminals));
+    if (nonTerminals == NULL) return false;
+    grammar->nonTerminals = nonTerminals;
+    snprintf(nonTerminals[grammar->numNonTerminals++], 20, "%s", name);
+    int hashed = grammar->nonTerminalHash != NULL ? grammar->nonTerminalHash->numKeys : 0;
+    if (grammar->numNonTerminals - hashed > hashed + 8) {
+        freePerfectHash(grammar->nonTerminalHash);
+        grammar->nonTerminalHash = hashNames(grammar->nonTerminals, grammar->numNonTerminals);
+    }
+    return true;
+}
+
+// A perfect hash over a list of names, NULL if there is no memory for it or the names repeat
+PerfectHash* hashNames(char (*names)[20], int count) {
+    const char** keys = malloc((count + 1) * sizeof(const char*));
+    if (keys == NULL) return NULL;
+    for (int i = 0; i < count; i++) {
+        keys[i] = names[i];
+    }
+    PerfectHash* hash = buildPerfectHash(keys, count);
+    free(keys);
+    return hash;
+}
+
+void indexGrammarSymbols(Grammar* grammar) {
+    freePerfectHash(grammar->terminalHash);
+    freePerfectHash(grammar->nonTerminalHash);
+    grammar->terminalHash = hashNames(grammar->terminals, grammar->numTerminals);
+    grammar->nonTerminalHash = hashNames(grammar->nonTerminals, grammar->numNonTerminals);
+}
+
+// Index of a name in a list through its hash, then among the names added after the hash was built;
+// -1 if it is not there. The name at the hashed index is compared too, so a hash over names that
+// were since cut off the end cannot answer for them
+int findName(const PerfectHash* hash, char (*names)[20], int count, const char* symbol) {
+    int hashed = 0;
+    if (hash != NULL) {
+        int i = lookupPerfectHash(hash, symbol, strlen(symbol));
+        if (i != -1 && i < count && strcmp(names[i], symbol) == 0) return i;
+        hashed = hash->numKeys < count ? hash->numKeys : count;
+    }
+    for (int i = hashed; i < count; i++) {
+        if (strcmp(names[i], symbol) == 0) return i;
+    }
+    return -1;
+}
+
+// Drop the productions from count on
+void truncateProductions(Grammar* grammar, int count) {
+    for (int i = count; i < grammar->numProductions; i++) {
+        free(grammar->productions[i].rhs);
+    }
+    if (count < grammar->numProductions) grammar->numProductions = count;
+}
+
+// Copy the symbols of one grammar into another that has none yet. False if there is no memory for them
+bool copySymbols(Grammar* to, const Grammar* from) {
+    for (int i = 0; i < from->numTerminals; i++) {
+        if (!addTerminal(to, from->terminals[i])) return false;
+    }
+    for (int i = 0; i < from->numNonTerminals; i++) {
+        if (!addNonTerminal(to, from->nonTerminals[i])) return false;
+    }
+    strcpy(to->startSymbol, from->startSymbol);
+    memcpy(to->entrySymbols, from->entrySymbols, sizeof(from->entrySymbols));
+    to->numEntrySymbols = from->numEntrySymbols;
+    indexGrammarSymbols(to);
+    return true;
+}
+
+Grammar copyGrammar(const Grammar* grammar) {
+    Grammar copy;
+    initGrammar(&copy);
+    bool ok = copySymbols(&copy, grammar);
+    for (int i = 0; i < grammar->numProductions && ok; i++) {
+        const Production* prod = &grammar->productions[i];
+        int index = addProduction(&copy, prod->lhs);
+        ok = index != -1;
+        for (int j = 0; j < prod->numRHS && ok; j++) {
+            ok = addAlternative(&copy.productions[index], prod->rhs[j]);
+        }
+    }
+    if (!ok) truncateProductions(&copy, 0);
+    return copy;
+}
+
+void freeGrammar(Grammar* grammar) {
+    truncateProductions(grammar, 0);
+    free(grammar->productions);
+    free(grammar->terminals);
+    free(grammar->nonTerminals);
+    freePerfectHash(grammar->terminalHash);
+    freePerfectHash(grammar->nonTerminalHash);
+    initGrammar(grammar);
+}
+
+// Declare the non-terminals of one "%entry A B ..." line as entry symbols
+void addEntrySymbols(Grammar* grammar, const char* names, int lineNum) {
+    char name[20];
+    int used;
+    while (sscanf(names, "%19s%n", name, &used) == 1) {
+        names += used;
+        if (!isupper((unsigned char)name[0])) {
+            printf("Invalid entry symbol %s at line %d\n", name, lineNum + 1);
+            continue;
+        }
+        if (isEntrySymbol(grammar, name)) continue;
+        if (grammar->numEntrySymbols == MAX_ENTRY_SYMBOLS) {
+            printf("Too many entry symbols at line %d\n", lineNum + 1);
+            return;
+        }
+        strcpy(grammar->entrySymbols[grammar->numEntrySymbols++], name);
+    }
+}
+
+// Add one "A -> α | β" line to the grammar, or one EBNF rule "A ::= ..." (see expandEbnf).
+// Malformed lines are reported and skipped; false if the rule does not fit the grammar's limits
+bool addGrammarLine(Grammar* grammar, char* line, int lineNum) {
+    line[strcspn(line, "\n")] = 0;  // Remove newline character
+    if (strlen(line) == 0) return true; // Skip empty lines
+
+    debugPrintf("\nProcessing Line %d: %s\n", lineNum + 1, line);
+
+    char* trimmedLine = trimString(line);
+
+    if (strncmp(trimmedLine, "%entry", 6) == 0 && isspace((unsigned char)trimmedLine[6])) {
+        addEntrySymbols(grammar, trimmedLine + 6, lineNum);
+        free(trimmedLine);
+        return true;
+    }
+
+    // Split line into LHS and RHS
+    char* ebnf = strstr(trimmedLine, "::=");
+    int arrowAt = ebnf != NULL ? (int)(ebnf - trimmedLine) : findBytePair(trimmedLine, strlen(trimmedLine), '-', '>');
+    if (arrowAt == -1) {
+        printf("Invalid grammar format at line %d\n", lineNum + 1);
+        free(trimmedLine);
+        return true;
+    }
+    char* arrow = trimmedLine + arrowAt;
+
+    // Extract LHS
+    *arrow = '\0';
+    char* lhs = trimString(trimmedLine);
+    debugPrintf("  - Found LHS: %s\n", lhs);
+    if (strlen(lhs) >= 20) {
+        printf("Too long a name at line %d (at most 19 bytes)\n", lineNum + 1);
+        free(trimmedLine);
+        free(lhs);
+        return false;
+    }
+
+    // Ensure LHS is a non-terminal (must be uppercase)
+    int numNonTerminals = grammar->numNonTerminals;
+    if (isupper(lhs[0])) {
+        bool found = findNonTerminalIndex(grammar, lhs) != -1;
+        if (!found && !addNonTerminal(grammar, lhs)) {
+            printf("Out of memory at line %d\n", lineNum + 1);
+            free(trimmedLine);
+            free(lhs);
+            return false;
+        }
+        if (!found) {
+            debugPrintf("  - Added Non-Terminal: %s\n", lhs);
+
+            // The first non-terminal is the start symbol
+            if (grammar->numNonTerminals == 1) {
+                strcpy(grammar->startSymbol, lhs);
+                debugPrintf("  - Start Symbol Set: %s\n", lhs);
+            }
+        }
+    } else {
+        debugPrintf("  - ERROR: LHS is not an uppercase non-terminal: %s\n", lhs);
+    }
+
+    // Extract RHS
+    char* rhsStr = trimString(arrow + (ebnf != NULL ? 3 : 2));
+    debugPrintf("  - Found RHS: %s\n", rhsStr);
+    
+    // An EBNF rule's helpers go after its own production
+    int index = addProduction(grammar, lhs);
+    if (index == -1) {
+        printf("Out of memory at line %d\n", lineNum + 1);
+        free(trimmedLine);
+        free(lhs);
+        free(rhsStr);
+        return false;
+    }
+    if (ebnf != NULL) {
+        char expanded[MAX_RHS * (MAX_PROD_LEN + 3)];
+        if (!expandEbnf(grammar, lhs, rhsStr, expanded, lineNum)) {
+            // Leave the grammar as it was, without the rule's helpers or a new left-hand side
+            truncateProductions(grammar, index);
+            grammar->numNonTerminals = numNonTerminals;
+            indexGrammarSymbols(grammar);
+            if (numNonTerminals == 0) grammar->startSymbol[0] = '\0';
+            free(trimmedLine);
+            free(lhs);
+            free(rhsStr);
+            return true;
+        }
+        free(rhsStr);
+        rhsStr = strdup(expanded);
+    }
+
+    // Split RHS by '|'
+    int numAlternatives;
+    char** alternatives = splitString(rhsStr, "|", &numAlternatives);
+
+    // Fill the new production
+    Production* prod = &grammar->productions[index];
+    bool fits = numAlternatives <= MAX_RHS;
+
+    for (int i = 0; i < numAlternatives && fits; i++) {
+        char* trimmedAlt = trimString(alternatives[i]);
+        fits = addAlternative(prod, trimmedAlt);
+        if (fits) {
+            debugPrintf("  - Added RHS Alternative: %s\n", trimmedAlt);
+        }
+        free(trimmedAlt);
+    }
+    if (!fits) {
+        printf("Rule too large at line %d (at most %d alternatives of %d bytes)\n", lineNum + 1, MAX_RHS,
+               MAX_PROD_LEN - 1);
+    }
+
+    // Free allocated memory
+    for (int i = 0; i < numAlternatives; i++) {
+        free(alternatives[i]);
+    }
+    free(alternatives);
+    free(trimmedLine);
+    free(lhs);
+    free(rhsStr);
+    return fits;
+}
+
+// Helper non-terminals are named after the rule: A'e1, A'e2, ...
+bool nameEbnfHelper(EbnfReader* reader, int helper, char* name) {
+    return snprintf(name, 20, "%s'e%d", reader->lhs, helper) < 20;
+}
+
+// Append a symbol to an alternative, where ε stands for the empty sequence
+bool appendEbnfSymbol(char* alternative, const char* symbol) {
+    if (strcmp(symbol, EPSILON) == 0) return true;
+    if (strcmp(alternative, EPSILON) == 0) alternative[0] = '\0';
+    if (strlen(alternative) + strlen(symbol) + 2 > MAX_PROD_LEN) return false;
+    if (alternative[0] != '\0') strcat(alternative, " ");
+    strcat(alternative, symbol);
+    return true;
+}
+
+// Define a new helper non-terminal by plain alternatives. A loop helper ends each alternative
+// with itself and can also be empty: R -> α R | β R | ε
+bool addEbnfHelper(EbnfReader* reader, char alternatives[][MAX_PROD_LEN], int numAlternatives, bool loop, char* name) {
+    char* line = reader->helperLine;
+    if (numAlternatives + loop > MAX_RHS || !nameEbnfHelper(reader, ++reader->numHelpers, name)) {
+        return false;
+    }
+    sprintf(line, "%s ->", name);
+    for (int i = 0; i < numAlternatives; i++) {
+        char alternative[MAX_PROD_LEN];
+        strcpy(alternative, alternatives[i]);
+        if (loop && (strcmp(alternative, EPSILON) == 0 || !appendEbnfSymbol(alternative, name))) continue;
+        if (i > 0) strcat(line, " |");
+        strcat(line, " ");
+        strcat(line, alternative);
+    }
+    if (loop) strcat(line, " | " EPSILON);
+    return addGrammarLine(reader->grammar, line, reader->lineNum);
+}
+
+// Read one item, a symbol or a parenthesized group with an optional repetition, into its
+// alternatives. Returns how many there are, 0 on a syntax error. A plain group yields its own
+// alternatives, which the enclosing sequence distributes over, so "(+ | -) T" is "+ T | - T".
+// X* becomes a loop helper R -> X R | ε, X+ is X R, and X? an optional helper O -> X | ε
+int expandEbnfItem(EbnfReader* reader, char out[][MAX_PROD_LEN]) {
+    const char* text = reader->text;
+    int numAlternatives = 1;
+    
+    reader->pos += scanSpaces(text + reader->pos, strlen(text + reader->pos));
+    char c = text[reader->pos];
+    if (c == '(') {
+        reader->pos++;
+        numAlternatives = expandEbnfAlternatives(reader, out);
+        reader->pos += scanSpaces(text + reader->pos, strlen(text + reader->pos));
+        if (numAlternatives == 0 || text[reader->pos] != ')') return 0;
+        reader->pos++;
+    } else if (c == '"') {
+        // Quoted terminals; a quoted punctuation byte is the plain one-byte terminal
+        int end = reader->pos + 1;
+        while (text[end] != '\0' && text[end] != '"') end++;
+        if (text[end] != '"' || end == reader->pos + 1 || end - reader->pos > 19) return 0;
+        if (end == reader->pos + 2 && !isalnum((unsigned char)text[reader->pos + 1])) {
+            if (text[reader->pos + 1] == '|') return 0;
+            sprintf(out[0], "%c", text[reader->pos + 1]);
+        } else {
+            sprintf(out[0], "%.*s", end - reader->pos + 1, text + reader->pos);
+        }
+        reader->pos = end + 1;
+    } else if (c == '\0' || strchr(")|*+?", c) != NULL) {
+        return 0;
+    } else {
+        // Any other symbol, or an action tag, as getSymbol reads it
+        int start = reader->pos;
+        if (c == '@') {
+            reader->pos++;
+            reader->pos += scanIdentifier(text + reader->pos, strlen(text + reader->pos));
+        } else {
+            free(getSymbol(text, &reader->pos));
+        }
+        if (reader->pos - start >= MAX_PROD_LEN) return 0;
+        sprintf(out[0], "%.*s", reader->pos - start, text + start);
+    }
+    
+    reader->pos += scanSpaces(text + reader->pos, strlen(text + reader->pos));
+    char repetition = text[reader->pos];
+    if (repetition != '*' && repetition != '+' && repetition != '?') return numAlternatives;
+    reader->pos++;
+    
+    char name[20];
+    if (repetition == '?') {
+        if (numAlternatives == MAX_RHS) return 0;
+        strcpy(out[numAlternatives++], EPSILON);
+        if (!addEbnfHelper(reader, out, numAlternatives, false, name)) return 0;
+        strcpy(out[0], name);
+        return 1;
+    }
+    if (!addEbnfHelper(reader, out, numAlternatives, true, name)) return 0;
+    if (repetition == '*') {
+        strcpy(out[0], name);
+        return 1;
+    }
+    for (int i = 0; i < numAlternatives; i++) {
+        if (!appendEbnfSymbol(out[i], name)) return 0;
+    }
+    return numAlternatives;
+}
+
+// Read alternatives up to a closing parenthesis or the end. Returns how many there are, 0 on a
+// syntax error. Each sequence is the product of its items' alternatives; an item that would
+// spread it past EBNF_MAX_SPREAD alternatives gets a helper instead
+int expandEbnfAlternatives(EbnfReader* reader, char out[][MAX_PROD_LEN]) {
+    int numAlternatives = 0;
+    while (true) {
+        char sequence[EBNF_MAX_SPREAD][MAX_PROD_LEN];
+        char spread[EBNF_MAX_SPREAD][MAX_PROD_LEN];
+        char item[MAX_RHS][MAX_PROD_LEN];
+        int numSequences = 1;
+        strcpy(sequence[0], EPSILON);
+        while (true) {
+            reader->pos += scanSpaces(reader->text + reader->pos, strlen(reader->text + reader->pos));
+            char c = reader->text[reader->pos];
+            if (c == '\0' || c == '|' || c == ')') break;
+            int numItems = expandEbnfItem(reader, item);
+            if (numItems == 0) return 0;
+            if (numSequences * numItems > EBNF_MAX_SPREAD) {
+                char name[20];
+                if (!addEbnfHelper(reader, item, numItems, false, name)) return 0;
+                strcpy(item[0], name);
+                numItems = 1;
+            }
+            for (int i = 0; i < numSequences; i++) {
+                for (int j = 0; j < numItems; j++) {
+                    strcpy(spread[i * numItems + j], sequence[i]);
+                    if (!appendEbnfSymbol(spread[i * numItems + j], item[j])) return 0;
+                }
+            }
+            numSequences *= numItems;
+            memcpy(sequence, spread, numSequences * sizeof(sequence[0]));
+        }
+        if (numAlternatives + numSequences > MAX_RHS) return 0;
+        memcpy(out[numAlternatives], sequence, numSequences * sizeof(sequence[0]));
+        numAlternatives += numSequences;
+        
+        if (reader->text[reader->pos] != '|') return numAlternatives;
+        reader->pos++;
+    }
+}
+
+// Expand an EBNF right-hand side into plain alternatives separated by " | ", adding the helper
+// productions it needs. Parentheses group, | separates alternatives, and *, + and ? repeat the
+// symbol or group before them; these characters, and any other punctuation, are terminals only
+// when quoted ("("). False on a syntax error, leaving helpers behind for the caller to drop
+bool expandEbnf(Grammar* grammar, const char* lhs, const char* rhs, char* out, int lineNum) {
+    EbnfReader reader = {grammar, lhs, rhs, 0, 0, lineNum, ""};
+    char alternatives[MAX_RHS][MAX_PROD_LEN];
+    
+    int numAlternatives = expandEbnfAlternatives(&reader, alternatives);
+    if (numAlternatives == 0 || rhs[reader.pos] != '\0') {
+        printf("Invalid EBNF at line %d, column %d: %s\n", lineNum + 1, reader.pos + 1, rhs);
+        return false;
+    }
+    out[0] = '\0';
+    for (int i = 0; i < numAlternatives; i++) {
+        if (i > 0) strcat(out, " | ");
+        strcat(out, alternatives[i]);
+    }
+    return true;
+}
+
+
+// Order of first appearance of a symbol name, for sorting duplicates together
+typedef struct {
+    char name[20];
+    int first;
+} SymbolOccurrence;
+
+int compareOccurrenceNames(const void* a, const void* b) {
+    const SymbolOccurrence* x = (const SymbolOccurrence*)a;
+    const SymbolOccurrence* y = (const SymbolOccurrence*)b;
+    int order = strcmp(x->name, y->name);
+    return order != 0 ? order : x->first - y->first;
+}
+
+int compareOccurrenceFirst(const void* a, const void* b) {
+    return ((const SymbolOccurrence*)a)->first - ((const SymbolOccurrence*)b)->first;
+}
+
+// Classify every right-hand side symbol once all lines are read. The left-hand sides are the
+// non-terminals, so the grammar's hash over them classifies each symbol with one lookup; the
+// remaining symbols are terminals, de-duplicated by sorting. False if there is no memory for them
+bool classifyGrammarSymbols(Grammar* grammar) {
+    indexGrammarSymbols(grammar);
+    
+    SymbolOccurrence* terminals = NULL;
+    int numOccurrences = 0, occurrenceCapacity = 0;
+    bool fits = true;
+    
+    for (int i = 0; i < grammar->numProductions && fits; i++) {
+        const Production* prod = &grammar->productions[i];
+        for (int j = 0; j < prod->numRHS && fits; j++) {
+            int pos = 0;
+            char* symbol;
+            while (fits && (symbol = getSymbol(prod->rhs[j], &pos)) != NULL) {
+                int length = strlen(symbol);
+                if (strcmp(symbol, EPSILON) == 0 || length >= 20 || findNonTerminalIndex(grammar, symbol) != -1) {
+                    free(symbol);
+                    continue;
+                }
+                
+                if (isupper((unsigned char)symbol[0])) {
+                    // Used but never defined; still a non-terminal
+                    fits = addNonTerminal(grammar, symbol);
+                    debugPrintf("  - Added Non-Terminal: %s\n", symbol);
+                } else {
+                    SymbolOccurrence* grown = growArray(terminals, &occurrenceCapacity, numOccurrences + 1,
+                                                        sizeof(SymbolOccurrence));
+                    fits = grown != NULL;
+                    if (fits) {
+                        terminals = grown;
+                        strcpy(terminals[numOccurrences].name, symbol);
+                        terminals[numOccurrences].first = numOccurrences;
+                        numOccurrences++;
+                    }
+                }
+                free(symbol);
+            }
+        }
+    }
+    
+    // Keep the first occurrence of each terminal, in order of appearance
+    if (numOccurrences > 0) {
+        qsort(terminals, numOccurrences, sizeof(SymbolOccurrence), compareOccurrenceNames);
+    }
+    int numUnique = 0;
+    for (int i = 0; i < numOccurrences; i++) {
+        if (numUnique == 0 || strcmp(terminals[numUnique - 1].name, terminals[i].name) != 0) {
+            terminals[numUnique++] = terminals[i];
+        }
+    }
+    if (numUnique > 0) {
+        qsort(terminals, numUnique, sizeof(SymbolOccurrence), compareOccurrenceFirst);
+    }
+    
+    grammar->numTerminals = 0;
+    freePerfectHash(grammar->terminalHash);
+    grammar->terminalHash = NULL;
+    for (int i = 0; i < numUnique && fits; i++) {
+        fits = addTerminal(grammar, terminals[i].name);
+        debugPrintf("  - Added Terminal: %s\n", terminals[i].name);
+    }
+    if (!fits) {
+        printf("Out of memory classifying the grammar's symbols\n");
+    }
+    
+    free(terminals);
+    indexGrammarSymbols(grammar);
+    return fits;
+}
+
+Grammar readGrammarFromString(const char* text) {
+    Grammar grammar;
+    initGrammar(&grammar);
+    
+    char line[MAX_LINE_LEN];
+    int lineNum = 0;
+    const char* end = text + strlen(text);
+    bool fits = true;
+    
+    while (fits && text < end) {
+        int lineLength = findByte(text, end - text, '\n');
+        if (lineLength == -1) lineLength = end - text;
+        int length = lineLength < MAX_LINE_LEN ? lineLength : MAX_LINE_LEN - 1;
+        memcpy(line, text, length);
+        line[length] = '\0';
+        line[strcspn(line, "\r")] = '\0';
+        
+        text += lineLength;
+        if (text < end) text++;
+        
+        if (lineLength >= MAX_LINE_LEN) {
+            printf("Line %d too long (at most %d bytes)\n", lineNum + 1, MAX_LINE_LEN - 1);
+            fits = false;
+        } else if (strlen(line) > 0) {
+            fits = addGrammarLine(&grammar, line, lineNum++);
+        }
+    }
+    
+    if (!fits || !classifyGrammarSymbols(&grammar)) truncateProductions(&grammar, 0);
+    return grammar;
+}
+
+Grammar readGrammarFromFile(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    Grammar grammar;
+    initGrammar(&grammar);
+
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        return grammar;
+    }
+
+    char line[MAX_LINE_LEN];
+    int lineNum = 0;
+    bool fits = true;
+
+    while (fits && fgets(line, MAX_LINE_LEN, file) != NULL) {
+        if (strchr(line, '\n') == NULL && !feof(file)) {
+            printf("Line %d too long (at most %d bytes)\n", lineNum + 1, MAX_LINE_LEN - 2);
+            fits = false;
+            break;
+        }
+        line[strcspn(line, "\r\n")] = 0;  // Remove newline character
+        if (strlen(line) == 0) continue; // Skip empty lines
+        fits = addGrammarLine(&grammar, line, lineNum++);
+    }
+
+    fclose(file);
+    if (!fits || !classifyGrammarSymbols(&grammar)) truncateProductions(&grammar, 0);
+    return grammar;
+}
+
+
+// Display the grammar
+void displayGrammar(Grammar grammar) {
+    printf("Productions:\n");
+    for (int i = 0; i < grammar.numProductions; i++) {
+        Production prod = grammar.productions[i];
+        printf("%s -> ", prod.lhs);
+        for (int j = 0; j < prod.numRHS; j++) {
+            printf("%s", prod.rhs[j]);
+            if (j < prod.numRHS - 1) {
+                printf(" | ");
+            }
+        }
+        printf("\n");
+    }
+    
+    printf("\nNon-terminals: ");
+    for (int i = 0; i < grammar.numNonTerminals; i++) {
+        printf("%s", grammar.nonTerminals[i]);
+        if (i < grammar.numNonTerminals - 1) {
+            printf(", ");
+        }
+    }
+    
+    printf("\nTerminals: ");
+    for (int i = 0; i < grammar.numTerminals; i++) {
+        printf("%s", grammar.terminals[i]);
+        if (i < grammar.numTerminals - 1) {
+            printf(", ");
+        }
+    }
+    
+    printf("\nStart Symbol: %s\n", grammar.startSymbol);
+    if (grammar.numEntrySymbols > 0) {
+        printf("Entry Symbols: ");
+        for (int i = 0; i < grammar.numEntrySymbols; i++) {
+            printf("%s%s", grammar.entrySymbols[i], i < grammar.numEntrySymbols - 1 ? ", " : "\n");
+        }
+    }
+}
+
+// Get the common prefix of two strings
+bool hasCommonPrefix(char* rhs1, char* rhs2, char* prefix) {
+    int i = 0;
+    while (rhs1[i] != '\0' && rhs2[i] != '\0' && rhs1[i] == rhs2[i]) {
+        prefix[i] = rhs1[i];
+        i++;
+    }
+    prefix[i] = '\0';
+    return i > 0;
+}
+
+// Extract a symbol from a string at a given position
+
+
+char* getSymbol(const char* rhs, int* pos) {
+    char* symbol = (char*)malloc(MAX_PROD_LEN);
+    int i = 0;
+    int length = *pos + strlen(rhs + *pos);
+    
+    // Skip whitespace, and action tags (@name), which are not grammar symbols
+    *pos += scanSpaces(rhs + *pos, length - *pos);
+    while (rhs[*pos] == '@' && isalpha((unsigned char)rhs[*pos + 1])) {
+        (*pos)++;
+        *pos += scanIdentifier(rhs + *pos, length - *pos);
+        *pos += scanSpaces(rhs + *pos, length - *pos);
+    }
+    
+    if (rhs[*pos] == '\0') {
+        free(symbol);
+        return NULL;
+    }
+    
+    // Epsilon is a two-byte UTF-8 character (0xCE 0xB5)
+    if ((unsigned char)rhs[*pos] == 0xCE && (unsigned char)rhs[*pos + 1] == 0xB5) {
+        strcpy(symbol, EPSILON);
+        (*pos) += 2;
+        return symbol;
+    }
+    
+    // A quoted multi-character terminal (keyword), kept with its quotes
+    if (rhs[*pos] == '"') {
+        symbol[i++] = rhs[(*pos)++];
+        while (rhs[*pos] != '\0' && rhs[*pos] != '"' && i < 18) {
+            symbol[i++] = rhs[(*pos)++];
+        }
+        if (rhs[*pos] == '"') {
+            symbol[i++] = rhs[(*pos)++];
+        }
+    }
+    // Check if it's a multi-character symbol (non-terminal)
+    else if (isalpha(rhs[*pos]) && isupper(rhs[*pos])) {
+        // Identifier runs separated by primes (E', E'2)
+        int end = *pos;
+        while (true) {
+            end += scanIdentifier(rhs + end, length - end);
+            if (rhs[end] != '\'') break;
+            end++;
+        }
+        if (end - *pos > MAX_PROD_LEN - 1) end = *pos + MAX_PROD_LEN - 1;
+        memcpy(symbol, rhs + *pos, end - *pos);
+        i = end - *pos;
+        *pos = end;
+    } 
+    // Single character symbol (terminal)
+    else {
+        symbol[i++] = rhs[*pos];
+        (*pos)++;
+    }
+    
+    symbol[i] = '\0';
+    return symbol;
+}
+
+
+
+
+
+
+// The action tag (@name) of an alternative, without the @. False if it has none
+bool getActionTag(const char* rhs, char* tag) {
+    int length = strlen(rhs);
+    int pos = 0;
+    while (true) {
+        pos += scanSpaces(rhs + pos, length - pos);
+        if (pos >= length) return false;
+        if (rhs[pos] == '@' && isalpha((unsigned char)rhs[pos + 1])) {
+            int n = scanIdentifier(rhs + pos + 1, length - pos - 1);
+            if (n > 19) n = 19;
+            memcpy(tag, rhs + pos + 1, n);
+            tag[n] = '\0';
+            return true;
+        }
+        char* symbol = getSymbol(rhs, &pos);
+        if (symbol == NULL) return false;
+        free(symbol);
+    }
+}
+
+char* getSymbol1(const char* rhs, int* pos) {
+    char* symbol = (char*)malloc(MAX_PROD_LEN);
+    
+    // Skip whitespace
+    while (rhs[*pos] != '\0' && isspace(rhs[*pos])) {
+        (*pos)++;
+    }
+    
+    if (rhs[*pos] == '\0') {
+        free(symbol);
+        return NULL;
+    }
+
+    // Check if the symbol is epsilon (UTF-8 encoding 0xCE 0xB5)
+    if ((unsigned char)rhs[*pos] == 0xCE && (unsigned char)rhs[*pos + 1] == 0xB5) {
+        strcpy(symbol, EPSILON);
+        (*pos) += 2; // Move past the two-byte UTF-8 character
+        return symbol;
+    }
+
+    free(symbol);
+    return NULL;
+}
+
+
+// What a transformation returns when an alternative or a new name would not fit: a grammar with no
+// productions, as for one that could not be read. The partial result is freed
+Grammar grammarTooLarge(Grammar* result, const char* step) {
+    printf("%s outgrows the grammar limits (alternatives of %d bytes, names of 19 bytes)\n", step, MAX_PROD_LEN - 1);
+    freeGrammar(result);
+    return *result;
+}
+
+// Index the productions by the non-terminal on their left-hand side, in production order. False if
+// there is no memory for it
+bool indexProductions(const Grammar* grammar, ProductionIndex* index) {
+    int* lhs = malloc((grammar->numProductions + 1) * sizeof(int));
+    index->start = calloc(grammar->numNonTerminals + 2, sizeof(int));
+    index->production = malloc((grammar->numProductions + 1) * sizeof(int));
+    if (lhs == NULL || index->start == NULL || index->production == NULL) {
+        free(lhs);
+        freeProductionIndex(index);
+        return false;
+    }
+    
+    // Counts go two places up, so that after the sums filling from start[n + 1] leaves start[n]
+    // at the start of n's productions and start[n + 1] at their end
+    for (int i = 0; i < grammar->numProductions; i++) {
+        lhs[i] = findNonTerminalIndex(grammar, grammar->productions[i].lhs);
+        if (lhs[i] != -1) index->start[lhs[i] + 2]++;
+    }
+    for (int n = 2; n <= grammar->numNonTerminals; n++) {
+        index->start[n] += index->start[n - 1];
+    }
+    for (int i = 0; i < grammar->numProductions; i++) {
+        if (lhs[i] != -1) index->production[index->start[lhs[i] + 1]++] = i;
+    }
+    free(lhs);
+    return true;
+}
+        
+void freeProductionIndex(ProductionIndex* index) {
+    free(index->start);
+    free(index->production);
+    index->start = NULL;
+    index->production = NULL;
+}
+
+// Name a new non-terminal after base (E', then E'1, E'2, ...) that the grammar does not have yet.
+// False if the name would be longer than 19 bytes
+bool newNonTerminalName(const Grammar* grammar, const char* base, char* name) {
+    char candidate[MAX_PROD_LEN];
+    snprintf(candidate, sizeof(candidate), "%s'", base);
+    int suffix = 1;
+    while (isNonTerminal(*grammar, candidate)) {
+        snprintf(candidate, sizeof(candidate), "%s'%d", base, suffix++);
+    }
+    if (strlen(candidate) >= 20) return false;
+    strcpy(name, candidate);
+    return true;
+}
+
+// A helper non-terminal left factoring introduced, with the remainders of the alternatives it factors
+typedef struct {
+    char name[20];
+    char (*alternatives)[MAX_PROD_LEN];
+    int numAlternatives;
+} FactoredGroup;
+
+// Add lhs's alternatives to result, left factored: alternatives starting with the same symbol are
+// replaced by their longest common prefix followed by a new non-terminal (named after base), whose
+// alternatives are what follows the prefix, factored in turn and added right after lhs's. Alternatives
+// starting with the left-hand side itself are left to left recursion removal, which turns
+// E -> E+T | E-T | T into one tail with an alternative per operator. False if something does not fit
+bool factorAlternatives(Grammar* result, const char* lhs, const char* base, char (*alternatives)[MAX_PROD_LEN],
+                        int numAlternatives) {
+    int* group = malloc((numAlternatives + 1) * sizeof(int));
+    int* groupSize = calloc(numAlternatives + 1, sizeof(int));
+    char (*firsts)[20] = malloc((numAlternatives + 1) * sizeof(*firsts));
+    FactoredGroup* helpers = calloc(numAlternatives + 1, sizeof(FactoredGroup));
+    int numHelpers = 0;
+    bool ok = group != NULL && groupSize != NULL && firsts != NULL && helpers != NULL;
+    
+    // Each alternative joins the group of the first alternative starting with the same symbol
+    for (int i = 0; i < numAlternatives && ok; i++) {
+        int pos = 0;
+        char* symbol = getSymbol(alternatives[i], &pos);
+        while (symbol != NULL && strcmp(symbol, EPSILON) == 0) {
+            free(symbol);
+            symbol = getSymbol(alternatives[i], &pos);
+        }
+        group[i] = i;
+        firsts[i][0] = '\0';
+        if (symbol != NULL && strcmp(symbol, lhs) != 0) {
+            snprintf(firsts[i], 20, "%s", symbol);
+            for (int k = 0; k < i; k++) {
+                if (group[k] == k && strcmp(firsts[k], firsts[i]) == 0) {
+                    group[i] = k;
+                    break;
+                }
+            }
+        }
+        free(symbol);
+        groupSize[group[i]]++;
+    }
+    
+    for (int i = 0; i < numAlternatives && ok; i++) {
+        if (groupSize[group[i]] < 2) {
+            ok = addRuleAlternative(result, lhs, alternatives[i]);
+            continue;
+        }
+        if (group[i] != i) continue;
+        
+        // The longest prefix every alternative of the group shares
+        char prefix[MAX_PROD_LEN][20], symbols[MAX_PROD_LEN][20];
+        int prefixLength = splitSymbols(alternatives[i], prefix, MAX_PROD_LEN);
+        for (int k = i + 1; k < numAlternatives; k++) {
+            if (group[k] != i) continue;
+            int n = splitSymbols(alternatives[k], symbols, MAX_PROD_LEN);
+            int common = 0;
+            while (common < n && common < prefixLength && strcmp(symbols[common], prefix[common]) == 0) {
+                common++;
+            }
+            prefixLength = common;
+        }
+        
+        FactoredGroup* helper = &helpers[numHelpers++];
+        helper->alternatives = malloc(groupSize[i] * sizeof(*helper->alternatives));
+        char factored[MAX_PROD_LEN];
+        ok = helper->alternatives != NULL && newNonTerminalName(result, base, helper->name) &&
+             addNonTerminal(result, helper->name) && joinSymbols(prefix, prefixLength, factored) &&
+             strlen(factored) + strlen(helper->name) + 2 <= MAX_PROD_LEN;
+        if (!ok) break;
+        strcat(factored, " ");
+        strcat(factored, helper->name);
+        ok = addRuleAlternative(result, lhs, factored);
+            
+        // The remainders keep their alternative's action tag
+        for (int k = i; k < numAlternatives && ok; k++) {
+            if (group[k] != i) continue;
+            int n = splitSymbols(alternatives[k], symbols, MAX_PROD_LEN);
+            char* remainder = helper->alternatives[helper->numAlternatives++];
+            char tag[20];
+            ok = joinSymbols(symbols + prefixLength, n - prefixLength, remainder);
+            if (ok && getActionTag(alternatives[k], tag)) {
+                size_t used = strlen(remainder);
+                int written = snprintf(remainder + used, MAX_PROD_LEN - used, " @%s", tag);
+                ok = written >= 0 && (size_t)written < MAX_PROD_LEN - used;
+            }
+        }
+    }
+    
+    for (int h = 0; h < numHelpers && ok; h++) {
+        ok = factorAlternatives(result, helpers[h].name, base, helpers[h].alternatives, helpers[h].numAlternatives);
+    }
+    
+    for (int h = 0; h < numHelpers; h++) {
+        free(helpers[h].alternatives);
+    }
+    free(helpers);
+    free(firsts);
+    free(groupSize);
+    free(group);
+    return ok;
+}
+
+// Implementation of left factoring. A non-terminal's alternatives are factored together, whichever
+// of its productions they are in
+Grammar leftFactoring(Grammar grammar) {
+    Grammar result;
+    initGrammar(&result);
+    ProductionIndex index;
+    if (!copySymbols(&result, &grammar) || !indexProductions(&grammar, &index)) {
+        return grammarTooLarge(&result, "Left factoring");
+    }
+    bool* done = calloc(grammar.numNonTerminals + 1, sizeof(bool));
+    bool ok = done != NULL;
+    
+    for (int i = 0; i < grammar.numProductions && ok; i++) {
+        const Production* prod = &grammar.productions[i];
+        int n = findNonTerminalIndex(&grammar, prod->lhs);
+        if (n == -1) {
+            // Not a non-terminal's rule; kept as it is
+            for (int j = 0; j < prod->numRHS && ok; j++) {
+                ok = addRuleAlternative(&result, prod->lhs, prod->rhs[j]);
+            }
+            continue;
+        }
+        if (done[n]) continue;
+        done[n] = true;
+        
+        int numAlternatives = 0;
+        for (int k = index.start[n]; k < index.start[n + 1]; k++) {
+            numAlternatives += grammar.productions[index.production[k]].numRHS;
+        }
+        char (*alternatives)[MAX_PROD_LEN] = malloc((numAlternatives + 1) * sizeof(*alternatives));
+        ok = alternatives != NULL;
+        numAlternatives = 0;
+        for (int k = index.start[n]; k < index.start[n + 1] && ok; k++) {
+            const Production* part = &grammar.productions[index.production[k]];
+            memcpy(alternatives[numAlternatives], part->rhs, part->numRHS * sizeof(*alternatives));
+            numAlternatives += part->numRHS;
+        }
+        ok = ok && factorAlternatives(&result, prod->lhs, prod->lhs, alternatives, numAlternatives);
+        free(alternatives);
+    }
+    
+    free(done);
+    freeProductionIndex(&index);
+    if (!ok) return grammarTooLarge(&result, "Left factoring");
+    return result;
+}
+
+// Check if a production has direct left recursion
+bool hasDirectLeftRecursion(Production prod) {
+    for (int i = 0; i < prod.numRHS; i++) {
+        int pos = 0;
+        char* firstSymbol = getSymbol(prod.rhs[i], &pos);
+        
+        if (firstSymbol != NULL && strcmp(firstSymbol, prod.lhs) == 0) {
+            free(firstSymbol);
+            return true;
+        }
+        
+        if (firstSymbol != NULL) {
+            free(firstSymbol);
+        }
+    }
+    
+    return false;
+}
+
+// Implementation of left recursion removal. A -> A α | β, over all of A's productions, becomes
+// A -> β A' and A' -> α A' | ε
+Grammar leftRecursionRemoval(Grammar grammar) {
+    Grammar result;
+    initGrammar(&result);
+    ProductionIndex index;
+    if (!copySymbols(&result, &grammar) || !indexProductions(&grammar, &index)) {
+        return grammarTooLarge(&result, "Left recursion removal");
+    }
+    bool ok = true;
+    
+    // For each non-terminal
+    for (int n = 0; n < grammar.numNonTerminals && ok; n++) {
+        const char* nonTerminal = grammar.nonTerminals[n];
+        bool recursive = false;
+        for (int k = index.start[n]; k < index.start[n + 1]; k++) {
+            if (hasDirectLeftRecursion(grammar.productions[index.production[k]])) recursive = true;
+        }
+        
+        if (!recursive) {
+            // No left recursion, add as is
+            for (int k = index.start[n]; k < index.start[n + 1] && ok; k++) {
+                const Production* prod = &grammar.productions[index.production[k]];
+                int copy = addProduction(&result, prod->lhs);
+                ok = copy != -1;
+                for (int j = 0; j < prod->numRHS && ok; j++) {
+                    ok = addAlternative(&result.productions[copy], prod->rhs[j]);
+                }
+            }
+            continue;
+        }
+        
+        // Create a new non-terminal for the recursive parts, making sure it is not already in use
+        char newNonTerminal[20];
+        ok = newNonTerminalName(&result, nonTerminal, newNonTerminal) && addNonTerminal(&result, newNonTerminal);
+        
+        // Every part gets the new non-terminal appended: first the non-recursive ones, as A's
+        // alternatives, then the suffixes of the recursive ones, as A''s
+        for (int recursivePart = 0; recursivePart <= 1 && ok; recursivePart++) {
+            const char* lhs = recursivePart ? newNonTerminal : nonTerminal;
+            for (int k = index.start[n]; k < index.start[n + 1] && ok; k++) {
+                const Production* prod = &grammar.productions[index.production[k]];
+                for (int j = 0; j < prod->numRHS && ok; j++) {
+                    int pos = 0;
+                    char* firstSymbol = getSymbol(prod->rhs[j], &pos);
+                    bool isRecursive = firstSymbol != NULL && strcmp(firstSymbol, nonTerminal) == 0;
+                    free(firstSymbol);
+                    if (isRecursive != recursivePart) continue;
+            
+                    const char* part = isRecursive ? prod->rhs[j] + pos : prod->rhs[j];
+                    part += scanSpaces(part, strlen(part));
+                    char newRHS[MAX_PROD_LEN];
+                    int written = part[0] == '\0' || strcmp(part, EPSILON) == 0
+                                ? snprintf(newRHS, MAX_PROD_LEN, "%s", newNonTerminal)
+                                : snprintf(newRHS, MAX_PROD_LEN, "%s %s", part, newNonTerminal);
+                    ok = written < MAX_PROD_LEN && addRuleAlternative(&result, lhs, newRHS);
+                }
+            }
+        }
+        // Add epsilon to the recursive production
+        ok = ok && addRuleAlternative(&result, newNonTerminal, EPSILON);
+    }
+    
+    freeProductionIndex(&index);
+    if (!ok) return grammarTooLarge(&result, "Left recursion removal");
+    return result;
+}
+
+// Split an alternative into its symbols, leaving out ε
+int splitSymbols(const char* rhs, char symbols[][20], int maxSymbols) {
+    int count = 0;
+    int pos = 0;
+    char* symbol;
+    while ((symbol = getSymbol(rhs, &pos)) != NULL) {
+        if (strcmp(symbol, EPSILON) != 0 && count < maxSymbols) {
+            strncpy(symbols[count], symbol, 19);
+            symbols[count][19] = '\0';
+            count++;
+        }
+        free(symbol);
+    }
+    return count;
+}
+
+// Join symbols back into an alternative; no symbols gives ε. False if they do not fit in MAX_PROD_LEN
+bool joinSymbols(char symbols[][20], int numSymbols, char* rhs) {
+    if (numSymbols == 0) {
+        strcpy(rhs, EPSILON);
+        return true;
+    }
+    rhs[0] = '\0';
+    for (int i = 0; i < numSymbols; i++) {
+        if (strlen(rhs) + strlen(symbols[i]) + 2 > MAX_PROD_LEN) return false;
+        if (i > 0) strcat(rhs, " ");
+        strcat(rhs, symbols[i]);
+    }
+    return true;
+}
+
+// Rewrite an alternative with every use of a non-terminal n that has renameTo[n] != -1 replaced by
+// non-terminal renameTo[n], keeping its action tag. Sets *uses to whether it uses a renamed one at all.
+// False if the rewritten alternative does not fit in MAX_PROD_LEN
+bool renameInAlternative(const Grammar* grammar, const char* rhs, const int* renameTo, char* renamed, bool* uses) {
+    char symbols[MAX_PROD_LEN][20];
+    int n = splitSymbols(rhs, symbols, MAX_PROD_LEN);
+    *uses = false;
+    for (int k = 0; k < n; k++) {
+        int index = findNonTerminalIndex(grammar, symbols[k]);
+        if (index != -1 && renameTo[index] != -1) {
+            strcpy(symbols[k], grammar->nonTerminals[renameTo[index]]);
+            *uses = true;
+        }
+    }
+    if (!*uses) return true;
+    
+    char tag[20];
+    if (!joinSymbols(symbols, n, renamed)) return false;
+    if (getActionTag(rhs, tag)) {
+        size_t used = strlen(renamed);
+        int written = snprintf(renamed + used, MAX_PROD_LEN - used, " @%s", tag);
+        if (written < 0 || (size_t)written >= MAX_PROD_LEN - used) return false;
+    }
+    return true;
+}
+
+// Drop the marked non-terminals, their productions and every alternative that uses one
+void removeNonTerminals(Grammar* grammar, const bool* removed) {
+    int numProductions = 0;
+    for (int i = 0; i < grammar->numProductions; i++) {
+        Production* prod = &grammar->productions[i];
+        int lhsIndex = findNonTerminalIndex(grammar, prod->lhs);
+        
+        int numRHS = 0;
+        for (int j = 0; j < prod->numRHS && (lhsIndex == -1 || !removed[lhsIndex]); j++) {
+            char symbols[MAX_PROD_LEN][20];
+            int numSymbols = splitSymbols(prod->rhs[j], symbols, MAX_PROD_LEN);
+            bool keep = true;
+            for (int k = 0; k < numSymbols && keep; k++) {
+                int index = findNonTerminalIndex(grammar, symbols[k]);
+                if (index != -1 && removed[index]) keep = false;
+            }
+            if (keep) {
+                if (numRHS != j) memcpy(prod->rhs[numRHS], prod->rhs[j], sizeof(*prod->rhs));
+                numRHS++;
+            }
+        }
+        prod->numRHS = numRHS;
+        
+        if (numRHS > 0) {
+            if (numProductions != i) grammar->productions[numProductions] = *prod;
+            numProductions++;
+        } else {
+            free(prod->rhs);
+        }
+    }
+    grammar->numProductions = numProductions;
+    
+    int numNonTerminals = 0;
+    for (int i = 0; i < grammar->numNonTerminals; i++) {
+        if (!removed[i]) {
+            if (numNonTerminals != i) memcpy(grammar->nonTerminals[numNonTerminals], grammar->nonTerminals[i], 20);
+            numNonTerminals++;
+        }
+    }
+    grammar->numNonTerminals = numNonTerminals;
+    freePerfectHash(grammar->nonTerminalHash);
+    grammar->nonTerminalHash = hashNames(grammar->nonTerminals, grammar->numNonTerminals);
+}
+
+// Keep only the terminals some alternative still uses, in their original order
+void removeUnusedTerminals(Grammar* grammar) {
+    bool* used = calloc(grammar->numTerminals + 1, sizeof(bool));
+    if (used == NULL) return;
+    for (int i = 0; i < grammar->numProductions; i++) {
+        for (int j = 0; j < grammar->productions[i].numRHS; j++) {
+            char symbols[MAX_PROD_LEN][20];
+            int numSymbols = splitSymbols(grammar->productions[i].rhs[j], symbols, MAX_PROD_LEN);
+            for (int k = 0; k < numSymbols; k++) {
+                int t = findTerminalIndex(grammar, symbols[k]);
+                if (t != -1) used[t] = true;
+            }
+        }
+    }
+    
+    int numTerminals = 0;
+    for (int t = 0; t < grammar->numTerminals; t++) {
+        if (used[t]) {
+            if (numTerminals != t) memcpy(grammar->terminals[numTerminals], grammar->terminals[t], 20);
+            numTerminals++;
+        }
+    }
+    grammar->numTerminals = numTerminals;
+    free(used);
+    freePerfectHash(grammar->terminalHash);
+    grammar->terminalHash = hashNames(grammar->terminals, grammar->numTerminals);
+}
+
+// Remove non-terminals that derive no terminal string, then those no entry symbol can reach
+void removeUselessSymbols(Grammar* grammar) {
+    int numNonTerminals = grammar->numNonTerminals;
+    bool* productive = calloc(numNonTerminals + 1, sizeof(bool));
+    bool* reachable = calloc(numNonTerminals + 1, sizeof(bool));
+    bool* removed = calloc(numNonTerminals + 1, sizeof(bool));
+    int* queue = malloc((numNonTerminals + 1) * sizeof(int));
+    ProductionIndex index = {NULL, NULL};
+    if (productive == NULL || reachable == NULL || removed == NULL || queue == NULL) {
+        free(productive);
+        free(reachable);
+        free(removed);
+        free(queue);
+        return;
+    }
+    
+    bool changes = true;
+    while (changes) {
+        changes = false;
+        for (int i = 0; i < grammar->numProductions; i++) {
+            const Production* prod = &grammar->productions[i];
+            int lhsIndex = findNonTerminalIndex(grammar, prod->lhs);
+            if (lhsIndex == -1 || productive[lhsIndex]) continue;
+            
+            for (int j = 0; j < prod->numRHS && !productive[lhsIndex]; j++) {
+                char symbols[MAX_PROD_LEN][20];
+                int numSymbols = splitSymbols(prod->rhs[j], symbols, MAX_PROD_LEN);
+                bool allProductive = true;
+                for (int k = 0; k < numSymbols && allProductive; k++) {
+                    int index = findNonTerminalIndex(grammar, symbols[k]);
+                    if (index != -1 && !productive[index]) allProductive = false;
+                }
+                if (allProductive) {
+                    productive[lhsIndex] = true;
+                    changes = true;
+                }
+            }
+        }
+    }
+    
+    // An unproductive start symbol means the language is empty; leave such a grammar alone
+    int start = findNonTerminalIndex(grammar, grammar->startSymbol);
+    if (start != -1 && productive[start]) {
+        for (int i = 0; i < grammar->numNonTerminals; i++) {
+            removed[i] = !productive[i];
+        }
+        removeNonTerminals(grammar, removed);
+    }
+    
+    int head = 0, tail = 0;
+    if (start != -1 && productive[start] && indexProductions(grammar, &index)) {
+        for (int i = 0; i < grammar->numNonTerminals; i++) {
+            if (isEntrySymbol(grammar, grammar->nonTerminals[i])) {
+                reachable[i] = true;
+                queue[tail++] = i;
+            }
+        }
+        while (head < tail) {
+            int nt = queue[head++];
+            for (int k = index.start[nt]; k < index.start[nt + 1]; k++) {
+                const Production* prod = &grammar->productions[index.production[k]];
+                for (int j = 0; j < prod->numRHS; j++) {
+                    char symbols[MAX_PROD_LEN][20];
+                    int numSymbols = splitSymbols(prod->rhs[j], symbols, MAX_PROD_LEN);
+                    for (int m = 0; m < numSymbols; m++) {
+                        int index = findNonTerminalIndex(grammar, symbols[m]);
+                        if (index != -1 && !reachable[index]) {
+                            reachable[index] = true;
+                            queue[tail++] = index;
+                        }
+                    }
+                }
+            }
+        }
+        
+        for (int i = 0; i < grammar->numNonTerminals; i++) {
+            removed[i] = !reachable[i];
+        }
+        removeNonTerminals(grammar, removed);
+        removeUnusedTerminals(grammar);
+    }
+    
+    freeProductionIndex(&index);
+    free(productive);
+    free(reachable);
+    free(removed);
+    free(queue);
+}
+
+// Replace alternatives A -> B by B's alternatives. The inlined alternatives select on subsets
+// of what A -> B selected on, so an LL(1) grammar stays LL(1). Returns true if anything changed
+bool collapseUnitProductions(Grammar* grammar) {
+    bool changed = false;
+    ProductionIndex index;
+    if (!indexProductions(grammar, &index)) return false;
+    
+    for (int i = 0; i < grammar->numProductions; i++) {
+        Production* prod = &grammar->productions[i];
+        
+        for (int j = 0; j < prod->numRHS; j++) {
+            // A tagged unit production stays, so its action still runs
+            char symbols[MAX_PROD_LEN][20];
+            char tag[20];
+            if (splitSymbols(prod->rhs[j], symbols, MAX_PROD_LEN) != 1 || getActionTag(prod->rhs[j], tag)) continue;
+            int unit = findNonTerminalIndex(grammar, symbols[0]);
+            if (strcmp(symbols[0], prod->lhs) == 0 || unit == -1) continue;
+            
+            // Gather B's alternatives; give up on unit cycles and on overflow
+            char inlined[MAX_RHS][MAX_PROD_LEN];
+            int numInlined = 0;
+            bool ok = true;
+            for (int k = index.start[unit]; k < index.start[unit + 1] && ok; k++) {
+                const Production* target = &grammar->productions[index.production[k]];
+                for (int m = 0; m < target->numRHS && ok; m++) {
+                    char targetSymbols[MAX_PROD_LEN][20];
+                    int n = splitSymbols(target->rhs[m], targetSymbols, MAX_PROD_LEN);
+                    if ((n == 1 && findNonTerminalIndex(grammar, targetSymbols[0]) != -1) || numInlined >= MAX_RHS) {
+                        ok = false;
+                    } else {
+                        strcpy(inlined[numInlined++], target->rhs[m]);
+                    }
+                }
+            }
+            if (!ok || numInlined == 0 || prod->numRHS - 1 + numInlined > MAX_RHS) continue;
+            char (*alternatives)[MAX_PROD_LEN] = growArray(prod->rhs, &prod->rhsCapacity, prod->numRHS - 1 + numInlined,
+                                                           sizeof(*prod->rhs));
+            if (alternatives == NULL) continue;
+            prod->rhs = alternatives;
+            
+            // Shift the following alternatives and splice B's in at j
+            memmove(prod->rhs[j + numInlined], prod->rhs[j + 1], (prod->numRHS - 1 - j) * sizeof(*prod->rhs));
+            for (int k = 0; k < numInlined; k++) {
+                strcpy(prod->rhs[j + k], inlined[k]);
+            }
+            prod->numRHS += numInlined - 1;
+            j += numInlined - 1;
+            changed = true;
+        }
+    }
+    
+    freeProductionIndex(&index);
+    return changed;
+}
+
+// A non-terminal's alternatives as one string, with its own name written as \1, so that non-terminals
+// with the same signature have the same alternatives, treating A inside A's and B inside B's as equal.
+// Action tags count too: merging alternatives with different tags would drop one tag's callbacks
+typedef struct {
+    char* text;
+    int nonTerminal;
+} Signature;
+    
+int compareSignatures(const void* a, const void* b) {
+    const Signature* x = (const Signature*)a;
+    const Signature* y = (const Signature*)b;
+    int order = strcmp(x->text, y->text);
+    return order != 0 ? order : x->nonTerminal - y->nonTerminal;
+}
+
+// Merge non-terminals with identical alternatives into the first of them. The signatures are sorted so
+// that identical ones are next to each other, and every merge is made in one rewrite of the grammar.
+// Returns true if anything changed
+bool mergeIdenticalNonTerminals(Grammar* grammar) {
+    int numNonTerminals = grammar->numNonTerminals;
+    ProductionIndex index;
+    if (!indexProductions(grammar, &index)) return false;
+    Signature* signatures = calloc(numNonTerminals + 1, sizeof(Signature));
+    int* renameTo = malloc((numNonTerminals + 1) * sizeof(int));
+    bool* removed = calloc(numNonTerminals + 1, sizeof(bool));
+    int numSignatures = 0;
+    bool ok = signatures != NULL && renameTo != NULL && removed != NULL;
+    
+    for (int n = 0; n < numNonTerminals && ok; n++) {
+        renameTo[n] = -1;
+        size_t length = 1;
+        for (int k = index.start[n]; k < index.start[n + 1]; k++) {
+            length += grammar->productions[index.production[k]].numRHS * (MAX_PROD_LEN + 24);
+        }
+        if (length == 1) continue;
+        Signature* signature = &signatures[numSignatures];
+        signature->nonTerminal = n;
+        signature->text = malloc(length);
+        ok = signature->text != NULL;
+        if (!ok) break;
+        numSignatures++;
+            
+        char* text = signature->text;
+        text[0] = '\0';
+        for (int k = index.start[n]; k < index.start[n + 1]; k++) {
+            const Production* prod = &grammar->productions[index.production[k]];
+            for (int j = 0; j < prod->numRHS; j++) {
+                char symbols[MAX_PROD_LEN][20], alternative[MAX_PROD_LEN], tag[20] = "";
+                int numSymbols = splitSymbols(prod->rhs[j], symbols, MAX_PROD_LEN);
+                for (int m = 0; m < numSymbols; m++) {
+                    if (strcmp(symbols[m], grammar->nonTerminals[n]) == 0) strcpy(symbols[m], "\1");
+                }
+                joinSymbols(symbols, numSymbols, alternative);
+                getActionTag(prod->rhs[j], tag);
+                text += sprintf(text, "%s @%s|", alternative, tag);
+            }
+        }
+    }
+    
+    // Each run of equal signatures merges into its first non-terminal; entry symbols stay
+    if (ok) qsort(signatures, numSignatures, sizeof(Signature), compareSignatures);
+    bool changed = false;
+    int first = 0;
+    for (int i = 1; i < numSignatures && ok; i++) {
+        if (strcmp(signatures[first].text, signatures[i].text) != 0) {
+            first = i;
+            continue;
+        }
+        if (isEntrySymbol(grammar, grammar->nonTerminals[signatures[i].nonTerminal])) continue;
+        renameTo[signatures[i].nonTerminal] = signatures[first].nonTerminal;
+        changed = true;
+    }
+    
+    // Pointing every use of B at A could make an alternative longer than MAX_PROD_LEN, since B's
+    // shorter name may be what lets it fit; the merges such an alternative needs are left out
+    char renamed[MAX_PROD_LEN];
+    bool fits = false;
+    while (changed && !fits) {
+        fits = true;
+        for (int i = 0; i < grammar->numProductions; i++) {
+            const Production* prod = &grammar->productions[i];
+            for (int j = 0; j < prod->numRHS; j++) {
+                bool uses;
+                if (renameInAlternative(grammar, prod->rhs[j], renameTo, renamed, &uses)) continue;
+                char symbols[MAX_PROD_LEN][20];
+                int numSymbols = splitSymbols(prod->rhs[j], symbols, MAX_PROD_LEN);
+                for (int k = 0; k < numSymbols; k++) {
+                    int n = findNonTerminalIndex(grammar, symbols[k]);
+                    if (n != -1) renameTo[n] = -1;
+                }
+                fits = false;
+            }
+        }
+    }
+    
+    changed = false;
+    for (int n = 0; n < numNonTerminals && ok; n++) {
+        removed[n] = renameTo[n] != -1;
+        if (removed[n]) changed = true;
+    }
+    if (changed) {
+        for (int i = 0; i < grammar->numProductions; i++) {
+            Production* prod = &grammar->productions[i];
+            for (int j = 0; j < prod->numRHS; j++) {
+                bool uses;
+                renameInAlternative(grammar, prod->rhs[j], renameTo, renamed, &uses);
+                if (uses) strcpy(prod->rhs[j], renamed);
+            }
+        }
+        removeNonTerminals(grammar, removed);
+    }
+    
+    for (int i = 0; i < numSignatures; i++) {
+        free(signatures[i].text);
+    }
+    free(signatures);
+    free(renameTo);
+    free(removed);
+    freeProductionIndex(&index);
+    return changed;
+}
+
+// Grammar simplification: useless symbols, unit productions and duplicate non-terminals
+Grammar simplifyGrammar(Grammar grammar) {
+    Grammar result = copyGrammar(&grammar);
+    if (result.numProductions < grammar.numProductions) return grammarTooLarge(&result, "Simplification");
+    
+    removeUselessSymbols(&result);
+    bool changed = true;
+    while (changed) {
+        changed = collapseUnitProductions(&result);
+        if (mergeIdenticalNonTerminals(&result)) changed = true;
+    }
+    removeUselessSymbols(&result);
+    
+    return result;
+}
+
+// Check if a symbol is a terminal
+bool isTerminal(Grammar grammar, const char* symbol) {
+    return findTerminalIndex(&grammar, symbol) != -1;
+}
+
+bool isEntrySymbol(const Grammar* grammar, const char* symbol) {
+    if (strcmp(grammar->startSymbol, symbol) == 0) return true;
+    for (int i = 0; i < grammar->numEntrySymbols; i++) {
+        if (strcmp(grammar->entrySymbols[i], symbol) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check if a symbol is a non-terminal
+bool isNonTerminal(Grammar grammar, const char* symbol) {
+    return findNonTerminalIndex(&grammar, symbol) != -1;
+}
+
+// Check if an element is in a set
+bool isInSet(Set set, const char* element) {
+    for (int i = 0; i < set.numElements; i++) {
+        if (strcmp(set.elements[i], element) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Find the index of a terminal in the grammar, or -1 if it is not one
+int findTerminalIndex(const Grammar* grammar, const char* symbol) {
+    return findName(grammar->terminalHash, grammar->terminals, grammar->numTerminals, symbol);
+}
+
+// Find the index of a non-terminal in the grammar, or -1 if it is not one
+int findNonTerminalIndex(const Grammar* grammar, const char* symbol) {
+    return findName(grammar->nonTerminalHash, grammar->nonTerminals, grammar->numNonTerminals, symbol);
+}
+
+// Number a grammar's symbols and alternatives, and find the non-terminals that can derive ε.
+// False if there was no memory for it
+bool encodeGrammar(const Grammar* grammar, EncodedGrammar* encoded) {
+    memset(encoded, 0, sizeof(EncodedGrammar));
+    int numTerminals = grammar->numTerminals;
+    int numNonTerminals = grammar->numNonTerminals;
+    encoded->grammar = grammar;
+    encoded->numTerminals = numTerminals;
+    encoded->numNonTerminals = numNonTerminals;
+    encoded->words = (numTerminals + 2 + 63) / 64;
+    
+    int numAlternatives = 0;
+    int numSymbols = 0;
+    for (int i = 0; i < grammar->numProductions; i++) {
+        numAlternatives += grammar->productions[i].numRHS;
+        for (int j = 0; j < grammar->productions[i].numRHS; j++) {
+            numSymbols += strlen(grammar->productions[i].rhs[j]);
+        }
+    }
+    encoded->lhs = (int*)malloc((numAlternatives + 1) * sizeof(int));
+    encoded->text = (const char**)malloc((numAlternatives + 1) * sizeof(const char*));
+    encoded->symbolStart = (int*)malloc((numAlternatives + 1) * sizeof(int));
+    encoded->symbols = (int*)malloc((numSymbols + 1) * sizeof(int));
+    encoded->alternativeStart = (int*)calloc(numNonTerminals + 2, sizeof(int));
+    encoded->byLhs = (int*)malloc((numAlternatives + 1) * sizeof(int));
+    encoded->nullable = (bool*)calloc(numNonTerminals + 1, sizeof(bool));
+    int* remaining = (int*)malloc((numAlternatives + 1) * sizeof(int));
+    int* occurrenceStart = (int*)calloc(numNonTerminals + 2, sizeof(int));
+    int* occurrences = (int*)malloc((numSymbols + 1) * sizeof(int));
+    int* queue = (int*)malloc((numNonTerminals + 1) * sizeof(int));
+    bool ok = encoded->lhs != NULL && encoded->text != NULL && encoded->symbolStart != NULL &&
+              encoded->symbols != NULL && encoded->alternativeStart != NULL && encoded->byLhs != NULL &&
+              encoded->nullable != NULL && remaining != NULL && occurrenceStart != NULL &&
+              occurrences != NULL && queue != NULL;
+    
+    if (ok) {
+        int a = 0;
+        int offset = 0;
+        for (int i = 0; i < grammar->numProductions; i++) {
+            const Production* prod = &grammar->productions[i];
+            int lhs = encodedSymbol(encoded, prod->lhs) - numTerminals;
+            if (lhs < 0) lhs = -1;
+            for (int j = 0; j < prod->numRHS; j++, a++) {
+                encoded->lhs[a] = lhs;
+                encoded->text[a] = prod->rhs[j];
+                encoded->symbolStart[a] = offset;
+                int pos = 0;
+                char* symbol;
+                while ((symbol = getSymbol(prod->rhs[j], &pos)) != NULL) {
+                    if (strcmp(symbol, EPSILON) != 0) {
+                        int s = encodedSymbol(encoded, symbol);
+                        encoded->symbols[offset++] = s;
+                        if (s >= numTerminals) occurrenceStart[s - numTerminals + 2]++;
+                    }
+                    free(symbol);
+                }
+                if (lhs != -1) encoded->alternativeStart[lhs + 2]++;
+            }
+        }
+        encoded->symbolStart[a] = offset;
+        encoded->numAlternatives = a;
+        
+        // Group the alternatives by non-terminal, and list where each non-terminal occurs
+        for (int n = 0; n < numNonTerminals; n++) {
+            encoded->alternativeStart[n + 2] += encoded->alternativeStart[n + 1];
+            occurrenceStart[n + 2] += occurrenceStart[n + 1];
+        }
+        for (a = 0; a < encoded->numAlternatives; a++) {
+            if (encoded->lhs[a] != -1) encoded->byLhs[encoded->alternativeStart[encoded->lhs[a] + 1]++] = a;
+            remaining[a] = encoded->symbolStart[a + 1] - encoded->symbolStart[a];
+            for (int i = encoded->symbolStart[a]; i < encoded->symbolStart[a + 1]; i++) {
+                int s = encoded->symbols[i];
+                if (s >= numTerminals) occurrences[occurrenceStart[s - numTerminals + 1]++] = a;
+            }
+        }
+        
+        // An alternative derives ε once each of its symbols does: count its symbols down as their
+        // non-terminals are found nullable, starting from the empty alternatives
+        int head = 0;
+        int tail = 0;
+        for (a = 0; a < encoded->numAlternatives; a++) {
+            int lhs = encoded->lhs[a];
+            if (remaining[a] == 0 && lhs != -1 && !encoded->nullable[lhs]) {
+                encoded->nullable[lhs] = true;
+                queue[tail++] = lhs;
+            }
+        }
+        while (head < tail) {
+            int n = queue[head++];
+            for (int i = occurrenceStart[n]; i < occurrenceStart[n + 1]; i++) {
+                a = occurrences[i];
+                int lhs = encoded->lhs[a];
+                if (--remaining[a] == 0 && lhs != -1 && !encoded->nullable[lhs]) {
+                    encoded->nullable[lhs] = true;
+                    queue[tail++] = lhs;
+                }
+            }
+        }
+    }
+    
+    free(remaining);
+    free(occurrenceStart);
+    free(occurrences);
+    free(queue);
+    if (!ok) freeEncodedGrammar(encoded);
+    return ok;
+}
+
+void freeEncodedGrammar(EncodedGrammar* encoded) {
+    free(encoded->lhs);
+    free(encoded->text);
+    free(encoded->symbolStart);
+    free(encoded->symbols);
+    free(encoded->alternativeStart);
+    free(encoded->byLhs);
+    free(encoded->nullable);
+    memset(encoded, 0, sizeof(EncodedGrammar));
+}
+
+// The number of a symbol, or -1 if the grammar does not list it
+int encodedSymbol(const EncodedGrammar* encoded, const char* name) {
+    const Grammar* grammar = encoded->grammar;
+    int t = findTerminalIndex(grammar, name);
+    if (t != -1) return t;
+    int n = findNonTerminalIndex(grammar, name);
+    return n == -1 ? -1 : grammar->numTerminals + n;
+}
+
+// Sets, one per non-terminal in grammar order, as bitsets
+void bitsFromSets(const EncodedGrammar* encoded, const Set* sets, uint64_t* bits) {
+    if (sets == NULL) return;
+    for (int n = 0; n < encoded->numNonTerminals; n++) {
+        uint64_t* set = bits + (size_t)n * encoded->words;
+        for (int i = 0; i < sets[n].numElements; i++) {
+            const char* element = sets[n].elements[i];
+            int bit = strcmp(element, EPSILON) == 0 ? encoded->numTerminals + 1
+                    : strcmp(element, "$") == 0 ? encoded->numTerminals
+                    : encodedSymbol(encoded, element);
+            if (bit < 0 || bit > encoded->numTerminals + 1) continue;
+            set[bit >> 6] |= 1ULL << (bit & 63);
+        }
+    }
+}
+        
+// Bitsets back into Sets, with their elements in bit order: the grammar's terminals, then $ and ε
+Set* setsFromBits(const Grammar* grammar, const EncodedGrammar* encoded, const uint64_t* bits) {
+    Set* sets = (Set*)calloc(encoded->numNonTerminals + 1, sizeof(Set));
+    if (sets == NULL) return NULL;
+    for (int n = 0; n < encoded->numNonTerminals; n++) {
+        const uint64_t* set = bits + (size_t)n * encoded->words;
+        strcpy(sets[n].symbol, grammar->nonTerminals[n]);
+        int count = 0;
+        for (int w = 0; w < encoded->words; w++) count += __builtin_popcountll(set[w]);
+        sets[n].elements = (char(*)[20])malloc((count + 1) * sizeof(*sets[n].elements));
+        if (sets[n].elements == NULL) {
+            freeSet(sets, n);
+            return NULL;
+        }
+        for (int w = 0; w < encoded->words; w++) {
+            for (uint64_t word = set[w]; word != 0; word &= word - 1) {
+                int bit = w * 64 + __builtin_ctzll(word);
+                strcpy(sets[n].elements[sets[n].numElements++],
+                       bit < encoded->numTerminals ? grammar->terminals[bit]
+                       : bit == encoded->numTerminals ? "$" : EPSILON);
+            }
+        }
+    }
+    return sets;
+}
+
+// OR FIRST of alternative a's symbols from the from-th on into set, without ε.
+// Returns true if those symbols can all derive ε
+bool addFirstOfAlternative(const EncodedGrammar* encoded, const uint64_t* first, int a, int from, uint64_t* set) {
+    int epsilon = encoded->numTerminals + 1;
+    bool nullable = true;
+    for (int i = encoded->symbolStart[a] + from; i < encoded->symbolStart[a + 1]; i++) {
+        int symbol = encoded->symbols[i];
+        if (symbol < encoded->numTerminals) {
+            if (symbol >= 0) set[symbol >> 6] |= 1ULL << (symbol & 63);
+            nullable = false;
+            break;
+        }
+        int n = symbol - encoded->numTerminals;
+        const uint64_t* other = first + (size_t)n * encoded->words;
+        for (int w = 0; w < encoded->words; w++) set[w] |= other[w];
+        if (!encoded->nullable[n]) {
+            nullable = false;
+            break;
+        }
+    }
+    set[epsilon >> 6] &= ~(1ULL << (epsilon & 63));
+    return nullable;
+}
+
+// Dependency edges from (from, to) pairs: pairs[2k] reads pairs[2k + 1]
+bool buildDependencyGraph(DependencyGraph* graph, int numNodes, const int* pairs, int numPairs) {
+    graph->numNodes = numNodes;
+    graph->edgeStart = (int*)calloc(numNodes + 2, sizeof(int));
+    graph->edges = (int*)malloc((numPairs + 1) * sizeof(int));
+    if (graph->edgeStart == NULL || graph->edges == NULL) {
+        free(graph->edgeStart);
+        free(graph->edges);
+        return false;
+    }
+    for (int k = 0; k < numPairs; k++) graph->edgeStart[pairs[2 * k] + 2]++;
+    for (int v = 0; v < numNodes; v++) graph->edgeStart[v + 2] += graph->edgeStart[v + 1];
+    for (int k = 0; k < numPairs; k++) graph->edges[graph->edgeStart[pairs[2 * k] + 1]++] = pairs[2 * k + 1];
+    return true;
+}
+
+// Tarjan's algorithm without recursion, so deep dependency chains cannot overflow the stack.
+// Components come out after every component they read from; then each component lists the
+// components reading it and counts the components it waits for
+bool findComponents(SccSchedule* schedule) {
+    const DependencyGraph* graph = schedule->graph;
+    int numNodes = graph->numNodes;
+    int numEdges = graph->edgeStart[numNodes];
+    schedule->componentOf = (int*)malloc((numNodes + 1) * sizeof(int));
+    schedule->memberStart = (int*)malloc((numNodes + 2) * sizeof(int));
+    schedule->members = (int*)malloc((numNodes + 1) * sizeof(int));
+    schedule->dependentStart = (int*)calloc(numNodes + 2, sizeof(int));
+    schedule->dependents = (int*)malloc((numEdges + 1) * sizeof(int));
+    schedule->pending = (int*)calloc(numNodes + 1, sizeof(int));
+    schedule->ready = (int*)malloc((numNodes + 1) * sizeof(int));
+    int* index = (int*)malloc((numNodes + 1) * sizeof(int));
+    int* lowLink = (int*)malloc((numNodes + 1) * sizeof(int));
+    int* nextEdge = (int*)malloc((numNodes + 1) * sizeof(int));
+    int* stack = (int*)malloc((numNodes + 1) * sizeof(int));
+    int* path = (int*)malloc((numNodes + 1) * sizeof(int));
+    bool* onStack = (bool*)calloc(numNodes + 1, sizeof(bool));
+    bool ok = schedule->componentOf != NULL && schedule->memberStart != NULL && schedule->members != NULL &&
+              schedule->dependentStart != NULL && schedule->dependents != NULL && schedule->pending != NULL &&
+              schedule->ready != NULL && index != NULL && lowLink != NULL && nextEdge != NULL &&
+              stack != NULL && path != NULL && onStack != NULL;
+    
+    if (ok) {
+        for (int v = 0; v < numNodes; v++) index[v] = -1;
+        int counter = 0;
+        int stackSize = 0;
+        int numMembers = 0;
+        schedule->numComponents = 0;
+        for (int root = 0; root < numNodes; root++) {
+            if (index[root] != -1) continue;
+            int depth = 0;
+            path[depth++] = root;
+            index[root] = lowLink[root] = counter++;
+            nextEdge[root] = graph->edgeStart[root];
+            stack[stackSize++] = root;
+            onStack[root] = true;
+
+            while (depth > 0) {
+                int v = path[depth - 1];
+                if (nextEdge[v] < graph->edgeStart[v + 1]) {
+                    int w = graph->edges[nextEdge[v]++];
+                    if (index[w] == -1) {
+                        index[w] = lowLink[w] = counter++;
+                        nextEdge[w] = graph->edgeStart[w];
+                        stack[stackSize++] = w;
+                        onStack[w] = true;
+                        path[depth++] = w;
+                    } else if (onStack[w] && index[w] < lowLink[v]) {
+                        lowLink[v] = index[w];
+                    }
+                    continue;
+                }
+    
+                // v is finished: it roots a component, or passes its low link to its parent
+                depth--;
+                if (lowLink[v] == index[v]) {
+                    int c = schedule->numComponents++;
+                    schedule->memberStart[c] = numMembers;
+                    int w;
+                    do {
+                        w = stack[--stackSize];
+                        onStack[w] = false;
+                        schedule->componentOf[w] = c;
+                        schedule->members[numMembers++] = w;
+                    } while (w != v);
+                }
+                if (depth > 0 && lowLink[v] < lowLink[path[depth - 1]]) {
+                    lowLink[path[depth - 1]] = lowLink[v];
+                }
+            }
+        }
+        schedule->memberStart[schedule->numComponents] = numMembers;
+        
+        // Each component is listed once per component it reads from; index[] marks the last
+        // reader a component was counted for
+        for (int pass = 0; pass < 2; pass++) {
+            for (int c = 0; c < schedule->numComponents; c++) index[c] = -1;
+            for (int c = 0; c < schedule->numComponents; c++) {
+                for (int m = schedule->memberStart[c]; m < schedule->memberStart[c + 1]; m++) {
+                    int v = schedule->members[m];
+                    for (int e = graph->edgeStart[v]; e < graph->edgeStart[v + 1]; e++) {
+                        int d = schedule->componentOf[graph->edges[e]];
+                        if (d == c || index[d] == c) continue;
+                        index[d] = c;
+                        if (pass == 0) {
+                            schedule->dependentStart[d + 2]++;
+                            schedule->pending[c]++;
+                        } else {
+                            schedule->dependents[schedule->dependentStart[d + 1]++] = c;
+                        }
+                    }
+                }
+            }
+            if (pass == 0) {
+                for (int c = 0; c < schedule->numComponents; c++) {
+                    schedule->dependentStart[c + 2] += schedule->dependentStart[c + 1];
+                }
+            }
+        }
+    }
+    
+    free(index);
+    free(lowLink);
+    free(nextEdge);
+    free(stack);
+    free(path);
+    free(onStack);
+    if (!ok) freeSccSchedule(schedule);
+    return ok;
+}
+
+void freeSccSchedule(SccSchedule* schedule) {
+    free(schedule->componentOf);
+    free(schedule->memberStart);
+    free(schedule->members);
+    free(schedule->dependentStart);
+    free(schedule->dependents);
+    free(schedule->pending);
+    free(schedule->ready);
+    schedule->componentOf = schedule->memberStart = schedule->members = NULL;
+    schedule->dependentStart = schedule->dependents = schedule->pending = schedule->ready = NULL;
+}
+    
+// Solve one component once every component it reads from is solved: its members' sets all
+// become the union of their own and of every set they read from
+void solveComponent(SccSchedule* schedule, int c) {
+    const DependencyGraph* graph = schedule->graph;
+    int words = schedule->words;
+    const int* members = schedule->members + schedule->memberStart[c];
+    int numMembers = schedule->memberStart[c + 1] - schedule->memberStart[c];
+    uint64_t* merged = schedule->sets + (size_t)members[0] * words;
+        
+    for (int m = 0; m < numMembers; m++) {
+        int v = members[m];
+        if (m > 0) {
+            const uint64_t* own = schedule->sets + (size_t)v * words;
+            for (int w = 0; w < words; w++) merged[w] |= own[w];
+        }
+        for (int e = graph->edgeStart[v]; e < graph->edgeStart[v + 1]; e++) {
+            int other = graph->edges[e];
+            if (schedule->componentOf[other] == c) continue;
+            const uint64_t* read = schedule->sets + (size_t)other * words;
+            for (int w = 0; w < words; w++) merged[w] |= read[w];
+        }
+    }
+    for (int m = 1; m < numMembers; m++) {
+        memcpy(schedule->sets + (size_t)members[m] * words, merged, words * sizeof(uint64_t));
+    }
+}
+
+// Worker: solve ready components until every component is done
+void* sccWorker(void* arg) {
+    SccSchedule* schedule = (SccSchedule*)arg;
+    
+    pthread_mutex_lock(&schedule->lock);
+    while (schedule->numDone < schedule->numComponents) {
+        if (schedule->readyHead == schedule->readyTail) {
+            pthread_cond_wait(&schedule->cond, &schedule->lock);
+            continue;
+        }
+        int c = schedule->ready[schedule->readyHead++];
+        pthread_mutex_unlock(&schedule->lock);
+        
+        solveComponent(schedule, c);
+        
+        pthread_mutex_lock(&schedule->lock);
+        for (int i = schedule->dependentStart[c]; i < schedule->dependentStart[c + 1]; i++) {
+            int dependent = schedule->dependents[i];
+            if (--schedule->pending[dependent] == 0) {
+                schedule->ready[schedule->readyTail++] = dependent;
+            }
+        }
+        schedule->numDone++;
+        pthread_cond_broadcast(&schedule->cond);
+    }
+    pthread_mutex_unlock(&schedule->lock);
+    return NULL;
+}
+
+// Solve set equations where each node's set includes the sets its edges lead to. With more than
+// one thread, each component starts as soon as the components it reads from finish.
+// False if there was no memory for it
+bool solveDependencies(const DependencyGraph* graph, uint64_t* sets, int words, int numThreads) {
+    SccSchedule schedule;
+    memset(&schedule, 0, sizeof(SccSchedule));
+    schedule.graph = graph;
+    schedule.sets = sets;
+    schedule.words = words;
+    if (!findComponents(&schedule)) return false;
+    
+    if (numThreads > schedule.numComponents) numThreads = schedule.numComponents;
+    if (numThreads > MAX_THREADS) numThreads = MAX_THREADS;
+    if (numThreads <= 1) {
+        // Emission order already puts every component after the ones it reads from
+        for (int c = 0; c < schedule.numComponents; c++) {
+            solveComponent(&schedule, c);
+        }
+        freeSccSchedule(&schedule);
+        return true;
+    }
+    
+    for (int c = 0; c < schedule.numComponents; c++) {
+        if (schedule.pending[c] == 0) {
+            schedule.ready[schedule.readyTail++] = c;
+        }
+    }
+    pthread_mutex_init(&schedule.lock, NULL);
+    pthread_cond_init(&schedule.cond, NULL);
+    
+    pthread_t threads[MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < numThreads; i++) {
+        if (pthread_create(&threads[started], NULL, sccWorker, &schedule) == 0) {
+            started++;
+        }
+    }
+    sccWorker(&schedule);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    pthread_cond_destroy(&schedule.cond);
+    pthread_mutex_destroy(&schedule.lock);
+    freeSccSchedule(&schedule);
+    return true;
+}
+
+// Compute the FIRST sets for all non-terminals
+Set* computeFirstSets(Grammar grammar) {
+    return computeFirstSetsParallel(grammar, 1);
+}
+
+// Compute the FOLLOW sets for all non-terminals
+Set* computeFollowSets(Grammar grammar, Set* firstSets) {
+    return computeFollowSetsParallel(grammar, firstSets, 1);
+}
+
+// FIRST(A) holds each terminal that begins one of A's alternatives after nothing but nullable
+// non-terminals, and includes FIRST(B) of each of those B and of the first B that is not nullable.
+// The equations are solved one strongly connected component at a time
+Set* computeFirstSetsParallel(Grammar grammar, int numThreads) {
+    EncodedGrammar encoded;
+    if (!encodeGrammar(&grammar, &encoded)) return NULL;
+    int words = encoded.words;
+    int numTerminals = encoded.numTerminals;
+    int numNonTerminals = encoded.numNonTerminals;
+    
+    Set* sets = NULL;
+    uint64_t* first = (uint64_t*)calloc((size_t)numNonTerminals * words + 1, sizeof(uint64_t));
+    int* pairs = (int*)malloc((2 * (size_t)encoded.symbolStart[encoded.numAlternatives] + 2) * sizeof(int));
+    DependencyGraph graph;
+    if (first != NULL && pairs != NULL) {
+        int numPairs = 0;
+        for (int a = 0; a < encoded.numAlternatives; a++) {
+            int lhs = encoded.lhs[a];
+            if (lhs == -1) continue;
+            uint64_t* set = first + (size_t)lhs * words;
+            for (int i = encoded.symbolStart[a]; i < encoded.symbolStart[a + 1]; i++) {
+                int symbol = encoded.symbols[i];
+                if (symbol < numTerminals) {
+                    if (symbol >= 0) set[symbol >> 6] |= 1ULL << (symbol & 63);
+                    break;
+                }
+                pairs[2 * numPairs] = lhs;
+                pairs[2 * numPairs + 1] = symbol - numTerminals;
+                numPairs++;
+                if (!encoded.nullable[symbol - numTerminals]) break;
+            }
+        }
+
+        if (buildDependencyGraph(&graph, numNonTerminals, pairs, numPairs)) {
+            if (solveDependencies(&graph, first, words, numThreads)) {
+                int epsilon = numTerminals + 1;
+                for (int n = 0; n < numNonTerminals; n++) {
+                    if (encoded.nullable[n]) first[(size_t)n * words + (epsilon >> 6)] |= 1ULL << (epsilon & 63);
+                }
+                sets = setsFromBits(&grammar, &encoded, first);
+            }
+            free(graph.edgeStart);
+            free(graph.edges);
+        }
+    }
+    
+    if (sets == NULL) printf("Out of memory computing the FIRST sets\n");
+    free(first);
+    free(pairs);
+    freeEncodedGrammar(&encoded);
+    return sets;
+}
+
+// FOLLOW(B) holds $ if B is an entry symbol, and FIRST of whatever follows B in an alternative;
+// where that can derive ε, it includes FOLLOW of the alternative's non-terminal. Solved like FIRST
+Set* computeFollowSetsParallel(Grammar grammar, Set* firstSets, int numThreads) {
+    EncodedGrammar encoded;
+    if (firstSets == NULL || !encodeGrammar(&grammar, &encoded)) return NULL;
+    int words = encoded.words;
+    int numTerminals = encoded.numTerminals;
+    int numNonTerminals = encoded.numNonTerminals;
+    int epsilon = numTerminals + 1;
+    
+    Set* sets = NULL;
+    uint64_t* first = (uint64_t*)calloc((size_t)numNonTerminals * words + 1, sizeof(uint64_t));
+    uint64_t* follow = (uint64_t*)calloc((size_t)numNonTerminals * words + 1, sizeof(uint64_t));
+    uint64_t* trailer = (uint64_t*)malloc(words * sizeof(uint64_t));
+    int* pairs = (int*)malloc((2 * (size_t)encoded.symbolStart[encoded.numAlternatives] + 2) * sizeof(int));
+    DependencyGraph graph;
+    if (first != NULL && follow != NULL && trailer != NULL && pairs != NULL) {
+        bitsFromSets(&encoded, firstSets, first);
+        for (int n = 0; n < numNonTerminals; n++) {
+            if (isEntrySymbol(&grammar, grammar.nonTerminals[n])) {
+                follow[(size_t)n * words + (numTerminals >> 6)] |= 1ULL << (numTerminals & 63);
+            }
+        }
+        
+        // Walk each alternative right to left, carrying FIRST of what follows the current symbol
+        int numPairs = 0;
+        for (int a = 0; a < encoded.numAlternatives; a++) {
+            int lhs = encoded.lhs[a];
+            if (lhs == -1) continue;
+            memset(trailer, 0, words * sizeof(uint64_t));
+            bool restNullable = true;
+            for (int i = encoded.symbolStart[a + 1] - 1; i >= encoded.symbolStart[a]; i--) {
+                int symbol = encoded.symbols[i];
+                if (symbol < numTerminals) {
+                    memset(trailer, 0, words * sizeof(uint64_t));
+                    if (symbol >= 0) trailer[symbol >> 6] |= 1ULL << (symbol & 63);
+                    restNullable = false;
+                    continue;
+                }
+                int n = symbol - numTerminals;
+                uint64_t* set = follow + (size_t)n * words;
+                for (int w = 0; w < words; w++) set[w] |= trailer[w];
+                if (restNullable) {
+                    pairs[2 * numPairs] = n;
+                    pairs[2 * numPairs + 1] = lhs;
+                    numPairs++;
+                }
+                if (!encoded.nullable[n]) {
+                    memset(trailer, 0, words * sizeof(uint64_t));
+                    restNullable = false;
+                }
+                const uint64_t* own = first + (size_t)n * words;
+                for (int w = 0; w < words; w++) trailer[w] |= own[w];
+                trailer[epsilon >> 6] &= ~(1ULL << (epsilon & 63));
+            }
+        }
+        
+        if (buildDependencyGraph(&graph, numNonTerminals, pairs, numPairs)) {
+            if (solveDependencies(&graph, follow, words, numThreads)) {
+                sets = setsFromBits(&grammar, &encoded, follow);
+            }
+            free(graph.edgeStart);
+            free(graph.edges);
+        }
+    }
+    
+    if (sets == NULL) printf("Out of memory computing the FOLLOW sets\n");
+    free(first);
+    free(follow);
+    free(trailer);
+    free(pairs);
+    freeEncodedGrammar(&encoded);
+    return sets;
+}
+
+// Construct the LL(1) parsing table
+/*
+ParseTable constructLL1Table(Grammar grammar, Set* firstSets, Set* followSets) {
+    ParseTable table;
+    table.numEntries = 0;
+    
+    // Copy terminals and non-terminals
+    table.numTerminals = grammar.numTerminals;
+    for (int i = 0; i < grammar.numTerminals; i++) {
+        strcpy(table.terminals[i], grammar.terminals[i]);
+    }
+    
+    // Add $ as a terminal
+    strcpy(table.terminals[table.numTerminals], "$");
+    table.numTerminals++;
+    
+    table.numNonTerminals = grammar.numNonTerminals;
+    for (int i = 0; i < grammar.numNonTerminals; i++) {
+        strcpy(table.nonTerminals[i], grammar.nonTerminals[i]);
+    }
+    
+    // For each production
+    for (int i = 0; i < grammar.numProductions; i++) {
+        Production prod = grammar.productions[i];
+        
+        // Find the index of this non-terminal in firstSets
+        int ntIndex = -1;
+        for (int j = 0; j < grammar.numNonTerminals; j++) {
+            if (strcmp(firstSets[j].symbol, prod.lhs) == 0) {
+                ntIndex = j;
+                break;
+            }
+        }
+        
+        if (ntIndex == -1) continue;
+        
+        // For each RHS
+        for (int j = 0; j < prod.numRHS; j++) {
+            char* rhs = prod.rhs[j];
+            
+            // Get the first symbol of RHS
+            int pos = 0;
+            char* firstSymbol = getSymbol(rhs, &pos);
+            
+            // If RHS is epsilon or starts with a terminal
+            if (firstSymbol == NULL || strcmp(firstSymbol, EPSILON) == 0 || isTerminal(grammar, firstSymbol)) {
+                if (firstSymbol == NULL || strcmp(firstSymbol, EPSILON) == 0) {
+                    // For each terminal in FOLLOW(LHS)
+                    for (int k = 0; k < followSets[ntIndex].numElements; k++) {
+                        char* terminal = followSets[ntIndex].elements[k];
+                        
+                        // Add entry to the parsing table
+                        strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
+                        strcpy(table.entries[table.numEntries].terminal, terminal);
+                        
+                        if (strcmp(rhs, EPSILON) == 0) {
+                            strcpy(table.entries[table.numEntries].production, EPSILON);
+                        } else {
+                            strcpy(table.entries[table.numEntries].production, rhs);
+                        }
+                        
+                        table.numEntries++;
+                    }
+                } else {
+                    // Add entry to the parsing table
+                    strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
+                    strcpy(table.entries[table.numEntries].terminal, firstSymbol);
+                    strcpy(table.entries[table.numEntries].production, rhs);
+                    table.numEntries++;
+                }
+            }
+            // If RHS starts with a non-terminal
+            else if (isNonTerminal(grammar, firstSymbol)) {
+                // Find FIRST(firstSymbol)
+                int symbolIndex = -1;
+                for (int k = 0; k < grammar.numNonTerminals; k++) {
+                    if (strcmp(firstSets[k].symbol, firstSymbol) == 0) {
+                        symbolIndex = k;
+                        break;
+                    }
+                }
+                
+                if (symbolIndex != -1) {
+                    // For each terminal in FIRST(firstSymbol)
+                    for (int k = 0; k < firstSets[symbolIndex].numElements; k++) {
+                        char* terminal = firstSets[symbolIndex].elements[k];
+                        
+                        // Skip epsilon
+                        if (strcmp(terminal, EPSILON) == 0) continue;
+                        
+                        // Add entry to the parsing table
+                        strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
+                        strcpy(table.entries[table.numEntries].terminal, terminal);
+                        strcpy(table.entries[table.numEntries].production, rhs);
+                        table.numEntries++;
+                    }
+                    
+                    // Check if FIRST(firstSymbol) contains epsilon
+                    bool hasEpsilon = false;
+                    for (int k = 0; k < firstSets[symbolIndex].numElements; k++) {
+                        if (strcmp(firstSets[symbolIndex].elements[k], EPSILON) == 0) {
+                            hasEpsilon = true;
+                            break;
+                        }
+                    }
+                    
+                    if (hasEpsilon) {
+                        // For each terminal in FOLLOW(LHS)
+                        for (int k = 0; k < followSets[ntIndex].numElements; k++) {
+                            char* terminal = followSets[ntIndex].elements[k];
+                            
+                            // Add entry to the parsing table
+                            strcpy(table.entries[table.numEntries].nonTerminal, prod.lhs);
+                            strcpy(table.entries[table.numEntries].terminal, terminal);
+                            strcpy(table.entries[table.numEntries].production, rhs);
+                            table.numEntries++;
+                        }
+                    }
+                }
+            }
+            
+            if (firstSymbol != NULL) {
+                free(firstSymbol);
+            }
+        }
+    }
+    
+    return table;
+}
+*/
+
+// Fill one row of the parsing table from the alternatives of its non-terminal: each selects FIRST of
+// its symbols, and FOLLOW of the non-terminal when those can derive ε. A row only reads the encoded
+// grammar and the finished sets, and writes only its own cells, so rows can be built independently
+void buildTableRow(const EncodedGrammar* encoded, const uint64_t* first, const uint64_t* follow,
+                   ParseTable* table, int row, uint64_t* select, TableRow* result) {
+    int words = encoded->words;
+    int* cells = table->cells + (size_t)row * table->numTerminals;
+    for (int t = 0; t < table->numTerminals; t++) {
+        cells[t] = -1;
+    }
+    
+    for (int k = encoded->alternativeStart[row]; k < encoded->alternativeStart[row + 1]; k++) {
+        int a = encoded->byLhs[k];
+        const char* production = encoded->text[a];
+        memset(select, 0, words * sizeof(uint64_t));
+        if (addFirstOfAlternative(encoded, first, a, 0, select)) {
+            const uint64_t* rowFollow = follow + (size_t)row * words;
+            for (int w = 0; w < words; w++) select[w] |= rowFollow[w];
+        }
+        
+        // Bit t is column t, $ included
+        for (int w = 0; w < words; w++) {
+            for (uint64_t word = select[w]; word != 0; word &= word - 1) {
+                int column = w * 64 + __builtin_ctzll(word);
+                if (column >= table->numTerminals) break;
+            
+                int existing = cells[column];
+                if (existing != -1) {
+                    // Keep the first production, report the clash
+                    if (strcmp(result->entries[existing].production, production) != 0) {
+                        if (result->numConflicts < MAX_CONFLICTS) {
+                            TableConflict* conflicts = (TableConflict*)growArray(result->conflicts,
+                                &result->conflictCapacity, result->numConflicts + 1, sizeof(TableConflict));
+                            if (conflicts == NULL) continue;
+                            result->conflicts = conflicts;
+                            TableConflict* conflict = &conflicts[result->numConflicts];
+                            strcpy(conflict->nonTerminal, table->nonTerminals[row]);
+                            strcpy(conflict->terminal, table->terminals[column]);
+                            strcpy(conflict->production1, result->entries[existing].production);
+                            strcpy(conflict->production2, production);
+                        }
+                        result->numConflicts++;
+                    }
+                    continue;
+                }
+                
+                ParseTableEntry* entries = (ParseTableEntry*)growArray(result->entries, &result->entryCapacity,
+                                                                       result->numEntries + 1, sizeof(ParseTableEntry));
+                if (entries == NULL) continue;
+                result->entries = entries;
+                ParseTableEntry* entry = &entries[result->numEntries];
+                strcpy(entry->nonTerminal, table->nonTerminals[row]);
+                strcpy(entry->terminal, table->terminals[column]);
+                strcpy(entry->production, production);
+                cells[column] = result->numEntries++;
+            }
+        }
+    }
+}
+
+typedef struct {
+    const EncodedGrammar* encoded;
+    const uint64_t* first;
+    const uint64_t* follow;
+    ParseTable* table;
+    TableRow* rows;
+    uint64_t* select;     // Scratch space for one select set
+    int firstRow;         // This thread fills rows firstRow .. endRow - 1
+    int endRow;
+} TableRowTask;
+
+void* tableRowWorker(void* arg) {
+    TableRowTask* task = (TableRowTask*)arg;
+    for (int row = task->firstRow; row < task->endRow; row++) {
+        buildTableRow(task->encoded, task->first, task->follow, task->table, row, task->select, &task->rows[row]);
+    }
+    return NULL;
+}
+
+// Build the LL(1) parsing table with the rows partitioned across numThreads threads. Each thread takes
+// a run of consecutive rows holding about the same number of alternatives, so it writes one block of
+// cells and no thread waits on another's long rows; rows and their conflicts are merged in row order afterwards
+ParseTable constructLL1TableParallel(Grammar grammar, Set* firstSets, Set* followSets, int numThreads) {
+    ParseTable table;
+    memset(&table, 0, sizeof(ParseTable));
+    EncodedGrammar encoded;
+    if (!encodeGrammar(&grammar, &encoded)) {
+        printf("Out of memory building the parse table\n");
+        return table;
+    }
+    
+    // Copy terminals and non-terminals, with $ as the last terminal
+    int numTerminals = grammar.numTerminals + 1;
+    int numNonTerminals = grammar.numNonTerminals;
+    size_t setSize = (size_t)numNonTerminals * encoded.words + 1;
+    table.terminals = (char(*)[20])malloc(numTerminals * sizeof(*table.terminals));
+    table.nonTerminals = (char(*)[20])malloc((numNonTerminals + 1) * sizeof(*table.nonTerminals));
+    table.cells = (int*)malloc(((size_t)numNonTerminals * numTerminals + 1) * sizeof(int));
+    uint64_t* first = (uint64_t*)calloc(setSize, sizeof(uint64_t));
+    uint64_t* follow = (uint64_t*)calloc(setSize, sizeof(uint64_t));
+    TableRow* rows = (TableRow*)calloc(numNonTerminals + 1, sizeof(TableRow));
+    
+    if (numThreads > numNonTerminals) numThreads = numNonTerminals;
+    if (numThreads > MAX_THREADS) numThreads = MAX_THREADS;
+    if (numThreads < 1) numThreads = 1;
+    uint64_t* select = (uint64_t*)malloc((size_t)numThreads * encoded.words * sizeof(uint64_t));
+    
+    if (table.terminals == NULL || table.nonTerminals == NULL || table.cells == NULL || first == NULL ||
+        follow == NULL || rows == NULL || select == NULL) {
+        printf("Out of memory building the parse table\n");
+        freeParseTable(&table);
+    } else {
+        for (int i = 0; i < grammar.numTerminals; i++) {
+            strcpy(table.terminals[i], grammar.terminals[i]);
+        }
+        strcpy(table.terminals[grammar.numTerminals], "$");
+        table.numTerminals = numTerminals;
+        for (int i = 0; i < numNonTerminals; i++) {
+            strcpy(table.nonTerminals[i], grammar.nonTerminals[i]);
+        }
+        table.numNonTerminals = numNonTerminals;
+        bitsFromSets(&encoded, firstSets, first);
+        bitsFromSets(&encoded, followSets, follow);
+    
+        pthread_t threads[MAX_THREADS];
+        bool started[MAX_THREADS];
+        TableRowTask tasks[MAX_THREADS];
+        int row = 0;
+        for (int i = 0; i < numThreads; i++) {
+            long long target = (long long)encoded.alternativeStart[numNonTerminals] * (i + 1) / numThreads;
+            tasks[i].firstRow = row;
+            while (row < numNonTerminals && (encoded.alternativeStart[row] < target || i == numThreads - 1)) {
+                row++;
+            }
+            tasks[i].endRow = row;
+            tasks[i].encoded = &encoded;
+            tasks[i].first = first;
+            tasks[i].follow = follow;
+            tasks[i].table = &table;
+            tasks[i].rows = rows;
+            tasks[i].select = select + (size_t)i * encoded.words;
+            started[i] = i > 0 && pthread_create(&threads[i], NULL, tableRowWorker, &tasks[i]) == 0;
+        }
+        // The calling thread takes the first partition, and any partition a thread could not be started for
+        for (int i = 0; i < numThreads; i++) {
+            if (!started[i]) tableRowWorker(&tasks[i]);
+        }
+        for (int i = 0; i < numThreads; i++) {
+            if (started[i]) pthread_join(threads[i], NULL);
+        }
+        
+        // Merge rows into the entry list, numbering each row's cells after the rows before it
+        int numEntries = 0;
+        for (int row = 0; row < numNonTerminals; row++) {
+            numEntries += rows[row].numEntries;
+        }
+        table.entries = (ParseTableEntry*)malloc((numEntries + 1) * sizeof(ParseTableEntry));
+        if (table.entries == NULL) {
+            printf("Out of memory building the parse table\n");
+            freeParseTable(&table);
+        } else {
+            for (int row = 0; row < numNonTerminals; row++) {
+                TableRow* r = &rows[row];
+                int* cells = table.cells + (size_t)row * numTerminals;
+                for (int t = 0; t < numTerminals; t++) {
+                    if (cells[t] != -1) cells[t] += table.numEntries;
+                }
+                for (int k = 0; k < r->numEntries; k++) {
+                    table.entries[table.numEntries++] = r->entries[k];
+                }
+                for (int k = 0; k < r->numConflicts; k++) {
+                    if (table.numConflicts < MAX_CONFLICTS && k < MAX_CONFLICTS) {
+                        table.conflicts[table.numConflicts] = r->conflicts[k];
+                    }
+                    table.numConflicts++;
+                }
+            }
+        }
+    }
+    
+    for (int row = 0; rows != NULL && row < numNonTerminals; row++) {
+        free(rows[row].entries);
+        free(rows[row].conflicts);
+    }
+    free(rows);
+    free(select);
+    free(first);
+    free(follow);
+    freeEncodedGrammar(&encoded);
+    return table;
+}
+
+ParseTable constructLL1Table(Grammar grammar, Set* firstSets, Set* followSets) {
+    debugPrintf("Initializing parse table with %d terminals and %d non-terminals\n",
+           grammar.numTerminals + 1, grammar.numNonTerminals);
+    
+    ParseTable table = constructLL1TableParallel(grammar, firstSets, followSets, 1);
+    
+    for (int i = 0; i < table.numConflicts && i < MAX_CONFLICTS; i++) {
+        debugPrintf("Conflict at [%s, %s]: %s vs %s\n", table.conflicts[i].nonTerminal, table.conflicts[i].terminal,
+               table.conflicts[i].production1, table.conflicts[i].production2);
+    }
+    debugPrintf("\nParse table construction complete. Total entries: %d\n", table.numEntries);
+    return table;
+}
+
+void freeParseTable(ParseTable* table) {
+    free(table->entries);
+    free(table->terminals);
+    free(table->nonTerminals);
+    free(table->cells);
+    memset(table, 0, sizeof(ParseTable));
+}
+
+// Display the FIRST sets
+void displayFirstSets(Set* firstSets, int numNonTerminals) {
+    for (int i = 0; i < numNonTerminals; i++) {
+        printf("FIRST(%s) = { ", firstSets[i].symbol);
+        for (int j = 0; j < firstSets[i].numElements; j++) {
+            printf("%s", firstSets[i].elements[j]);
+            if (j < firstSets[i].numElements - 1) {
+                printf(", ");
+            }
+        }
+        printf(" }\n");
+    }
+}
+
+// Display the FOLLOW sets
+void displayFollowSets(Set* followSets, int numNonTerminals) {
+    for (int i = 0; i < numNonTerminals; i++) {
+        printf("FOLLOW(%s) = { ", followSets[i].symbol);
+        for (int j = 0; j < followSets[i].numElements; j++) {
+            printf("%s", followSets[i].elements[j]);
+            if (j < followSets[i].numElements - 1) {
+                printf(", ");
+            }
+        }
+        printf(" }\n");
+    }
+}
+
+// Display the parsing table
+void displayParseTable(ParseTable table) {
+    printf("%-10s | ", "");
+    for (int i = 0; i < table.numTerminals; i++) {
+        printf("%-10s | ", table.terminals[i]);
+    }
+    printf("\n");
+    
+    for (int i = 0; i < (table.numTerminals + 1) * 13; i++) {
+        printf("-");
+    }
+    printf("\n");
+    
+    for (int i = 0; i < table.numNonTerminals; i++) {
+        printf("%-10s | ", table.nonTerminals[i]);
+        
+        for (int j = 0; j < table.numTerminals; j++) {
+            int k = table.cells[i * table.numTerminals + j];
+            printf("%-10s | ", k == -1 ? "" : table.entries[k].production);
+        }
+        
+        printf("\n");
+    }
+    
+    if (table.numConflicts > 0) {
+        printf("\nConflicts: %d (grammar is not LL(1))\n", table.numConflicts);
+        for (int i = 0; i < table.numConflicts && i < MAX_CONFLICTS; i++) {
+            printf("[%s, %s]: %s vs %s\n", table.conflicts[i].nonTerminal, table.conflicts[i].terminal,
+                   table.conflicts[i].production1, table.conflicts[i].production2);
+        }
+    }
+}
+
+// Split a string on a one-byte delimiter. Like strtok, empty pieces are dropped
+char** splitString(const char* str, const char* delimiter, int* count) {
+    int length = strlen(str);
+    *count = 0;
+    
+    // Count the number of tokens
+    int start = 0;
+    while (start < length) {
+        int end = findByte(str + start, length - start, delimiter[0]);
+        end = end == -1 ? length : start + end;
+        if (end > start) (*count)++;
+        start = end + 1;
+    }
+    
+    // Allocate memory for the result
+    char** result = (char**)malloc((*count) * sizeof(char*));
+    
+    // Split the string
+    int i = 0;
+    start = 0;
+    while (start < length) {
+        int end = findByte(str + start, length - start, delimiter[0]);
+        end = end == -1 ? length : start + end;
+        if (end > start) result[i++] = strndup(str + start, end - start);
+        start = end + 1;
+    }
+    
+    return result;
+}
+
+// Trim whitespace from a string. The result is a new string the caller frees
+char* trimString(char* str) {
+    int length = strlen(str);
+    
+    // Trim leading whitespace
+    int start = scanSpaces(str, length);
+    
+    // Trim trailing whitespace
+    int end = length;
+    while (end > start && isspace((unsigned char)str[end - 1])) {
+        end--;
+    }
+    
+    return strndup(str + start, end - start);
+}
+
+// Free memory allocated for sets
+void freeSet(Set* set, int count) {
+    if (set == NULL) return;
+    for (int i = 0; i < count; i++) {
+        free(set[i].elements);
+    }
+    free(set);
+}
+
+// Find the set belonging to a non-terminal
+const Set* findSet(const Set* sets, int numSets, const char* symbol) {
+    for (int i = 0; i < numSets; i++) {
+        if (strcmp(sets[i].symbol, symbol) == 0) {
+            return &sets[i];
+        }
+    }
+    return NULL;
+}
+
+// Look up the production in a table cell, or NULL if the cell is empty
+const char* lookupParseTable(const ParseTable* table, const char* nonTerminal, const char* terminal) {
+    for (int i = 0; i < table->numNonTerminals; i++) {
+        if (strcmp(table->nonTerminals[i], nonTerminal) != 0) continue;
+        for (int j = 0; j < table->numTerminals; j++) {
+            if (strcmp(table->terminals[j], terminal) == 0) {
+                int k = table->cells[i * table->numTerminals + j];
+                return k == -1 ? NULL : table->entries[k].production;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Run every stage on a grammar. The result is a new grammar; the argument is left as it was
+Grammar transformGrammar(Grammar grammar) {
+    Grammar leftFactored = leftFactoring(grammar);
+    Grammar withoutLeftRecursion = leftRecursionRemoval(leftFactored);
+    Grammar simplified = simplifyGrammar(withoutLeftRecursion);
+    freeGrammar(&leftFactored);
+    freeGrammar(&withoutLeftRecursion);
+    return simplified;
+}
+
+GrammarAnalysis* analyzeGrammar(Grammar grammar, int numThreads) {
+    if (grammar.numProductions == 0) {
+        freeGrammar(&grammar);
+        return NULL;
+    }
+    
+    GrammarAnalysis* analysis = (GrammarAnalysis*)calloc(1, sizeof(GrammarAnalysis));
+    if (analysis == NULL) {
+        freeGrammar(&grammar);
+        return NULL;
+    }
+    
+    analysis->original = grammar;
+    analysis->leftFactored = leftFactoring(grammar);
+    analysis->withoutLeftRecursion = leftRecursionRemoval(analysis->leftFactored);
+    if (analysis->withoutLeftRecursion.numProductions == 0) {
+        freeGrammarAnalysis(analysis);
+        return NULL;
+    }
+    analysis->simplified = simplifyGrammar(analysis->withoutLeftRecursion);
+    analyzeSimplifiedGrammar(analysis, numThreads);
+    return analysis;
+}
+
+// FIRST, FOLLOW and the table of an analysis's simplified grammar
+void analyzeSimplifiedGrammar(GrammarAnalysis* analysis, int numThreads) {
+    if (numThreads > 1) {
+        analysis->firstSets = computeFirstSetsParallel(analysis->simplified, numThreads);
+        analysis->followSets = computeFollowSetsParallel(analysis->simplified, analysis->firstSets, numThreads);
+        analysis->parseTable = constructLL1TableParallel(analysis->simplified, analysis->firstSets,
+                                                         analysis->followSets, numThreads);
+    } else {
+        analysis->firstSets = computeFirstSets(analysis->simplified);
+        analysis->followSets = computeFollowSets(analysis->simplified, analysis->firstSets);
+        analysis->parseTable = constructLL1Table(analysis->simplified, analysis->firstSets,
+                                                 analysis->followSets);
+    }
+}
+
+void reanalyzeGrammar(GrammarAnalysis* analysis, int numThreads) {
+    freeSet(analysis->firstSets, analysis->simplified.numNonTerminals);
+    freeSet(analysis->followSets, analysis->simplified.numNonTerminals);
+    freeParseTable(&analysis->parseTable);
+    analyzeSimplifiedGrammar(analysis, numThreads);
+}
+
+void freeGrammarAnalysis(GrammarAnalysis* analysis) {
+    if (analysis == NULL) return;
+    freeSet(analysis->firstSets, analysis->simplified.numNonTerminals);
+    freeSet(analysis->followSets, analysis->simplified.numNonTerminals);
+    freeParseTable(&analysis->parseTable);
+    freeGrammar(&analysis->original);
+    freeGrammar(&analysis->leftFactored);
+    freeGrammar(&analysis->withoutLeftRecursion);
+    freeGrammar(&analysis->simplified);
+    free(analysis);
+}
+
+// Write output to a file
+void writeOutputToFile(Grammar original, Grammar leftFactored, Grammar withoutLeftRecursion, Grammar simplified,
+    Set* firstSets, Set* followSets, ParseTable parseTable, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        return;
+    }
+
+    debugPrintf("Debug: Writing to %s\n", filename); // Debug message
+    
+    // Write original grammar
+    fprintf(file, "Original Grammar:\n");
+    for (int i = 0; i < original.numProductions; i++) {
+        Production prod = original.productions[i];
+        fprintf(file, "%s -> ", prod.lhs);
+        for (int j = 0; j < prod.numRHS; j++) {
+            fprintf(file, "%s", prod.rhs[j]);
+            if (j < prod.numRHS - 1) {
+                fprintf(file, " | ");
+            }
+        }
+        fprintf(file, "\n");
+    }
+
+    // Write left factored grammar
+    fprintf(file, "\nGrammar after Left Factoring:\n");
+    for (int i = 0; i < leftFactored.numProductions; i++) {
+        Production prod = leftFactored.productions[i];
+        fprintf(file, "%s -> ", prod.lhs);
+        for (int j = 0; j < prod.numRHS; j++) {
+            fprintf(file, "%s", prod.rhs[j]);
+            if (j < prod.numRHS - 1) {
+                fprintf(file, " | ");
+            }
+        }
+        fprintf(file, "\n");
+    }
+    
+    // Write grammar without left recursion
+    fprintf(file, "\nGrammar after Left Recursion Removal:\n");
+    for (int i = 0; i < withoutLeftRecursion.numProductions; i++) {
+        Production prod = withoutLeftRecursion.productions[i];
+        fprintf(file, "%s -> ", prod.lhs);
+        for (int j = 0; j < prod.numRHS; j++) {
+            fprintf(file, "%s", prod.rhs[j]);
+            if (j < prod.numRHS - 1) {
+                fprintf(file, " | ");
+            }
+        }
+        fprintf(file, "\n");
+    }
+    
+    // Write simplified grammar
+    fprintf(file, "\nGrammar after Simplification:\n");
+    for (int i = 0; i < simplified.numProductions; i++) {
+        Production prod = simplified.productions[i];
+        fprintf(file, "%s -> ", prod.lhs);
+        for (int j = 0; j < prod.numRHS; j++) {
+            fprintf(file, "%s", prod.rhs[j]);
+            if (j < prod.numRHS - 1) {
+                fprintf(file, " | ");
+            }
+        }
+        fprintf(file, "\n");
+    }
+    
+    // Write FIRST sets
+    fprintf(file, "\nFIRST Sets:\n");
+    for (int i = 0; i < simplified.numNonTerminals; i++) {
+        fprintf(file, "FIRST(%s) = { ", firstSets[i].symbol);
+        for (int j = 0; j < firstSets[i].numElements; j++) {
+            fprintf(file, "%s", firstSets[i].elements[j]);
+            if (j < firstSets[i].numElements - 1) {
+                fprintf(file, ", ");
+            }
+        }
+        fprintf(file, " }\n");
+    }
+    
+    // Write FOLLOW sets
+    fprintf(file, "\nFOLLOW Sets:\n");
+    for (int i = 0; i < simplified.numNonTerminals; i++) {
+        fprintf(file, "FOLLOW(%s) = { ", followSets[i].symbol);
+        for (int j = 0; j < followSets[i].numElements; j++) {
+            fprintf(file, "%s", followSets[i].elements[j]);
+            if (j < followSets[i].numElements - 1) {
+                fprintf(file, ", ");
+            }
+        }
+        fprintf(file, " }\n");
+    }
+    
+    // Write LL(1) parsing table
+    fprintf(file, "\nLL(1) Parsing Table:\n");
+    
+    fprintf(file, "%-10s | ", "");
+    for (int i = 0; i < parseTable.numTerminals; i++) {
+        fprintf(file, "%-10s | ", parseTable.terminals[i]);
+    }
+    fprintf(file, "\n");
+    
+    for (int i = 0; i < (parseTable.numTerminals + 1) * 13; i++) {
+        fprintf(file, "-");
+    }
+    fprintf(file, "\n");
+    
+    for (int i = 0; i < parseTable.numNonTerminals; i++) {
+        fprintf(file, "%-10s | ", parseTable.nonTerminals[i]);
+        
+        for (int j = 0; j < parseTable.numTerminals; j++) {
+            int k = parseTable.cells[i * parseTable.numTerminals + j];
+            fprintf(file, "%-10s | ", k == -1 ? "" : parseTable.entries[k].production);
+        }
+        
+        fprintf(file, "\n");
+    }
+    
+    if (parseTable.numConflicts > 0) {
+        fprintf(file, "\nConflicts: %d (grammar is not LL(1))\n", parseTable.numConflicts);
+        for (int i = 0; i < parseTable.numConflicts && i < MAX_CONFLICTS; i++) {
+            fprintf(file, "[%s, %s]: %s vs %s\n", parseTable.conflicts[i].nonTerminal,
+                    parseTable.conflicts[i].terminal, parseTable.conflicts[i].production1,
+                    parseTable.conflicts[i].production2);
+        }
+    }
+    
+    fclose(file);
+}
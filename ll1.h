@@ -0,0 +1,154 @@
+#ifndef LL1_H
+#define LL1_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "phash.h"
+
+// Grammars, sets and tables grow as they are filled, so a grammar may have any number of rules and
+// symbols; only one rule's alternatives, their length and names are bounded
+#define MAX_RHS 50           // Maximum number of RHS alternatives per production
+#define MAX_PROD_LEN 100     // Maximum length of a production
+#define MAX_LINE_LEN 256     // Maximum line length in input file
+#define EPSILON "ε"          // Epsilon symbol
+#define MAX_THREADS 64       // Maximum number of worker threads
+#define MAX_CONFLICTS 100    // Maximum number of parse table conflicts kept
+#define MAX_ENTRY_SYMBOLS 16 // Maximum number of declared entry non-terminals
+
+// Structure for a production rule
+typedef struct {
+    char lhs[20];                  // Left-hand side non-terminal
+    char (*rhs)[MAX_PROD_LEN];     // Right-hand side alternatives
+    int numRHS;                    // Number of RHS alternatives
+    int rhsCapacity;               // Alternatives rhs has room for, at most MAX_RHS
+} Production;
+
+// Structure for a grammar. A grammar owns its arrays: copies made by assignment share them, and
+// are only read, while copyGrammar makes one that can be changed and freed on its own
+typedef struct {
+    Production* productions;
+    int numProductions;
+    int productionCapacity;
+    char (*terminals)[20];
+    int numTerminals;
+    int terminalCapacity;
+    char (*nonTerminals)[20];
+    int numNonTerminals;
+    int nonTerminalCapacity;
+    char startSymbol[20];
+    // Non-terminals parses may also start from, declared with "%entry A B ..." lines. Like the start
+    // symbol they are kept by simplification and get $ in their FOLLOW sets, so one table serves all
+    char entrySymbols[MAX_ENTRY_SYMBOLS][20];
+    int numEntrySymbols;
+    // Name -> index, over the terminals and non-terminals there were when each hash was built. Names
+    // added since are searched one by one, and the hash is rebuilt once they are as many as the
+    // hashed ones; anything that moves or removes names rebuilds it with indexGrammarSymbols
+    PerfectHash* terminalHash;
+    PerfectHash* nonTerminalHash;
+} Grammar;
+
+// Structure for FIRST and FOLLOW sets
+typedef struct {
+    char symbol[20];
+    char (*elements)[20];
+    int numElements;
+} Set;
+
+// Structure for LL(1) parsing table
+typedef struct {
+    char nonTerminal[20];
+    char terminal[20];
+    char production[MAX_PROD_LEN];
+} ParseTableEntry;
+
+// Two productions competing for the same table cell
+typedef struct {
+    char nonTerminal[20];
+    char terminal[20];
+    char production1[MAX_PROD_LEN]; // The production kept in the table
+    char production2[MAX_PROD_LEN]; // The production that lost
+} TableConflict;
+
+typedef struct {
+    ParseTableEntry* entries;
+    int numEntries;
+    char (*terminals)[20];
+    int numTerminals;
+    char (*nonTerminals)[20];
+    int numNonTerminals;
+    int* cells;                                  // [non-terminal * numTerminals + terminal] -> index into
+                                                 // entries, -1 if empty
+    TableConflict conflicts[MAX_CONFLICTS];
+    int numConflicts;                            // May exceed MAX_CONFLICTS; only the first ones are kept
+} ParseTable;
+
+// Every stage of the analysis of one grammar, each owned by the analysis.
+// Nothing is shared between analyses, so separate grammars can be analyzed on separate threads
+typedef struct {
+    Grammar original;
+    Grammar leftFactored;
+    Grammar withoutLeftRecursion;
+    Grammar simplified;          // The grammar the sets and the table are computed for
+    Set* firstSets;              // One per non-terminal of simplified
+    Set* followSets;
+    ParseTable parseTable;
+} GrammarAnalysis;
+
+// Loading; a grammar with no productions means the input could not be read or a rule outgrew the
+// limits above. Either way the grammar is freed with freeGrammar
+Grammar readGrammarFromFile(const char* filename);
+Grammar readGrammarFromString(const char* text);
+Grammar copyGrammar(const Grammar* grammar);
+void freeGrammar(Grammar* grammar);
+void indexGrammarSymbols(Grammar* grammar);   // Rebuild the name hashes after names were moved or removed
+
+// Transformations; each returns a new grammar, leaving its argument as it was, with no productions
+// if an alternative or a new name would outgrow the limits above
+Grammar leftFactoring(Grammar grammar);
+Grammar leftRecursionRemoval(Grammar grammar);
+Grammar simplifyGrammar(Grammar grammar);
+Grammar transformGrammar(Grammar grammar);   // All three in order, as analyzeGrammar applies them
+
+// FIRST/FOLLOW sets; the results are freed with freeSet. The equations are solved one strongly connected
+// component of their dependency graph at a time, after the components it reads from; the parallel
+// versions hand the components to numThreads threads as they become ready
+Set* computeFirstSets(Grammar grammar);
+Set* computeFollowSets(Grammar grammar, Set* firstSets);
+Set* computeFirstSetsParallel(Grammar grammar, int numThreads);
+Set* computeFollowSetsParallel(Grammar grammar, Set* firstSets, int numThreads);
+void freeSet(Set* set, int count);
+
+// LL(1) parsing table, freed with freeParseTable. The parallel build splits the rows across threads
+ParseTable constructLL1Table(Grammar grammar, Set* firstSets, Set* followSets);
+ParseTable constructLL1TableParallel(Grammar grammar, Set* firstSets, Set* followSets, int numThreads);
+void freeParseTable(ParseTable* table);
+
+// Whole pipeline: left factoring, left recursion removal, simplification, FIRST, FOLLOW and the table.
+// The analysis takes the grammar over. Returns NULL, having freed the grammar, if it has no productions
+// or outgrows the limits once transformed
+GrammarAnalysis* analyzeGrammar(Grammar grammar, int numThreads);
+void freeGrammarAnalysis(GrammarAnalysis* analysis);
+// Redo FIRST, FOLLOW and the table after the simplified grammar was changed in place, e.g. reordered
+void reanalyzeGrammar(GrammarAnalysis* analysis, int numThreads);
+
+// Queries; symbol lookups cost one hash and one compare (see Grammar)
+bool isTerminal(Grammar grammar, const char* symbol);
+bool isNonTerminal(Grammar grammar, const char* symbol);
+bool isEntrySymbol(const Grammar* grammar, const char* symbol);   // The start symbol or a declared entry
+int findTerminalIndex(const Grammar* grammar, const char* symbol);
+int findNonTerminalIndex(const Grammar* grammar, const char* symbol);
+const Set* findSet(const Set* sets, int numSets, const char* symbol);
+bool isInSet(Set set, const char* element);
+const char* lookupParseTable(const ParseTable* table, const char* nonTerminal, const char* terminal);
+char* getSymbol(const char* rhs, int* pos);
+bool getActionTag(const char* rhs, char* tag);
+
+// Output
+void displayGrammar(Grammar grammar);
+void displayFirstSets(Set* firstSets, int numNonTerminals);
+void displayFollowSets(Set* followSets, int numNonTerminals);
+void displayParseTable(ParseTable table);
+void writeOutputToFile(Grammar original, Grammar leftFactored, Grammar withoutLeftRecursion, Grammar simplified,
+                      Set* firstSets, Set* followSets, ParseTable parseTable, const char* filename);
+
+#endif
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lockstep.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define STEP_SCRATCH 64      // Symbols and expansions a step is worked out with before it falls back to one expansion
+#define STACK_STRIDE (LOCKSTEP_STACK + LOCKSTEP_PUSH)   // Room for a whole block copied at the top of a full stack
+#define TOKEN_STRIDE (LOCKSTEP_TOKENS + 1)              // Room for the token after $, read but never used
+
+// The state of every lane, as parallel arrays so a lane's fields load into vector lanes
+typedef struct {
+    int (*stacks)[STACK_STRIDE];
+    Token (*tokens)[TOKEN_STRIDE];       // Each lane's input, lexed when the lane starts it; unknown bytes are width - 1
+    int top[LOCKSTEP_LANES];
+    int token[LOCKSTEP_LANES];
+    int next[LOCKSTEP_LANES];            // Index of the lookahead in tokens
+    int message[LOCKSTEP_LANES];         // Index of the input in the lane, -1 if the lane is idle
+} Lanes;
+
+// Function prototypes
+bool addStep(LockstepTable* table, int* capacity, int symbol, int column);
+void stepLanes(Lanes* lanes, const LockstepTable* table, int* step);
+bool startLane(Lanes* lanes, int lane, const LockstepTable* table, const char* const* inputs,
+               const int* lengths, int count, int* nextMessage, ParseResult* results);
+
+// Work out the step for symbol on top and the token of column by running the parser on a stack
+// that holds only symbol, until it matches the token or pops everything
+bool addStep(LockstepTable* table, int* capacity, int symbol, int column) {
+    const CompiledTable* compiled = table->compiled;
+    const int numTerminals = compiled->numTerminals;
+    int token = column < numTerminals ? column : -1;
+    int* step = &table->steps[symbol * table->width + column];
+    int scratch[STEP_SCRATCH];
+    int n = 0;
+    bool consumed = false;
+    
+    *step = -1;
+    scratch[n++] = symbol;
+    for (int expansions = 0; n > 0 && !consumed; expansions++) {
+        int top = scratch[--n];
+        if (top < numTerminals) {
+            if (top != token) return true;
+            consumed = true;
+            continue;
+        }
+        int p = token >= 0 ? tableCell(compiled, top - numTerminals, token) : -1;
+        if (p < 0) return true;
+        int length = compiled->productionLength[p];
+        if (n + length > STEP_SCRATCH || expansions == STEP_SCRATCH) {
+            n = STEP_SCRATCH;
+            break;
+        }
+        const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+        for (int i = length - 1; i >= 0; i--) {
+            scratch[n++] = rhs[i];
+        }
+    }
+    if (n > LOCKSTEP_PUSH) {
+        *step = -2 - tableCell(compiled, symbol - numTerminals, token);
+        return true;
+    }
+    
+    // The block copy reads LOCKSTEP_PUSH symbols from any step's start
+    if (table->numPushes + LOCKSTEP_PUSH > *capacity) {
+        int grown = *capacity * 2 > table->numPushes + LOCKSTEP_PUSH ? *capacity * 2 : table->numPushes + LOCKSTEP_PUSH;
+        if (grown > (1 << 26)) return false;
+        int* pushes = (int*)realloc(table->pushes, grown * sizeof(int));
+        if (pushes == NULL) return false;
+        memset(pushes + *capacity, 0, (grown - *capacity) * sizeof(int));
+        table->pushes = pushes;
+        *capacity = grown;
+    }
+    memcpy(table->pushes + table->numPushes, scratch, n * sizeof(int));
+    *step = table->numPushes << 5 | n << 1 | (consumed ? 1 : 0);
+    table->numPushes += n;
+    return true;
+}
+
+LockstepTable* compileLockstepTable(const CompiledTable* compiled) {
+    if (compiled->cells == NULL || compiled->numDecisions > 0 || compiled->lazyRows != NULL) return NULL;
+    LockstepTable* table = (LockstepTable*)calloc(1, sizeof(LockstepTable));
+    if (table == NULL) return NULL;
+    
+    int numSymbols = compiled->numTerminals + compiled->numNonTerminals;
+    int capacity = 0;
+    table->compiled = compiled;
+    table->width = compiled->numTerminals + 1;
+    table->steps = (int*)malloc((size_t)numSymbols * table->width * sizeof(int));
+    bool ok = table->steps != NULL;
+    for (int symbol = 0; ok && symbol < numSymbols; symbol++) {
+        for (int column = 0; ok && column < table->width; column++) {
+            ok = addStep(table, &capacity, symbol, column);
+        }
+    }
+    if (!ok) {
+        freeLockstepTable(table);
+        return NULL;
+    }
+    return table;
+}
+
+void freeLockstepTable(LockstepTable* table) {
+    if (table == NULL) return;
+    free(table->steps);
+    free(table->pushes);
+    free(table);
+}
+
+// One lockstep round for every lane at once: the step for the symbol on top of each stack and its
+// lookahead goes to step[lane], and lanes whose step consumes the token move on to the next one
+void stepLanes(Lanes* lanes, const LockstepTable* table, int* step) {
+#ifdef __AVX2__
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i one = _mm256_set1_epi32(1);
+    // Eight lanes per vector; the groups are independent, so their gathers overlap
+    for (int group = 0; group < LOCKSTEP_LANES; group += 8) {
+        __m256i lane = _mm256_add_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(group));
+        __m256i active = _mm256_cmpgt_epi32(_mm256_loadu_si256((const __m256i*)(lanes->message + group)), minusOne);
+        
+        // stacks[lane][top - 1], then steps[symbol * width + token]
+        __m256i top = _mm256_loadu_si256((const __m256i*)(lanes->top + group));
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(lane, _mm256_set1_epi32(STACK_STRIDE)),
+                                         _mm256_sub_epi32(top, one));
+        __m256i symbols = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)lanes->stacks, index, active, 4);
+        __m256i token = _mm256_loadu_si256((const __m256i*)(lanes->token + group));
+        __m256i stepIndex = _mm256_add_epi32(_mm256_mullo_epi32(symbols, _mm256_set1_epi32(table->width)), token);
+        __m256i steps = _mm256_mask_i32gather_epi32(minusOne, table->steps, stepIndex, active, 4);
+        _mm256_storeu_si256((__m256i*)(step + group), steps);
+        
+        // Lanes that consume their token gather tokens[lane][next + 1].token
+        __m256i consumed = _mm256_and_si256(_mm256_cmpgt_epi32(steps, minusOne),
+                                            _mm256_cmpeq_epi32(_mm256_and_si256(steps, one), one));
+        __m256i next = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(lanes->next + group)), consumed);
+        __m256i tokenIndex = _mm256_add_epi32(_mm256_mullo_epi32(lane, _mm256_set1_epi32(TOKEN_STRIDE)), next);
+        token = _mm256_mask_i32gather_epi32(token, (const int*)lanes->tokens, _mm256_slli_epi32(tokenIndex, 1), consumed, 4);
+        _mm256_storeu_si256((__m256i*)(lanes->next + group), next);
+        _mm256_storeu_si256((__m256i*)(lanes->token + group), token);
+    }
+#else
+    for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+        if (lanes->message[lane] < 0) {
+            step[lane] = -1;
+            continue;
+        }
+        int symbol = lanes->stacks[lane][lanes->top[lane] - 1];
+        step[lane] = table->steps[symbol * table->width + lanes->token[lane]];
+        if (step[lane] >= 0 && (step[lane] & 1)) {
+            lanes->token[lane] = lanes->tokens[lane][++lanes->next[lane]].token;
+        }
+    }
+#endif
+}
+
+// Put the next input in a lane: lex it, and put $ and the start symbol on the lane's stack.
+// Inputs with more than LOCKSTEP_TOKENS tokens are parsed on the spot with parseInput instead.
+// False once the inputs run out, leaving the lane idle
+bool startLane(Lanes* lanes, int lane, const LockstepTable* table, const char* const* inputs,
+               const int* lengths, int count, int* nextMessage, ParseResult* results) {
+    const CompiledTable* compiled = table->compiled;
+    lanes->message[lane] = -1;
+    lanes->top[lane] = 1;
+    
+    while (*nextMessage < count) {
+        int message = (*nextMessage)++;
+        Token* tokens = lanes->tokens[lane];
+        int pos = 0;
+        int n = 0;
+        do {
+            tokens[n].token = nextToken(compiled, inputs[message], lengths[message], &pos, &tokens[n].offset);
+            if (tokens[n].token < 0) tokens[n].token = table->width - 1;
+            n++;
+        } while (tokens[n - 1].token != compiled->endMarker && n < LOCKSTEP_TOKENS);
+        
+        if (tokens[n - 1].token != compiled->endMarker) {
+            results[message] = parseInput(compiled, inputs[message], lengths[message]);
+            continue;
+        }
+        tokens[n].token = compiled->endMarker;
+        
+        lanes->message[lane] = message;
+        lanes->stacks[lane][0] = compiled->endMarker;
+        lanes->stacks[lane][1] = compiled->startSymbol;
+        lanes->top[lane] = 2;
+        lanes->next[lane] = 0;
+        lanes->token[lane] = tokens[0].token;
+        return true;
+    }
+    return false;
+}
+
+void parseInputsLockstep(const LockstepTable* table, const char* const* inputs, const int* lengths,
+                         int count, ParseResult* results) {
+    const CompiledTable* compiled = table->compiled;
+    Lanes lanes;
+    lanes.stacks = malloc(LOCKSTEP_LANES * sizeof(*lanes.stacks));
+    lanes.tokens = malloc(LOCKSTEP_LANES * sizeof(*lanes.tokens));
+    if (lanes.stacks == NULL || lanes.tokens == NULL) {
+        for (int i = 0; i < count; i++) {
+            results[i] = parseInput(compiled, inputs[i], lengths[i]);
+        }
+        free(lanes.stacks);
+        free(lanes.tokens);
+        return;
+    }
+    
+    int nextMessage = 0;
+    int active = 0;
+    for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+        if (startLane(&lanes, lane, table, inputs, lengths, count, &nextMessage, results)) {
+            active++;
+        }
+    }
+    
+    int step[LOCKSTEP_LANES];
+    while (active > 0) {
+        stepLanes(&lanes, table, step);
+        
+        for (int lane = 0; lane < LOCKSTEP_LANES; lane++) {
+            if (lanes.message[lane] < 0) continue;
+            int* stack = lanes.stacks[lane];
+            int top = lanes.top[lane] - 1;
+            int s = step[lane];
+            
+            if (s >= 0) {
+                // Replace the symbol on top by the step's block; only $ matching $ empties the stack
+                memcpy(stack + top, table->pushes + (s >> 5), LOCKSTEP_PUSH * sizeof(int));
+                top += (s >> 1) & 15;
+            } else if (s < -1) {
+                // A step too long for one block: expand by its production and go on from there
+                int p = -2 - s;
+                int n = compiled->productionLength[p];
+                const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+                if (top + n > LOCKSTEP_STACK) {
+                    s = -1;
+                } else {
+                    for (int i = n - 1; i >= 0; i--) {
+                        stack[top++] = rhs[i];
+                    }
+                }
+            }
+            lanes.top[lane] = top;
+            if (s != -1 && top > 0 && top <= LOCKSTEP_STACK) continue;
+            
+            // Accepted once $ is matched; rejected at the lookahead otherwise
+            ParseResult* result = &results[lanes.message[lane]];
+            int next = lanes.next[lane];
+            result->accepted = s != -1 && top == 0;
+            result->numTokens = result->accepted ? next : next + 1;
+            result->errorOffset = result->accepted ? -1 : lanes.tokens[lane][next].offset;
+            if (!startLane(&lanes, lane, table, inputs, lengths, count, &nextMessage, results)) {
+                active--;
+            }
+        }
+    }
+    
+    free(lanes.stacks);
+    free(lanes.tokens);
+}
@@ -0,0 +1,42 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "parser.h"
+
+#define LOCKSTEP_LANES 16    // Parses advanced together, two vectors of eight 32-bit lanes
+#define LOCKSTEP_STACK 512   // Maximum parse stack depth of each lane
+#define LOCKSTEP_TOKENS 256  // Longest input parsed in a lane, in tokens including $
+#define LOCKSTEP_PUSH 8      // Longest run of symbols one step pushes, copied as one block
+
+// A parse table recompiled for lockstep parsing. A step is everything the parser does with the
+// symbol on top and one lookahead until it either matches that token or pops the symbol by ε: the
+// symbol is replaced by what the expansions leave over it, and the token is consumed or not.
+// steps[symbol * width + token] holds that step for terminals and non-terminals alike, with one
+// extra column for unknown bytes:
+//   -1          the parse fails here
+//   -2 - p      expand by production p only, the rest is left to the following steps
+//   otherwise   push[step >> 5] on, (step >> 1) & 15 symbols, and consume the token if step & 1
+typedef struct {
+    const CompiledTable* compiled;
+    int width;                   // numTerminals + 1
+    int* steps;
+    int* pushes;                 // The symbols steps push, bottom of the stack first
+    int numPushes;
+} LockstepTable;
+
+// Compile a table's steps. The lockstep table reads the compiled one, which has to outlive it.
+// NULL if out of memory, or if the table is compressed, lazy or has contested cells, none of
+// which has dense cells whose steps can be worked out ahead
+LockstepTable* compileLockstepTable(const CompiledTable* compiled);
+void freeLockstepTable(LockstepTable* table);
+
+// Parse many independent inputs against one table, results[i] for inputs[i].
+// LOCKSTEP_LANES parses advance in lockstep: each round gathers their stack tops, their steps and
+// their next tokens eight lanes at a time (AVX2 with -mavx2, a plain loop otherwise), then copies
+// each lane's pushed symbols as one block. A lane lexes its input when it starts it, and picks up the next
+// input when it finishes. Results are the same as parseInput's, except that a parse needing a
+// stack deeper than LOCKSTEP_STACK is rejected. Longer inputs are parsed one at a time
+void parseInputsLockstep(const LockstepTable* table, const char* const* inputs, const int* lengths,
+                         int count, ParseResult* results);
+
+#endif
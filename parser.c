@@ -0,0 +1,1648 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include "parser.h"
+#include "scan.h"
+
+#define DECISION_CACHE_SLOTS (2 * DECISION_CACHE_STATES)
+#define MAX_SPECULATIONS 16    // Candidates, with the forks of nested decisions, followed at once
+#define SPECULATION_STACK 64
+#define SPECULATION_STEPS 256  // Expansions a speculation may make before it matches a token
+
+// Edges of the decisions' lookahead DFAs in one open-addressing hash table. An edge is added by
+// claiming a free key with compare-and-swap, so threads sharing a table add states without locks;
+// a state's prediction is written before the edge to it is published
+struct DecisionCache {
+    atomic_ullong keys[DECISION_CACHE_SLOTS];    // Edge (decision, state, token), 0 if the slot is free
+    atomic_int targets[DECISION_CACHE_SLOTS];    // State the edge leads to, 0 until it is written
+    int predictions[DECISION_CACHE_STATES];      // Candidate a state settles on, -1 if it needs more tokens
+    atomic_int numStates;                        // State 0 is the start of every decision
+};
+
+// FIRST and FOLLOW sets of a lazy table as bitsets over terminals, solved for a non-terminal and
+// whatever its sets depend on the first time a row needs them. Nullability and the index of
+// productions and occurrences are built with the table; they are one pass over the productions
+struct LazyRows {
+    int words;                   // 64-bit words per set
+    bool* nullable;
+    uint64_t* first;
+    uint64_t* follow;
+    bool* firstDone;
+    bool* followDone;
+    bool* built;                 // Rows filled so far; the others are still all -1
+    int* productionIndex;        // Productions of non-terminal n: productions[productionIndex[n]..productionIndex[n + 1]]
+    int* productions;
+    int* occurrenceIndex;        // Occurrences of non-terminal n in right-hand sides, likewise
+    int* occurrences;            // Offset of the occurrence in rhsSymbols
+    int* occurrenceProduction;
+    int* members;                // Scratch: the non-terminals being solved
+    bool* isMember;
+    int* followMembers;          // Scratch: the FOLLOW sets being solved while FIRST sets are
+    uint64_t* grown;             // Scratch: one set, for the equations being solved
+    uint64_t* select;            // Scratch: one set, for the row being built
+    int numBuilt;
+};
+
+// One candidate of a decision being expanded against the tokens ahead
+typedef struct {
+    int candidate;               // Index among the decision's candidates
+    int top;
+    int stack[SPECULATION_STACK];
+} Speculation;
+
+// Where a decision reads the tokens after its lookahead: from tokens already lexed, then from the input
+typedef struct {
+    const int* tokens;
+    int numTokens;
+    int next;
+    const char* input;           // NULL past the tokens: the input ends there
+    int length;
+    int pos;
+} DecisionInput;
+
+typedef enum {
+    SPECULATION_DROPPED,         // The token does not fit
+    SPECULATION_MATCHED,         // A terminal matching the token is on top
+    SPECULATION_ENDED            // The candidate's expansion is complete
+} SpeculationStep;
+
+// Find the number of a terminal in the compiled table, or -1
+int findCompiledTerminal(const CompiledTable* compiled, const char* symbol) {
+    for (int i = 0; i < compiled->numTerminals; i++) {
+        if (strcmp(compiled->terminalNames[i], symbol) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// The same, through the grammar's hash: the table lists the grammar's terminals in order, then $
+int findTableTerminal(const Grammar* grammar, const CompiledTable* compiled, const char* symbol) {
+    int t = findTerminalIndex(grammar, symbol);
+    if (t != -1 && t < compiled->numTerminals && strcmp(compiled->terminalNames[t], symbol) == 0) return t;
+    if (strcmp(symbol, "$") == 0 && compiled->endMarker != -1) return compiled->endMarker;
+    return findCompiledTerminal(compiled, symbol);
+}
+
+int findAction(const CompiledTable* compiled, const char* name) {
+    for (int i = 0; i < compiled->numActions; i++) {
+        if (strcmp(compiled->actionNames[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Binary-operator levels, as left recursion removal leaves them: A -> B A' where every alternative
+// of A' is ε or an operator followed by B A' (left associative) or by A (right associative), and
+// A' is used nowhere else. Each level A gets a precedence-climbing loop covering the operators of
+// A and of the levels under it through B: parsing A pushes the loop and the operand at the bottom,
+// and the loop then takes every operator of those levels it finds, pushing itself back, the loop
+// of the operator's right operand and the bottom operand. Levels whose operators are not all
+// distinct are left to the table
+void compileOperatorLoops(CompiledTable* compiled) {
+    const int numTerminals = compiled->numTerminals;
+    const int numNonTerminals = compiled->numNonTerminals;
+    int* firstProduction = malloc(numNonTerminals * sizeof(int));
+    for (int n = 0; n < numNonTerminals; n++) {
+        firstProduction[n] = compiled->numProductions;
+    }
+    int* numAlternatives = calloc(numNonTerminals, sizeof(int));
+    int* uses = calloc(numNonTerminals, sizeof(int));
+    int* operand = malloc(numNonTerminals * sizeof(int));
+    int* tail = malloc(numNonTerminals * sizeof(int));
+    bool* rightAssociative = malloc(numNonTerminals * sizeof(bool));
+    short* row = malloc(numTerminals * sizeof(short));
+    compiled->expressionLoop = malloc(numNonTerminals * sizeof(int));
+    compiled->loopOperand = malloc(numNonTerminals * sizeof(int));
+    compiled->operatorLoops = malloc(numNonTerminals * numTerminals * sizeof(short));
+    
+    for (int p = compiled->numProductions - 1; p >= 0; p--) {
+        firstProduction[compiled->productionLhs[p]] = p;
+        numAlternatives[compiled->productionLhs[p]]++;
+        for (int i = 0; i < compiled->productionLength[p]; i++) {
+            int symbol = compiled->rhsSymbols[compiled->productionStart[p] + i];
+            if (symbol >= numTerminals) uses[symbol - numTerminals]++;
+        }
+    }
+    
+    for (int a = 0; a < numNonTerminals; a++) {
+        operand[a] = -1;
+        compiled->expressionLoop[a] = -1;
+        if (numAlternatives[a] != 1 || compiled->productionLength[firstProduction[a]] != 2) continue;
+        const int* rhs = compiled->rhsSymbols + compiled->productionStart[firstProduction[a]];
+        int b = rhs[0];
+        int t = rhs[1] - numTerminals;
+        if (t < 0 || t == a || b == rhs[1] || rhs[1] == compiled->startSymbol) continue;
+        
+        // Every alternative of the tail is ε or an operator its cell selects
+        int numOperators = 0, numEpsilons = 0;
+        bool left = false, right = false, valid = true;
+        for (int q = firstProduction[t]; q < compiled->numProductions && compiled->productionLhs[q] == t && valid; q++) {
+            int n = compiled->productionLength[q];
+            const int* alternative = compiled->rhsSymbols + compiled->productionStart[q];
+            if (n == 0) {
+                numEpsilons++;
+                continue;
+            }
+            int op = alternative[0];
+            if (op >= numTerminals || op == compiled->endMarker || compiled->cells[t * numTerminals + op] != q) {
+                valid = false;
+            } else if (n == 3 && alternative[1] == b && alternative[2] == rhs[1]) {
+                left = true;
+            } else if (n == 2 && alternative[1] == numTerminals + a) {
+                right = true;
+            } else {
+                valid = false;
+            }
+            numOperators++;
+        }
+        if (!valid || numEpsilons != 1 || numOperators == 0 || (left && right) ||
+            numOperators + numEpsilons != numAlternatives[t] || uses[t] != 1 + (left ? numOperators : 0)) {
+            continue;
+        }
+        operand[a] = b;
+        tail[a] = t;
+        rightAssociative[a] = right;
+    }
+    
+    // A level gets a loop if the operators of its chain are distinct. A level's chain contains the
+    // chain of the level under it, so the levels under one with a loop have loops too
+    for (int a = 0; a < numNonTerminals; a++) {
+        if (operand[a] == -1) continue;
+        for (int t = 0; t < numTerminals; t++) {
+            row[t] = -1;
+        }
+        bool distinct = true;
+        int level = a;
+        for (int depth = 0; distinct && level != -1 && operand[level] != -1 && depth < numNonTerminals; depth++) {
+            for (int q = firstProduction[tail[level]]; q < compiled->numProductions && compiled->productionLhs[q] == tail[level]; q++) {
+                if (compiled->productionLength[q] == 0) continue;
+                int op = compiled->rhsSymbols[compiled->productionStart[q]];
+                if (row[op] != -1) distinct = false;
+                row[op] = 0;
+            }
+            level = operand[level] >= numTerminals ? operand[level] - numTerminals : -1;
+        }
+        if (distinct) compiled->expressionLoop[a] = compiled->numOperatorLoops++;
+    }
+    
+    int numLoops = compiled->numOperatorLoops;
+    for (int a = 0; a < numNonTerminals; a++) {
+        int loop = compiled->expressionLoop[a];
+        if (loop == -1) continue;
+        short* loopRow = compiled->operatorLoops + loop * numTerminals;
+        for (int t = 0; t < numTerminals; t++) {
+            loopRow[t] = -1;
+        }
+        int level = a;
+        while (true) {
+            int below = operand[level] >= numTerminals ? operand[level] - numTerminals : -1;
+            int next = rightAssociative[level] ? compiled->expressionLoop[level]
+                                               : below != -1 && operand[below] != -1 ? compiled->expressionLoop[below] : numLoops;
+            for (int q = firstProduction[tail[level]]; q < compiled->numProductions && compiled->productionLhs[q] == tail[level]; q++) {
+                if (compiled->productionLength[q] > 0) loopRow[compiled->rhsSymbols[compiled->productionStart[q]]] = (short)next;
+            }
+            if (below == -1 || operand[below] == -1) break;
+            level = below;
+        }
+        compiled->loopOperand[loop] = operand[level];
+    }
+    
+    free(firstProduction);
+    free(numAlternatives);
+    free(uses);
+    free(operand);
+    free(tail);
+    free(rightAssociative);
+    free(row);
+}
+
+CompiledTable* compileParseTable(const Grammar* grammar, const ParseTable* table, const Set* followSets) {
+    CompiledTable* compiled = (CompiledTable*)calloc(1, sizeof(CompiledTable));
+    compiled->numTerminals = table->numTerminals;
+    compiled->numNonTerminals = table->numNonTerminals;
+    compiled->terminalNames = malloc(table->numTerminals * sizeof(*compiled->terminalNames));
+    compiled->nonTerminalNames = malloc(table->numNonTerminals * sizeof(*compiled->nonTerminalNames));
+    memcpy(compiled->terminalNames, table->terminals, table->numTerminals * sizeof(*compiled->terminalNames));
+    memcpy(compiled->nonTerminalNames, table->nonTerminals, table->numNonTerminals * sizeof(*compiled->nonTerminalNames));
+    compiled->endMarker = findCompiledTerminal(compiled, "$");
+    compiled->startSymbol = compiled->numTerminals + findNonTerminalIndex(grammar, grammar->startSymbol);
+    
+    // Entry points: the start symbol, then the declared entry symbols simplification kept
+    compiled->entryPoints = malloc((grammar->numEntrySymbols + 1) * sizeof(int));
+    compiled->entryPoints[compiled->numEntryPoints++] = compiled->startSymbol;
+    for (int i = 0; i < grammar->numEntrySymbols; i++) {
+        int n = findNonTerminalIndex(grammar, grammar->entrySymbols[i]);
+        if (n == -1) {
+            printf("Entry symbol %s is not a non-terminal of the grammar\n", grammar->entrySymbols[i]);
+        } else if (compiled->numTerminals + n != compiled->startSymbol) {
+            compiled->entryPoints[compiled->numEntryPoints++] = compiled->numTerminals + n;
+        }
+    }
+    
+    // Single-byte terminals are recognized straight from the input
+    for (int c = 0; c < 256; c++) {
+        compiled->terminalOf[c] = -1;
+    }
+    bool hasKeywords = false;
+    for (int i = 0; i < compiled->numTerminals; i++) {
+        if (i != compiled->endMarker && strlen(compiled->terminalNames[i]) == 1) {
+            compiled->terminalOf[(unsigned char)compiled->terminalNames[i][0]] = i;
+        }
+        if (compiled->terminalNames[i][0] == '"') hasKeywords = true;
+    }
+    
+    // Keywords ("if") are matched as whole identifier runs through a perfect hash over every
+    // terminal's spelling, numbered like the terminals
+    if (hasKeywords) {
+        char (*spellings)[20] = malloc((compiled->numTerminals + 1) * sizeof(*spellings));
+        const char** names = malloc((compiled->numTerminals + 1) * sizeof(const char*));
+        for (int i = 0; spellings != NULL && names != NULL && i < compiled->numTerminals; i++) {
+            const char* name = compiled->terminalNames[i];
+            int length = strlen(name);
+            if (name[0] == '"' && length >= 2 && name[length - 1] == '"') {
+                memcpy(spellings[i], name + 1, length - 2);
+                spellings[i][length - 2] = '\0';
+            } else {
+                strcpy(spellings[i], name);
+            }
+            names[i] = spellings[i];
+        }
+        compiled->keywordHash = spellings == NULL || names == NULL ? NULL
+                              : buildPerfectHash(names, compiled->numTerminals);
+        free(spellings);
+        free(names);
+        if (compiled->keywordHash == NULL) {
+            printf("Terminals are not spelled distinctly; keywords are disabled\n");
+        }
+    }
+    
+    // Flatten the alternatives into numbered productions
+    int numAlternatives = 0, numSymbols = 0;
+    for (int i = 0; i < grammar->numProductions; i++) {
+        numAlternatives += grammar->productions[i].numRHS;
+        for (int j = 0; j < grammar->productions[i].numRHS; j++) {
+            numSymbols += strlen(grammar->productions[i].rhs[j]);
+        }
+    }
+    // Cells hold production numbers as shorts
+    if (numAlternatives > SHRT_MAX) {
+        printf("Too many alternatives to compile: %d (at most %d)\n", numAlternatives, SHRT_MAX);
+        freeCompiledTable(compiled);
+        return NULL;
+    }
+    compiled->productionLhs = malloc(numAlternatives * sizeof(int));
+    compiled->productionStart = malloc(numAlternatives * sizeof(int));
+    compiled->productionLength = malloc(numAlternatives * sizeof(int));
+    compiled->productionAction = malloc(numAlternatives * sizeof(int));
+    compiled->actionNames = malloc(numAlternatives * sizeof(*compiled->actionNames));
+    compiled->rhsSymbols = malloc((numSymbols + 1) * sizeof(int));
+    compiled->cells = malloc(compiled->numNonTerminals * compiled->numTerminals * sizeof(short));
+    for (int i = 0; i < compiled->numNonTerminals * compiled->numTerminals; i++) {
+        compiled->cells[i] = -1;
+    }
+    int numConflicts = table->numConflicts < MAX_CONFLICTS ? table->numConflicts : MAX_CONFLICTS;
+    compiled->decisions = malloc((numConflicts + 1) * sizeof(Decision));
+    compiled->decisionCandidates = malloc((numConflicts + 1) * MAX_RHS * sizeof(int));
+    compiled->contested = calloc(numAlternatives + 1, sizeof(bool));
+    
+    int offset = 0;
+    for (int i = 0; i < grammar->numProductions; i++) {
+        const Production* prod = &grammar->productions[i];
+        int lhs = findNonTerminalIndex(grammar, prod->lhs);
+        
+        for (int j = 0; j < prod->numRHS; j++) {
+            int p = compiled->numProductions++;
+            compiled->productionLhs[p] = lhs;
+            compiled->productionStart[p] = offset;
+            
+            int pos = 0;
+            char* symbol;
+            while ((symbol = getSymbol(prod->rhs[j], &pos)) != NULL) {
+                int number = -1;
+                if (strcmp(symbol, EPSILON) != 0) {
+                    int nt = findNonTerminalIndex(grammar, symbol);
+                    number = nt != -1 ? compiled->numTerminals + nt : findTableTerminal(grammar, compiled, symbol);
+                    if (number == -1) {
+                        printf("Unknown symbol %s in %s -> %s\n", symbol, prod->lhs, prod->rhs[j]);
+                        free(symbol);
+                        freeCompiledTable(compiled);
+                        return NULL;
+                    }
+                    compiled->rhsSymbols[offset++] = number;
+                }
+                free(symbol);
+            }
+            compiled->productionLength[p] = offset - compiled->productionStart[p];
+            
+            char tag[20];
+            compiled->productionAction[p] = -1;
+            if (getActionTag(prod->rhs[j], tag)) {
+                int action = findAction(compiled, tag);
+                if (action == -1) {
+                    action = compiled->numActions++;
+                    strcpy(compiled->actionNames[action], tag);
+                }
+                compiled->productionAction[p] = action;
+            }
+            
+            // Point the table cells holding this alternative at its number
+            if (lhs == -1) continue;
+            const char* text = strcmp(prod->rhs[j], EPSILON) == 0 ? EPSILON : prod->rhs[j];
+            for (int t = 0; t < table->numTerminals; t++) {
+                int k = table->cells[lhs * table->numTerminals + t];
+                if (k != -1 && compiled->cells[lhs * compiled->numTerminals + t] == -1 &&
+                    strcmp(table->entries[k].production, text) == 0) {
+                    compiled->cells[lhs * compiled->numTerminals + t] = (short)p;
+                }
+            }
+            
+            // A conflict this alternative lost makes it a candidate of the cell's decision, after
+            // the production kept there (an earlier alternative, so already numbered)
+            for (int k = 0; k < numConflicts; k++) {
+                const TableConflict* conflict = &table->conflicts[k];
+                int t = findTableTerminal(grammar, compiled, conflict->terminal);
+                if (t == -1 || strcmp(conflict->nonTerminal, prod->lhs) != 0 || strcmp(conflict->production2, text) != 0) continue;
+                int kept = compiled->cells[lhs * compiled->numTerminals + t];
+                if (kept == -1) continue;
+                int d = findDecision(compiled, lhs, t);
+                if (d == -1) {
+                    d = compiled->numDecisions++;
+                    compiled->decisions[d] = (Decision){lhs, t, d * MAX_RHS, 1};
+                    compiled->decisionCandidates[d * MAX_RHS] = kept;
+                    compiled->contested[kept] = true;
+                }
+                Decision* decision = &compiled->decisions[d];
+                int* candidates = compiled->decisionCandidates + decision->firstCandidate;
+                bool known = false;
+                for (int c = 0; c < decision->numCandidates; c++) {
+                    if (candidates[c] == p) known = true;
+                }
+                if (!known && decision->numCandidates < MAX_RHS) {
+                    candidates[decision->numCandidates++] = p;
+                }
+            }
+        }
+    }
+    
+    // Sync sets for error recovery: the terminals with a cell in the row, FOLLOW and $
+    compiled->syncWords = (compiled->numTerminals + 63) / 64;
+    compiled->syncSets = calloc(compiled->numNonTerminals * compiled->syncWords, sizeof(uint64_t));
+    for (int n = 0; n < compiled->numNonTerminals; n++) {
+        uint64_t* sync = compiled->syncSets + n * compiled->syncWords;
+        for (int t = 0; t < compiled->numTerminals; t++) {
+            if (compiled->cells[n * compiled->numTerminals + t] != -1 || t == compiled->endMarker) {
+                sync[t >> 6] |= 1ULL << (t & 63);
+            }
+        }
+        const Set* follow = followSets != NULL ? findSet(followSets, compiled->numNonTerminals, compiled->nonTerminalNames[n]) : NULL;
+        for (int k = 0; follow != NULL && k < follow->numElements; k++) {
+            int t = findTableTerminal(grammar, compiled, follow->elements[k]);
+            if (t != -1) sync[t >> 6] |= 1ULL << (t & 63);
+        }
+    }
+    
+    // The operator loops bypass the table, so they are only used when every cell is LL(1)
+    if (compiled->numDecisions > 0) {
+        compiled->decisionCache = calloc(1, sizeof(DecisionCache));
+        if (compiled->decisionCache == NULL) {
+            freeCompiledTable(compiled);
+            return NULL;
+        }
+    } else {
+        compileOperatorLoops(compiled);
+    }
+    return compiled;
+}
+
+void freeLazyRows(LazyRows* lazy) {
+    if (lazy == NULL) return;
+    free(lazy->nullable);
+    free(lazy->first);
+    free(lazy->follow);
+    free(lazy->firstDone);
+    free(lazy->followDone);
+    free(lazy->built);
+    free(lazy->productionIndex);
+    free(lazy->productions);
+    free(lazy->occurrenceIndex);
+    free(lazy->occurrences);
+    free(lazy->occurrenceProduction);
+    free(lazy->members);
+    free(lazy->isMember);
+    free(lazy->followMembers);
+    free(lazy->grown);
+    free(lazy->select);
+    free(lazy);
+}
+
+// Add non-terminal n to the set being solved unless it is solved already or in the set
+void addLazyMember(LazyRows* lazy, const bool* done, int* count, int n) {
+    if (done[n] || lazy->isMember[n]) return;
+    lazy->isMember[n] = true;
+    lazy->members[(*count)++] = n;
+}
+
+// OR FIRST of the symbols from rhs[i] on into set; true if they can all derive ε
+bool addLazyFirst(const CompiledTable* compiled, const LazyRows* lazy, const int* rhs, int i, int length, uint64_t* set) {
+    for (; i < length; i++) {
+        int symbol = rhs[i];
+        if (symbol < compiled->numTerminals) {
+            set[symbol >> 6] |= 1ULL << (symbol & 63);
+            return false;
+        }
+        int n = symbol - compiled->numTerminals;
+        for (int w = 0; w < lazy->words; w++) {
+            set[w] |= lazy->first[n * lazy->words + w];
+        }
+        if (!lazy->nullable[n]) return false;
+    }
+    return true;
+}
+
+// Solve FIRST(n) together with the unsolved sets it reads: those of the non-terminals that can
+// begin one of its productions, after nothing but nullable ones
+void solveLazyFirst(const CompiledTable* compiled, LazyRows* lazy, int n) {
+    const int numTerminals = compiled->numTerminals;
+    int count = 0;
+    addLazyMember(lazy, lazy->firstDone, &count, n);
+    for (int m = 0; m < count; m++) {
+        int a = lazy->members[m];
+        for (int k = lazy->productionIndex[a]; k < lazy->productionIndex[a + 1]; k++) {
+            int p = lazy->productions[k];
+            const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+            for (int i = 0; i < compiled->productionLength[p] && rhs[i] >= numTerminals; i++) {
+                addLazyMember(lazy, lazy->firstDone, &count, rhs[i] - numTerminals);
+                if (!lazy->nullable[rhs[i] - numTerminals]) break;
+            }
+        }
+    }
+    
+    bool changes = true;
+    while (changes) {
+        changes = false;
+        for (int m = 0; m < count; m++) {
+            int a = lazy->members[m];
+            uint64_t* set = lazy->first + a * lazy->words;
+            for (int k = lazy->productionIndex[a]; k < lazy->productionIndex[a + 1]; k++) {
+                int p = lazy->productions[k];
+                uint64_t* grown = lazy->grown;
+                memset(grown, 0, lazy->words * sizeof(uint64_t));
+                addLazyFirst(compiled, lazy, compiled->rhsSymbols + compiled->productionStart[p], 0, compiled->productionLength[p], grown);
+                for (int w = 0; w < lazy->words; w++) {
+                    if (grown[w] & ~set[w]) changes = true;
+                    set[w] |= grown[w];
+                }
+            }
+        }
+    }
+    for (int m = 0; m < count; m++) {
+        lazy->firstDone[lazy->members[m]] = true;
+        lazy->isMember[lazy->members[m]] = false;
+    }
+}
+
+// Solve FOLLOW(n) together with the unsolved sets it reads: those of the left-hand sides of its
+// occurrences with nothing but nullable symbols after them. The FIRST sets of what follows each
+// occurrence are solved before the equations are
+void solveLazyFollow(const CompiledTable* compiled, LazyRows* lazy, int n) {
+    const int numTerminals = compiled->numTerminals;
+    int count = 0;
+    addLazyMember(lazy, lazy->followDone, &count, n);
+    for (int m = 0; m < count; m++) {
+        int a = lazy->members[m];
+        for (int k = lazy->occurrenceIndex[a]; k < lazy->occurrenceIndex[a + 1]; k++) {
+            int p = lazy->occurrenceProduction[k];
+            int end = compiled->productionStart[p] + compiled->productionLength[p];
+            int i = lazy->occurrences[k] + 1;
+            while (i < end && compiled->rhsSymbols[i] >= numTerminals && lazy->nullable[compiled->rhsSymbols[i] - numTerminals]) {
+                i++;
+            }
+            if (i == end) addLazyMember(lazy, lazy->followDone, &count, compiled->productionLhs[p]);
+        }
+    }
+    int* members = lazy->followMembers;
+    for (int m = 0; m < count; m++) {
+        members[m] = lazy->members[m];
+        lazy->isMember[members[m]] = false;
+    }
+    for (int m = 0; m < count; m++) {
+        int a = members[m];
+        for (int k = lazy->occurrenceIndex[a]; k < lazy->occurrenceIndex[a + 1]; k++) {
+            int p = lazy->occurrenceProduction[k];
+            int end = compiled->productionStart[p] + compiled->productionLength[p];
+            for (int i = lazy->occurrences[k] + 1; i < end && compiled->rhsSymbols[i] >= numTerminals; i++) {
+                int b = compiled->rhsSymbols[i] - numTerminals;
+                if (!lazy->firstDone[b]) solveLazyFirst(compiled, lazy, b);
+                if (!lazy->nullable[b]) break;
+            }
+        }
+        for (int e = 0; e < compiled->numEntryPoints; e++) {
+            if (compiled->entryPoints[e] == numTerminals + a) {
+                lazy->follow[a * lazy->words + (compiled->endMarker >> 6)] |= 1ULL << (compiled->endMarker & 63);
+            }
+        }
+    }
+    
+    // FOLLOW(a) gets FIRST of what follows each occurrence, and FOLLOW(lhs) if that can vanish
+    bool changes = true;
+    while (changes) {
+        changes = false;
+        for (int m = 0; m < count; m++) {
+            int a = members[m];
+            uint64_t* set = lazy->follow + a * lazy->words;
+            for (int k = lazy->occurrenceIndex[a]; k < lazy->occurrenceIndex[a + 1]; k++) {
+                int p = lazy->occurrenceProduction[k];
+                int start = compiled->productionStart[p];
+                uint64_t* grown = lazy->grown;
+                memset(grown, 0, lazy->words * sizeof(uint64_t));
+                if (addLazyFirst(compiled, lazy, compiled->rhsSymbols + start, lazy->occurrences[k] + 1 - start,
+                                 compiled->productionLength[p], grown)) {
+                    const uint64_t* lhsFollow = lazy->follow + compiled->productionLhs[p] * lazy->words;
+                    for (int w = 0; w < lazy->words; w++) {
+                        grown[w] |= lhsFollow[w];
+                    }
+                }
+                for (int w = 0; w < lazy->words; w++) {
+                    if (grown[w] & ~set[w]) changes = true;
+                    set[w] |= grown[w];
+                }
+            }
+        }
+    }
+    for (int m = 0; m < count; m++) {
+        lazy->followDone[members[m]] = true;
+    }
+}
+
+// Fill a row as buildTableRow does: each production selects FIRST of its right-hand side, and
+// FOLLOW of the non-terminal if that can derive ε, with the first production kept in each cell.
+// The row's sync set is filled too
+bool buildLazyRow(CompiledTable* compiled, int nonTerminal) {
+    LazyRows* lazy = compiled->lazyRows;
+    const int numTerminals = compiled->numTerminals;
+    short* cells = compiled->cells + nonTerminal * numTerminals;
+    if (lazy == NULL || lazy->built[nonTerminal]) return false;
+    
+    if (!lazy->followDone[nonTerminal]) solveLazyFollow(compiled, lazy, nonTerminal);
+    for (int k = lazy->productionIndex[nonTerminal]; k < lazy->productionIndex[nonTerminal + 1]; k++) {
+        int p = lazy->productions[k];
+        const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+        for (int i = 0; i < compiled->productionLength[p] && rhs[i] >= numTerminals; i++) {
+            if (!lazy->firstDone[rhs[i] - numTerminals]) solveLazyFirst(compiled, lazy, rhs[i] - numTerminals);
+            if (!lazy->nullable[rhs[i] - numTerminals]) break;
+        }
+        uint64_t* select = lazy->select;
+        memset(select, 0, lazy->words * sizeof(uint64_t));
+        if (addLazyFirst(compiled, lazy, rhs, 0, compiled->productionLength[p], select)) {
+            for (int w = 0; w < lazy->words; w++) {
+                select[w] |= lazy->follow[nonTerminal * lazy->words + w];
+            }
+        }
+        for (int t = 0; t < numTerminals; t++) {
+            if (select[t >> 6] >> (t & 63) & 1 && cells[t] == -1) cells[t] = (short)p;
+        }
+    }
+    
+    uint64_t* sync = compiled->syncSets + nonTerminal * compiled->syncWords;
+    for (int t = 0; t < numTerminals; t++) {
+        if (cells[t] != -1 || t == compiled->endMarker || lazy->follow[nonTerminal * lazy->words + (t >> 6)] >> (t & 63) & 1) {
+            sync[t >> 6] |= 1ULL << (t & 63);
+        }
+    }
+    lazy->built[nonTerminal] = true;
+    lazy->numBuilt++;
+    return true;
+}
+
+CompiledTable* compileLazyParseTable(const Grammar* grammar) {
+    // An empty table over the same symbols numbers the productions, terminals and actions
+    ParseTable table;
+    memset(&table, 0, sizeof(ParseTable));
+    int numCells = (grammar->numTerminals + 1) * grammar->numNonTerminals;
+    table.terminals = malloc((grammar->numTerminals + 1) * sizeof(*table.terminals));
+    table.nonTerminals = malloc((grammar->numNonTerminals + 1) * sizeof(*table.nonTerminals));
+    table.cells = malloc((numCells + 1) * sizeof(int));
+    if (table.terminals == NULL || table.nonTerminals == NULL || table.cells == NULL) {
+        freeParseTable(&table);
+        return NULL;
+    }
+    table.numTerminals = grammar->numTerminals + 1;
+    for (int i = 0; i < grammar->numTerminals; i++) {
+        strcpy(table.terminals[i], grammar->terminals[i]);
+    }
+    strcpy(table.terminals[grammar->numTerminals], "$");
+    table.numNonTerminals = grammar->numNonTerminals;
+    for (int i = 0; i < grammar->numNonTerminals; i++) {
+        strcpy(table.nonTerminals[i], grammar->nonTerminals[i]);
+    }
+    for (int i = 0; i < numCells; i++) {
+        table.cells[i] = -1;
+    }
+    CompiledTable* compiled = compileParseTable(grammar, &table, NULL);
+    freeParseTable(&table);
+    if (compiled == NULL) return NULL;
+    
+    const int numTerminals = compiled->numTerminals;
+    const int numNonTerminals = compiled->numNonTerminals;
+    LazyRows* lazy = calloc(1, sizeof(LazyRows));
+    compiled->lazyRows = lazy;
+    if (lazy == NULL) {
+        freeCompiledTable(compiled);
+        return NULL;
+    }
+    lazy->words = (numTerminals + 63) / 64;
+    lazy->nullable = calloc(numNonTerminals + 1, sizeof(bool));
+    lazy->first = calloc(numNonTerminals * lazy->words + 1, sizeof(uint64_t));
+    lazy->follow = calloc(numNonTerminals * lazy->words + 1, sizeof(uint64_t));
+    lazy->firstDone = calloc(numNonTerminals + 1, sizeof(bool));
+    lazy->followDone = calloc(numNonTerminals + 1, sizeof(bool));
+    lazy->built = calloc(numNonTerminals + 1, sizeof(bool));
+    lazy->productionIndex = calloc(numNonTerminals + 2, sizeof(int));
+    lazy->productions = malloc((compiled->numProductions + 1) * sizeof(int));
+    lazy->occurrenceIndex = calloc(numNonTerminals + 2, sizeof(int));
+    int numSymbols = compiled->numProductions > 0 ? compiled->productionStart[compiled->numProductions - 1] +
+                                                    compiled->productionLength[compiled->numProductions - 1] : 0;
+    lazy->occurrences = malloc((numSymbols + 1) * sizeof(int));
+    lazy->occurrenceProduction = malloc((numSymbols + 1) * sizeof(int));
+    lazy->members = malloc((numNonTerminals + 1) * sizeof(int));
+    lazy->isMember = calloc(numNonTerminals + 1, sizeof(bool));
+    lazy->followMembers = malloc((numNonTerminals + 1) * sizeof(int));
+    lazy->grown = malloc(lazy->words * sizeof(uint64_t) + 1);
+    lazy->select = malloc(lazy->words * sizeof(uint64_t) + 1);
+    if (lazy->nullable == NULL || lazy->first == NULL || lazy->follow == NULL || lazy->firstDone == NULL ||
+        lazy->followDone == NULL || lazy->built == NULL || lazy->productionIndex == NULL || lazy->productions == NULL ||
+        lazy->occurrenceIndex == NULL || lazy->occurrences == NULL || lazy->occurrenceProduction == NULL ||
+        lazy->members == NULL || lazy->isMember == NULL || lazy->followMembers == NULL ||
+        lazy->grown == NULL || lazy->select == NULL) {
+        freeCompiledTable(compiled);
+        return NULL;
+    }
+    
+    // Index the productions by left-hand side and the occurrences by symbol, in production order.
+    // Counts go two places up, so that after the sums filling from index[n + 1] leaves index[n]
+    // at the start of n's entries and index[n + 1] at their end
+    for (int p = 0; p < compiled->numProductions; p++) {
+        lazy->productionIndex[compiled->productionLhs[p] + 2]++;
+        for (int i = 0; i < compiled->productionLength[p]; i++) {
+            int symbol = compiled->rhsSymbols[compiled->productionStart[p] + i];
+            if (symbol >= numTerminals) lazy->occurrenceIndex[symbol - numTerminals + 2]++;
+        }
+    }
+    for (int n = 2; n <= numNonTerminals; n++) {
+        lazy->productionIndex[n] += lazy->productionIndex[n - 1];
+        lazy->occurrenceIndex[n] += lazy->occurrenceIndex[n - 1];
+    }
+    for (int p = 0; p < compiled->numProductions; p++) {
+        lazy->productions[lazy->productionIndex[compiled->productionLhs[p] + 1]++] = p;
+        for (int i = 0; i < compiled->productionLength[p]; i++) {
+            int offset = compiled->productionStart[p] + i;
+            int symbol = compiled->rhsSymbols[offset];
+            if (symbol < numTerminals) continue;
+            int k = lazy->occurrenceIndex[symbol - numTerminals + 1]++;
+            lazy->occurrences[k] = offset;
+            lazy->occurrenceProduction[k] = p;
+        }
+    }
+    
+    bool changes = true;
+    while (changes) {
+        changes = false;
+        for (int p = 0; p < compiled->numProductions; p++) {
+            int lhs = compiled->productionLhs[p];
+            if (lazy->nullable[lhs]) continue;
+            const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+            int i = 0;
+            while (i < compiled->productionLength[p] && rhs[i] >= numTerminals && lazy->nullable[rhs[i] - numTerminals]) {
+                i++;
+            }
+            if (i == compiled->productionLength[p]) {
+                lazy->nullable[lhs] = true;
+                changes = true;
+            }
+        }
+    }
+    
+    if (compiled->startSymbol >= numTerminals) {
+        buildLazyRow(compiled, compiled->startSymbol - numTerminals);
+    }
+    return compiled;
+}
+
+int builtTableRows(const CompiledTable* compiled) {
+    return compiled->lazyRows != NULL ? compiled->lazyRows->numBuilt : compiled->numNonTerminals;
+}
+
+void freeCompiledTable(CompiledTable* compiled) {
+    if (compiled == NULL) return;
+    free(compiled->productionLhs);
+    free(compiled->productionStart);
+    free(compiled->productionLength);
+    free(compiled->rhsSymbols);
+    free(compiled->productionAction);
+    free(compiled->syncSets);
+    free(compiled->actionNames);
+    free(compiled->cells);
+    freePerfectHash(compiled->keywordHash);
+    free(compiled->rowBase);
+    free(compiled->comb);
+    free(compiled->check);
+    free(compiled->expressionLoop);
+    free(compiled->loopOperand);
+    free(compiled->operatorLoops);
+    free(compiled->decisions);
+    free(compiled->decisionCandidates);
+    free(compiled->contested);
+    free(compiled->decisionCache);
+    free(compiled->entryPoints);
+    freeLazyRows(compiled->lazyRows);
+    free(compiled->terminalNames);
+    free(compiled->nonTerminalNames);
+    free(compiled);
+}
+
+// First free comb slot at or after slot, compressing the path it followed. nextFree[i] is i while
+// slot i is free, and points further on once it is taken
+int findFreeSlot(int* nextFree, int slot) {
+    int free = slot;
+    while (nextFree[free] != free) free = nextFree[free];
+    while (nextFree[slot] != free) {
+        int next = nextFree[slot];
+        nextFree[slot] = free;
+        slot = next;
+    }
+    return free;
+}
+
+// The 64 bits of a bitset from bit position on
+static inline uint64_t bitsFrom(const uint64_t* bits, int position) {
+    int word = position >> 6;
+    int offset = position & 63;
+    return offset == 0 ? bits[word] : bits[word] >> offset | bits[word + 1] << (64 - offset);
+}
+
+// Pack the rows into one comb vector, densest rows first, each at the lowest base where
+// its non-empty cells land on free slots. The search starts at the first base that puts a
+// row's first cell on a free slot, and tries 64 bases at once against a bitset of the taken
+// slots, so packing stays fast for thousands of rows. Tables whose row numbers do not fit
+// the check array stay dense
+void compressCompiledTable(CompiledTable* compiled) {
+    if (compiled->comb != NULL || compiled->numNonTerminals > SHRT_MAX) return;
+    for (int n = 0; compiled->lazyRows != NULL && n < compiled->numNonTerminals; n++) {
+        buildLazyRow(compiled, n);
+    }
+    
+    // The filled columns of each row, and the rows by how many they have, most first
+    int numRows = compiled->numNonTerminals;
+    int numColumns = compiled->numTerminals;
+    int* columnStart = calloc(numRows + 2, sizeof(int));
+    int* sizeStart = calloc(numColumns + 2, sizeof(int));
+    int* order = malloc((numRows + 1) * sizeof(int));
+    int numFilled = 0;
+    for (int n = 0; n < numRows; n++) {
+        for (int t = 0; t < numColumns; t++) {
+            if (compiled->cells[n * numColumns + t] != -1) columnStart[n + 2]++;
+        }
+        numFilled += columnStart[n + 2];
+        sizeStart[numColumns - columnStart[n + 2] + 1]++;
+    }
+    int* columns = malloc((numFilled + 1) * sizeof(int));
+    for (int n = 0; n < numRows; n++) {
+        columnStart[n + 2] += columnStart[n + 1];
+    }
+    for (int n = 0; n < numRows; n++) {
+        for (int t = 0; t < numColumns; t++) {
+            if (compiled->cells[n * numColumns + t] != -1) columns[columnStart[n + 1]++] = t;
+        }
+    }
+    for (int s = 0; s < numColumns; s++) {
+        sizeStart[s + 1] += sizeStart[s];
+    }
+    for (int n = 0; n < numRows; n++) {
+        order[sizeStart[numColumns - (columnStart[n + 1] - columnStart[n])]++] = n;
+    }
+    
+    // Worst case every row gets its own span; the padding keeps base + terminal in bounds
+    int capacity = numRows * numColumns + numColumns;
+    compiled->rowBase = malloc((numRows + 1) * sizeof(int));
+    compiled->comb = malloc(capacity * sizeof(short));
+    compiled->check = malloc(capacity * sizeof(short));
+    int* nextFree = malloc((capacity + 1) * sizeof(int));
+    uint64_t* taken = calloc(capacity / 64 + 3, sizeof(uint64_t));
+    for (int i = 0; i < capacity; i++) {
+        compiled->comb[i] = -1;
+        compiled->check[i] = -1;
+        nextFree[i] = i;
+    }
+    nextFree[capacity] = capacity;
+    
+    int used = 0;
+    for (int i = 0; i < numRows; i++) {
+        int row = order[i];
+        const int* filled = columns + columnStart[row];
+        int numCells = columnStart[row + 1] - columnStart[row];
+        int base = 0;
+        if (numCells > 0) {
+            // Bit b of fits is set when base + b puts every cell on a free slot. A base at or past
+            // used always fits, so the window never reads past the padding
+            base = findFreeSlot(nextFree, filled[0]) - filled[0];
+            while (true) {
+                uint64_t fits = ~0ULL;
+                for (int k = 0; k < numCells && fits != 0; k++) {
+                    fits &= ~bitsFrom(taken, base + filled[k]);
+                }
+                if (fits != 0) {
+                    base += __builtin_ctzll(fits);
+                    break;
+                }
+                base += 64;
+            }
+        }
+        
+        compiled->rowBase[row] = base;
+        for (int k = 0; k < numCells; k++) {
+            int slot = base + filled[k];
+            compiled->comb[slot] = compiled->cells[row * numColumns + filled[k]];
+            compiled->check[slot] = (short)row;
+            nextFree[slot] = slot + 1;
+            taken[slot >> 6] |= 1ULL << (slot & 63);
+            if (slot + 1 > used) used = slot + 1;
+        }
+    }
+    
+    compiled->combSize = used + numColumns;
+    compiled->comb = realloc(compiled->comb, compiled->combSize * sizeof(short));
+    compiled->check = realloc(compiled->check, compiled->combSize * sizeof(short));
+    free(compiled->cells);
+    compiled->cells = NULL;
+    free(columnStart);
+    free(sizeStart);
+    free(order);
+    free(columns);
+    free(nextFree);
+    free(taken);
+}
+
+size_t denseTableBytes(const CompiledTable* compiled) {
+    return (size_t)compiled->numNonTerminals * compiled->numTerminals * sizeof(short);
+}
+
+size_t compressedTableBytes(const CompiledTable* compiled) {
+    if (compiled->comb == NULL) return denseTableBytes(compiled);
+    return (size_t)compiled->combSize * 2 * sizeof(short) + compiled->numNonTerminals * sizeof(int);
+}
+
+static inline bool isWordByte(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+int nextToken(const CompiledTable* compiled, const char* input, int length, int* pos, int* start) {
+    *pos += scanSpaces(input + *pos, length - *pos);
+    *start = *pos;
+    if (*pos >= length) {
+        return compiled->endMarker;
+    }
+    
+    // Only a whole run can be a keyword, so the rest of a run that was not one stays bytes
+    if (compiled->keywordHash != NULL && isWordByte(input[*pos]) && (*pos == 0 || !isWordByte(input[*pos - 1]))) {
+        int end = *pos + scanIdentifier(input + *pos, length - *pos);
+        int terminal = lookupPerfectHash(compiled->keywordHash, input + *pos, end - *pos);
+        if (terminal != -1) {
+            *pos = end;
+            return terminal;
+        }
+    }
+    return compiled->terminalOf[(unsigned char)input[(*pos)++]];
+}
+
+int findDecision(const CompiledTable* compiled, int nonTerminal, int terminal) {
+    for (int d = 0; d < compiled->numDecisions; d++) {
+        if (compiled->decisions[d].nonTerminal == nonTerminal && compiled->decisions[d].terminal == terminal) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+unsigned long long decisionEdge(int decision, int state, int token) {
+    return (unsigned long long)(decision + 1) << 48 | (unsigned long long)state << 16 | (unsigned int)(token + 1);
+}
+
+unsigned int decisionSlot(unsigned long long edge) {
+    return (unsigned int)((edge * 0x9E3779B97F4A7C15ULL) >> 40) % DECISION_CACHE_SLOTS;
+}
+
+// The state an edge leads to, 0 if it is not cached (yet)
+int findCachedState(DecisionCache* cache, unsigned long long edge) {
+    unsigned int slot = decisionSlot(edge);
+    for (int i = 0; i < DECISION_CACHE_SLOTS; i++) {
+        unsigned long long key = atomic_load_explicit(&cache->keys[slot], memory_order_acquire);
+        if (key == 0) return 0;
+        if (key == edge) return atomic_load_explicit(&cache->targets[slot], memory_order_acquire);
+        slot = (slot + 1) % DECISION_CACHE_SLOTS;
+    }
+    return 0;
+}
+
+// Add a state with its prediction and the edge to it. Returns the state the edge leads to, which
+// another thread may have added first, or 0 if the cache is full
+int addCachedState(DecisionCache* cache, unsigned long long edge, int prediction) {
+    if (atomic_load_explicit(&cache->numStates, memory_order_relaxed) >= DECISION_CACHE_STATES - 1) return 0;
+    int state = atomic_fetch_add(&cache->numStates, 1) + 1;
+    if (state >= DECISION_CACHE_STATES) return 0;
+    cache->predictions[state] = prediction;
+    
+    unsigned int slot = decisionSlot(edge);
+    for (int i = 0; i < DECISION_CACHE_SLOTS; i++) {
+        unsigned long long expected = 0;
+        if (atomic_compare_exchange_strong(&cache->keys[slot], &expected, edge)) {
+            atomic_store_explicit(&cache->targets[slot], state, memory_order_release);
+            return state;
+        }
+        if (expected == edge) return atomic_load_explicit(&cache->targets[slot], memory_order_acquire);
+        slot = (slot + 1) % DECISION_CACHE_SLOTS;
+    }
+    return 0;
+}
+
+bool pushSpeculation(const CompiledTable* compiled, Speculation* speculation, int production) {
+    int n = compiled->productionLength[production];
+    if (speculation->top + n > SPECULATION_STACK) return false;
+    const int* rhs = compiled->rhsSymbols + compiled->productionStart[production];
+    for (int i = n - 1; i >= 0; i--) {
+        speculation->stack[speculation->top++] = rhs[i];
+    }
+    return true;
+}
+
+// Expand speculation i until a terminal is on top. A nested decision forks a copy for each of its
+// other candidates onto the end of speculations while there is room
+SpeculationStep stepSpeculation(const CompiledTable* compiled, Speculation* speculations, int* count, int i, int token) {
+    Speculation* speculation = &speculations[i];
+    for (int steps = 0; steps < SPECULATION_STEPS; steps++) {
+        if (speculation->top == 0) return SPECULATION_ENDED;
+        int symbol = speculation->stack[speculation->top - 1];
+        if (symbol < compiled->numTerminals) return symbol == token ? SPECULATION_MATCHED : SPECULATION_DROPPED;
+        if (token < 0) return SPECULATION_DROPPED;
+        
+        int nonTerminal = symbol - compiled->numTerminals;
+        int p = tableCell(compiled, nonTerminal, token);
+        if (p < 0) return SPECULATION_DROPPED;
+        speculation->top--;
+        int d = compiled->contested[p] ? findDecision(compiled, nonTerminal, token) : -1;
+        if (d != -1) {
+            const Decision* decision = &compiled->decisions[d];
+            const int* candidates = compiled->decisionCandidates + decision->firstCandidate;
+            for (int c = 1; c < decision->numCandidates && *count < MAX_SPECULATIONS; c++) {
+                speculations[*count] = *speculation;
+                if (pushSpeculation(compiled, &speculations[*count], candidates[c])) (*count)++;
+            }
+        }
+        if (!pushSpeculation(compiled, speculation, p)) return SPECULATION_DROPPED;
+    }
+    return SPECULATION_DROPPED;
+}
+
+// Next token of a decision's lookahead
+int nextDecisionToken(const CompiledTable* compiled, DecisionInput* ahead) {
+    if (ahead->next < ahead->numTokens) return ahead->tokens[ahead->next++];
+    if (ahead->input == NULL) return compiled->endMarker;
+    int start;
+    return nextToken(compiled, ahead->input, ahead->length, &ahead->pos, &start);
+}
+
+// predictProduction with the tokens after the lookahead read from ahead
+int predictDecision(const CompiledTable* compiled, int decision, int token, const DecisionInput* ahead) {
+    const Decision* contested = &compiled->decisions[decision];
+    const int* candidates = compiled->decisionCandidates + contested->firstCandidate;
+    DecisionCache* cache = compiled->decisionCache;
+    int tokens[MAX_LOOKAHEAD];
+    
+    // Follow the cached DFA as far as it goes
+    int state = 0;
+    int lookahead = token;
+    DecisionInput input = *ahead;
+    for (int depth = 0; depth < MAX_LOOKAHEAD; depth++) {
+        state = findCachedState(cache, decisionEdge(decision, state, lookahead));
+        if (state == 0) break;
+        if (cache->predictions[state] >= 0) return candidates[cache->predictions[state]];
+        lookahead = nextDecisionToken(compiled, &input);
+    }
+    
+    // Expand every candidate against the tokens ahead, one token at a time
+    Speculation speculations[MAX_SPECULATIONS];
+    int count = 0;
+    for (int c = 0; c < contested->numCandidates && count < MAX_SPECULATIONS; c++) {
+        speculations[count].candidate = c;
+        speculations[count].top = 0;
+        if (pushSpeculation(compiled, &speculations[count], candidates[c])) count++;
+    }
+    int settled = 0;
+    int depth = 0;
+    lookahead = token;
+    input = *ahead;
+    while (true) {
+        tokens[depth] = lookahead;
+        int survivors = 0;
+        bool ended = false;
+        for (int i = 0; i < count; i++) {
+            SpeculationStep step = stepSpeculation(compiled, speculations, &count, i, lookahead);
+            if (step == SPECULATION_DROPPED) continue;
+            if (step == SPECULATION_ENDED) ended = true;
+            if (survivors != i) speculations[survivors] = speculations[i];
+            survivors++;
+        }
+        count = survivors;
+        
+        // No candidate fits: keep the cell's production, and the parser reports the error
+        if (count == 0) break;
+        int earliest = speculations[0].candidate;
+        bool agreed = true;
+        for (int i = 1; i < count; i++) {
+            if (speculations[i].candidate != earliest) agreed = false;
+            if (speculations[i].candidate < earliest) earliest = speculations[i].candidate;
+        }
+        if (agreed || ended || lookahead == compiled->endMarker || depth == MAX_LOOKAHEAD - 1) {
+            settled = earliest;
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            speculations[i].top--;
+        }
+        lookahead = nextDecisionToken(compiled, &input);
+        depth++;
+    }
+    
+    // Cache the tokens looked at as a path ending in the prediction
+    state = 0;
+    for (int i = 0; i <= depth; i++) {
+        unsigned long long edge = decisionEdge(decision, state, tokens[i]);
+        int next = findCachedState(cache, edge);
+        state = next != 0 ? next : addCachedState(cache, edge, i == depth ? settled : -1);
+        if (state == 0) break;
+    }
+    return candidates[settled];
+}
+
+int predictProduction(const CompiledTable* compiled, int decision, const char* input, int length, int pos, int token) {
+    DecisionInput ahead = {NULL, 0, 0, input, length, pos};
+    return predictDecision(compiled, decision, token, &ahead);
+}
+
+int predictProductionTokens(const CompiledTable* compiled, int decision, const int* tokens, int numTokens) {
+    DecisionInput ahead = {tokens + 1, numTokens - 1, 0, NULL, 0, 0};
+    return predictDecision(compiled, decision, tokens[0], &ahead);
+}
+
+void initParseTree(ParseTree* tree) {
+    tree->nodes = NULL;
+    tree->numNodes = 0;
+    tree->capacity = 0;
+}
+
+void resetParseTree(ParseTree* tree) {
+    tree->numNodes = 0;
+}
+
+void freeParseTree(ParseTree* tree) {
+    free(tree->nodes);
+    initParseTree(tree);
+}
+
+// Bump-allocate count consecutive nodes, growing the array if needed. -1 if out of memory
+int allocateTreeNodes(ParseTree* tree, int count) {
+    if (tree->numNodes + count > tree->capacity) {
+        int capacity = tree->capacity > 0 ? tree->capacity : 1024;
+        while (capacity < tree->numNodes + count) capacity *= 2;
+        TreeNode* nodes = realloc(tree->nodes, capacity * sizeof(TreeNode));
+        if (nodes == NULL) return -1;
+        tree->nodes = nodes;
+        tree->capacity = capacity;
+    }
+    int first = tree->numNodes;
+    tree->numNodes += count;
+    return first;
+}
+
+void recordParseError(ParseErrors* errors, int offset, int expected, int found) {
+    if (errors->numErrors < MAX_PARSE_ERRORS) {
+        errors->errors[errors->numErrors] = (ParseError){offset, expected, found};
+    }
+    errors->numErrors++;
+}
+
+// Next token, reporting and skipping bytes that are no terminal when recovering from errors
+int nextKnownToken(const CompiledTable* compiled, const char* input, int length, int* pos, int* start,
+                   ParseErrors* errors, int expected) {
+    int token = nextToken(compiled, input, length, pos, start);
+    while (token == -1 && errors != NULL) {
+        recordParseError(errors, *start, expected, -1);
+        token = nextToken(compiled, input, length, pos, start);
+    }
+    return token;
+}
+
+// Highest stack entry below top that can go on with token when recovering: the token itself, or a
+// non-terminal whose sync set holds it. -1 if there is none
+int resumePoint(const CompiledTable* compiled, const int* stack, int top, int token) {
+    for (int i = top - 1; i >= 0; i--) {
+        int symbol = stack[i];
+        if (symbol < compiled->numTerminals) {
+            if (symbol == token) return i;
+            continue;
+        }
+        const uint64_t* sync = compiled->syncSets + (symbol - compiled->numTerminals) * compiled->syncWords;
+        if (sync[token >> 6] >> (token & 63) & 1) return i;
+    }
+    return -1;
+}
+
+// The predictive parser. With a tree, every stack entry carries the node it will fill in:
+// expanding a non-terminal allocates its children as siblings in one block, and matching a
+// terminal records the token's offset and length. With actions, a production whose action has
+// a complete callback leaves a marker (-1 - production) under its symbols that fires it when popped.
+// With errors, it recovers in panic mode instead of stopping: a missing terminal is reported and
+// popped, and a non-terminal with no cell for the lookahead skips tokens up to its sync set, then
+// expands if the token has a cell or gives up on the non-terminal if the token follows it. The
+// skipping also stops at a token that a symbol lower on the stack can go on with, and pops the
+// stack down to that symbol, so an error does not swallow the input of an enclosing construct.
+// With a profile, every expansion is counted in it. Tail loops keep their non-terminal on the
+// stack across iterations, and without a tree, actions, errors or a profile the binary-operator
+// levels are parsed by their operator loops
+// lazy is the same table when it is a lazy one being parsed with parseInputLazy, NULL otherwise
+ParseResult runParser(const CompiledTable* compiled, int start, const char* input, int length, ParseTree* tree,
+                      const ParseActions* actions, ParseErrors* errors, ParseProfile* profile, CompiledTable* lazy) {
+    ParseResult result = {false, -1, 0};
+    int stack[MAX_PARSE_STACK];
+    int nodeStack[MAX_PARSE_STACK];
+    int top = 0;
+    const int numTerminals = compiled->numTerminals;
+    const int firstLoop = numTerminals + compiled->numNonTerminals;
+    const bool recognizeOnly = tree == NULL && actions == NULL && errors == NULL && profile == NULL;
+    const bool useLoops = recognizeOnly && compiled->numOperatorLoops > 0;
+    
+    stack[top++] = compiled->endMarker;
+    stack[top++] = start;
+    if (profile != NULL && top > profile->maxStackDepth) profile->maxStackDepth = top;
+    
+    int pos = 0;
+    int tokenOffset;
+    int tokenEnd = 0;
+    int token = nextKnownToken(compiled, input, length, &pos, &tokenOffset, errors, start);
+    result.numTokens = 1;
+    if (errors != NULL) errors->numErrors = 0;
+    
+    if (tree != NULL) {
+        resetParseTree(tree);
+        int root = allocateTreeNodes(tree, 1);
+        if (root == -1) {
+            result.errorOffset = tokenOffset;
+            return result;
+        }
+        tree->nodes[root] = (TreeNode){start, -1, -1, -1, tokenOffset, 0};
+        nodeStack[1] = root;
+    }
+    
+    while (top > 0) {
+        int symbol = stack[--top];
+        int node = tree != NULL ? nodeStack[top] : -1;
+        
+        if (symbol < 0) {
+            int p = -1 - symbol;
+            actions->complete[compiled->productionAction[p]](actions->context, p, tokenEnd);
+            continue;
+        }
+        
+        if (symbol < numTerminals) {
+            // Terminal on top: it has to match the lookahead
+            if (symbol != token) {
+                if (errors == NULL) break;
+                recordParseError(errors, tokenOffset, symbol, token);
+                if (symbol == compiled->endMarker) break;
+                continue;
+            }
+            if (token == compiled->endMarker) {
+                result.accepted = errors == NULL || errors->numErrors == 0;
+                if (!result.accepted) result.errorOffset = errors->errors[0].offset;
+                return result;
+            }
+            if (tree != NULL) {
+                tree->nodes[node].start = tokenOffset;
+                tree->nodes[node].length = pos - tokenOffset;
+            }
+            tokenEnd = pos;
+            int expected = top > 0 && stack[top - 1] >= 0 ? stack[top - 1] : -1;
+            token = nextKnownToken(compiled, input, length, &pos, &tokenOffset, errors, expected);
+            result.numTokens++;
+            continue;
+        }
+        
+        if (useLoops) {
+            int loop = symbol >= firstLoop ? symbol - firstLoop : compiled->expressionLoop[symbol - numTerminals];
+            if (loop != -1 && top + 3 > MAX_PARSE_STACK) break;
+            if (symbol >= firstLoop) {
+                // Operator loop on top: take an operator of its levels, or end the loop
+                int next = token >= 0 ? compiled->operatorLoops[loop * numTerminals + token] : -1;
+                if (next == -1) continue;
+                tokenEnd = pos;
+                token = nextToken(compiled, input, length, &pos, &tokenOffset);
+                result.numTokens++;
+                stack[top++] = symbol;
+                if (next < compiled->numOperatorLoops) stack[top++] = firstLoop + next;
+                stack[top++] = compiled->loopOperand[loop];
+                continue;
+            }
+            if (loop != -1) {
+                stack[top++] = firstLoop + loop;
+                stack[top++] = compiled->loopOperand[loop];
+                continue;
+            }
+        }
+        
+        // Non-terminal on top: expand by the table cell for the lookahead
+        if (token < 0) break;
+        int p = tableCell(compiled, symbol - numTerminals, token);
+        // A lazy table's unbuilt rows are empty, so the row is built on its first miss
+        if (p < 0 && lazy != NULL && buildLazyRow(lazy, symbol - numTerminals)) {
+            p = tableCell(compiled, symbol - numTerminals, token);
+        }
+        if (p < 0) {
+            if (errors == NULL) break;
+            recordParseError(errors, tokenOffset, symbol, token);
+            
+            // $ is in every sync set, so the skipping stops at the end of the input. Each skipped
+            // token costs a bit test per stack entry
+            const uint64_t* sync = compiled->syncSets + (symbol - numTerminals) * compiled->syncWords;
+            int resume = -1;
+            while (!(sync[token >> 6] >> (token & 63) & 1)) {
+                resume = resumePoint(compiled, stack, top, token);
+                if (resume != -1) break;
+                token = nextKnownToken(compiled, input, length, &pos, &tokenOffset, errors, symbol);
+                result.numTokens++;
+            }
+            if (resume != -1) {
+                top = resume + 1;
+                continue;
+            }
+            p = tableCell(compiled, symbol - numTerminals, token);
+            if (p < 0) continue;
+        }
+        if (compiled->contested[p]) {
+            int d = findDecision(compiled, symbol - numTerminals, token);
+            if (d != -1) p = predictProduction(compiled, d, input, length, pos, token);
+        }
+        
+        if (profile != NULL) {
+            int nonTerminal = symbol - numTerminals;
+            profile->cellCounts[nonTerminal * numTerminals + token]++;
+            profile->productionCounts[p]++;
+            if (top + 1 > profile->maxDepth[nonTerminal]) profile->maxDepth[nonTerminal] = top + 1;
+        }
+        
+        int n = compiled->productionLength[p];
+        if (top + n + 1 > MAX_PARSE_STACK) break;
+        const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+        
+        int action = actions != NULL ? compiled->productionAction[p] : -1;
+        bool completes = action != -1 && actions->complete != NULL && actions->complete[action] != NULL;
+        if (action != -1) {
+            if (actions->expand != NULL && actions->expand[action] != NULL) {
+                actions->expand[action](actions->context, p, tokenOffset);
+            }
+            if (completes) {
+                stack[top++] = -1 - p;
+            }
+        }
+        
+        // A tail rule (R -> α R, as EBNF repetitions and left recursion removal make) runs in place:
+        // R stays in its stack slot under α for the next iteration, and with a tree the slot moves on
+        // to the new R node. A complete callback has to fire after the rest of the loop, so those
+        // iterations nest
+        bool inPlace = n > 0 && rhs[n - 1] == symbol && !completes;
+        
+        if (tree != NULL) {
+            int first = n > 0 ? allocateTreeNodes(tree, n) : -1;
+            if (n > 0 && first == -1) break;
+            tree->nodes[node].production = p;
+            tree->nodes[node].firstChild = first;
+            tree->nodes[node].start = tokenOffset;
+            for (int i = 0; i < n; i++) {
+                tree->nodes[first + i] = (TreeNode){rhs[i], -1, -1, i + 1 < n ? first + i + 1 : -1, tokenOffset, 0};
+                nodeStack[top + n - 1 - i] = first + i;
+            }
+        }
+        if (inPlace) {
+            top++;
+            n--;
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            stack[top++] = rhs[i];
+        }
+        if (profile != NULL && top > profile->maxStackDepth) profile->maxStackDepth = top;
+    }
+    
+    result.errorOffset = errors != NULL && errors->numErrors > 0 ? errors->errors[0].offset : tokenOffset;
+    return result;
+}
+
+ParseResult parseInput(const CompiledTable* compiled, const char* input, int length) {
+    return runParser(compiled, compiled->startSymbol, input, length, NULL, NULL, NULL, NULL, NULL);
+}
+
+ParseResult parseInputTree(const CompiledTable* compiled, const char* input, int length, ParseTree* tree) {
+    return runParser(compiled, compiled->startSymbol, input, length, tree, NULL, NULL, NULL, NULL);
+}
+
+ParseResult parseInputActions(const CompiledTable* compiled, const char* input, int length, const ParseActions* actions) {
+    return runParser(compiled, compiled->startSymbol, input, length, NULL, actions, NULL, NULL, NULL);
+}
+
+ParseResult parseInputRecover(const CompiledTable* compiled, const char* input, int length, ParseErrors* errors) {
+    return runParser(compiled, compiled->startSymbol, input, length, NULL, NULL, errors, NULL, NULL);
+}
+
+ParseResult parseInputFrom(const CompiledTable* compiled, int entryPoint, const char* input, int length) {
+    return runParser(compiled, compiled->entryPoints[entryPoint], input, length, NULL, NULL, NULL, NULL, NULL);
+}
+
+ParseResult parseInputRecoverFrom(const CompiledTable* compiled, int entryPoint, const char* input, int length, ParseErrors* errors) {
+    return runParser(compiled, compiled->entryPoints[entryPoint], input, length, NULL, NULL, errors, NULL, NULL);
+}
+
+ParseResult parseInputLazy(CompiledTable* compiled, int entryPoint, const char* input, int length) {
+    return runParser(compiled, compiled->entryPoints[entryPoint], input, length, NULL, NULL, NULL, NULL, compiled);
+}
+
+ParseProfile* createParseProfile(const CompiledTable* compiled) {
+    ParseProfile* profile = (ParseProfile*)calloc(1, sizeof(ParseProfile));
+    if (profile == NULL) return NULL;
+    profile->numTerminals = compiled->numTerminals;
+    profile->numNonTerminals = compiled->numNonTerminals;
+    profile->numProductions = compiled->numProductions;
+    profile->cellCounts = calloc(compiled->numNonTerminals * compiled->numTerminals + 1, sizeof(unsigned long long));
+    profile->productionCounts = calloc(compiled->numProductions + 1, sizeof(unsigned long long));
+    profile->maxDepth = calloc(compiled->numNonTerminals + 1, sizeof(int));
+    if (profile->cellCounts == NULL || profile->productionCounts == NULL || profile->maxDepth == NULL) {
+        freeParseProfile(profile);
+        return NULL;
+    }
+    return profile;
+}
+
+void freeParseProfile(ParseProfile* profile) {
+    if (profile == NULL) return;
+    free(profile->cellCounts);
+    free(profile->productionCounts);
+    free(profile->maxDepth);
+    free(profile);
+}
+
+ParseResult parseInputProfile(const CompiledTable* compiled, const char* input, int length, ParseProfile* profile) {
+    ParseResult result = runParser(compiled, compiled->startSymbol, input, length, NULL, NULL, NULL, profile, NULL);
+    profile->numParses++;
+    if (result.accepted) profile->numAccepted++;
+    profile->numTokens += result.numTokens;
+    return result;
+}
+
+int findEntryPoint(const CompiledTable* compiled, const char* name) {
+    for (int i = 0; i < compiled->numEntryPoints; i++) {
+        if (strcmp(compiled->nonTerminalNames[compiled->entryPoints[i] - compiled->numTerminals], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void initPushParser(PushParser* parser, const CompiledTable* compiled) {
+    parser->compiled = compiled;
+    parser->top = 0;
+    parser->stack[parser->top++] = compiled->endMarker;
+    parser->stack[parser->top++] = compiled->startSymbol;
+    parser->offset = 0;
+    parser->runLength = 0;
+    parser->runStart = 0;
+    parser->status = PUSH_NEED_INPUT;
+    parser->errorOffset = -1;
+    parser->numTokens = 0;
+    parser->numAhead = 0;
+}
+
+// Parse one token. With decisions it is ahead[0], and the rest of ahead is its lookahead
+PushStatus parsePushedToken(PushParser* parser, int token, int offset) {
+    const CompiledTable* compiled = parser->compiled;
+    const int numTerminals = compiled->numTerminals;
+    
+    // Expand until the terminal on top can be matched against the token
+    while (parser->top > 0) {
+        int symbol = parser->stack[--parser->top];
+        
+        if (symbol < numTerminals) {
+            if (symbol != token) break;
+            if (token == compiled->endMarker) {
+                parser->status = PUSH_ACCEPTED;
+            }
+            return parser->status;
+        }
+        
+        if (token < 0) break;
+        int p = tableCell(compiled, symbol - numTerminals, token);
+        if (p < 0) break;
+        if (compiled->contested[p]) {
+            int d = findDecision(compiled, symbol - numTerminals, token);
+            if (d != -1) {
+                int tokens[MAX_LOOKAHEAD];
+                for (int i = 0; i < parser->numAhead; i++) {
+                    tokens[i] = parser->ahead[i].token;
+                }
+                p = predictProductionTokens(compiled, d, tokens, parser->numAhead);
+            }
+        }
+        
+        int n = compiled->productionLength[p];
+        if (parser->top + n > MAX_PARSE_STACK) break;
+        const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+        
+        // A tail loop keeps its non-terminal in place under the rest of the production
+        if (n > 0 && rhs[n - 1] == symbol) {
+            parser->top++;
+            n--;
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            parser->stack[parser->top++] = rhs[i];
+        }
+    }
+    
+    parser->status = PUSH_REJECTED;
+    parser->errorOffset = offset;
+    return parser->status;
+}
+
+PushStatus pushParserToken(PushParser* parser, int token, int offset) {
+    if (parser->status != PUSH_NEED_INPUT) return parser->status;
+    parser->numTokens++;
+    if (parser->compiled->numDecisions == 0) return parsePushedToken(parser, token, offset);
+    
+    // Hold tokens back until the one to parse has its full lookahead, or the input has ended
+    parser->ahead[parser->numAhead++] = (Token){token, offset};
+    while (parser->status == PUSH_NEED_INPUT && parser->numAhead > 0 &&
+           (parser->numAhead == MAX_LOOKAHEAD || token == parser->compiled->endMarker)) {
+        parsePushedToken(parser, parser->ahead[0].token, parser->ahead[0].offset);
+        parser->numAhead--;
+        memmove(parser->ahead, parser->ahead + 1, parser->numAhead * sizeof(Token));
+    }
+    return parser->status;
+}
+
+PushStatus pushParserTokens(PushParser* parser, const Token* tokens, int count) {
+    if (parser->status != PUSH_NEED_INPUT) return parser->status;
+    const CompiledTable* compiled = parser->compiled;
+    if (compiled->numDecisions > 0) {
+        for (int k = 0; k < count; k++) {
+            pushParserToken(parser, tokens[k].token, tokens[k].offset);
+        }
+        return parser->status;
+    }
+    const int numTerminals = compiled->numTerminals;
+    int* stack = parser->stack;
+    int top = parser->top;
+    
+    for (int k = 0; k < count; k++) {
+        int token = tokens[k].token;
+        parser->numTokens++;
+        
+        while (true) {
+            if (top == 0) goto reject;
+            int symbol = stack[--top];
+            
+            if (symbol < numTerminals) {
+                if (symbol != token) goto reject;
+                if (token == compiled->endMarker) {
+                    parser->top = top;
+                    parser->status = PUSH_ACCEPTED;
+                    return parser->status;
+                }
+                break;
+            }
+            
+            if (token < 0) goto reject;
+            int p = tableCell(compiled, symbol - numTerminals, token);
+            if (p < 0) goto reject;
+            
+            int n = compiled->productionLength[p];
+            if (top + n > MAX_PARSE_STACK) goto reject;
+            const int* rhs = compiled->rhsSymbols + compiled->productionStart[p];
+            if (n > 0 && rhs[n - 1] == symbol) {
+                top++;
+                n--;
+            }
+            for (int i = n - 1; i >= 0; i--) {
+                stack[top++] = rhs[i];
+            }
+        }
+        continue;
+        
+    reject:
+        parser->top = top;
+        parser->status = PUSH_REJECTED;
+        parser->errorOffset = tokens[k].offset;
+        return parser->status;
+    }
+    
+    parser->top = top;
+    return parser->status;
+}
+
+// Push an identifier run starting at offset: one keyword token, or one token per byte
+void pushWordRun(PushParser* parser, const char* run, int length, int offset) {
+    const CompiledTable* compiled = parser->compiled;
+    int terminal = length < MAX_KEYWORD_RUN ? lookupPerfectHash(compiled->keywordHash, run, length) : -1;
+    if (terminal != -1) {
+        pushParserToken(parser, terminal, offset);
+        return;
+    }
+    for (int i = 0; i < length; i++) {
+        pushParserToken(parser, compiled->terminalOf[(unsigned char)run[i]], offset + i);
+    }
+}
+
+// Tokenize a chunk the way nextToken would tokenize the whole input. An identifier run that
+// reaches the end of the chunk is held back in run[] until it ends, since it might spell a
+// keyword; past MAX_KEYWORD_RUN bytes it cannot, and its bytes are pushed as they come
+PushStatus pushParserBytes(PushParser* parser, const char* chunk, int length) {
+    const CompiledTable* compiled = parser->compiled;
+    int pos = 0;
+    
+    while (pos < length && parser->status == PUSH_NEED_INPUT) {
+        if (parser->runLength != 0) {
+            int n = scanIdentifier(chunk + pos, length - pos);
+            if (parser->runLength > 0 && parser->runLength + n < MAX_KEYWORD_RUN) {
+                memcpy(parser->run + parser->runLength, chunk + pos, n);
+                parser->runLength += n;
+            } else {
+                // Too long for a keyword: flush what was held and go on byte by byte. The held
+                // bytes are only the start of the run, so they are not looked up as a keyword either
+                for (int i = 0; i < parser->runLength; i++) {
+                    pushParserToken(parser, compiled->terminalOf[(unsigned char)parser->run[i]], parser->runStart + i);
+                }
+                for (int i = 0; i < n; i++) {
+                    pushParserToken(parser, compiled->terminalOf[(unsigned char)chunk[pos + i]], parser->offset + pos + i);
+                }
+                parser->runLength = -1;
+            }
+            pos += n;
+            if (pos == length) break;
+            
+            if (parser->runLength > 0) {
+                pushWordRun(parser, parser->run, parser->runLength, parser->runStart);
+            }
+            parser->runLength = 0;
+            continue;
+        }
+        
+        pos += scanSpaces(chunk + pos, length - pos);
+        if (pos == length) break;
+        
+        int start = pos;
+        if (compiled->keywordHash != NULL && isWordByte(chunk[pos])) {
+            int n = scanIdentifier(chunk + pos, length - pos);
+            pos += n;
+            if (pos == length) {
+                parser->runLength = n < MAX_KEYWORD_RUN ? n : -1;
+                parser->runStart = parser->offset + start;
+                if (n < MAX_KEYWORD_RUN) {
+                    memcpy(parser->run, chunk + start, n);
+                } else {
+                    pushWordRun(parser, chunk + start, n, parser->offset + start);
+                }
+                break;
+            }
+            pushWordRun(parser, chunk + start, n, parser->offset + start);
+            continue;
+        }
+        pushParserToken(parser, compiled->terminalOf[(unsigned char)chunk[pos]], parser->offset + pos);
+        pos++;
+    }
+    
+    parser->offset += length;
+    return parser->status;
+}
+
+PushStatus finishPushParser(PushParser* parser) {
+    if (parser->runLength > 0 && parser->status == PUSH_NEED_INPUT) {
+        pushWordRun(parser, parser->run, parser->runLength, parser->runStart);
+    }
+    parser->runLength = 0;
+    pushParserToken(parser, parser->compiled->endMarker, parser->offset);
+    
+    // The input ended before the parse did
+    if (parser->status == PUSH_NEED_INPUT) {
+        parser->status = PUSH_REJECTED;
+        parser->errorOffset = parser->offset;
+    }
+    return parser->status;
+}
@@ -0,0 +1,287 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ll1.h"
+#include "phash.h"
+
+#define MAX_PARSE_STACK 4096 // Maximum depth of the predictive parser's stack
+#define MAX_PARSE_ERRORS 64  // Errors kept by error recovery; later ones are only counted
+#define MAX_KEYWORD_RUN 20   // Identifier runs this long or longer cannot be keywords
+#define MAX_LOOKAHEAD 8      // Tokens a decision between conflicting productions may look at
+#define DECISION_CACHE_STATES 4096 // Lookahead states cached per table for those decisions
+
+// A table cell that more than one production claimed (see constructLL1Table's conflicts). The
+// cell holds the production constructLL1Table kept, which is the first candidate
+typedef struct {
+    int nonTerminal;
+    int terminal;
+    int firstCandidate;          // Offset of the candidates in decisionCandidates
+    int numCandidates;
+} Decision;
+
+// The lookahead DFA of every decision of a table, built as inputs reach it (see predictProduction)
+typedef struct DecisionCache DecisionCache;
+
+// What a lazy table needs to build its rows: FIRST and FOLLOW sets solved so far (see compileLazyParseTable)
+typedef struct LazyRows LazyRows;
+
+// A parse table compiled to symbol numbers for the predictive parser.
+// Terminals are numbered 0..numTerminals-1 in table order, with $ last; non-terminal n is
+// stack symbol numTerminals + n. Productions are the grammar's alternatives in order
+typedef struct {
+    int numTerminals;
+    int numNonTerminals;
+    int startSymbol;             // Stack symbol of the start non-terminal
+    int numEntryPoints;
+    int* entryPoints;            // Stack symbols parses may start from: startSymbol, then the entry symbols
+    int endMarker;               // Terminal number of $
+    short terminalOf[256];       // Input byte -> terminal number, -1 if no terminal is spelled that way
+    PerfectHash* keywordHash;    // Terminal spellings (quotes stripped) -> terminal number; NULL without keywords
+    int numProductions;
+    int* productionLhs;          // Non-terminal number of each production
+    int* productionStart;        // Offset of each production's symbols in rhsSymbols
+    int* productionLength;       // 0 for ε
+    int* rhsSymbols;
+    short* cells;                // [non-terminal * numTerminals + terminal] -> production, -1 if empty,
+                                 // as is every cell of a row a lazy table has not built
+    // Row-displacement encoding, used instead of cells once compressCompiledTable has run:
+    // the cell (n, t) is comb[rowBase[n] + t] if check[rowBase[n] + t] == n, otherwise empty
+    int* rowBase;
+    short* comb;
+    short* check;
+    int combSize;
+    int* productionAction;       // Action number of each production, -1 if untagged
+    int numActions;
+    char (*actionNames)[20];     // Action tags in order of first use
+    // Error recovery: per non-terminal, a bitset over terminals of where skipping stops
+    int syncWords;               // 64-bit words per non-terminal
+    uint64_t* syncSets;
+    // Operator-precedence loops for binary-operator levels (see compileOperatorLoops). Loop i is
+    // stack symbol numTerminals + numNonTerminals + i
+    int numOperatorLoops;
+    int* expressionLoop;         // Loop that parses each non-terminal, -1 if the table does
+    int* loopOperand;            // Stack symbol of the operand at the bottom of each loop's levels
+    short* operatorLoops;        // [loop * numTerminals + terminal] -> loop for the right operand of
+                                 // an operator, numOperatorLoops if it needs none, -1 if no operator
+    // Cells with conflicting productions, decided with up to MAX_LOOKAHEAD tokens. Every other
+    // cell is a plain lookup; contested[p] only marks the productions kept in such a cell
+    int numDecisions;
+    Decision* decisions;
+    int* decisionCandidates;     // Production numbers
+    bool* contested;
+    DecisionCache* decisionCache;
+    LazyRows* lazyRows;          // NULL if the table was built whole
+    char (*terminalNames)[20];
+    char (*nonTerminalNames)[20];
+} CompiledTable;
+
+typedef struct {
+    bool accepted;
+    int errorOffset;             // Byte offset of the token that could not be parsed, -1 if accepted
+    int numTokens;               // Tokens consumed, including $
+} ParseResult;
+
+typedef struct {
+    int offset;                  // Byte offset of the offending token
+    int expected;                // Stack symbol on top when it was found (-1 for a completion marker)
+    int found;                   // Its terminal number, -1 for a byte no terminal is spelled with
+} ParseError;
+
+typedef struct {
+    ParseError errors[MAX_PARSE_ERRORS];
+    int numErrors;               // Every error found, including those past MAX_PARSE_ERRORS
+} ParseErrors;
+
+// Usage counts gathered by parseInputProfile, numbered like the table they were gathered with.
+// A profile is written to by one parse at a time; see profile.h for reports and profile files
+typedef struct {
+    int numTerminals;
+    int numNonTerminals;
+    int numProductions;
+    unsigned long long* cellCounts;        // [non-terminal * numTerminals + terminal] -> expansions
+    unsigned long long* productionCounts;  // Expansions of each production
+    int* maxDepth;               // Deepest stack position each non-terminal was expanded at, 0 if never
+    int maxStackDepth;
+    unsigned long long numParses;
+    unsigned long long numAccepted;
+    unsigned long long numTokens;
+} ParseProfile;
+
+// Called when a tagged production is expanded (offset of the lookahead) or completed
+// (offset just past its last token)
+typedef void (*ActionCallback)(void* context, int production, int offset);
+
+// Callbacks indexed by action number; either array, and any entry, may be NULL
+typedef struct {
+    const ActionCallback* expand;
+    const ActionCallback* complete;
+    void* context;
+} ParseActions;
+
+// A concrete syntax tree node. Nodes link by index into the tree's node array, so the array
+// can grow without fixing up links
+typedef struct {
+    int symbol;                  // Stack symbol: a terminal, or numTerminals + non-terminal
+    int production;              // Production a non-terminal was expanded by, -1 for a token
+    int firstChild;              // -1 for a token or an ε expansion
+    int nextSibling;             // -1 for the last child
+    int start;                   // Source offset of the token, or of the lookahead when expanded
+    int length;                  // Token length in bytes, 0 for a non-terminal
+} TreeNode;
+
+// Nodes are bump-allocated from one array that is reused from tree to tree. The root is node 0
+typedef struct {
+    TreeNode* nodes;
+    int numNodes;
+    int capacity;
+} ParseTree;
+
+// Compile the table of an analyzed grammar (the grammar the table and the FOLLOW sets were built
+// from). followSets may be NULL, leaving only the table rows and $ to recover on. NULL on failure
+CompiledTable* compileParseTable(const Grammar* grammar, const ParseTable* table, const Set* followSets);
+void freeCompiledTable(CompiledTable* compiled);
+
+// Compile a transformed grammar (see transformGrammar) without its FIRST/FOLLOW sets or table.
+// Only the start symbol's row is built here; parseInputLazy builds any other row, with the FIRST
+// and FOLLOW sets it reads, when a parse first misses in it. Rows keep the first production
+// claiming a cell, as constructLL1Table does, but conflicts are not decided and there are no
+// operator loops. The other engines read unbuilt rows as empty, so they need every row built
+// first (buildLazyRow, or compressCompiledTable, which builds them). NULL on failure
+CompiledTable* compileLazyParseTable(const Grammar* grammar);
+
+// Build a lazy table's row for a non-terminal. False if it was built already or the table is not lazy
+bool buildLazyRow(CompiledTable* compiled, int nonTerminal);
+
+// Rows built so far; every row of a table that was not compiled lazily
+int builtTableRows(const CompiledTable* compiled);
+
+// Replace the dense cells with the row-displacement encoding. A 3571 x 401 table packs from 2.8 MB
+// into 0.8 MB in 0.1 s, and parses at the dense table's speed. Tables with more than SHRT_MAX rows
+// stay dense
+void compressCompiledTable(CompiledTable* compiled);
+size_t denseTableBytes(const CompiledTable* compiled);
+size_t compressedTableBytes(const CompiledTable* compiled);
+
+// Production in the cell for a non-terminal and a terminal, -1 if empty
+static inline int tableCell(const CompiledTable* compiled, int nonTerminal, int terminal) {
+    if (compiled->comb != NULL) {
+        int i = compiled->rowBase[nonTerminal] + terminal;
+        return compiled->check[i] == nonTerminal ? compiled->comb[i] : -1;
+    }
+    return compiled->cells[nonTerminal * compiled->numTerminals + terminal];
+}
+
+// Next token of the input from *pos: its terminal number, endMarker at the end, -1 if unknown.
+// Whitespace is skipped, *start is set to the token's offset and *pos is left after it.
+// A whole identifier run that spells a keyword is one token; anything else is one byte per token
+int nextToken(const CompiledTable* compiled, const char* input, int length, int* pos, int* start);
+
+// Decision for the cell of a non-terminal and a terminal, -1 if the cell is not contested
+int findDecision(const CompiledTable* compiled, int nonTerminal, int terminal);
+
+// Choose between the candidates of a decision, given the lookahead token and the input position
+// after it. Each candidate is expanded, by the table and by nested decisions, against the tokens
+// that follow until only one candidate still matches them. What follows the non-terminal is not
+// looked at, so a candidate whose expansion ends first stays in the running; when MAX_LOOKAHEAD
+// tokens or the end do not settle it, the earliest remaining candidate wins. Outcomes are cached
+// per decision by the tokens they looked at, so a table can be shared by threads
+int predictProduction(const CompiledTable* compiled, int decision, const char* input, int length, int pos, int token);
+
+// predictProduction over tokens already lexed: tokens[0] is the lookahead, and the input is taken
+// to end after the last one, so they should run to MAX_LOOKAHEAD tokens or to the end marker
+int predictProductionTokens(const CompiledTable* compiled, int decision, const int* tokens, int numTokens);
+
+// Run the predictive parser over input. Contested cells are decided by predictProduction here, in
+// the variants below, in the push parser and in documents
+ParseResult parseInput(const CompiledTable* compiled, const char* input, int length);
+
+// Run the parser and build the tree of the input into tree, replacing what it held.
+// On a parse error the tree holds the part built so far
+ParseResult parseInputTree(const CompiledTable* compiled, const char* input, int length, ParseTree* tree);
+
+// Run the parser, dispatching the actions of tagged productions instead of building anything.
+// Memory use is the parser stack alone
+ParseResult parseInputActions(const CompiledTable* compiled, const char* input, int length, const ParseActions* actions);
+
+// Run the parser to the end of the input whatever errors it meets, listing them in errors.
+// Accepted only if there were none; errorOffset is the first error's offset
+ParseResult parseInputRecover(const CompiledTable* compiled, const char* input, int length, ParseErrors* errors);
+
+// Parse a fragment from one of the table's entry points (see Grammar's entrySymbols) instead of
+// the start symbol: input has to be a complete derivation of that non-terminal. Entry point 0 is
+// the start symbol
+ParseResult parseInputFrom(const CompiledTable* compiled, int entryPoint, const char* input, int length);
+ParseResult parseInputRecoverFrom(const CompiledTable* compiled, int entryPoint, const char* input, int length, ParseErrors* errors);
+
+// parseInputFrom for a lazy table, building the rows the input reaches. Building writes to the
+// table, so threads must not share a lazy table while they parse with it
+ParseResult parseInputLazy(CompiledTable* compiled, int entryPoint, const char* input, int length);
+
+// Entry point of a non-terminal, or -1 if it is not one
+int findEntryPoint(const CompiledTable* compiled, const char* name);
+
+// An empty profile for a table's symbols and productions. NULL if out of memory
+ParseProfile* createParseProfile(const CompiledTable* compiled);
+void freeParseProfile(ParseProfile* profile);
+
+// Run the parser, adding the cells and productions it expands and the stack depths it reaches to
+// profile. It expands by the table throughout, bypassing the operator loops, so every step counts
+ParseResult parseInputProfile(const CompiledTable* compiled, const char* input, int length, ParseProfile* profile);
+
+// Action number of a tag, or -1
+int findAction(const CompiledTable* compiled, const char* name);
+
+void initParseTree(ParseTree* tree);
+void resetParseTree(ParseTree* tree);   // Drop every node, keeping the memory for the next tree
+void freeParseTree(ParseTree* tree);
+
+// A token from a lexer: its terminal number (-1 if unknown) and source offset
+typedef struct {
+    int token;
+    int offset;
+} Token;
+
+typedef enum {
+    PUSH_NEED_INPUT,
+    PUSH_ACCEPTED,
+    PUSH_REJECTED
+} PushStatus;
+
+// A resumable parser fed the input piece by piece. Between calls its state is the parse stack,
+// plus the bytes of an identifier run cut off at the end of the last chunk. A table with decisions
+// parses each token once MAX_LOOKAHEAD - 1 more have been fed (or the input ended), as a contested
+// cell may look that far ahead
+typedef struct {
+    const CompiledTable* compiled;
+    int stack[MAX_PARSE_STACK];
+    int top;
+    int offset;                  // Input bytes fed so far
+    char run[MAX_KEYWORD_RUN];   // Held-back identifier run; runLength -1 past MAX_KEYWORD_RUN
+    int runLength;
+    int runStart;
+    PushStatus status;
+    int errorOffset;             // Offset of the rejected token, -1 otherwise
+    int numTokens;
+    Token ahead[MAX_LOOKAHEAD];  // With decisions, tokens fed but not parsed yet, as the lookahead of ahead[0]
+    int numAhead;
+} PushParser;
+
+void initPushParser(PushParser* parser, const CompiledTable* compiled);
+
+// Feed the next chunk of input bytes; chunks may split tokens anywhere. PUSH_NEED_INPUT until
+// the parse is decided, which for an accepted input is only at finishPushParser
+PushStatus pushParserBytes(PushParser* parser, const char* chunk, int length);
+
+// Feed one token from a lexer of the caller's own, with its offset
+PushStatus pushParserToken(PushParser* parser, int token, int offset);
+
+// Feed a batch of tokens; same as feeding them one at a time, without the per-token call
+PushStatus pushParserTokens(PushParser* parser, const Token* tokens, int count);
+
+// Signal the end of the input: PUSH_ACCEPTED or PUSH_REJECTED
+PushStatus finishPushParser(PushParser* parser);
+
+#endif
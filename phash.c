@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+#include "phash.h"
+
+#define PHASH_MAX_DISPLACEMENT (1 << 20) // Give up on a bucket after this many tries
+
+// FNV-1a
+uint64_t hashName(const char* key, int length) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < length; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// SplitMix64 finalizer. FNV-1a leaves names that differ in their last bytes close together in the
+// high bits, so every use of a hash goes through this first
+static inline uint64_t mixHash(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Slot of a hash under a displacement
+static inline int displacedSlot(uint64_t h, int displacement, int numKeys) {
+    return (int)(mixHash(h + (uint64_t)displacement * 0x9e3779b97f4a7c15ULL) % (uint64_t)numKeys);
+}
+
+static inline int bucketOf(uint64_t h, int numBuckets) {
+    return (int)((mixHash(h ^ 0x5851f42d4c957f2dULL) >> 32) % (uint64_t)numBuckets);
+}
+
+PerfectHash* buildPerfectHash(const char* const* names, int numKeys) {
+    PerfectHash* hash = (PerfectHash*)calloc(1, sizeof(PerfectHash));
+    hash->numKeys = numKeys;
+    hash->numBuckets = numKeys / 2 + 1;
+    hash->displacement = calloc(hash->numBuckets, sizeof(int));
+    hash->slotKey = malloc((numKeys > 0 ? numKeys : 1) * sizeof(int));
+    hash->keys = malloc((numKeys > 0 ? numKeys : 1) * sizeof(char*));
+    
+    uint64_t* hashes = malloc((numKeys > 0 ? numKeys : 1) * sizeof(uint64_t));
+    int* bucketSize = calloc(hash->numBuckets, sizeof(int));
+    int* bucketStart = calloc(hash->numBuckets + 1, sizeof(int));
+    int* members = malloc((numKeys > 0 ? numKeys : 1) * sizeof(int));
+    int* order = malloc(hash->numBuckets * sizeof(int));
+    bool ok = true;
+    
+    for (int i = 0; i < numKeys; i++) {
+        hash->keys[i] = strdup(names[i]);
+        hashes[i] = hashName(names[i], strlen(names[i]));
+        bucketSize[bucketOf(hashes[i], hash->numBuckets)]++;
+        hash->slotKey[i] = -1;
+    }
+    
+    // Group the keys by bucket
+    for (int b = 0; b < hash->numBuckets; b++) {
+        bucketStart[b + 1] = bucketStart[b] + bucketSize[b];
+        bucketSize[b] = 0;
+    }
+    for (int i = 0; i < numKeys; i++) {
+        int b = bucketOf(hashes[i], hash->numBuckets);
+        members[bucketStart[b] + bucketSize[b]++] = i;
+    }
+    
+    // Place the largest buckets first, while most slots are still free. A counting sort by size,
+    // largest first and in bucket order within a size, so rebuilding for many keys stays linear
+    int* sizeStart = calloc(numKeys + 2, sizeof(int));
+    ok = sizeStart != NULL;
+    for (int b = 0; b < hash->numBuckets && ok; b++) {
+        sizeStart[numKeys - bucketSize[b] + 1]++;
+    }
+    for (int s = 0; s <= numKeys && ok; s++) {
+        sizeStart[s + 1] += sizeStart[s];
+    }
+    for (int b = 0; b < hash->numBuckets && ok; b++) {
+        order[sizeStart[numKeys - bucketSize[b]]++] = b;
+    }
+    free(sizeStart);
+    
+    for (int i = 0; i < hash->numBuckets && ok; i++) {
+        int b = order[i];
+        if (bucketSize[b] == 0) break;
+        const int* keys = members + bucketStart[b];
+        
+        // Keys with the same hash share a slot under every displacement
+        for (int k = 1; k < bucketSize[b] && ok; k++) {
+            for (int m = 0; m < k && ok; m++) {
+                if (hashes[keys[m]] == hashes[keys[k]]) ok = false;
+            }
+        }
+        if (!ok) break;
+        
+        int d = 0;
+        for (; d < PHASH_MAX_DISPLACEMENT; d++) {
+            bool fits = true;
+            for (int k = 0; k < bucketSize[b] && fits; k++) {
+                int slot = displacedSlot(hashes[keys[k]], d, numKeys);
+                if (hash->slotKey[slot] != -1) fits = false;
+                // Two keys of the bucket may not share a slot either
+                for (int m = 0; m < k && fits; m++) {
+                    if (displacedSlot(hashes[keys[m]], d, numKeys) == slot) fits = false;
+                }
+            }
+            if (fits) break;
+        }
+        if (d == PHASH_MAX_DISPLACEMENT) {
+            ok = false;
+            break;
+        }
+        
+        hash->displacement[b] = d;
+        for (int k = 0; k < bucketSize[b]; k++) {
+            hash->slotKey[displacedSlot(hashes[keys[k]], d, numKeys)] = keys[k];
+        }
+    }
+    
+    free(hashes);
+    free(bucketSize);
+    free(bucketStart);
+    free(members);
+    free(order);
+    if (!ok) {
+        freePerfectHash(hash);
+        return NULL;
+    }
+    return hash;
+}
+
+void freePerfectHash(PerfectHash* hash) {
+    if (hash == NULL) return;
+    for (int i = 0; i < hash->numKeys; i++) {
+        free(hash->keys[i]);
+    }
+    free(hash->keys);
+    free(hash->displacement);
+    free(hash->slotKey);
+    free(hash);
+}
+
+int lookupPerfectHash(const PerfectHash* hash, const char* key, int length) {
+    if (hash == NULL || hash->numKeys == 0) return -1;
+    uint64_t h = hashName(key, length);
+    int index = hash->slotKey[displacedSlot(h, hash->displacement[bucketOf(h, hash->numBuckets)], hash->numKeys)];
+    const char* candidate = hash->keys[index];
+    return strncmp(candidate, key, length) == 0 && candidate[length] == '\0' ? index : -1;
+}
@@ -0,0 +1,27 @@
+#ifndef PHASH_H
+#define PHASH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Minimal perfect hash over a fixed set of names (hash and displace).
+// A key's 64-bit hash picks a bucket, and the bucket's displacement moves it to its own slot,
+// so a lookup is one hash, one mix and one compare against the name stored in that slot
+typedef struct {
+    int numKeys;
+    int numBuckets;
+    int* displacement;       // Per bucket
+    int* slotKey;            // Slot -> index of the key in the original list
+    char** keys;             // Copies of the names, by original index
+} PerfectHash;
+
+// Build over numKeys distinct names. NULL if the names are not distinct
+PerfectHash* buildPerfectHash(const char* const* names, int numKeys);
+void freePerfectHash(PerfectHash* hash);
+
+// Index of the key in the list the hash was built from, or -1
+int lookupPerfectHash(const PerfectHash* hash, const char* key, int length);
+
+uint64_t hashName(const char* key, int length);
+
+#endif
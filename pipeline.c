@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <pthread.h>
+#include "pipeline.h"
+
+#define SPINS_BEFORE_YIELD 256
+
+// The producer owns tail and the consumer owns head; each only reads the other's.
+// They sit on separate cache lines so publishing one does not invalidate the other
+typedef struct {
+    Token slots[TOKEN_RING_SIZE];
+    _Alignas(64) atomic_uint head;   // Next slot the parser reads
+    _Alignas(64) atomic_uint tail;   // Next slot the lexer writes
+    _Alignas(64) atomic_bool stop;   // The parser is done; the lexer can quit early
+    const CompiledTable* compiled;
+    const char* input;
+    int length;
+} TokenRing;
+
+// Function prototypes
+void waitBriefly(int* spins);
+void* lexerThread(void* arg);
+
+void waitBriefly(int* spins) {
+    if (++*spins >= SPINS_BEFORE_YIELD) {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+// Lex the whole input into the ring, a batch at a time, ending with $
+void* lexerThread(void* arg) {
+    TokenRing* ring = (TokenRing*)arg;
+    unsigned int tail = 0;
+    unsigned int head = 0;
+    int pos = 0;
+    bool done = false;
+    
+    while (!done) {
+        // Wait for room for a whole batch
+        int spins = 0;
+        while (tail - head > TOKEN_RING_SIZE - TOKEN_RING_BATCH) {
+            if (atomic_load_explicit(&ring->stop, memory_order_relaxed)) return NULL;
+            head = atomic_load_explicit(&ring->head, memory_order_acquire);
+            if (tail - head > TOKEN_RING_SIZE - TOKEN_RING_BATCH) waitBriefly(&spins);
+        }
+        
+        for (int i = 0; i < TOKEN_RING_BATCH && !done; i++) {
+            Token* slot = &ring->slots[tail & (TOKEN_RING_SIZE - 1)];
+            slot->token = nextToken(ring->compiled, ring->input, ring->length, &pos, &slot->offset);
+            done = slot->token == ring->compiled->endMarker;
+            tail++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    return NULL;
+}
+
+ParseResult parseInputPipelined(const CompiledTable* compiled, const char* input, int length) {
+    ParseResult result = {false, -1, 0};
+    
+    // Contested cells look ahead of the push parser's tokens, so those tables parse in one piece
+    if (compiled->numDecisions > 0) {
+        return parseInput(compiled, input, length);
+    }
+    TokenRing* ring = (TokenRing*)aligned_alloc(64, sizeof(TokenRing));
+    PushParser* parser = (PushParser*)malloc(sizeof(PushParser));
+    if (ring == NULL || parser == NULL) {
+        free(ring);
+        free(parser);
+        return parseInput(compiled, input, length);
+    }
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->stop, false);
+    ring->compiled = compiled;
+    ring->input = input;
+    ring->length = length;
+    
+    pthread_t lexer;
+    if (pthread_create(&lexer, NULL, lexerThread, ring) != 0) {
+        free(ring);
+        free(parser);
+        return parseInput(compiled, input, length);
+    }
+    
+    // Parse on this thread; the lexer always ends with $, which decides the parse
+    initPushParser(parser, compiled);
+    unsigned int head = 0;
+    while (parser->status == PUSH_NEED_INPUT) {
+        int spins = 0;
+        unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        while (tail == head) {
+            waitBriefly(&spins);
+            tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        }
+        
+        // The published tokens, in at most two runs around the end of the ring
+        while (head != tail && parser->status == PUSH_NEED_INPUT) {
+            unsigned int first = head & (TOKEN_RING_SIZE - 1);
+            unsigned int count = tail - head;
+            if (count > TOKEN_RING_SIZE - first) count = TOKEN_RING_SIZE - first;
+            pushParserTokens(parser, ring->slots + first, count);
+            head += count;
+        }
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+    }
+    
+    atomic_store_explicit(&ring->stop, true, memory_order_relaxed);
+    pthread_join(lexer, NULL);
+    
+    result.accepted = parser->status == PUSH_ACCEPTED;
+    result.errorOffset = parser->errorOffset;
+    result.numTokens = parser->numTokens;
+    free(ring);
+    free(parser);
+    return result;
+}
@@ -0,0 +1,13 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "parser.h"
+
+#define TOKEN_RING_SIZE 8192 // Tokens in flight between the lexer and the parser, a power of two
+#define TOKEN_RING_BATCH 512 // Tokens the lexer publishes at a time
+
+// Parse input with the lexer on a second thread, handing tokens to the parser through a
+// lock-free single-producer/single-consumer ring. Same result as parseInput
+ParseResult parseInputPipelined(const CompiledTable* compiled, const char* input, int length);
+
+#endif
@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+
+// Function prototypes
+void printProduction(FILE* out, const CompiledTable* compiled, int production);
+int findProfileSymbol(const CompiledTable* compiled, const char* name);
+int findProfileProduction(const CompiledTable* compiled, const char* text);
+bool sameProfileSymbols(const char* rhs, const char* text);
+int compareHeat(const void* a, const void* b);
+void sortByHeat(const unsigned long long* heat, int count, int* order);
+
+// "lhs -> symbols", the symbols separated by spaces
+void printProduction(FILE* out, const CompiledTable* compiled, int production) {
+    fprintf(out, "%s ->", compiled->nonTerminalNames[compiled->productionLhs[production]]);
+    const int* rhs = compiled->rhsSymbols + compiled->productionStart[production];
+    for (int i = 0; i < compiled->productionLength[production]; i++) {
+        int symbol = rhs[i];
+        fprintf(out, " %s", symbol < compiled->numTerminals ? compiled->terminalNames[symbol]
+                                                            : compiled->nonTerminalNames[symbol - compiled->numTerminals]);
+    }
+    if (compiled->productionLength[production] == 0) fprintf(out, " %s", EPSILON);
+}
+
+// Stack symbol of a name, non-terminals first, or -1
+int findProfileSymbol(const CompiledTable* compiled, const char* name) {
+    for (int n = 0; n < compiled->numNonTerminals; n++) {
+        if (strcmp(compiled->nonTerminalNames[n], name) == 0) return compiled->numTerminals + n;
+    }
+    for (int t = 0; t < compiled->numTerminals; t++) {
+        if (strcmp(compiled->terminalNames[t], name) == 0) return t;
+    }
+    return -1;
+}
+
+// Production written as "lhs -> symbols" by printProduction, or -1
+int findProfileProduction(const CompiledTable* compiled, const char* text) {
+    char name[20];
+    int used;
+    int symbols[MAX_PROD_LEN];
+    int length = 0;
+    if (sscanf(text, "%19s%n", name, &used) != 1) return -1;
+    int lhs = findProfileSymbol(compiled, name) - compiled->numTerminals;
+    if (lhs < 0) return -1;
+    text += used;
+    if (sscanf(text, "%19s%n", name, &used) != 1 || strcmp(name, "->") != 0) return -1;
+    text += used;
+    while (sscanf(text, "%19s%n", name, &used) == 1) {
+        text += used;
+        if (strcmp(name, EPSILON) == 0) continue;
+        int symbol = findProfileSymbol(compiled, name);
+        if (symbol == -1 || length == MAX_PROD_LEN) return -1;
+        symbols[length++] = symbol;
+    }
+    
+    for (int p = 0; p < compiled->numProductions; p++) {
+        if (compiled->productionLhs[p] != lhs || compiled->productionLength[p] != length) continue;
+        if (memcmp(compiled->rhsSymbols + compiled->productionStart[p], symbols, length * sizeof(int)) == 0) return p;
+    }
+    return -1;
+}
+
+void writeProfileReport(FILE* out, const CompiledTable* compiled, const ParseProfile* profile) {
+    const int numTerminals = compiled->numTerminals;
+    unsigned long long expansions = 0;
+    int used = 0;
+    for (int p = 0; p < compiled->numProductions; p++) {
+        expansions += profile->productionCounts[p];
+        if (profile->productionCounts[p] > 0) used++;
+    }
+    fprintf(out, "Profile: %llu parses (%llu accepted), %llu tokens, %llu expansions, stack up to %d deep\n",
+            profile->numParses, profile->numAccepted, profile->numTokens, expansions, profile->maxStackDepth);
+    
+    // Productions by use, most used first; equal counts keep grammar order
+    int* order = malloc((compiled->numProductions + 1) * sizeof(int));
+    if (order == NULL) return;
+    sortByHeat(profile->productionCounts, compiled->numProductions, order);
+    fprintf(out, "\nProductions used: %d of %d\n", used, compiled->numProductions);
+    for (int i = 0; i < used; i++) {
+        int p = order[i];
+        fprintf(out, "%12llu %6.2f%%  ", profile->productionCounts[p],
+                expansions > 0 ? 100.0 * profile->productionCounts[p] / expansions : 0.0);
+        printProduction(out, compiled, p);
+        fprintf(out, "\n");
+    }
+    if (used < compiled->numProductions) {
+        fprintf(out, "\nNever used:\n");
+        for (int p = 0; p < compiled->numProductions; p++) {
+            if (profile->productionCounts[p] > 0) continue;
+            fprintf(out, "    ");
+            printProduction(out, compiled, p);
+            fprintf(out, "\n");
+        }
+    }
+    free(order);
+    
+    // The hottest cells, kept sorted as they are found
+    int hot[PROFILE_HOT_CELLS];
+    int numHot = 0;
+    for (int cell = 0; cell < compiled->numNonTerminals * numTerminals; cell++) {
+        unsigned long long count = profile->cellCounts[cell];
+        if (count == 0 || (numHot == PROFILE_HOT_CELLS && count <= profile->cellCounts[hot[numHot - 1]])) continue;
+        int j = numHot < PROFILE_HOT_CELLS ? numHot++ : numHot - 1;
+        while (j > 0 && profile->cellCounts[hot[j - 1]] < count) {
+            hot[j] = hot[j - 1];
+            j--;
+        }
+        hot[j] = cell;
+    }
+    if (numHot > 0) {
+        fprintf(out, "\nHottest cells:\n");
+    }
+    for (int i = 0; i < numHot; i++) {
+        fprintf(out, "%12llu  [%s, %s]\n", profile->cellCounts[hot[i]],
+                compiled->nonTerminalNames[hot[i] / numTerminals], compiled->terminalNames[hot[i] % numTerminals]);
+    }
+    
+    fprintf(out, "\nDeepest expansion by non-terminal:\n");
+    for (int n = 0; n < compiled->numNonTerminals; n++) {
+        if (profile->maxDepth[n] > 0) {
+            fprintf(out, "%12d  %s\n", profile->maxDepth[n], compiled->nonTerminalNames[n]);
+        } else {
+            fprintf(out, "%12s  %s\n", "-", compiled->nonTerminalNames[n]);
+        }
+    }
+}
+
+bool writeParseProfile(const char* filename, const CompiledTable* compiled, const ParseProfile* profile) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        printf("Error opening file: %s\n", filename);
+        return false;
+    }
+    
+    fprintf(file, "parses %llu %llu %llu\n", profile->numParses, profile->numAccepted, profile->numTokens);
+    fprintf(file, "stack %d\n", profile->maxStackDepth);
+    for (int p = 0; p < compiled->numProductions; p++) {
+        if (profile->productionCounts[p] == 0) continue;
+        fprintf(file, "production %llu ", profile->productionCounts[p]);
+        printProduction(file, compiled, p);
+        fprintf(file, "\n");
+    }
+    for (int n = 0; n < compiled->numNonTerminals; n++) {
+        for (int t = 0; t < compiled->numTerminals; t++) {
+            unsigned long long count = profile->cellCounts[n * compiled->numTerminals + t];
+            if (count > 0) {
+                fprintf(file, "cell %llu %s %s\n", count, compiled->nonTerminalNames[n], compiled->terminalNames[t]);
+            }
+        }
+    }
+    for (int n = 0; n < compiled->numNonTerminals; n++) {
+        if (profile->maxDepth[n] > 0) {
+            fprintf(file, "depth %d %s\n", profile->maxDepth[n], compiled->nonTerminalNames[n]);
+        }
+    }
+    
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+bool readParseProfile(const char* filename, const CompiledTable* compiled, ParseProfile* profile) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) return false;
+    
+    char line[PROFILE_LINE_LEN];
+    while (fgets(line, PROFILE_LINE_LEN, file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char kind[20], first[20], second[20];
+        unsigned long long count, accepted, tokens;
+        int used;
+        if (sscanf(line, "%19s%n", kind, &used) != 1) continue;
+        const char* rest = line + used;
+        
+        if (strcmp(kind, "parses") == 0 && sscanf(rest, "%llu %llu %llu", &count, &accepted, &tokens) == 3) {
+            profile->numParses += count;
+            profile->numAccepted += accepted;
+            profile->numTokens += tokens;
+        } else if (strcmp(kind, "stack") == 0 && sscanf(rest, "%llu", &count) == 1) {
+            if ((int)count > profile->maxStackDepth) profile->maxStackDepth = (int)count;
+        } else if (strcmp(kind, "production") == 0 && sscanf(rest, "%llu%n", &count, &used) == 1) {
+            int p = findProfileProduction(compiled, rest + used);
+            if (p != -1) profile->productionCounts[p] += count;
+        } else if (strcmp(kind, "cell") == 0 && sscanf(rest, "%llu %19s %19s", &count, first, second) == 3) {
+            int n = findProfileSymbol(compiled, first) - compiled->numTerminals;
+            int t = findProfileSymbol(compiled, second);
+            if (n >= 0 && t >= 0 && t < compiled->numTerminals) {
+                profile->cellCounts[n * compiled->numTerminals + t] += count;
+            }
+        } else if (strcmp(kind, "depth") == 0 && sscanf(rest, "%llu %19s", &count, first) == 2) {
+            int n = findProfileSymbol(compiled, first) - compiled->numTerminals;
+            if (n >= 0 && (int)count > profile->maxDepth[n]) profile->maxDepth[n] = (int)count;
+        }
+    }
+    
+    fclose(file);
+    return true;
+}
+
+// Whether an alternative has the symbols a profile line lists after "->" (ε for none)
+bool sameProfileSymbols(const char* rhs, const char* text) {
+    int pos = 0;
+    char name[20];
+    int used;
+    while (true) {
+        char* symbol = getSymbol(rhs, &pos);
+        while (symbol != NULL && strcmp(symbol, EPSILON) == 0) {
+            free(symbol);
+            symbol = getSymbol(rhs, &pos);
+        }
+        bool more = sscanf(text, "%19s%n", name, &used) == 1;
+        while (more && strcmp(name, EPSILON) == 0) {
+            text += used;
+            more = sscanf(text, "%19s%n", name, &used) == 1;
+        }
+        if (symbol == NULL || !more) {
+            bool same = symbol == NULL && !more;
+            free(symbol);
+            return same;
+        }
+        bool same = strcmp(symbol, name) == 0;
+        free(symbol);
+        if (!same) return false;
+        text += used;
+    }
+}
+
+typedef struct {
+    unsigned long long heat;
+    int index;
+} HeatEntry;
+
+int compareHeat(const void* a, const void* b) {
+    const HeatEntry* x = (const HeatEntry*)a;
+    const HeatEntry* y = (const HeatEntry*)b;
+    if (x->heat != y->heat) return x->heat > y->heat ? -1 : 1;
+    return x->index - y->index;
+}
+
+// Indices 0..count-1, hottest first; equal heat keeps index order. Without memory for the sort
+// the indices stay in order
+void sortByHeat(const unsigned long long* heat, int count, int* order) {
+    HeatEntry* entries = malloc((count + 1) * sizeof(HeatEntry));
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+        if (entries != NULL) entries[i] = (HeatEntry){heat[i], i};
+    }
+    if (entries == NULL) return;
+    qsort(entries, count, sizeof(HeatEntry), compareHeat);
+    for (int i = 0; i < count; i++) {
+        order[i] = entries[i].index;
+    }
+    free(entries);
+}
+
+bool orderGrammarByProfile(Grammar* grammar, const ParseTable* table, const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) return false;
+    
+    // Heat of each row, column and alternative; production i's alternatives start at alternativeStart[i]
+    int numProductions = grammar->numProductions;
+    int largest = numProductions;
+    if (grammar->numNonTerminals > largest) largest = grammar->numNonTerminals;
+    if (grammar->numTerminals > largest) largest = grammar->numTerminals;
+    unsigned long long* rowHeat = calloc(grammar->numNonTerminals + 1, sizeof(unsigned long long));
+    unsigned long long* columnHeat = calloc(grammar->numTerminals + 1, sizeof(unsigned long long));
+    unsigned long long* groupHeat = calloc(numProductions + 1, sizeof(unsigned long long));
+    int* alternativeStart = malloc((numProductions + 1) * sizeof(int));
+    int* order = malloc((largest + 1) * sizeof(int));
+    char (*names)[20] = malloc((largest + 1) * sizeof(*names));
+    Production* productions = malloc((numProductions + 1) * sizeof(Production));
+    // Productions of non-terminal n: byLhs[lhsStart[n]] .. byLhs[lhsStart[n + 1] - 1]
+    int* lhsOf = malloc((numProductions + 1) * sizeof(int));
+    int* lhsStart = calloc(grammar->numNonTerminals + 2, sizeof(int));
+    int* byLhs = malloc((numProductions + 1) * sizeof(int));
+    bool* conflicted = calloc(grammar->numNonTerminals + 1, sizeof(bool));
+    unsigned long long* alternativeHeat = NULL;
+    if (alternativeStart != NULL) {
+        int numAlternatives = 0;
+        for (int i = 0; i < numProductions; i++) {
+            alternativeStart[i] = numAlternatives;
+            numAlternatives += grammar->productions[i].numRHS;
+        }
+        alternativeHeat = calloc(numAlternatives + 1, sizeof(unsigned long long));
+    }
+    bool ok = rowHeat != NULL && columnHeat != NULL && groupHeat != NULL && alternativeStart != NULL &&
+              order != NULL && names != NULL && productions != NULL && alternativeHeat != NULL &&
+              lhsOf != NULL && lhsStart != NULL && byLhs != NULL && conflicted != NULL;
+    for (int i = 0; ok && i < numProductions; i++) {
+        lhsOf[i] = findNonTerminalIndex(grammar, grammar->productions[i].lhs);
+        if (lhsOf[i] != -1) lhsStart[lhsOf[i] + 2]++;
+    }
+    for (int n = 0; ok && n < grammar->numNonTerminals; n++) {
+        lhsStart[n + 2] += lhsStart[n + 1];
+    }
+    for (int i = 0; ok && i < numProductions; i++) {
+        if (lhsOf[i] != -1) byLhs[lhsStart[lhsOf[i] + 1]++] = i;
+    }
+    
+    char line[PROFILE_LINE_LEN];
+    while (ok && fgets(line, PROFILE_LINE_LEN, file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char kind[20], first[20], second[20];
+        unsigned long long count;
+        int used;
+        if (sscanf(line, "%19s %llu%n", kind, &count, &used) != 2) continue;
+        const char* rest = line + used;
+        
+        if (strcmp(kind, "cell") == 0 && sscanf(rest, "%19s %19s", first, second) == 2) {
+            int n = findNonTerminalIndex(grammar, first);
+            int t = findTerminalIndex(grammar, second);
+            if (n != -1) rowHeat[n] += count;
+            if (t != -1) columnHeat[t] += count;
+        } else if (strcmp(kind, "production") == 0 && sscanf(rest, "%19s %19s%n", first, second, &used) == 2 &&
+                   strcmp(second, "->") == 0) {
+            int n = findNonTerminalIndex(grammar, first);
+            for (int k = n != -1 ? lhsStart[n] : 0; n != -1 && k < lhsStart[n + 1]; k++) {
+                int i = byLhs[k];
+                const Production* prod = &grammar->productions[i];
+                for (int j = 0; j < prod->numRHS; j++) {
+                    if (sameProfileSymbols(prod->rhs[j], rest + used)) alternativeHeat[alternativeStart[i] + j] += count;
+                }
+            }
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        free(rowHeat);
+        free(columnHeat);
+        free(groupHeat);
+        free(alternativeStart);
+        free(alternativeHeat);
+        free(order);
+        free(names);
+        free(productions);
+        free(lhsOf);
+        free(lhsStart);
+        free(byLhs);
+        free(conflicted);
+        return false;
+    }
+    
+    // Productions follow their non-terminal's row, so the groups of one non-terminal keep their order
+    for (int i = 0; i < grammar->numProductions; i++) {
+        groupHeat[i] = lhsOf[i] != -1 ? rowHeat[lhsOf[i]] : 0;
+    }
+    // Conflicts beyond the ones kept could be anywhere, so then no alternatives move
+    bool conflictsKept = table != NULL && table->numConflicts <= MAX_CONFLICTS;
+    for (int c = 0; conflictsKept && c < table->numConflicts; c++) {
+        int n = findNonTerminalIndex(grammar, table->conflicts[c].nonTerminal);
+        if (n != -1) conflicted[n] = true;
+    }
+    sortByHeat(groupHeat, grammar->numProductions, order);
+    for (int i = 0; i < grammar->numProductions; i++) {
+        productions[i] = grammar->productions[order[i]];
+        
+        Production* prod = &productions[i];
+        if (!conflictsKept || lhsOf[order[i]] == -1 || conflicted[lhsOf[order[i]]]) continue;
+        // The production shares its alternatives with the grammar, so they move through a copy
+        int alternatives[MAX_RHS];
+        char moved[MAX_RHS][MAX_PROD_LEN];
+        sortByHeat(alternativeHeat + alternativeStart[order[i]], prod->numRHS, alternatives);
+        for (int j = 0; j < prod->numRHS; j++) {
+            strcpy(moved[j], prod->rhs[alternatives[j]]);
+        }
+        memcpy(prod->rhs, moved, prod->numRHS * sizeof(moved[0]));
+    }
+    memcpy(grammar->productions, productions, grammar->numProductions * sizeof(Production));
+    
+    sortByHeat(rowHeat, grammar->numNonTerminals, order);
+    for (int n = 0; n < grammar->numNonTerminals; n++) {
+        strcpy(names[n], grammar->nonTerminals[order[n]]);
+    }
+    memcpy(grammar->nonTerminals, names, grammar->numNonTerminals * sizeof(names[0]));
+    
+    sortByHeat(columnHeat, grammar->numTerminals, order);
+    for (int t = 0; t < grammar->numTerminals; t++) {
+        strcpy(names[t], grammar->terminals[order[t]]);
+    }
+    memcpy(grammar->terminals, names, grammar->numTerminals * sizeof(names[0]));
+    indexGrammarSymbols(grammar);
+    
+    free(rowHeat);
+    free(columnHeat);
+    free(groupHeat);
+    free(alternativeStart);
+    free(alternativeHeat);
+    free(order);
+    free(names);
+    free(productions);
+    free(lhsOf);
+    free(lhsStart);
+    free(byLhs);
+    free(conflicted);
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdio.h>
+#include "parser.h"
+
+#define PROFILE_HOT_CELLS 20         // Cells listed in a report
+#define PROFILE_LINE_LEN 4096        // Longest line of a profile file
+
+// Print what a profile covers: productions by use and the ones never used (the grammar's coverage),
+// the hottest table cells, and the deepest stack position each non-terminal was expanded at
+void writeProfileReport(FILE* out, const CompiledTable* compiled, const ParseProfile* profile);
+
+// Write a profile file, one count per line. Symbols and productions are named rather than numbered,
+// so the file can be read back into any table built from the grammar, however it is numbered:
+//   parses <parses> <accepted> <tokens>
+//   stack <deepest stack>
+//   production <count> <lhs> -> <symbols, or ε>
+//   cell <count> <non-terminal> <terminal>
+//   depth <deepest expansion> <non-terminal>
+// False if the file cannot be written
+bool writeParseProfile(const char* filename, const CompiledTable* compiled, const ParseProfile* profile);
+
+// Add the counts of a profile file to profile, which is numbered like compiled. Lines naming a symbol
+// or production the table does not have are skipped. False if the file cannot be read
+bool readParseProfile(const char* filename, const CompiledTable* compiled, ParseProfile* profile);
+
+// Reorder a grammar by a profile file so that a table built from it keeps what the parses use
+// together: non-terminals (rows) and terminals (columns) hottest first by their cell lookups, and the
+// productions in the order of their non-terminals. Given the grammar's table, the alternatives of a
+// non-terminal are stored hottest first as well, unless it has a conflict, whose cells the first
+// alternative wins. What the profile never saw keeps its order after the rest, and as only the
+// numbering changes, every parse stays the same. Sorting and lookups are n log n in the grammar's
+// size. Whether the order pays depends on how few rows the parses use; see the README. False if the
+// file cannot be read
+bool orderGrammarByProfile(Grammar* grammar, const ParseTable* table, const char* filename);
+
+#endif
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "registry.h"
+
+// Function prototypes
+void freeGrammarVersion(GrammarVersion* version);
+int findGrammarLocked(GrammarRegistry* registry, const char* name);
+
+void freeGrammarVersion(GrammarVersion* version) {
+    freeCompiledTable(version->compiled);
+    freeGrammarAnalysis(version->analysis);
+    free(version);
+}
+
+GrammarRegistry* createGrammarRegistry(void) {
+    GrammarRegistry* registry = (GrammarRegistry*)aligned_alloc(64, sizeof(GrammarRegistry));
+    if (registry == NULL) return NULL;
+    for (int i = 0; i < REGISTRY_MAX_GRAMMARS; i++) {
+        atomic_init(&registry->current[i], NULL);
+    }
+    for (int i = 0; i < REGISTRY_MAX_READERS; i++) {
+        atomic_init(&registry->readers[i].epoch, 0);
+    }
+    atomic_init(&registry->numGrammars, 0);
+    atomic_init(&registry->numReaders, 0);
+    atomic_init(&registry->epoch, 1);
+    pthread_mutex_init(&registry->publishLock, NULL);
+    registry->retired = NULL;
+    registry->nextVersion = 1;
+    return registry;
+}
+
+void freeGrammarRegistry(GrammarRegistry* registry) {
+    if (registry == NULL) return;
+    int numGrammars = atomic_load(&registry->numGrammars);
+    for (int i = 0; i < numGrammars; i++) {
+        freeGrammarVersion(atomic_load(&registry->current[i]));
+    }
+    while (registry->retired != NULL) {
+        GrammarVersion* next = registry->retired->nextRetired;
+        freeGrammarVersion(registry->retired);
+        registry->retired = next;
+    }
+    pthread_mutex_destroy(&registry->publishLock);
+    free(registry);
+}
+
+int findGrammarLocked(GrammarRegistry* registry, const char* name) {
+    int numGrammars = atomic_load_explicit(&registry->numGrammars, memory_order_relaxed);
+    for (int i = 0; i < numGrammars; i++) {
+        if (strcmp(registry->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+int publishGrammar(GrammarRegistry* registry, const char* name, GrammarAnalysis* analysis, bool compress) {
+    GrammarVersion* version = (GrammarVersion*)malloc(sizeof(GrammarVersion));
+    CompiledTable* compiled = compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    if (version == NULL || compiled == NULL || strlen(name) >= REGISTRY_NAME_LENGTH) {
+        free(version);
+        freeCompiledTable(compiled);
+        freeGrammarAnalysis(analysis);
+        return -1;
+    }
+    if (compress) {
+        compressCompiledTable(compiled);
+    }
+    version->analysis = analysis;
+    version->compiled = compiled;
+    version->retiredAt = 0;
+    version->nextRetired = NULL;
+    
+    pthread_mutex_lock(&registry->publishLock);
+    int index = findGrammarLocked(registry, name);
+    if (index == -1) {
+        index = atomic_load_explicit(&registry->numGrammars, memory_order_relaxed);
+        if (index == REGISTRY_MAX_GRAMMARS) {
+            pthread_mutex_unlock(&registry->publishLock);
+            freeGrammarVersion(version);
+            return -1;
+        }
+        strcpy(registry->names[index], name);
+    }
+    version->version = registry->nextVersion++;
+    
+    // Readers that load the pointer from here on get the new version. Ones whose section began
+    // before the epoch moves on may still hold the old one
+    GrammarVersion* old = atomic_exchange(&registry->current[index], version);
+    if (old != NULL) {
+        old->retiredAt = atomic_fetch_add(&registry->epoch, 1);
+        old->nextRetired = registry->retired;
+        registry->retired = old;
+    } else {
+        atomic_store_explicit(&registry->numGrammars, index + 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&registry->publishLock);
+    
+    reclaimGrammars(registry);
+    return index;
+}
+
+int findGrammar(GrammarRegistry* registry, const char* name) {
+    int numGrammars = atomic_load_explicit(&registry->numGrammars, memory_order_acquire);
+    for (int i = 0; i < numGrammars; i++) {
+        if (strcmp(registry->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+int registerGrammarReader(GrammarRegistry* registry) {
+    int reader = atomic_fetch_add(&registry->numReaders, 1);
+    if (reader >= REGISTRY_MAX_READERS) {
+        atomic_fetch_sub(&registry->numReaders, 1);
+        return -1;
+    }
+    return reader;
+}
+
+// The slot is stored before any version pointer is loaded (both sequentially consistent), so a
+// publisher that misses it swapped its pointer before the load and the reader gets the new version
+void beginGrammarRead(GrammarRegistry* registry, int reader) {
+    atomic_store(&registry->readers[reader].epoch, atomic_load(&registry->epoch));
+}
+
+void endGrammarRead(GrammarRegistry* registry, int reader) {
+    atomic_store_explicit(&registry->readers[reader].epoch, 0, memory_order_release);
+}
+
+const GrammarVersion* readGrammar(GrammarRegistry* registry, int index) {
+    if (index < 0 || index >= atomic_load_explicit(&registry->numGrammars, memory_order_acquire)) return NULL;
+    return atomic_load(&registry->current[index]);
+}
+
+int reclaimGrammars(GrammarRegistry* registry) {
+    pthread_mutex_lock(&registry->publishLock);
+    
+    // A version retired in epoch e is only reachable from sections that began in e or earlier
+    unsigned long long oldest = 0;
+    int numReaders = atomic_load(&registry->numReaders);
+    if (numReaders > REGISTRY_MAX_READERS) numReaders = REGISTRY_MAX_READERS;
+    for (int i = 0; i < numReaders; i++) {
+        unsigned long long epoch = atomic_load(&registry->readers[i].epoch);
+        if (epoch != 0 && (oldest == 0 || epoch < oldest)) oldest = epoch;
+    }
+    
+    int left = 0;
+    GrammarVersion** link = &registry->retired;
+    while (*link != NULL) {
+        GrammarVersion* version = *link;
+        if (oldest == 0 || version->retiredAt < oldest) {
+            *link = version->nextRetired;
+            freeGrammarVersion(version);
+        } else {
+            link = &version->nextRetired;
+            left++;
+        }
+    }
+    pthread_mutex_unlock(&registry->publishLock);
+    return left;
+}
+
+void synchronizeGrammars(GrammarRegistry* registry) {
+    const struct timespec pause = {0, 1000000};
+    while (reclaimGrammars(registry) > 0) {
+        nanosleep(&pause, NULL);
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include "parser.h"
+
+#define REGISTRY_MAX_GRAMMARS 256    // Grammar indexes fit the daemon protocol's u8
+#define REGISTRY_MAX_READERS 64      // Threads that can read from one registry
+#define REGISTRY_NAME_LENGTH 256
+
+// One published version of a grammar; nothing in it changes after publication
+typedef struct GrammarVersion {
+    int version;                     // Increases with every publication in the registry
+    GrammarAnalysis* analysis;       // Symbol table, FIRST/FOLLOW sets and the table from constructLL1Table
+    CompiledTable* compiled;
+    unsigned long long retiredAt;    // Epoch in which a newer version replaced this one
+    struct GrammarVersion* nextRetired;
+} GrammarVersion;
+
+// The epoch a reader's current read section began in, 0 outside one. Each on its own cache line,
+// written only by its reader
+typedef struct {
+    _Alignas(64) atomic_ullong epoch;
+} ReaderSlot;
+
+// Named grammars that can be replaced while other threads parse with them, read-copy-update style.
+// A reader brackets its use of a version with beginGrammarRead and endGrammarRead, which only
+// store to the reader's own slot. A publisher swaps the new version in and retires the old one,
+// which is freed once no reader's section began before the swap
+typedef struct {
+    _Atomic(GrammarVersion*) current[REGISTRY_MAX_GRAMMARS];
+    char names[REGISTRY_MAX_GRAMMARS][REGISTRY_NAME_LENGTH];
+    atomic_int numGrammars;          // Names are written before the count is raised past them
+    ReaderSlot readers[REGISTRY_MAX_READERS];
+    atomic_int numReaders;
+    _Alignas(64) atomic_ullong epoch;
+    pthread_mutex_t publishLock;     // Serializes publication and reclamation
+    GrammarVersion* retired;         // Replaced versions not freed yet
+    int nextVersion;
+} GrammarRegistry;
+
+GrammarRegistry* createGrammarRegistry(void);
+
+// Free every version. No reader may be in a read section
+void freeGrammarRegistry(GrammarRegistry* registry);
+
+// Compile an analysis and publish it as the current version of name, adding name if it is new.
+// The registry takes the analysis over. Returns the grammar's index, or -1 if the table could
+// not be compiled or the registry is full
+int publishGrammar(GrammarRegistry* registry, const char* name, GrammarAnalysis* analysis, bool compress);
+
+// Index of a published grammar, -1 if there is none by that name
+int findGrammar(GrammarRegistry* registry, const char* name);
+
+// Claim a reader slot for the calling thread, -1 if all are taken
+int registerGrammarReader(GrammarRegistry* registry);
+
+void beginGrammarRead(GrammarRegistry* registry, int reader);
+void endGrammarRead(GrammarRegistry* registry, int reader);
+
+// The current version of a grammar, NULL if there is no such index. Only valid until the reader's
+// endGrammarRead
+const GrammarVersion* readGrammar(GrammarRegistry* registry, int index);
+
+// Free the retired versions no reader can still hold. Returns how many are left
+int reclaimGrammars(GrammarRegistry* registry);
+
+// Wait until every retired version has been freed
+void synchronizeGrammars(GrammarRegistry* registry);
+
+#endif
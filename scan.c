@@ -0,0 +1,134 @@
+#include "scan.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Block width and the per-block classification, one bit per byte in the returned mask.
+// The classes use only byte compares: whitespace is ' ' or 9..13, identifiers are a letter
+// (case folded with | 0x20), a digit or '_'
+#if defined(__AVX2__)
+
+#define SCAN_BLOCK 32
+
+typedef __m256i Block;
+
+static inline Block loadBlock(const char* p) {
+    return _mm256_loadu_si256((const __m256i*)p);
+}
+
+static inline unsigned int inRange(Block x, char low, char count) {
+    // x - low <= count - 1, unsigned: min(t, count - 1) == t
+    Block t = _mm256_sub_epi8(x, _mm256_set1_epi8(low));
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(count - 1)), t));
+}
+
+static inline unsigned int equalTo(Block x, char c) {
+    return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(c)));
+}
+
+static inline unsigned int foldCase(Block x, char low, char count) {
+    return inRange(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), low, count);
+}
+
+#elif defined(__SSE2__)
+
+#define SCAN_BLOCK 16
+
+typedef __m128i Block;
+
+static inline Block loadBlock(const char* p) {
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+static inline unsigned int inRange(Block x, char low, char count) {
+    Block t = _mm_sub_epi8(x, _mm_set1_epi8(low));
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(count - 1)), t));
+}
+
+static inline unsigned int equalTo(Block x, char c) {
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8(c)));
+}
+
+static inline unsigned int foldCase(Block x, char low, char count) {
+    return inRange(_mm_or_si128(x, _mm_set1_epi8(0x20)), low, count);
+}
+
+#endif
+
+#ifdef SCAN_BLOCK
+#define FULL_MASK (SCAN_BLOCK == 32 ? 0xFFFFFFFFu : 0xFFFFu)
+
+static inline unsigned int spaceMask(Block x) {
+    return equalTo(x, ' ') | inRange(x, '\t', 5);
+}
+
+static inline unsigned int identifierMask(Block x) {
+    return foldCase(x, 'a', 26) | inRange(x, '0', 10) | equalTo(x, '_');
+}
+#endif
+
+static inline int isSpaceByte(char c) {
+    return c == ' ' || (unsigned char)(c - '\t') < 5;
+}
+
+static inline int isIdentifierByte(char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26 || (unsigned char)(c - '0') < 10 || c == '_';
+}
+
+int scanSpaces(const char* text, int length) {
+    int i = 0;
+#ifdef SCAN_BLOCK
+    for (; i + SCAN_BLOCK <= length; i += SCAN_BLOCK) {
+        unsigned int other = ~spaceMask(loadBlock(text + i)) & FULL_MASK;
+        if (other != 0) return i + __builtin_ctz(other);
+    }
+#endif
+    while (i < length && isSpaceByte(text[i])) {
+        i++;
+    }
+    return i;
+}
+
+int scanIdentifier(const char* text, int length) {
+    int i = 0;
+#ifdef SCAN_BLOCK
+    for (; i + SCAN_BLOCK <= length; i += SCAN_BLOCK) {
+        unsigned int other = ~identifierMask(loadBlock(text + i)) & FULL_MASK;
+        if (other != 0) return i + __builtin_ctz(other);
+    }
+#endif
+    while (i < length && isIdentifierByte(text[i])) {
+        i++;
+    }
+    return i;
+}
+
+int findByte(const char* text, int length, char c) {
+    int i = 0;
+#ifdef SCAN_BLOCK
+    for (; i + SCAN_BLOCK <= length; i += SCAN_BLOCK) {
+        unsigned int hits = equalTo(loadBlock(text + i), c);
+        if (hits != 0) return i + __builtin_ctz(hits);
+    }
+#endif
+    for (; i < length; i++) {
+        if (text[i] == c) return i;
+    }
+    return -1;
+}
+
+int findBytePair(const char* text, int length, char a, char b) {
+    int i = 0;
+#ifdef SCAN_BLOCK
+    // Compare the block against a and the block one byte later against b
+    for (; i + SCAN_BLOCK + 1 <= length; i += SCAN_BLOCK) {
+        unsigned int hits = equalTo(loadBlock(text + i), a) & equalTo(loadBlock(text + i + 1), b);
+        if (hits != 0) return i + __builtin_ctz(hits);
+    }
+#endif
+    for (; i + 1 < length; i++) {
+        if (text[i] == a && text[i + 1] == b) return i;
+    }
+    return -1;
+}
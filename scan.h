@@ -0,0 +1,20 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+// Byte scanning for the grammar loader and the input tokenizer.
+// Each call classifies 32 (AVX2) or 16 (SSE2) bytes per step and finishes the tail one byte at a
+// time; other targets use the byte loop throughout. None of them read past text + length
+
+// Length of the run of whitespace (space, \t, \n, \v, \f, \r) at the start of text
+int scanSpaces(const char* text, int length);
+
+// Length of the run of identifier bytes [A-Za-z0-9_] at the start of text
+int scanIdentifier(const char* text, int length);
+
+// Offset of the first byte equal to c, or -1
+int findByte(const char* text, int length, char c);
+
+// Offset of the first two-byte sequence "ab" ("->", or the UTF-8 bytes of ε), or -1
+int findBytePair(const char* text, int length, char a, char b);
+
+#endif
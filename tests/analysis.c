@@ -0,0 +1,444 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ll1.h"
+#include "parser.h"
+#include "phash.h"
+
+// Analysis tests on grammars past the sizes the fixed arrays used to allow. Random grammars with
+// recursion and ε are generated; their FIRST and FOLLOW sets, serial and parallel, must match a
+// textbook fixpoint over the generated symbols, and serial and parallel tables must match cell for
+// cell. The perfect hash behind symbol lookups must find every key it was built over and nothing
+// else. Prints every disagreement and exits 1 if there was one
+
+#define MAX_ALTERNATIVES 3       // Per generated non-terminal
+#define MAX_LENGTH 4             // Symbols per generated alternative
+#define NUM_THREADS 4
+#define MAX_REPORTED 10
+
+static const int tableThreads[] = {2, 3, 7, MAX_THREADS};
+
+// A generated grammar: symbol s < numTerminals is terminal "t<s>", otherwise non-terminal N<s - numTerminals>
+typedef struct {
+    int numTerminals;
+    int numNonTerminals;
+    int (*numSymbols)[MAX_ALTERNATIVES]; // -1 past the last alternative
+    int (*symbols)[MAX_ALTERNATIVES][MAX_LENGTH];
+    char* text;
+    bool* nullable;              // The reference sets, indexed [non-terminal * (numTerminals + 1) + terminal], $ last
+    bool* first;
+    bool* follow;
+} RandomGrammar;
+
+// Function prototypes
+void symbolName(const RandomGrammar* random, int symbol, char* name);
+bool generateGrammar(RandomGrammar* random, int numTerminals, int numNonTerminals);
+void freeRandomGrammar(RandomGrammar* random);
+void solveReference(RandomGrammar* random);
+int compareSets(const RandomGrammar* random, const Grammar* grammar, const Set* sets, const bool* expected,
+                const char* what);
+int compareTables(const ParseTable* serial, const ParseTable* parallel);
+int checkSymbolLookups(const Grammar* grammar, const char* stage);
+int checkCompression(const GrammarAnalysis* analysis);
+int testRandomGrammar(int numTerminals, int numNonTerminals);
+int testLeftFactoring(void);
+int testPerfectHash(int numKeys);
+
+void symbolName(const RandomGrammar* random, int symbol, char* name) {
+    if (symbol < random->numTerminals) {
+        sprintf(name, "\"t%d\"", symbol);
+    } else {
+        sprintf(name, "N%d", symbol - random->numTerminals);
+    }
+}
+
+bool generateGrammar(RandomGrammar* random, int numTerminals, int numNonTerminals) {
+    memset(random, 0, sizeof(RandomGrammar));
+    random->numTerminals = numTerminals;
+    random->numNonTerminals = numNonTerminals;
+    random->numSymbols = malloc(numNonTerminals * sizeof(*random->numSymbols));
+    random->symbols = malloc(numNonTerminals * sizeof(*random->symbols));
+    random->text = malloc((size_t)numNonTerminals * MAX_LINE_LEN);
+    size_t cells = (size_t)numNonTerminals * (numTerminals + 1);
+    random->nullable = calloc(numNonTerminals, sizeof(bool));
+    random->first = calloc(cells, sizeof(bool));
+    random->follow = calloc(cells, sizeof(bool));
+    if (random->numSymbols == NULL || random->symbols == NULL || random->text == NULL ||
+        random->nullable == NULL || random->first == NULL || random->follow == NULL) {
+        return false;
+    }
+    
+    // Every terminal is used once in order, so the grammar lists them all; the rest is random.
+    // A few ε alternatives make chains of nullable non-terminals
+    int nextTerminal = 0;
+    char* line = random->text;
+    for (int n = 0; n < numNonTerminals; n++) {
+        int numAlternatives = 1 + rand() % MAX_ALTERNATIVES;
+        line += sprintf(line, "N%d ->", n);
+        for (int a = 0; a < MAX_ALTERNATIVES; a++) {
+            if (a >= numAlternatives) {
+                random->numSymbols[n][a] = -1;
+                continue;
+            }
+            int length = rand() % 6 == 0 ? 0 : 1 + rand() % MAX_LENGTH;
+            random->numSymbols[n][a] = length;
+            line += sprintf(line, a > 0 ? " |" : "");
+            for (int i = 0; i < length; i++) {
+                int symbol = rand() % 2 == 0 ? rand() % numTerminals : numTerminals + rand() % numNonTerminals;
+                if (i == 0 && nextTerminal < numTerminals) symbol = nextTerminal++;
+                random->symbols[n][a][i] = symbol;
+                char name[20];
+                symbolName(random, symbol, name);
+                line += sprintf(line, " %s", name);
+            }
+            if (length == 0) line += sprintf(line, " %s", EPSILON);
+        }
+        line += sprintf(line, "\n");
+    }
+    return nextTerminal == numTerminals;
+}
+
+void freeRandomGrammar(RandomGrammar* random) {
+    free(random->numSymbols);
+    free(random->symbols);
+    free(random->text);
+    free(random->nullable);
+    free(random->first);
+    free(random->follow);
+}
+
+// The sets by the textbook: apply every equation until nothing changes. N0 is the start symbol
+void solveReference(RandomGrammar* random) {
+    int width = random->numTerminals + 1;
+    int end = random->numTerminals;
+    random->follow[end] = true;
+    
+    bool changes = true;
+    while (changes) {
+        changes = false;
+        for (int n = 0; n < random->numNonTerminals; n++) {
+            for (int a = 0; a < MAX_ALTERNATIVES && random->numSymbols[n][a] != -1; a++) {
+                const int* symbols = random->symbols[n][a];
+                int length = random->numSymbols[n][a];
+                
+                // FIRST(n) gets FIRST of the alternative; n is nullable if all of it is
+                bool allNullable = true;
+                for (int i = 0; i < length && allNullable; i++) {
+                    int s = symbols[i];
+                    for (int t = 0; t < end; t++) {
+                        bool has = s < end ? s == t : random->first[(s - end) * width + t];
+                        if (has && !random->first[n * width + t]) {
+                            random->first[n * width + t] = true;
+                            changes = true;
+                        }
+                    }
+                    allNullable = s >= end && random->nullable[s - end];
+                }
+                if (allNullable && !random->nullable[n]) {
+                    random->nullable[n] = true;
+                    changes = true;
+                }
+                
+                // FOLLOW(B) gets FIRST of what follows B, and FOLLOW(n) if that can derive ε
+                for (int i = 0; i < length; i++) {
+                    if (symbols[i] < end) continue;
+                    bool* follow = random->follow + (symbols[i] - end) * width;
+                    bool restNullable = true;
+                    for (int k = i + 1; k < length && restNullable; k++) {
+                        int s = symbols[k];
+                        for (int t = 0; t < end; t++) {
+                            bool has = s < end ? s == t : random->first[(s - end) * width + t];
+                            if (has && !follow[t]) {
+                                follow[t] = true;
+                                changes = true;
+                            }
+                        }
+                        restNullable = s >= end && random->nullable[s - end];
+                    }
+                    for (int t = 0; restNullable && t < width; t++) {
+                        if (random->follow[n * width + t] && !follow[t]) {
+                            follow[t] = true;
+                            changes = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Failures: sets that differ from the expected ones. FIRST sets hold ε for nullable non-terminals,
+// FOLLOW sets hold $ in the last column
+int compareSets(const RandomGrammar* random, const Grammar* grammar, const Set* sets, const bool* expected,
+                const char* what) {
+    if (sets == NULL) {
+        printf("FAIL %s: no sets\n", what);
+        return 1;
+    }
+    int width = random->numTerminals + 1;
+    int failures = 0;
+    for (int n = 0; n < random->numNonTerminals; n++) {
+        char name[20];
+        symbolName(random, random->numTerminals + n, name);
+        const Set* set = findSet(sets, grammar->numNonTerminals, name);
+        int count = 0;
+        bool same = set != NULL;
+        for (int t = 0; same && t < width; t++) {
+            char element[20];
+            if (t < random->numTerminals) symbolName(random, t, element);
+            else strcpy(element, "$");
+            if (expected[n * width + t]) count++;
+            if (expected[n * width + t] != isInSet(*set, element)) same = false;
+        }
+        bool epsilon = expected == random->first && random->nullable[n];
+        if (same && epsilon != isInSet(*set, EPSILON)) same = false;
+        if (same && set->numElements != count + epsilon) same = false;
+        if (!same && failures++ < MAX_REPORTED) printf("FAIL %s of %s\n", what, name);
+    }
+    return failures;
+}
+
+// Failures: cells or conflicts where the two tables differ
+int compareTables(const ParseTable* serial, const ParseTable* parallel) {
+    if (serial->numTerminals != parallel->numTerminals || serial->numNonTerminals != parallel->numNonTerminals ||
+        serial->numEntries != parallel->numEntries || serial->numConflicts != parallel->numConflicts) {
+        printf("FAIL table: %d entries and %d conflicts serially, %d and %d in parallel\n", serial->numEntries,
+               serial->numConflicts, parallel->numEntries, parallel->numConflicts);
+        return 1;
+    }
+    int failures = 0;
+    for (int i = 0; i < serial->numNonTerminals * serial->numTerminals; i++) {
+        int a = serial->cells[i], b = parallel->cells[i];
+        bool same = (a == -1) == (b == -1) &&
+                    (a == -1 || strcmp(serial->entries[a].production, parallel->entries[b].production) == 0);
+        if (!same && failures++ < MAX_REPORTED) {
+            printf("FAIL table: cell [%s, %s] differs\n", serial->nonTerminals[i / serial->numTerminals],
+                   serial->terminals[i % serial->numTerminals]);
+        }
+    }
+    for (int c = 0; c < serial->numConflicts && c < MAX_CONFLICTS; c++) {
+        const TableConflict* a = &serial->conflicts[c];
+        const TableConflict* b = &parallel->conflicts[c];
+        bool same = strcmp(a->nonTerminal, b->nonTerminal) == 0 && strcmp(a->terminal, b->terminal) == 0 &&
+                    strcmp(a->production1, b->production1) == 0 && strcmp(a->production2, b->production2) == 0;
+        if (!same && failures++ < MAX_REPORTED) {
+            printf("FAIL table: conflict %d differs\n", c);
+        }
+    }
+    return failures;
+}
+
+// Every name of a stage's grammar is found at its own index, and names it lost are not found
+int checkSymbolLookups(const Grammar* grammar, const char* stage) {
+    int failures = 0;
+    for (int t = 0; t < grammar->numTerminals; t++) {
+        if (findTerminalIndex(grammar, grammar->terminals[t]) != t && failures++ < MAX_REPORTED) {
+            printf("FAIL %s: terminal %s not found at %d\n", stage, grammar->terminals[t], t);
+        }
+    }
+    for (int n = 0; n < grammar->numNonTerminals; n++) {
+        if (findNonTerminalIndex(grammar, grammar->nonTerminals[n]) != n && failures++ < MAX_REPORTED) {
+            printf("FAIL %s: non-terminal %s not found at %d\n", stage, grammar->nonTerminals[n], n);
+        }
+    }
+    // Generated names the stage does not list, whether simplification removed them or they never were
+    int numNames = 2 * grammar->numNonTerminals + 1;
+    bool* listed = calloc(numNames, sizeof(bool));
+    for (int n = 0; n < grammar->numNonTerminals; n++) {
+        int number;
+        char rest;
+        if (sscanf(grammar->nonTerminals[n], "N%d%c", &number, &rest) == 1 && number >= 0 && number < numNames) {
+            listed[number] = true;
+        }
+    }
+    char name[20];
+    for (int n = 0; n < numNames; n++) {
+        sprintf(name, "N%d", n);
+        if (!listed[n] && (isNonTerminal(*grammar, name) || isTerminal(*grammar, name)) && failures++ < MAX_REPORTED) {
+            printf("FAIL %s: %s is found but not listed\n", stage, name);
+        }
+    }
+    free(listed);
+    return failures;
+}
+
+// The row-displacement encoding of a large table keeps every cell
+int checkCompression(const GrammarAnalysis* analysis) {
+    CompiledTable* compiled = compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    if (compiled == NULL) {
+        printf("FAIL compression: the table did not compile\n");
+        return 1;
+    }
+    int numCells = compiled->numNonTerminals * compiled->numTerminals;
+    short* dense = malloc((numCells + 1) * sizeof(short));
+    memcpy(dense, compiled->cells, numCells * sizeof(short));
+    compressCompiledTable(compiled);
+    
+    int failures = 0;
+    for (int i = 0; i < numCells; i++) {
+        int n = i / compiled->numTerminals;
+        int t = i % compiled->numTerminals;
+        if (tableCell(compiled, n, t) != dense[i] && failures++ < MAX_REPORTED) {
+            printf("FAIL compression: cell [%s, %s] is %d, not %d\n", compiled->nonTerminalNames[n],
+                   compiled->terminalNames[t], tableCell(compiled, n, t), dense[i]);
+        }
+    }
+    free(dense);
+    freeCompiledTable(compiled);
+    return failures;
+}
+
+// Failures on one random grammar, read as it is (left recursion and all) and analyzed whole
+int testRandomGrammar(int numTerminals, int numNonTerminals) {
+    RandomGrammar random;
+    int failures = 0;
+    if (!generateGrammar(&random, numTerminals, numNonTerminals)) {
+        printf("FAIL %d terminals, %d non-terminals: could not generate the grammar\n", numTerminals, numNonTerminals);
+        freeRandomGrammar(&random);
+        return 1;
+    }
+    solveReference(&random);
+    
+    Grammar grammar = readGrammarFromString(random.text);
+    if (grammar.numTerminals != numTerminals || grammar.numNonTerminals != numNonTerminals) {
+        printf("FAIL %d terminals, %d non-terminals: read %d and %d\n", numTerminals, numNonTerminals,
+               grammar.numTerminals, grammar.numNonTerminals);
+        freeGrammar(&grammar);
+        freeRandomGrammar(&random);
+        return 1;
+    }
+    
+    clock_t started = clock();
+    Set* firstSets = computeFirstSets(grammar);
+    Set* followSets = computeFollowSets(grammar, firstSets);
+    ParseTable table = constructLL1Table(grammar, firstSets, followSets);
+    double seconds = (double)(clock() - started) / CLOCKS_PER_SEC;
+    Set* parallelFirst = computeFirstSetsParallel(grammar, NUM_THREADS);
+    Set* parallelFollow = computeFollowSetsParallel(grammar, parallelFirst, NUM_THREADS);
+    ParseTable parallelTable = constructLL1TableParallel(grammar, parallelFirst, parallelFollow, NUM_THREADS);
+    
+    failures += compareSets(&random, &grammar, firstSets, random.first, "FIRST");
+    failures += compareSets(&random, &grammar, followSets, random.follow, "FOLLOW");
+    failures += compareSets(&random, &grammar, parallelFirst, random.first, "parallel FIRST");
+    failures += compareSets(&random, &grammar, parallelFollow, random.follow, "parallel FOLLOW");
+    failures += compareTables(&table, &parallelTable);
+    
+    // However the rows are split, including more threads than rows, the table comes out the same
+    for (size_t i = 0; i < sizeof(tableThreads) / sizeof(tableThreads[0]); i++) {
+        ParseTable split = constructLL1TableParallel(grammar, firstSets, followSets, tableThreads[i]);
+        failures += compareTables(&table, &split);
+        freeParseTable(&split);
+    }
+    
+    // Every stage has to cope with the size too
+    GrammarAnalysis* analysis = analyzeGrammar(copyGrammar(&grammar), NUM_THREADS);
+    if (analysis == NULL) {
+        printf("FAIL %d non-terminals: the analysis failed\n", numNonTerminals);
+        failures++;
+    } else {
+        failures += checkSymbolLookups(&analysis->original, "original");
+        failures += checkSymbolLookups(&analysis->leftFactored, "left factored");
+        failures += checkSymbolLookups(&analysis->withoutLeftRecursion, "without left recursion");
+        failures += checkSymbolLookups(&analysis->simplified, "simplified");
+        failures += checkCompression(analysis);
+    }
+    
+    printf("%5d terminals %5d non-terminals: sets and table in %.3f s, %d conflicts, %d after the transformations: %s\n",
+           numTerminals, numNonTerminals, seconds, table.numConflicts,
+           analysis != NULL ? analysis->parseTable.numConflicts : -1, failures == 0 ? "match" : "FAILED");
+    freeGrammarAnalysis(analysis);
+    freeSet(firstSets, grammar.numNonTerminals);
+    freeSet(followSets, grammar.numNonTerminals);
+    freeSet(parallelFirst, grammar.numNonTerminals);
+    freeSet(parallelFollow, grammar.numNonTerminals);
+    freeParseTable(&table);
+    freeParseTable(&parallelTable);
+    freeGrammar(&grammar);
+    freeRandomGrammar(&random);
+    return failures;
+}
+
+// Alternatives without a common prefix stay where they are when the others are factored
+int testLeftFactoring(void) {
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString("S -> a b | a c | d\n"), 1);
+    CompiledTable* compiled = analysis == NULL ? NULL
+                            : compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    bool ok = compiled != NULL && parseInput(compiled, "d", 1).accepted && parseInput(compiled, "ab", 2).accepted &&
+              parseInput(compiled, "ac", 2).accepted && !parseInput(compiled, "a", 1).accepted;
+    printf("%-10s %s\n", "factoring", ok ? "unfactored alternatives kept" : "FAILED: an alternative was lost");
+    freeCompiledTable(compiled);
+    freeGrammarAnalysis(analysis);
+    return ok ? 0 : 1;
+}
+
+// A perfect hash over numKeys names that differ only in their last characters, as generated
+// symbols do: each key maps to its own index through a slot of its own, names that are not keys
+// (prefixes and extensions of keys among them) map to -1, and a repeated name is refused
+int testPerfectHash(int numKeys) {
+    char (*names)[24] = malloc((numKeys + 1) * sizeof(*names));
+    const char** keys = malloc((numKeys + 1) * sizeof(char*));
+    for (int i = 0; i < numKeys; i++) {
+        sprintf(names[i], i % 2 == 0 ? "N%d" : "\"t%d\"", i);
+        keys[i] = names[i];
+    }
+    int failures = 0;
+    PerfectHash* hash = buildPerfectHash(keys, numKeys);
+    if (hash == NULL) {
+        printf("FAIL phash: no hash over %d distinct names\n", numKeys);
+        failures++;
+    }
+    
+    bool* placed = calloc(numKeys + 1, sizeof(bool));
+    for (int slot = 0; hash != NULL && slot < numKeys; slot++) {
+        int key = hash->slotKey[slot];
+        if (key < 0 || key >= numKeys || placed[key]) {
+            if (failures++ < MAX_REPORTED) printf("FAIL phash: slot %d of %d holds key %d\n", slot, numKeys, key);
+        } else {
+            placed[key] = true;
+        }
+    }
+    for (int i = 0; hash != NULL && i < numKeys; i++) {
+        char other[32];
+        int length = strlen(names[i]);
+        int found = lookupPerfectHash(hash, names[i], length);
+        sprintf(other, "%sx", names[i]);
+        int extended = lookupPerfectHash(hash, other, length + 1);
+        sprintf(other, i % 2 == 0 ? "M%d" : "\"u%d\"", i);
+        int absent = lookupPerfectHash(hash, other, strlen(other));
+        // All of a key but its last byte: N24 less a byte is N2, a key itself, and "t7" less one is no key
+        int prefix = lookupPerfectHash(hash, names[i], length - 1);
+        int expectedPrefix = i % 2 == 0 && i >= 10 && i / 10 % 2 == 0 ? i / 10 : -1;
+        if ((found != i || extended != -1 || absent != -1 || prefix != expectedPrefix) && failures++ < MAX_REPORTED) {
+            printf("FAIL phash: %s found at %d, extended at %d, absent at %d, prefix at %d\n", names[i], found,
+                   extended, absent, prefix);
+        }
+    }
+    freePerfectHash(hash);
+    
+    if (numKeys > 0) {
+        keys[numKeys] = names[numKeys / 2];
+        hash = buildPerfectHash(keys, numKeys + 1);
+        if (hash != NULL) {
+            printf("FAIL phash: a hash was built over %d names with a repeat\n", numKeys + 1);
+            failures++;
+            freePerfectHash(hash);
+        }
+    }
+    printf("%-10s %d keys: %s\n", "phash", numKeys, failures == 0 ? "each found at its own index, nothing else" : "FAILED");
+    free(placed);
+    free(keys);
+    free(names);
+    return failures;
+}
+
+int main(void) {
+    srand(1);
+    int failures = testLeftFactoring();
+    failures += testPerfectHash(0) + testPerfectHash(1) + testPerfectHash(7) + testPerfectHash(100000);
+    failures += testRandomGrammar(20, 30);
+    failures += testRandomGrammar(150, 600);
+    failures += testRandomGrammar(400, 5000);
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "ll1.h"
+
+// Batch mode tests: ./cc -b over a directory and over a list file, on several threads, has to write
+// each grammar's output exactly as a run of ./cc on that grammar alone does, and its summary has to
+// report every grammar's conflicts and failures. Needs ./cc built. Exits 1 on any difference
+
+#define MAX_OUTPUT 65536
+
+typedef struct {
+    const char* name;
+    const char* text;            // NULL for a file that is not a grammar
+} TestGrammar;
+
+static const TestGrammar grammars[] = {
+    {"expression", "E -> E+T | E-T | T\nT -> T*F | T/F | F\nF -> (E) | i\n"},
+    {"factoring", "S -> i E t S | i E t S e S | a\nE -> b\n"},
+    {"conflict", "S -> A a | b\nA -> a | ε\n"},
+    {"ebnf", "S ::= E (\";\" E)*\nE ::= T ((\"+\" | \"-\") T)*\nT ::= i | \"(\" E \")\"\n"},
+    {"keywords", "S -> \"if\" E \"then\" S | x\nE -> y\n"},
+    {"bad", "this is not a grammar\n"},
+    {"indirect", "S -> A a | b\nA -> A c | S d | ε\n"},
+};
+
+#define NUM_GRAMMARS (int)(sizeof(grammars) / sizeof(grammars[0]))
+
+// Function prototypes
+bool writeText(const char* path, const char* text);
+int readText(const char* path, char* text);
+int runCommand(const char* command, char* output);
+int expectedConflicts(const TestGrammar* grammar);
+int checkBatch(const char* dir, const char* source, const char* outputDir, const int* listed, int numListed);
+
+bool writeText(const char* path, const char* text) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) return false;
+    fputs(text, file);
+    fclose(file);
+    return true;
+}
+
+// The file's bytes, -1 if it cannot be read
+int readText(const char* path, char* text) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+    int length = fread(text, 1, MAX_OUTPUT - 1, file);
+    text[length] = '\0';
+    fclose(file);
+    return length;
+}
+
+// Run a shell command, keeping what it prints; its exit status
+int runCommand(const char* command, char* output) {
+    FILE* pipe = popen(command, "r");
+    if (pipe == NULL) return -1;
+    int length = fread(output, 1, MAX_OUTPUT - 1, pipe);
+    output[length] = '\0';
+    int status = pclose(pipe);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Conflicts analyzeGrammar reports for the grammar, -1 if it does not read
+int expectedConflicts(const TestGrammar* grammar) {
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString(grammar->text), 1);
+    if (analysis == NULL) return -1;
+    int numConflicts = analysis->parseTable.numConflicts;
+    freeGrammarAnalysis(analysis);
+    return numConflicts;
+}
+
+// Run one batch over source and check every listed grammar's output file against the reference
+// written by a single run, its summary line, and the totals. Failures found
+int checkBatch(const char* dir, const char* source, const char* outputDir, const int* listed, int numListed) {
+    char command[1024];
+    char summary[MAX_OUTPUT], expected[MAX_OUTPUT], actual[MAX_OUTPUT];
+    int failures = 0;
+    mkdir(outputDir, 0700);
+    snprintf(command, sizeof(command), "./cc -b %s -o %s -j 4", source, outputDir);
+    int status = runCommand(command, summary);
+
+    int analyzed = 0, failed = 0, conflicted = 0, totalConflicts = 0;
+    for (int k = 0; k < numListed; k++) {
+        const TestGrammar* grammar = &grammars[listed[k]];
+        int numConflicts = expectedConflicts(grammar);
+        char line[512], path[512];
+        snprintf(path, sizeof(path), "%s/grammars/%s", dir, grammar->name);
+        if (numConflicts < 0) {
+            failed++;
+            snprintf(line, sizeof(line), "%s ", path);
+            if (strstr(summary, line) == NULL || strstr(strstr(summary, line), "FAILED") == NULL) {
+                printf("FAIL %s: %s is not reported as failed\n", source, grammar->name);
+                failures++;
+            }
+            continue;
+        }
+        analyzed++;
+        totalConflicts += numConflicts;
+        if (numConflicts > 0) conflicted++;
+
+        // The summary line names the grammar, its conflicts and its output file
+        char output[512];
+        snprintf(output, sizeof(output), "%s/%s.out", outputDir, grammar->name);
+        snprintf(line, sizeof(line), "%d conflicts -> %s\n", numConflicts, output);
+        char* entry = strstr(summary, path);
+        if (entry == NULL || strncmp(strchr(entry, '\n') - strlen(line) + 1, line, strlen(line)) != 0) {
+            printf("FAIL %s: no summary line \"%s ... %.*s\"\n", source, path, (int)strlen(line) - 1, line);
+            failures++;
+        }
+
+        snprintf(command, sizeof(command), "./cc %s %s/reference.out > /dev/null", path, dir);
+        snprintf(path, sizeof(path), "%s/reference.out", dir);
+        if (runCommand(command, actual) != 0 || readText(path, expected) < 0) {
+            printf("FAIL %s: ./cc alone did not analyze %s\n", source, grammar->name);
+            failures++;
+        } else if (readText(output, actual) < 0 || strcmp(expected, actual) != 0) {
+            printf("FAIL %s: %s differs from the output of ./cc alone\n", source, output);
+            failures++;
+        }
+    }
+
+    char totals[256];
+    snprintf(totals, sizeof(totals), "Grammars: %d analyzed, %d failed, %d not LL(1) (%d conflicts)\n",
+             analyzed, failed, conflicted, totalConflicts);
+    if (strstr(summary, totals) == NULL) {
+        printf("FAIL %s: expected \"%.*s\" in the summary:\n%s", source, (int)strlen(totals) - 1, totals, summary);
+        failures++;
+    }
+    if (status != (failed > 0 ? 1 : 0)) {
+        printf("FAIL %s: exit status %d with %d failed grammars\n", source, status, failed);
+        failures++;
+    }
+    printf("%-10s %d grammars, %d failed: %s\n", strstr(source, "list") != NULL ? "list file" : "directory",
+           numListed, failed, failures == 0 ? "same outputs as single runs" : "FAILED");
+    return failures;
+}
+
+int main(void) {
+    if (access("./cc", X_OK) != 0) {
+        printf("FAIL: ./cc is not built\n");
+        return 1;
+    }
+    char dir[] = "/tmp/ll1-batch-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        printf("FAIL: cannot create a temporary directory\n");
+        return 1;
+    }
+
+    // Every grammar in a directory, then every other one through a list file
+    char path[512], source[512], outputDir[512];
+    snprintf(path, sizeof(path), "%s/grammars", dir);
+    mkdir(path, 0700);
+    int all[NUM_GRAMMARS], some[NUM_GRAMMARS];
+    int numSome = 0;
+    char list[4096] = "";
+    bool written = true;
+    for (int g = 0; g < NUM_GRAMMARS; g++) {
+        snprintf(path, sizeof(path), "%s/grammars/%s", dir, grammars[g].name);
+        written = written && writeText(path, grammars[g].text);
+        all[g] = g;
+        if (g % 2 == 0) {
+            some[numSome++] = g;
+            strcat(list, path);
+            strcat(list, "\n");
+        }
+    }
+    snprintf(source, sizeof(source), "%s/list", dir);
+    written = written && writeText(source, list);
+
+    int failures = 0;
+    if (!written) {
+        printf("FAIL: cannot write the grammar files\n");
+        failures++;
+    } else {
+        snprintf(source, sizeof(source), "%s/grammars", dir);
+        snprintf(outputDir, sizeof(outputDir), "%s/all", dir);
+        failures += checkBatch(dir, source, outputDir, all, NUM_GRAMMARS);
+        snprintf(source, sizeof(source), "%s/list", dir);
+        snprintf(outputDir, sizeof(outputDir), "%s/some", dir);
+        failures += checkBatch(dir, source, outputDir, some, numSome);
+    }
+
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    if (system(command) != 0) printf("Could not remove %s\n", dir);
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
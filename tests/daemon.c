@@ -0,0 +1,434 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "ll1.h"
+#include "daemon.h"
+#include "generate.h"
+
+// Daemon tests: runDaemon serves a registry on a socket in a temporary directory, on a thread of
+// its own. Requests sent over it, pipelined or one at a time, have to be answered in order and as
+// parseInput answers them; malformed ones are refused. An edited document has to be answered as
+// parseInput answers the text the client keeps, also across a republication of its grammar.
+// Prints every failure and exits 1 if there was one
+
+#define PIPELINED_REQUESTS 4000
+#define MAX_INPUT 160
+#define LATENCY_REQUESTS 2000
+#define EDITS_PER_PHASE 200
+#define MAX_DOCUMENT 400         // Edits stop inserting once the document is this long
+
+typedef struct {
+    const char* name;
+    const char* text;
+    const char* alphabet;        // Bytes mutations insert or substitute
+    bool compress;
+} TestGrammar;
+
+static const TestGrammar grammars[] = {
+    {"expression", "E -> E+T | E-T | T\nT -> T*F | T/F | F\nF -> (E) | i\n", "i+-*/()", false},
+    {"keywords", "S -> \"if\" c S | B\nB -> i f A\nA -> a A | ε\n", "ifac ", true},
+};
+
+#define NUM_GRAMMARS (int)(sizeof(grammars) / sizeof(grammars[0]))
+
+// The expression grammar republished while a document is open, with a second operand
+#define REPUBLISHED "E -> E+T | E-T | T\nT -> T*F | T/F | F\nF -> (E) | i | n\n"
+#define REPUBLISHED_ALPHABET "in+-*/()"
+
+// Requests written by one thread while the main thread reads the responses
+typedef struct {
+    int fd;
+    char (*inputs)[3 * MAX_INPUT];
+    int* lengths;
+    int* grammar;
+    int count;
+} Pipeline;
+
+typedef struct {
+    const char* socketPath;
+    GrammarRegistry* registry;
+    int status;
+} DaemonRun;
+
+static int failures = 0;
+
+// Function prototypes
+void fail(const char* check);
+bool writeAll(int fd, const void* bytes, size_t length);
+bool readAll(int fd, void* bytes, size_t length);
+void putUint32(unsigned char* bytes, uint32_t value);
+bool sendRequest(int fd, int opcode, int grammar, const char* payload, int length);
+bool readResponse(int fd, int* status, uint32_t* errorOffset);
+bool sameAnswer(int status, uint32_t errorOffset, ParseResult expected);
+int connectDaemon(const char* socketPath);
+void* runDaemonThread(void* arg);
+void* writePipeline(void* arg);
+void testPipelined(const char* socketPath, GrammarRegistry* registry);
+void testBadRequests(const char* socketPath);
+ParseResult parseCurrent(GrammarRegistry* registry, int reader, int grammar, const char* text, int length);
+int randomEdit(char* text, int* length, const char* alphabet, unsigned char* payload);
+bool sendEdits(int fd, GrammarRegistry* registry, int reader, int grammar, char* text, int* length,
+               const char* alphabet);
+void testDocumentEdits(const char* socketPath, GrammarRegistry* registry);
+void measureLatency(const char* socketPath);
+
+void fail(const char* check) {
+    printf("FAIL %s\n", check);
+    failures++;
+}
+
+bool writeAll(int fd, const void* bytes, size_t length) {
+    const char* next = (const char*)bytes;
+    while (length > 0) {
+        ssize_t written = write(fd, next, length);
+        if (written <= 0) return false;
+        next += written;
+        length -= written;
+    }
+    return true;
+}
+
+bool readAll(int fd, void* bytes, size_t length) {
+    char* next = (char*)bytes;
+    while (length > 0) {
+        ssize_t received = read(fd, next, length);
+        if (received <= 0) return false;
+        next += received;
+        length -= received;
+    }
+    return true;
+}
+
+void putUint32(unsigned char* bytes, uint32_t value) {
+    bytes[0] = value >> 24;
+    bytes[1] = value >> 16;
+    bytes[2] = value >> 8;
+    bytes[3] = value;
+}
+
+// One frame: the length, the opcode, the grammar index, then the payload bytes
+bool sendRequest(int fd, int opcode, int grammar, const char* payload, int length) {
+    unsigned char header[6];
+    putUint32(header, length + 2);
+    header[4] = opcode;
+    header[5] = grammar;
+    return writeAll(fd, header, sizeof(header)) && writeAll(fd, payload, length);
+}
+
+bool readResponse(int fd, int* status, uint32_t* errorOffset) {
+    unsigned char frame[9];
+    if (!readAll(fd, frame, sizeof(frame))) return false;
+    if (frame[0] != 0 || frame[1] != 0 || frame[2] != 0 || frame[3] != 5) return false;
+    *status = frame[4];
+    *errorOffset = ((uint32_t)frame[5] << 24) | ((uint32_t)frame[6] << 16) | ((uint32_t)frame[7] << 8) | frame[8];
+    return true;
+}
+
+bool sameAnswer(int status, uint32_t errorOffset, ParseResult expected) {
+    if (expected.accepted) return status == RESPONSE_ACCEPTED && errorOffset == 0xFFFFFFFFu;
+    return status == RESPONSE_REJECTED && errorOffset == (uint32_t)expected.errorOffset;
+}
+
+// A connection to the daemon, retried while it is still starting; -1 if it never listens
+int connectDaemon(const char* socketPath) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    for (int attempt = 0; attempt < 2000; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0) return fd;
+        if (fd >= 0) close(fd);
+        usleep(1000);
+    }
+    return -1;
+}
+
+void* runDaemonThread(void* arg) {
+    DaemonRun* run = (DaemonRun*)arg;
+    run->status = runDaemon(run->socketPath, run->registry);
+    return NULL;
+}
+
+void* writePipeline(void* arg) {
+    Pipeline* pipeline = (Pipeline*)arg;
+    for (int i = 0; i < pipeline->count; i++) {
+        if (!sendRequest(pipeline->fd, REQUEST_PARSE, pipeline->grammar[i], pipeline->inputs[i], pipeline->lengths[i])) break;
+    }
+    return NULL;
+}
+
+// Derived and mutated inputs for both grammars, all written before most answers are read, so the
+// daemon sees many frames per read, split anywhere; the answers have to come back in order
+void testPipelined(const char* socketPath, GrammarRegistry* registry) {
+    Pipeline pipeline;
+    pipeline.inputs = malloc(PIPELINED_REQUESTS * sizeof(*pipeline.inputs));
+    pipeline.lengths = malloc(PIPELINED_REQUESTS * sizeof(int));
+    pipeline.grammar = malloc(PIPELINED_REQUESTS * sizeof(int));
+    pipeline.count = PIPELINED_REQUESTS;
+    ParseResult* expected = malloc(PIPELINED_REQUESTS * sizeof(ParseResult));
+    
+    int reader = registerGrammarReader(registry);
+    beginGrammarRead(registry, reader);
+    InputGenerator generators[NUM_GRAMMARS];
+    for (int g = 0; g < NUM_GRAMMARS; g++) {
+        initInputGenerator(&generators[g], readGrammar(registry, g)->compiled, MAX_INPUT);
+    }
+    for (int i = 0; i < PIPELINED_REQUESTS; i++) {
+        int g = i % NUM_GRAMMARS;
+        const CompiledTable* compiled = readGrammar(registry, g)->compiled;
+        int length = generateDerivation(&generators[g], compiled->startSymbol, pipeline.inputs[i]);
+        pipeline.lengths[i] = mutateInput(pipeline.inputs[i], length, grammars[g].alphabet, rand() % 3);
+        pipeline.grammar[i] = g;
+        expected[i] = parseInput(compiled, pipeline.inputs[i], pipeline.lengths[i]);
+    }
+    for (int g = 0; g < NUM_GRAMMARS; g++) {
+        freeInputGenerator(&generators[g]);
+    }
+    endGrammarRead(registry, reader);
+    
+    pipeline.fd = connectDaemon(socketPath);
+    pthread_t writer;
+    int answered = 0, accepted = 0;
+    if (pipeline.fd < 0 || pthread_create(&writer, NULL, writePipeline, &pipeline) != 0) {
+        fail("pipelined: cannot connect to the daemon");
+    } else {
+        int status;
+        uint32_t errorOffset;
+        while (answered < PIPELINED_REQUESTS && readResponse(pipeline.fd, &status, &errorOffset)) {
+            if (!sameAnswer(status, errorOffset, expected[answered])) {
+                printf("FAIL pipelined: request %d on \"%.*s\" answered %d at %u\n", answered,
+                       pipeline.lengths[answered], pipeline.inputs[answered], status, errorOffset);
+                failures++;
+            }
+            if (status == RESPONSE_ACCEPTED) accepted++;
+            answered++;
+        }
+        pthread_join(writer, NULL);
+        if (answered < PIPELINED_REQUESTS) fail("pipelined: the daemon stopped answering");
+        close(pipeline.fd);
+    }
+    printf("%-10s %d requests, %d accepted: %s\n", "pipelined", answered, accepted,
+           answered == PIPELINED_REQUESTS ? "answered in order" : "FAILED");
+    free(pipeline.inputs);
+    free(pipeline.lengths);
+    free(pipeline.grammar);
+    free(expected);
+}
+
+// Requests the daemon has to refuse without dropping the connection, then a frame too large for
+// it, which drops the connection
+void testBadRequests(const char* socketPath) {
+    int fd = connectDaemon(socketPath);
+    if (fd < 0) {
+        fail("bad requests: cannot connect to the daemon");
+        return;
+    }
+    int status;
+    uint32_t errorOffset;
+    unsigned char header[5];
+    putUint32(header, 1);
+    header[4] = REQUEST_PARSE;
+    bool refused = sendRequest(fd, REQUEST_PARSE, NUM_GRAMMARS, "i", 1) &&           // No such grammar
+                   readResponse(fd, &status, &errorOffset) && status == RESPONSE_BAD_REQUEST &&
+                   writeAll(fd, header, sizeof(header)) &&                           // No grammar byte
+                   readResponse(fd, &status, &errorOffset) && status == RESPONSE_BAD_REQUEST &&
+                   sendRequest(fd, REQUEST_EDIT, 0, "\0\0\0\0\0\0\0\0", 8) &&        // No document open
+                   readResponse(fd, &status, &errorOffset) && status == RESPONSE_BAD_REQUEST &&
+                   sendRequest(fd, 9, 0, "i", 1) &&                                  // No such opcode
+                   readResponse(fd, &status, &errorOffset) && status == RESPONSE_BAD_REQUEST &&
+                   sendRequest(fd, REQUEST_PARSE, 0, "i+i", 3) &&                    // Still served
+                   readResponse(fd, &status, &errorOffset) && status == RESPONSE_ACCEPTED;
+    if (!refused) fail("bad requests: a malformed request was not refused, or ended the connection");
+    
+    putUint32(header, DAEMON_MAX_FRAME + 1);
+    char byte;
+    bool dropped = writeAll(fd, header, sizeof(header)) && read(fd, &byte, 1) == 0;
+    if (!dropped) fail("bad requests: a frame over DAEMON_MAX_FRAME did not end the connection");
+    close(fd);
+    printf("%-10s %s\n", "refused", refused && dropped ? "malformed requests refused, oversized frame dropped" : "FAILED");
+}
+
+// What parseInput answers with the grammar's current version
+ParseResult parseCurrent(GrammarRegistry* registry, int reader, int grammar, const char* text, int length) {
+    beginGrammarRead(registry, reader);
+    ParseResult result = parseInput(readGrammar(registry, grammar)->compiled, text, length);
+    endGrammarRead(registry, reader);
+    return result;
+}
+
+// Make a random edit to text, and write it as an edit request's payload after the opcode and
+// grammar bytes: start, bytes removed, bytes inserted. The payload's length
+int randomEdit(char* text, int* length, const char* alphabet, unsigned char* payload) {
+    int start = rand() % (*length + 1);
+    int removed = rand() % (*length - start < 4 ? *length - start + 1 : 4);
+    int inserted = *length < MAX_DOCUMENT ? rand() % 4 : 0;
+    putUint32(payload, start);
+    putUint32(payload + 4, removed);
+    for (int i = 0; i < inserted; i++) {
+        payload[8 + i] = alphabet[rand() % strlen(alphabet)];
+    }
+    memmove(text + start + inserted, text + start + removed, *length - start - removed);
+    memcpy(text + start, payload + 8, inserted);
+    *length += inserted - removed;
+    return 8 + inserted;
+}
+
+// EDITS_PER_PHASE edits to the connection's document, which the client keeps a copy of in text,
+// each answered as parseInput answers the copy with the grammar's current version. The edits carry
+// another grammar's index, which the daemon has to ignore. False on any difference
+bool sendEdits(int fd, GrammarRegistry* registry, int reader, int grammar, char* text, int* length,
+               const char* alphabet) {
+    unsigned char payload[16];
+    int status;
+    uint32_t errorOffset;
+    bool same = true;
+    for (int i = 0; i < EDITS_PER_PHASE; i++) {
+        int size = randomEdit(text, length, alphabet, payload);
+        if (!sendRequest(fd, REQUEST_EDIT, grammar ^ 1, (const char*)payload, size) ||
+            !readResponse(fd, &status, &errorOffset)) {
+            fail("edits: the daemon stopped answering");
+            return false;
+        }
+        if (!sameAnswer(status, errorOffset, parseCurrent(registry, reader, grammar, text, *length))) {
+            printf("FAIL edits: \"%.*s\" answered %d at %u\n", *length, text, status, errorOffset);
+            failures++;
+            same = false;
+        }
+    }
+    return same;
+}
+
+// A document opened with each grammar in turn and edited. The first grammar is republished with a
+// larger language halfway through its edits, and the daemon has to parse the document again with
+// it. An edit past the end of the document is refused and leaves the document as it was
+void testDocumentEdits(const char* socketPath, GrammarRegistry* registry) {
+    int fd = connectDaemon(socketPath);
+    if (fd < 0) {
+        fail("edits: cannot connect to the daemon");
+        return;
+    }
+    int reader = registerGrammarReader(registry);
+    char* text = malloc(MAX_DOCUMENT + 8);
+    bool same = true;
+    int status;
+    uint32_t errorOffset;
+    for (int g = 0; g < NUM_GRAMMARS && same; g++) {
+        beginGrammarRead(registry, reader);
+        const CompiledTable* compiled = readGrammar(registry, g)->compiled;
+        InputGenerator generator;
+        initInputGenerator(&generator, compiled, MAX_DOCUMENT / 4);
+        int length = generateDerivation(&generator, compiled->startSymbol, text);
+        freeInputGenerator(&generator);
+        endGrammarRead(registry, reader);
+        if (!sendRequest(fd, REQUEST_OPEN, g, text, length) || !readResponse(fd, &status, &errorOffset) ||
+            !sameAnswer(status, errorOffset, parseCurrent(registry, reader, g, text, length))) {
+            fail("edits: the opened document was not answered as parseInput answers it");
+            same = false;
+            break;
+        }
+        same = sendEdits(fd, registry, reader, g, text, &length, grammars[g].alphabet) && same;
+        
+        unsigned char outOfRange[8];
+        putUint32(outOfRange, length);
+        putUint32(outOfRange + 4, 1);
+        if (!sendRequest(fd, REQUEST_EDIT, g, (const char*)outOfRange, 8) || !readResponse(fd, &status, &errorOffset) ||
+            status != RESPONSE_BAD_REQUEST) {
+            fail("edits: an edit past the end of the document was not refused");
+            same = false;
+        }
+        if (g > 0) continue;
+        
+        GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString(REPUBLISHED), 1);
+        if (analysis == NULL || publishGrammar(registry, grammars[g].name, analysis, grammars[g].compress) != g) {
+            fail("edits: the grammar did not republish");
+            same = false;
+            break;
+        }
+        same = sendEdits(fd, registry, reader, g, text, &length, REPUBLISHED_ALPHABET) && same;
+    }
+    close(fd);
+    free(text);
+    printf("%-10s %d edits to %d documents: %s\n", "edits", (NUM_GRAMMARS + 1) * EDITS_PER_PHASE, NUM_GRAMMARS,
+           same ? "answered as parseInput, across a republication" : "FAILED");
+}
+
+// Round trips of one small request at a time; printed, not checked, as they depend on the machine
+void measureLatency(const char* socketPath) {
+    int fd = connectDaemon(socketPath);
+    double* seconds = malloc(LATENCY_REQUESTS * sizeof(double));
+    int done = 0;
+    int status;
+    uint32_t errorOffset;
+    while (fd >= 0 && done < LATENCY_REQUESTS) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (!sendRequest(fd, REQUEST_PARSE, 0, "(i+i)*i-i", 9) || !readResponse(fd, &status, &errorOffset)) break;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        seconds[done++] = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    }
+    if (done < LATENCY_REQUESTS) {
+        fail("latency: the daemon stopped answering");
+    } else {
+        // Insertion sort is plenty for the percentiles of a couple of thousand samples
+        for (int i = 1; i < done; i++) {
+            double value = seconds[i];
+            int j = i;
+            for (; j > 0 && seconds[j - 1] > value; j--) seconds[j] = seconds[j - 1];
+            seconds[j] = value;
+        }
+        printf("%-10s %d round trips: median %.1f us, p99 %.1f us\n", "latency", done,
+               seconds[done / 2] * 1e6, seconds[done * 99 / 100] * 1e6);
+    }
+    if (fd >= 0) close(fd);
+    free(seconds);
+}
+
+int main(void) {
+    srand(1);
+    char dir[] = "/tmp/ll1-daemon-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        printf("FAIL: cannot create a temporary directory\n");
+        return 1;
+    }
+    char socketPath[64];
+    snprintf(socketPath, sizeof(socketPath), "%s/socket", dir);
+    
+    GrammarRegistry* registry = createGrammarRegistry();
+    for (int g = 0; g < NUM_GRAMMARS; g++) {
+        GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString(grammars[g].text), 1);
+        if (analysis == NULL || publishGrammar(registry, grammars[g].name, analysis, grammars[g].compress) != g) {
+            printf("FAIL %s: the grammar did not publish\n", grammars[g].name);
+            return 1;
+        }
+    }
+    
+    DaemonRun run = {socketPath, registry, -1};
+    pthread_t daemon;
+    if (pthread_create(&daemon, NULL, runDaemonThread, &run) != 0) {
+        printf("FAIL: cannot start the daemon thread\n");
+        return 1;
+    }
+    testPipelined(socketPath, registry);
+    testBadRequests(socketPath);
+    testDocumentEdits(socketPath, registry);
+    measureLatency(socketPath);
+    
+    // SIGTERM ends the daemon's loop; it closes what is still open and removes the socket
+    pthread_kill(daemon, SIGTERM);
+    pthread_join(daemon, NULL);
+    if (run.status != 0) fail("shutdown: runDaemon did not return 0");
+    if (access(socketPath, F_OK) == 0) fail("shutdown: the socket was left behind");
+    rmdir(dir);
+    freeGrammarRegistry(registry);
+    
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
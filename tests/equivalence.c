@@ -0,0 +1,475 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ll1.h"
+#include "parser.h"
+#include "bytecode.h"
+#include "lockstep.h"
+#include "pipeline.h"
+#include "incremental.h"
+#include "generate.h"
+
+// Equivalence tests: every way of running a table has to agree with parseInput. For each grammar,
+// inputs derived from it and then mutated are parsed by every engine; a document is edited from
+// each input to the next a byte at a time. On accepted inputs, the actions dispatched have to be
+// the tagged productions of the tree, expanded in preorder and completed in postorder. Inputs many
+// times the size of the pipelined parser's token ring are parsed by it too. Prints every
+// disagreement and exits 1 if there was one
+
+#define INPUTS_PER_GRAMMAR 3000
+#define MAX_INPUT 160            // Generated inputs stop growing once this long
+#define MAX_REPORTED 10          // Failures printed per grammar; the rest are only counted
+#define LONG_INPUT (8 * TOKEN_RING_SIZE)  // Operands in the long pipelined inputs
+
+typedef struct {
+    const char* name;
+    const char* text;
+    const char* alphabet;        // Bytes mutations insert or substitute
+    const char* fixedInputs[4];  // Inputs always tried, before the generated ones
+} TestGrammar;
+
+// The engines under test, all built from one grammar
+typedef struct {
+    const TestGrammar* grammar;
+    GrammarAnalysis* analysis;
+    CompiledTable* compiled;
+    CompiledTable* compressed;
+    CompiledTable* lazy;         // NULL for a table with decisions, which lazy tables do not decide
+    BytecodeProgram* program;
+    LockstepTable* lockstep;     // NULL where lockstep parsing does not apply
+    ParseTree tree;
+    Document document;
+    InputGenerator generator;
+    char (*batch)[4 * MAX_INPUT];  // Every input, parsed in lockstep once they are all generated
+    int* lengths;
+    ParseResult* expected;
+    int inputs;
+    int accepted;
+    int failures;
+} TestRun;
+
+// One callback of parseInputActions, or of the walk of a tree that stands for it
+typedef struct {
+    bool complete;
+    int production;
+    int offset;
+} ActionEvent;
+
+typedef struct {
+    ActionEvent* events;
+    int numEvents;
+    int capacity;
+} ActionLog;
+
+static const TestGrammar grammars[] = {
+    // Operator loops, and the table walk of the same levels
+    {"expression", "E -> E+T | E-T | T\nT -> T*F | T/F | F\nF -> (E) | i\n", "i+-*/()",
+     {"i+i*i-i/i", "((i))", "i+", ""}},
+    // EBNF repetitions, desugared into tail rules the parsers run in place, and an entry point
+    {"ebnf", "S ::= E (\";\" E)*\nE ::= T ((\"+\" | \"-\") T)*\nT ::= i | \"(\" E \")\"\n%entry E T\n", "i+-();",
+     {"i;i+(i-i)", "i+i;", ";", NULL}},
+    // Contested cells decided by lookahead
+    {"assignment", "P -> S ; P | ε\nS -> L = E | E\nL -> i | * E\nE -> L | n | ( E )\n", ";=i*n()",
+     {"*i=n;i;", "**i=*i;(n);", "i=", NULL}},
+    {"lists", "S -> X ; S | ε\nX -> A a | B b | C\nA -> i A | j\nB -> i B | k\nC -> i i c\n", ";abcijk",
+     {"iiiija;iik b;iic;", "iiiiiiiij a;", "iii", NULL}},
+    // Keywords next to identifier runs, including runs too long to be keywords
+    {"keywords", "S -> \"if\" c | B\nB -> i f A\nA -> a A | ε\n", "ifac ",
+     {"if c", "i f aaaaaaaaaaaaaaaaaaaaaaaaa", "ifaaaaaaaaaaaaaaaaaaaa", "ifc"}},
+    // Expansions longer than one lockstep block
+    {"long", "S -> a b c d e f g h i j S | x\n", "abcdefghijx",
+     {"abcdefghijabcdefghijx", "abcdx", "x", NULL}},
+    // Action tags on left recursion, on tail rules and on ε
+    {"actions", "S -> E ; S @stmt | ε\nE -> E + T @add | T\nT -> i @id | ( E ) @group | [ L ]\nL -> i L @item | ε @end\n",
+     "i+;()[]", {"i+(i+i);[ii];", "[];i;", "(i", NULL}},
+};
+
+// Function prototypes
+void reportFailure(TestRun* run, const char* check, const char* input, int length);
+int generateInput(TestRun* run, char* out);
+bool sameResult(ParseResult a, ParseResult b);
+void checkEngines(TestRun* run, const char* input, int length, ParseResult expected);
+void checkPushParser(TestRun* run, const char* input, int length, ParseResult expected);
+void logAction(ActionLog* log, bool complete, int production, int offset);
+void logExpand(void* context, int production, int offset);
+void logComplete(void* context, int production, int offset);
+void walkTreeActions(const TestRun* run, int node, const ParseActions* actions, const Token* tokens, const int* ends,
+                     int* numMatched, ActionLog* log);
+void checkActions(TestRun* run, const char* input, int length);
+void checkLockstep(TestRun* run);
+bool sameDocumentTrees(const Document* a, int nodeA, const Document* b, int nodeB);
+void checkDocument(TestRun* run);
+void editDocumentTo(TestRun* run, const char* input, int length);
+bool setUpRun(TestRun* run, const TestGrammar* grammar);
+void tearDownRun(TestRun* run);
+int testGrammar(const TestGrammar* grammar);
+int testLongPipelined(void);
+
+void reportFailure(TestRun* run, const char* check, const char* input, int length) {
+    if (run->failures++ < MAX_REPORTED) {
+        printf("FAIL %s: %s differs on \"%.*s\"\n", run->grammar->name, check, length, input);
+    }
+}
+
+// A derivation of the start symbol with up to two bytes inserted, deleted or replaced
+int generateInput(TestRun* run, char* out) {
+    int length = generateDerivation(&run->generator, run->compiled->startSymbol, out);
+    return mutateInput(out, length, run->grammar->alphabet, rand() % 3);
+}
+
+bool sameResult(ParseResult a, ParseResult b) {
+    return a.accepted == b.accepted && a.errorOffset == b.errorOffset;
+}
+
+// Every whole-input engine against parseInput
+void checkEngines(TestRun* run, const char* input, int length, ParseResult expected) {
+    const CompiledTable* compiled = run->compiled;
+    ParseResult result = parseInputTree(compiled, input, length, &run->tree);
+    if (!sameResult(result, expected)) reportFailure(run, "parseInputTree (table walk)", input, length);
+
+    ParseProfile* profile = createParseProfile(compiled);
+    result = parseInputProfile(compiled, input, length, profile);
+    if (!sameResult(result, expected)) reportFailure(run, "parseInputProfile (table walk)", input, length);
+    freeParseProfile(profile);
+
+    ParseActions actions = {NULL, NULL, NULL};
+    result = parseInputActions(compiled, input, length, &actions);
+    if (!sameResult(result, expected)) reportFailure(run, "parseInputActions", input, length);
+    if (expected.accepted) checkActions(run, input, length);
+    
+    result = parseInputPipelined(compiled, input, length);
+    if (!sameResult(result, expected) || result.numTokens != expected.numTokens) {
+        reportFailure(run, "parseInputPipelined", input, length);
+    }
+
+    ParseErrors errors;
+    result = parseInputRecover(compiled, input, length, &errors);
+    if (!sameResult(result, expected)) reportFailure(run, "parseInputRecover", input, length);
+
+    result = parseInputBytecode(run->program, input, length);
+    if (!sameResult(result, expected) || result.numTokens != expected.numTokens) {
+        reportFailure(run, "parseInputBytecode", input, length);
+    }
+
+    result = parseInput(run->compressed, input, length);
+    if (!sameResult(result, expected) || result.numTokens != expected.numTokens) {
+        reportFailure(run, "compressed table", input, length);
+    }
+
+    if (run->lazy != NULL && parseInputLazy(run->lazy, 0, input, length).accepted != expected.accepted) {
+        reportFailure(run, "lazy table", input, length);
+    }
+
+    // Fragments from each entry point, table against bytecode and the lazy table
+    for (int e = 1; e < compiled->numEntryPoints; e++) {
+        ParseResult table = parseInputFrom(compiled, e, input, length);
+        if (!sameResult(parseInputBytecodeFrom(run->program, e, input, length), table)) {
+            reportFailure(run, "parseInputBytecodeFrom", input, length);
+        }
+        if (run->lazy != NULL && parseInputLazy(run->lazy, e, input, length).accepted != table.accepted) {
+            reportFailure(run, "parseInputLazy from an entry point", input, length);
+        }
+    }
+}
+
+void logAction(ActionLog* log, bool complete, int production, int offset) {
+    if (log->numEvents == log->capacity) {
+        log->capacity = log->capacity > 0 ? 2 * log->capacity : 64;
+        log->events = realloc(log->events, log->capacity * sizeof(ActionEvent));
+    }
+    log->events[log->numEvents++] = (ActionEvent){complete, production, offset};
+}
+
+void logExpand(void* context, int production, int offset) {
+    logAction((ActionLog*)context, false, production, offset);
+}
+
+void logComplete(void* context, int production, int offset) {
+    logAction((ActionLog*)context, true, production, offset);
+}
+
+// The callbacks actions would get for the subtree at node, from the tree alone: a tagged production
+// is expanded at the lookahead, the first token not matched before it, and completed just past the
+// last token matched at its end, or at 0 before any. tokens and ends are the input's tokens and
+// their end offsets, and *numMatched counts the tokens walked so far
+void walkTreeActions(const TestRun* run, int node, const ParseActions* actions, const Token* tokens, const int* ends,
+                     int* numMatched, ActionLog* log) {
+    const TreeNode* n = &run->tree.nodes[node];
+    if (n->symbol < run->compiled->numTerminals) {
+        (*numMatched)++;
+        return;
+    }
+    int action = run->compiled->productionAction[n->production];
+    if (action != -1 && actions->expand != NULL && actions->expand[action] != NULL) {
+        logAction(log, false, n->production, tokens[*numMatched].offset);
+    }
+    for (int child = n->firstChild; child != -1; child = run->tree.nodes[child].nextSibling) {
+        walkTreeActions(run, child, actions, tokens, ends, numMatched, log);
+    }
+    if (action != -1 && actions->complete != NULL && actions->complete[action] != NULL) {
+        logAction(log, true, n->production, *numMatched > 0 ? ends[*numMatched - 1] : 0);
+    }
+}
+
+// Actions dispatched on an accepted input against the walk of its tree, with every callback set,
+// with expand callbacks alone (which lets tagged tail rules run in place), and with the callbacks
+// of every other tag alone
+void checkActions(TestRun* run, const char* input, int length) {
+    const CompiledTable* compiled = run->compiled;
+    if (compiled->numActions == 0 || !parseInputTree(compiled, input, length, &run->tree).accepted) return;
+    Token tokens[2 * MAX_INPUT + 8];
+    int ends[2 * MAX_INPUT + 8];
+    int numTokens = 0;
+    int pos = 0;
+    do {
+        tokens[numTokens].token = nextToken(compiled, input, length, &pos, &tokens[numTokens].offset);
+        ends[numTokens] = pos;
+    } while (tokens[numTokens++].token != compiled->endMarker);
+    
+    ActionCallback* expand = malloc(compiled->numActions * sizeof(ActionCallback));
+    ActionCallback* complete = malloc(compiled->numActions * sizeof(ActionCallback));
+    for (int configuration = 0; configuration < 3; configuration++) {
+        for (int a = 0; a < compiled->numActions; a++) {
+            bool set = configuration != 2 || a % 2 == 0;
+            expand[a] = set ? logExpand : NULL;
+            complete[a] = set ? logComplete : NULL;
+        }
+        ActionLog dispatched = {NULL, 0, 0}, walked = {NULL, 0, 0};
+        ParseActions actions = {expand, configuration == 1 ? NULL : complete, &dispatched};
+        parseInputActions(compiled, input, length, &actions);
+        int numMatched = 0;
+        walkTreeActions(run, 0, &actions, tokens, ends, &numMatched, &walked);
+        bool same = dispatched.numEvents == walked.numEvents;
+        for (int i = 0; i < walked.numEvents && same; i++) {
+            same = dispatched.events[i].complete == walked.events[i].complete &&
+                   dispatched.events[i].production == walked.events[i].production &&
+                   dispatched.events[i].offset == walked.events[i].offset;
+        }
+        if (!same) {
+            reportFailure(run, configuration == 0 ? "actions dispatched" : configuration == 1 ? "expand actions dispatched"
+                               : "actions of every other tag dispatched", input, length);
+        }
+        free(dispatched.events);
+        free(walked.events);
+    }
+    free(expand);
+    free(complete);
+}
+
+// The push parser fed the input in two chunks split at every byte, and as lexed tokens
+void checkPushParser(TestRun* run, const char* input, int length, ParseResult expected) {
+    PushParser* parser = malloc(sizeof(PushParser));
+    for (int split = 0; split <= length; split++) {
+        initPushParser(parser, run->compiled);
+        pushParserBytes(parser, input, split);
+        pushParserBytes(parser, input + split, length - split);
+        PushStatus status = finishPushParser(parser);
+        if ((status == PUSH_ACCEPTED) != expected.accepted || (!expected.accepted && parser->errorOffset != expected.errorOffset)) {
+            reportFailure(run, "push parser split into two chunks", input, length);
+            break;
+        }
+    }
+
+    Token tokens[2 * MAX_INPUT + 8];
+    int numTokens = 0;
+    int pos = 0;
+    do {
+        tokens[numTokens].token = nextToken(run->compiled, input, length, &pos, &tokens[numTokens].offset);
+    } while (tokens[numTokens++].token != run->compiled->endMarker);
+    initPushParser(parser, run->compiled);
+    pushParserTokens(parser, tokens, numTokens);
+    if ((finishPushParser(parser) == PUSH_ACCEPTED) != expected.accepted) {
+        reportFailure(run, "push parser fed tokens", input, length);
+    }
+    free(parser);
+}
+
+// Every input of the run in one lockstep batch, each lane's result against parseInput's
+void checkLockstep(TestRun* run) {
+    if (run->lockstep == NULL) return;
+    const char** inputs = malloc(run->inputs * sizeof(char*));
+    ParseResult* results = malloc(run->inputs * sizeof(ParseResult));
+    for (int i = 0; i < run->inputs; i++) {
+        inputs[i] = run->batch[i];
+    }
+    parseInputsLockstep(run->lockstep, inputs, run->lengths, run->inputs, results);
+    for (int i = 0; i < run->inputs; i++) {
+        if (!sameResult(results[i], run->expected[i]) || results[i].numTokens != run->expected[i].numTokens) {
+            reportFailure(run, "parseInputsLockstep", inputs[i], run->lengths[i]);
+        }
+    }
+    free(inputs);
+    free(results);
+}
+
+bool sameDocumentTrees(const Document* a, int nodeA, const Document* b, int nodeB) {
+    const DocumentNode* x = &a->nodes[nodeA];
+    const DocumentNode* y = &b->nodes[nodeB];
+    if (x->symbol != y->symbol || x->production != y->production || x->numTokens != y->numTokens) return false;
+    int childA = x->firstChild, childB = y->firstChild;
+    while (childA != -1 && childB != -1) {
+        if (!sameDocumentTrees(a, childA, b, childB)) return false;
+        childA = a->nodes[childA].nextSibling;
+        childB = b->nodes[childB].nextSibling;
+    }
+    return childA == childB;
+}
+
+// The edited document against one opened on its text: same result, tokens and tree
+void checkDocument(TestRun* run) {
+    Document* document = &run->document;
+    Document fresh;
+    openDocument(&fresh, run->compiled, document->text, document->length);
+    bool same = sameResult(fresh.result, document->result) && fresh.numTokens == document->numTokens;
+    for (int i = 0; i < fresh.numTokens && same; i++) {
+        DocumentToken a = documentToken(&fresh, i), b = documentToken(document, i);
+        same = a.terminal == b.terminal && a.offset == b.offset && a.end == b.end;
+    }
+    if (same && fresh.result.accepted) same = sameDocumentTrees(&fresh, fresh.root, document, document->root);
+    if (!same || !sameResult(document->result, parseInput(run->compiled, document->text, document->length))) {
+        reportFailure(run, "edited document", document->text, document->length);
+    }
+    closeDocument(&fresh);
+}
+
+// Turn the document's text into input: delete the bytes that differ a byte at a time, then insert
+// the new ones, checking the document after every edit, valid or not
+void editDocumentTo(TestRun* run, const char* input, int length) {
+    Document* document = &run->document;
+    int prefix = 0, suffix = 0;
+    while (prefix < length && prefix < document->length && document->text[prefix] == input[prefix]) prefix++;
+    while (suffix < length - prefix && suffix < document->length - prefix &&
+           document->text[document->length - 1 - suffix] == input[length - 1 - suffix]) {
+        suffix++;
+    }
+    while (document->length > prefix + suffix) {
+        editDocument(document, prefix, 1, "", 0);
+        checkDocument(run);
+    }
+    for (int i = prefix; i < length - suffix; i++) {
+        editDocument(document, i, 0, input + i, 1);
+        checkDocument(run);
+    }
+}
+
+bool setUpRun(TestRun* run, const TestGrammar* grammar) {
+    memset(run, 0, sizeof(TestRun));
+    run->grammar = grammar;
+    run->analysis = analyzeGrammar(readGrammarFromString(grammar->text), 1);
+    if (run->analysis == NULL) return false;
+    const Grammar* simplified = &run->analysis->simplified;
+    run->compiled = compileParseTable(simplified, &run->analysis->parseTable, run->analysis->followSets);
+    run->compressed = compileParseTable(simplified, &run->analysis->parseTable, run->analysis->followSets);
+    if (run->compiled == NULL || run->compressed == NULL) return false;
+    compressCompiledTable(run->compressed);
+    if (run->compiled->numDecisions == 0) run->lazy = compileLazyParseTable(simplified);
+    run->program = compileBytecode(run->compiled);
+    run->lockstep = compileLockstepTable(run->compiled);
+    run->batch = malloc(INPUTS_PER_GRAMMAR * sizeof(*run->batch));
+    run->lengths = malloc(INPUTS_PER_GRAMMAR * sizeof(int));
+    run->expected = malloc(INPUTS_PER_GRAMMAR * sizeof(ParseResult));
+    if (run->program == NULL || run->batch == NULL || run->lengths == NULL || run->expected == NULL) return false;
+    if (run->compiled->numDecisions == 0 && run->lockstep == NULL) return false;
+    initParseTree(&run->tree);
+    initInputGenerator(&run->generator, run->compiled, MAX_INPUT);
+    return openDocument(&run->document, run->compiled, "", 0);
+}
+
+void tearDownRun(TestRun* run) {
+    closeDocument(&run->document);
+    freeParseTree(&run->tree);
+    freeInputGenerator(&run->generator);
+    freeBytecode(run->program);
+    freeLockstepTable(run->lockstep);
+    free(run->batch);
+    free(run->lengths);
+    free(run->expected);
+    freeCompiledTable(run->lazy);
+    freeCompiledTable(run->compressed);
+    freeCompiledTable(run->compiled);
+    freeGrammarAnalysis(run->analysis);
+}
+
+// Failures found on one grammar
+int testGrammar(const TestGrammar* grammar) {
+    TestRun* run = malloc(sizeof(TestRun));
+    if (!setUpRun(run, grammar)) {
+        printf("FAIL %s: the grammar did not compile\n", grammar->name);
+        free(run);
+        return 1;
+    }
+
+    char input[4 * MAX_INPUT];
+    for (int i = 0; i < INPUTS_PER_GRAMMAR; i++) {
+        int length;
+        if (i < 4 && grammar->fixedInputs[i] != NULL) {
+            length = strlen(grammar->fixedInputs[i]);
+            memcpy(input, grammar->fixedInputs[i], length);
+        } else {
+            length = generateInput(run, input);
+        }
+
+        ParseResult expected = parseInput(run->compiled, input, length);
+        memcpy(run->batch[run->inputs], input, length);
+        run->lengths[run->inputs] = length;
+        run->expected[run->inputs] = expected;
+        run->inputs++;
+        if (expected.accepted) run->accepted++;
+        checkEngines(run, input, length, expected);
+        checkPushParser(run, input, length, expected);
+        editDocumentTo(run, input, length);
+    }
+    checkLockstep(run);
+
+    printf("%-10s %d inputs, %d accepted, %d decisions, %d operator loops: %s\n", grammar->name, run->inputs,
+           run->accepted, run->compiled->numDecisions, run->compiled->numOperatorLoops,
+           run->failures == 0 ? "all engines agree" : "FAILED");
+    int failures = run->failures;
+    tearDownRun(run);
+    free(run);
+    return failures;
+}
+
+// An expression of LONG_INPUT operands through the pipelined parser, whole and with an error put
+// in early, at each ring wrap and in the last batch, against parseInput
+int testLongPipelined(void) {
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString(grammars[0].text), 1);
+    CompiledTable* compiled = analysis == NULL ? NULL
+                            : compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    int length = 2 * LONG_INPUT - 1;
+    char* input = malloc(length);
+    static const char operators[] = "+-*/";
+    for (int i = 0; i < length; i++) {
+        input[i] = i % 2 == 0 ? 'i' : operators[i / 2 % 4];
+    }
+    int failures = compiled == NULL ? 1 : 0;
+    int checked = 0;
+    for (int error = -1; compiled != NULL && error < length; error += error < 0 ? 5 : TOKEN_RING_SIZE - 1) {
+        if (error >= 0) input[error] = ')';
+        ParseResult expected = parseInput(compiled, input, length);
+        ParseResult result = parseInputPipelined(compiled, input, length);
+        if (!sameResult(result, expected) || result.numTokens != expected.numTokens ||
+            expected.accepted != (error < 0)) {
+            printf("FAIL pipelined: parseInputPipelined differs with an error at %d\n", error);
+            failures++;
+        }
+        if (error >= 0) input[error] = error % 2 == 0 ? 'i' : operators[error / 2 % 4];
+        checked++;
+    }
+    printf("%-10s %d inputs of %d tokens: %s\n", "pipelined", checked, length + 1,
+           failures == 0 ? "pipelined parses agree" : "FAILED");
+    free(input);
+    freeCompiledTable(compiled);
+    freeGrammarAnalysis(analysis);
+    return failures;
+}
+
+int main(void) {
+    srand(1);
+    int failures = testLongPipelined();
+    for (size_t g = 0; g < sizeof(grammars) / sizeof(grammars[0]); g++) {
+        failures += testGrammar(&grammars[g]);
+    }
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
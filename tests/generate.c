@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "generate.h"
+
+#define MAX_DERIVATION_DEPTH 12  // Deeper than this, derivations pick the shortest productions
+
+// Function prototypes
+int productionMinLength(const InputGenerator* generator, int production);
+int generateSymbol(const InputGenerator* generator, int symbol, int depth, char* out, int length);
+
+int terminalSpelling(const CompiledTable* compiled, int terminal, const char** spelling) {
+    const char* name = compiled->terminalNames[terminal];
+    int length = strlen(name);
+    if (length > 1 && name[0] == '"') {
+        *spelling = name + 1;
+        return length - 2;
+    }
+    *spelling = name;
+    return length;
+}
+
+// Fewest bytes a production derives, given the non-terminals' so far
+int productionMinLength(const InputGenerator* generator, int production) {
+    const CompiledTable* compiled = generator->compiled;
+    const int* rhs = compiled->rhsSymbols + compiled->productionStart[production];
+    int length = 0;
+    for (int i = 0; i < compiled->productionLength[production]; i++) {
+        const char* spelling;
+        length += rhs[i] < compiled->numTerminals ? terminalSpelling(compiled, rhs[i], &spelling) + 1
+                                                  : generator->minLength[rhs[i] - compiled->numTerminals];
+    }
+    return length;
+}
+
+// Fewest bytes each non-terminal derives, to a fixed point over the productions
+void initInputGenerator(InputGenerator* generator, const CompiledTable* compiled, int maxLength) {
+    generator->compiled = compiled;
+    generator->maxLength = maxLength;
+    generator->minLength = malloc(compiled->numNonTerminals * sizeof(int));
+    for (int n = 0; n < compiled->numNonTerminals; n++) {
+        generator->minLength[n] = maxLength;
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int p = 0; p < compiled->numProductions; p++) {
+            int length = productionMinLength(generator, p);
+            int lhs = compiled->productionLhs[p];
+            if (length < generator->minLength[lhs]) {
+                generator->minLength[lhs] = length;
+                changed = true;
+            }
+        }
+    }
+}
+
+void freeInputGenerator(InputGenerator* generator) {
+    free(generator->minLength);
+    generator->minLength = NULL;
+}
+
+// Append a derivation of symbol to out, which holds length bytes; the new length
+int generateSymbol(const InputGenerator* generator, int symbol, int depth, char* out, int length) {
+    const CompiledTable* compiled = generator->compiled;
+    if (symbol < compiled->numTerminals) {
+        const char* spelling;
+        int n = terminalSpelling(compiled, symbol, &spelling);
+        if (length > 0 && isalnum((unsigned char)out[length - 1]) && isalnum((unsigned char)spelling[0])) {
+            out[length++] = ' ';
+        }
+        memcpy(out + length, spelling, n);
+        return length + n;
+    }
+    
+    // Past the depth limit or the length limit, only the productions deriving the fewest bytes
+    int nonTerminal = symbol - compiled->numTerminals;
+    bool shortest = depth > MAX_DERIVATION_DEPTH || length > generator->maxLength;
+    int chosen = -1, seen = 0;
+    for (int p = 0; p < compiled->numProductions; p++) {
+        if (compiled->productionLhs[p] != nonTerminal) continue;
+        if (shortest && productionMinLength(generator, p) > generator->minLength[nonTerminal]) continue;
+        if (rand() % ++seen == 0) chosen = p;
+    }
+    if (chosen == -1) return length;
+    
+    const int* rhs = compiled->rhsSymbols + compiled->productionStart[chosen];
+    for (int i = 0; i < compiled->productionLength[chosen] && length < 2 * generator->maxLength; i++) {
+        length = generateSymbol(generator, rhs[i], depth + 1, out, length);
+    }
+    return length;
+}
+
+int generateDerivation(const InputGenerator* generator, int symbol, char* out) {
+    return generateSymbol(generator, symbol, 0, out, 0);
+}
+
+int mutateInput(char* input, int length, const char* alphabet, int numMutations) {
+    for (int m = 0; m < numMutations; m++) {
+        int at = rand() % (length + 1);
+        int kind = rand() % 3;
+        if (kind == 0 || at == length) {
+            memmove(input + at + 1, input + at, length - at);
+            input[at] = alphabet[rand() % strlen(alphabet)];
+            length++;
+        } else if (kind == 1) {
+            memmove(input + at, input + at + 1, length - at - 1);
+            length--;
+        } else {
+            input[at] = alphabet[rand() % strlen(alphabet)];
+        }
+    }
+    return length;
+}
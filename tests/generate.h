@@ -0,0 +1,27 @@
+#ifndef GENERATE_H
+#define GENERATE_H
+
+#include "parser.h"
+
+// Random inputs for the tests: derivations of a compiled table's productions, optionally mutated
+
+typedef struct {
+    const CompiledTable* compiled;
+    int* minLength;              // Fewest bytes each non-terminal derives
+    int maxLength;               // Derivations stop growing once this long
+} InputGenerator;
+
+void initInputGenerator(InputGenerator* generator, const CompiledTable* compiled, int maxLength);
+void freeInputGenerator(InputGenerator* generator);
+
+// A random derivation of a stack symbol, written to out, which must hold 3 * maxLength bytes; its length.
+// Word bytes from two tokens are kept apart by a space, so the tokens lex as derived
+int generateDerivation(const InputGenerator* generator, int symbol, char* out);
+
+// Insert, delete or replace numMutations random bytes, inserted bytes taken from alphabet; the new length
+int mutateInput(char* input, int length, const char* alphabet, int numMutations);
+
+// Bytes of a terminal's spelling, quotes stripped
+int terminalSpelling(const CompiledTable* compiled, int terminal, const char** spelling);
+
+#endif
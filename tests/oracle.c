@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ll1.h"
+#include "parser.h"
+#include "generate.h"
+
+// Oracle tests: the parsers are checked against an Earley recognizer of each grammar as it was
+// written, before left factoring, left recursion removal and simplification, so a transformation
+// that changes the language shows up as well as a parser that strays from its table. Inputs are
+// derivations of both the written and the simplified grammar, some of them mutated. Without
+// conflicts, parseInput (with its operator loops) and parseInputTree (the table walk) have to
+// accept exactly the inputs in the language; with decisions, whose lookahead is bounded, whatever
+// they accept has to be in it. parseInputFrom is held to the same from each entry point, against
+// the language of the non-terminal it names. Prints every failure and exits 1 if there was one
+
+#define INPUTS 3000              // Per grammar
+#define MAX_INPUT 48             // Generated inputs stop growing once this long
+#define MAX_REPORTED 10
+
+typedef struct {
+    const char* name;
+    const char* text;
+    const char* alphabet;        // Bytes mutations insert
+} TestGrammar;
+
+typedef struct {
+    int production;
+    int dot;                     // Symbols of the production recognized so far
+    int origin;                  // Set the item was predicted in
+} EarleyItem;
+
+typedef struct {
+    EarleyItem* items;
+    int numItems;
+    int capacity;
+} EarleySet;
+
+// The grammar as written, numbered the way compiled tables number symbols and productions
+typedef struct {
+    CompiledTable* grammar;
+    bool* nullable;              // Per non-terminal
+    int* itemBase;               // Per production, the number of its first dotted item
+    int numItems;
+    int* byLhsStart;             // Per non-terminal, the offset of its productions in byLhs
+    int* byLhs;
+} Recognizer;
+
+typedef struct {
+    const TestGrammar* grammar;
+    GrammarAnalysis* analysis;
+    CompiledTable* compiled;
+    Recognizer recognizer;
+    int inputs;
+    int inLanguage;
+    int accepted;
+    int failures;
+} TestRun;
+
+static const TestGrammar grammars[] = {
+    // Operator loops: levels of left-associative operators, and right-associative ones beside them
+    {"expression", "E -> E+T | E-T | T\nT -> T*F | T/F | F\nF -> (E) | i\n", "i+-*/()"},
+    {"levels", "C -> C<A | C=A | A\nA -> A+M | A-M | M\nM -> M*U | M%U | U\nU -> -U | (C) | i | n\n%entry M U\n",
+     "<=+-*%()in"},
+    {"power", "E -> E+T | T\nT -> F^T | F\nF -> (E) | i\n", "i+^()"},
+    // EBNF repetitions, and entry points at a repetition and below it
+    {"ebnf", "S ::= E (\";\" E)*\nE ::= T ((\"+\" | \"-\") T)*\nT ::= i | \"(\" E \")\"\n%entry E T\n", "i+-();"},
+    // Keywords next to identifier runs
+    {"keywords", "S -> \"if\" c | B\nB -> i f A\nA -> a A | ε\n", "ifac "},
+    {"statements", "P -> S P | ε\nS -> \"while\" E \"do\" S | i = E ; | { P }\nE -> E + i | i\n%entry S E\n",
+     "whiledo=;{}+ "},
+    // Action tags, ε in the middle of productions, and an entry point that only ] follows otherwise
+    {"actions", "S -> E ; S @stmt | ε\nE -> E + T @add | T\nT -> i @id | ( E ) @group | [ L ]\nL -> i L @item | ε @end\n%entry L T\n",
+     "i+;()[]"},
+    // Contested cells decided by lookahead
+    {"assignment", "P -> S ; P | ε\nS -> L = E | E\nL -> i | * E\nE -> L | n | ( E )\n", ";=i*n()"},
+    {"lists", "S -> X ; S | ε\nX -> A a | B b | C\nA -> i A | j\nB -> i B | k\nC -> i i c\n", ";abcijk"},
+    // Indirect left recursion, which the transformations leave in place for decisions to try
+    {"indirect", "S -> A a | b\nA -> A c | S d | ε\n", "abcd"},
+};
+
+#define NUM_GRAMMARS (int)(sizeof(grammars) / sizeof(grammars[0]))
+
+// Function prototypes
+bool initRecognizer(Recognizer* recognizer, const Grammar* grammar);
+void freeRecognizer(Recognizer* recognizer);
+int lexInput(const CompiledTable* grammar, const char* input, int length, int* tokens);
+void addItem(EarleySet* sets, int* seen, const Recognizer* recognizer, int set, int production, int dot, int origin);
+bool earleyAccepts(const Recognizer* recognizer, int nonTerminal, const char* input, int length);
+void reportFailure(TestRun* run, const char* check, const char* input, int length);
+void checkInput(TestRun* run, const char* input, int length);
+int checkEntryPoints(TestRun* run, const InputGenerator* written, const InputGenerator* simplified);
+int testGrammar(const TestGrammar* grammar);
+
+// Number the grammar's symbols and productions, and find its nullable non-terminals by a fixed point
+bool initRecognizer(Recognizer* recognizer, const Grammar* grammar) {
+    memset(recognizer, 0, sizeof(*recognizer));
+    recognizer->grammar = compileLazyParseTable(grammar);
+    if (recognizer->grammar == NULL) return false;
+    const CompiledTable* g = recognizer->grammar;
+    recognizer->nullable = calloc(g->numNonTerminals, sizeof(bool));
+    recognizer->itemBase = malloc(g->numProductions * sizeof(int));
+    recognizer->byLhsStart = calloc(g->numNonTerminals + 1, sizeof(int));
+    recognizer->byLhs = malloc(g->numProductions * sizeof(int));
+    for (int p = 0; p < g->numProductions; p++) {
+        recognizer->itemBase[p] = recognizer->numItems;
+        recognizer->numItems += g->productionLength[p] + 1;
+        recognizer->byLhsStart[g->productionLhs[p] + 1]++;
+    }
+    for (int n = 0; n < g->numNonTerminals; n++) {
+        recognizer->byLhsStart[n + 1] += recognizer->byLhsStart[n];
+    }
+    int* filled = calloc(g->numNonTerminals, sizeof(int));
+    for (int p = 0; p < g->numProductions; p++) {
+        int lhs = g->productionLhs[p];
+        recognizer->byLhs[recognizer->byLhsStart[lhs] + filled[lhs]++] = p;
+    }
+    free(filled);
+    
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int p = 0; p < g->numProductions; p++) {
+            const int* rhs = g->rhsSymbols + g->productionStart[p];
+            bool nullable = true;
+            for (int i = 0; i < g->productionLength[p] && nullable; i++) {
+                nullable = rhs[i] >= g->numTerminals && recognizer->nullable[rhs[i] - g->numTerminals];
+            }
+            if (nullable && !recognizer->nullable[g->productionLhs[p]]) {
+                recognizer->nullable[g->productionLhs[p]] = changed = true;
+            }
+        }
+    }
+    return true;
+}
+
+void freeRecognizer(Recognizer* recognizer) {
+    freeCompiledTable(recognizer->grammar);
+    free(recognizer->nullable);
+    free(recognizer->itemBase);
+    free(recognizer->byLhsStart);
+    free(recognizer->byLhs);
+}
+
+// The input's terminals, without $; -1 if a byte is no terminal's
+int lexInput(const CompiledTable* grammar, const char* input, int length, int* tokens) {
+    int pos = 0, start, numTokens = 0;
+    for (;;) {
+        int token = nextToken(grammar, input, length, &pos, &start);
+        if (token < 0) return -1;
+        if (token == grammar->endMarker) return numTokens;
+        tokens[numTokens++] = token;
+    }
+}
+
+// Add an item to a set unless the set has it; seen[item * sets + origin] is the last set it went to.
+// Items with a terminal before the dot only come from scanning, into the next set, and every other
+// item only into the set being worked on, so the last set is all an item needs to remember
+void addItem(EarleySet* sets, int* seen, const Recognizer* recognizer, int set, int production, int dot, int origin) {
+    int* last = &seen[(recognizer->itemBase[production] + dot) * (MAX_INPUT * 3 + 1) + origin];
+    if (*last == set) return;
+    *last = set;
+    EarleySet* s = &sets[set];
+    if (s->numItems == s->capacity) {
+        s->capacity = s->capacity == 0 ? 16 : 2 * s->capacity;
+        s->items = realloc(s->items, s->capacity * sizeof(EarleyItem));
+    }
+    s->items[s->numItems++] = (EarleyItem){production, dot, origin};
+}
+
+// Whether a non-terminal derives the input. Predicting a nullable non-terminal also steps over it,
+// so completions of ε within a set need no second pass (Aycock and Horspool)
+bool earleyAccepts(const Recognizer* recognizer, int nonTerminal, const char* input, int length) {
+    const CompiledTable* g = recognizer->grammar;
+    int tokens[MAX_INPUT * 3];
+    int numTokens = lexInput(g, input, length, tokens);
+    if (numTokens < 0) return false;
+    EarleySet* sets = calloc(numTokens + 1, sizeof(EarleySet));
+    int* seen = malloc(recognizer->numItems * (MAX_INPUT * 3 + 1) * sizeof(int));
+    memset(seen, 0xFF, recognizer->numItems * (MAX_INPUT * 3 + 1) * sizeof(int));
+    for (int i = recognizer->byLhsStart[nonTerminal]; i < recognizer->byLhsStart[nonTerminal + 1]; i++) {
+        addItem(sets, seen, recognizer, 0, recognizer->byLhs[i], 0, 0);
+    }
+    
+    for (int k = 0; k <= numTokens; k++) {
+        for (int i = 0; i < sets[k].numItems; i++) {
+            EarleyItem item = sets[k].items[i];
+            const int* rhs = g->rhsSymbols + g->productionStart[item.production];
+            if (item.dot < g->productionLength[item.production]) {
+                int symbol = rhs[item.dot];
+                if (symbol < g->numTerminals) {
+                    if (k < numTokens && tokens[k] == symbol) {
+                        addItem(sets, seen, recognizer, k + 1, item.production, item.dot + 1, item.origin);
+                    }
+                    continue;
+                }
+                int predicted = symbol - g->numTerminals;
+                for (int j = recognizer->byLhsStart[predicted]; j < recognizer->byLhsStart[predicted + 1]; j++) {
+                    addItem(sets, seen, recognizer, k, recognizer->byLhs[j], 0, k);
+                }
+                if (recognizer->nullable[predicted]) {
+                    addItem(sets, seen, recognizer, k, item.production, item.dot + 1, item.origin);
+                }
+                continue;
+            }
+            // Complete: advance every item of the origin set waiting for this non-terminal
+            int completed = g->numTerminals + g->productionLhs[item.production];
+            for (int j = 0; j < sets[item.origin].numItems; j++) {
+                EarleyItem waiting = sets[item.origin].items[j];
+                if (waiting.dot < g->productionLength[waiting.production] &&
+                    g->rhsSymbols[g->productionStart[waiting.production] + waiting.dot] == completed) {
+                    addItem(sets, seen, recognizer, k, waiting.production, waiting.dot + 1, waiting.origin);
+                }
+            }
+        }
+    }
+    
+    bool accepted = false;
+    for (int i = 0; i < sets[numTokens].numItems; i++) {
+        EarleyItem item = sets[numTokens].items[i];
+        accepted = accepted || (item.origin == 0 && g->productionLhs[item.production] == nonTerminal &&
+                                item.dot == g->productionLength[item.production]);
+    }
+    for (int k = 0; k <= numTokens; k++) {
+        free(sets[k].items);
+    }
+    free(sets);
+    free(seen);
+    return accepted;
+}
+
+void reportFailure(TestRun* run, const char* check, const char* input, int length) {
+    if (run->failures++ < MAX_REPORTED) {
+        printf("FAIL %s: %s on \"%.*s\"\n", run->grammar->name, check, length, input);
+    }
+}
+
+// Both parsers against the recognizer, exactly or, with decisions, only for what they accept
+void checkInput(TestRun* run, const char* input, int length) {
+    const CompiledTable* oracle = run->recognizer.grammar;
+    bool inLanguage = earleyAccepts(&run->recognizer, oracle->startSymbol - oracle->numTerminals, input, length);
+    bool exact = run->analysis->parseTable.numConflicts == 0;
+    ParseTree tree;
+    initParseTree(&tree);
+    bool loops = parseInput(run->compiled, input, length).accepted;
+    bool walk = parseInputTree(run->compiled, input, length, &tree).accepted;
+    freeParseTree(&tree);
+    if (loops != inLanguage && (exact || loops)) {
+        reportFailure(run, loops ? "parseInput accepts outside the language" : "parseInput rejects a sentence", input, length);
+    }
+    if (walk != inLanguage && (exact || walk)) {
+        reportFailure(run, walk ? "parseInputTree accepts outside the language" : "parseInputTree rejects a sentence",
+                      input, length);
+    }
+    run->inputs++;
+    run->inLanguage += inLanguage;
+    run->accepted += loops;
+}
+
+// Fragments from each entry point, parsed by parseInputFrom and recognized from the written grammar's
+// non-terminal of the same name; the number checked
+int checkEntryPoints(TestRun* run, const InputGenerator* written, const InputGenerator* simplified) {
+    const CompiledTable* compiled = run->compiled;
+    const CompiledTable* oracle = run->recognizer.grammar;
+    char input[MAX_INPUT * 3 + 2];
+    int fragments = 0;
+    for (int e = 1; e < compiled->numEntryPoints; e++) {
+        const char* name = compiled->nonTerminalNames[compiled->entryPoints[e] - compiled->numTerminals];
+        int nonTerminal = -1;
+        for (int n = 0; n < oracle->numNonTerminals; n++) {
+            if (strcmp(oracle->nonTerminalNames[n], name) == 0) nonTerminal = n;
+        }
+        if (nonTerminal == -1) {
+            reportFailure(run, "an entry point the written grammar does not have", name, strlen(name));
+            continue;
+        }
+        bool exact = run->analysis->parseTable.numConflicts == 0;
+        for (int i = 0; i < INPUTS / 4; i++) {
+            int length = i % 2 == 0 ? generateDerivation(written, oracle->numTerminals + nonTerminal, input)
+                                    : generateDerivation(simplified, compiled->entryPoints[e], input);
+            if (i % 3 == 2) length = mutateInput(input, length, run->grammar->alphabet, 1 + rand() % 2);
+            if (length > MAX_INPUT * 3) length = MAX_INPUT * 3;
+            bool inLanguage = earleyAccepts(&run->recognizer, nonTerminal, input, length);
+            bool accepted = parseInputFrom(compiled, e, input, length).accepted;
+            if (accepted != inLanguage && (exact || accepted)) {
+                reportFailure(run, accepted ? "parseInputFrom accepts a non-fragment" : "parseInputFrom rejects a fragment",
+                              input, length);
+            }
+            fragments++;
+        }
+    }
+    return fragments;
+}
+
+// Half the inputs derived from the grammar as written, half from the simplified table, and one in
+// three of them mutated
+int testGrammar(const TestGrammar* grammar) {
+    TestRun run;
+    memset(&run, 0, sizeof(run));
+    run.grammar = grammar;
+    run.analysis = analyzeGrammar(readGrammarFromString(grammar->text), 1);
+    run.compiled = run.analysis == NULL ? NULL
+                 : compileParseTable(&run.analysis->simplified, &run.analysis->parseTable, run.analysis->followSets);
+    if (run.compiled == NULL || !initRecognizer(&run.recognizer, &run.analysis->original)) {
+        printf("FAIL %s: the grammar did not compile\n", grammar->name);
+        if (run.compiled != NULL) freeCompiledTable(run.compiled);
+        freeGrammarAnalysis(run.analysis);
+        return 1;
+    }
+    InputGenerator written, simplified;
+    initInputGenerator(&written, run.recognizer.grammar, MAX_INPUT);
+    initInputGenerator(&simplified, run.compiled, MAX_INPUT);
+    char input[MAX_INPUT * 3 + 2];  // A mutation may insert two bytes
+    for (int i = 0; i < INPUTS; i++) {
+        const InputGenerator* generator = i % 2 == 0 ? &written : &simplified;
+        int length = generateDerivation(generator, generator->compiled->startSymbol, input);
+        if (i % 3 == 2) length = mutateInput(input, length, grammar->alphabet, 1 + rand() % 2);
+        if (length > MAX_INPUT * 3) length = MAX_INPUT * 3;
+        checkInput(&run, input, length);
+    }
+    
+    printf("%-10s %d inputs, %d in the language, %d accepted: %s\n", grammar->name, run.inputs, run.inLanguage,
+           run.accepted, run.failures > 0 ? "FAILED"
+                       : run.analysis->parseTable.numConflicts == 0 ? "same language" : "accepted inputs in the language");
+    if (run.compiled->numEntryPoints > 1) {
+        int before = run.failures;
+        int fragments = checkEntryPoints(&run, &written, &simplified);
+        printf("%-10s %d fragments from %d entry points: %s\n", "", fragments, run.compiled->numEntryPoints - 1,
+               run.failures > before ? "FAILED" : "each entry point's language");
+    }
+    freeInputGenerator(&written);
+    freeInputGenerator(&simplified);
+    freeRecognizer(&run.recognizer);
+    freeCompiledTable(run.compiled);
+    freeGrammarAnalysis(run.analysis);
+    return run.failures;
+}
+
+int main(void) {
+    srand(1);
+    int failures = 0;
+    for (int g = 0; g < NUM_GRAMMARS; g++) {
+        failures += testGrammar(&grammars[g]);
+    }
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
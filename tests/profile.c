@@ -0,0 +1,379 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ll1.h"
+#include "parser.h"
+#include "profile.h"
+#include "generate.h"
+
+// Profile tests: parseInputProfile has to count exactly the expansions of the input's parse tree,
+// each production once per node it labels and each cell under the token the node was expanded on,
+// and has to accept what parseInputTree accepts. A profile written with writeParseProfile and read
+// back with readParseProfile has to give the same counts, and reading adds to what is there. Laid
+// out by that profile (orderGrammarByProfile), a table has to parse every input the same, to the
+// same tree under its new numbering, with what the parses used most numbered first. Prints every
+// failure and exits 1 if there was one
+
+#define INPUTS 2000              // Per grammar
+#define MAX_INPUT 40             // Generated inputs stop growing once this long
+#define MAX_REPORTED 10
+
+typedef struct {
+    const char* name;
+    const char* text;
+    const char* alphabet;        // Bytes mutations insert
+} TestGrammar;
+
+typedef struct {
+    const TestGrammar* grammar;
+    GrammarAnalysis* analysis;
+    CompiledTable* compiled;
+    ParseTree tree;
+    ParseProfile* single;        // The counts of one parse
+    ParseProfile* total;         // The counts of every parse
+    unsigned long long* cells;   // The counts one tree gives
+    unsigned long long* productions;
+    int* tokenAt;                // Terminal starting at each input offset, -1 where none does
+    char (*inputs)[MAX_INPUT * 3 + 2];  // Every input, for the laid-out table; a mutation may insert two bytes
+    int* lengths;
+    int failures;
+} TestRun;
+
+static const TestGrammar grammars[] = {
+    // Operator levels, which profiled parses expand by the table
+    {"expression", "E -> E+T | E-T | T\nT -> T*F | T/F | F\nF -> (E) | i\n", "i+-*/()"},
+    // EBNF repetitions, whose tail rules are expanded once per iteration
+    {"ebnf", "S ::= E (\";\" E)*\nE ::= T ((\"+\" | \"-\") T)*\nT ::= i | \"(\" E \")\"\n", "i+-();"},
+    // Tagged productions, named with their tags in profile files
+    {"actions", "S -> E ; S @stmt | ε\nE -> E + T @add | T\nT -> i @id | ( E ) @group | [ L ]\nL -> i L @item | ε @end\n",
+     "i+;()[]"},
+    // Contested cells, counted under the token that was looked up rather than the ones decided on
+    {"assignment", "P -> S ; P | ε\nS -> L = E | E\nL -> i | * E\nE -> L | n | ( E )\n", ";=i*n()"},
+    {"keywords", "S -> \"if\" c | B\nB -> i f A\nA -> a A | ε\n", "ifac "},
+};
+
+#define NUM_GRAMMARS (int)(sizeof(grammars) / sizeof(grammars[0]))
+
+// Function prototypes
+void reportFailure(TestRun* run, const char* check, const char* input, int length);
+void clearParseProfile(ParseProfile* profile);
+void countTree(TestRun* run, const char* input, int length);
+void checkInput(TestRun* run, const char* input, int length);
+bool sameProfiles(const ParseProfile* a, const ParseProfile* b, int times);
+void checkRoundTrip(TestRun* run, const char* filename);
+const char* symbolName(const CompiledTable* compiled, int symbol);
+bool sameTrees(const CompiledTable* a, const ParseTree* treeA, const CompiledTable* b, const ParseTree* treeB);
+void checkHotOrder(TestRun* run, const CompiledTable* ordered, const ParseProfile* profile, bool alternatives);
+void checkLayout(TestRun* run, const char* filename);
+int testGrammar(const TestGrammar* grammar);
+
+void reportFailure(TestRun* run, const char* check, const char* input, int length) {
+    if (run->failures++ < MAX_REPORTED) {
+        printf("FAIL %s: %s on \"%.*s\"\n", run->grammar->name, check, length, input);
+    }
+}
+
+void clearParseProfile(ParseProfile* profile) {
+    memset(profile->cellCounts, 0, profile->numNonTerminals * profile->numTerminals * sizeof(unsigned long long));
+    memset(profile->productionCounts, 0, profile->numProductions * sizeof(unsigned long long));
+    memset(profile->maxDepth, 0, profile->numNonTerminals * sizeof(int));
+    profile->maxStackDepth = 0;
+    profile->numParses = profile->numAccepted = profile->numTokens = 0;
+}
+
+// The productions and cells of the tree's expansions, each non-terminal node counted under the
+// token that starts where it was expanded
+void countTree(TestRun* run, const char* input, int length) {
+    const CompiledTable* compiled = run->compiled;
+    memset(run->cells, 0, compiled->numNonTerminals * compiled->numTerminals * sizeof(unsigned long long));
+    memset(run->productions, 0, compiled->numProductions * sizeof(unsigned long long));
+    for (int i = 0; i <= length; i++) {
+        run->tokenAt[i] = -1;
+    }
+    int pos = 0, start, token;
+    do {
+        token = nextToken(compiled, input, length, &pos, &start);
+        if (token >= 0) run->tokenAt[start] = token;
+    } while (token >= 0 && token != compiled->endMarker);
+    
+    for (int i = 0; i < run->tree.numNodes; i++) {
+        const TreeNode* node = &run->tree.nodes[i];
+        if (node->production < 0) continue;
+        run->productions[node->production]++;
+        int lookahead = node->start >= 0 && node->start <= length ? run->tokenAt[node->start] : -1;
+        if (lookahead < 0) {
+            reportFailure(run, "a node expanded where no token starts", input, length);
+            continue;
+        }
+        run->cells[(node->symbol - compiled->numTerminals) * compiled->numTerminals + lookahead]++;
+    }
+}
+
+// The profile of one parse against the input's tree, then the parse added to the total profile
+void checkInput(TestRun* run, const char* input, int length) {
+    const CompiledTable* compiled = run->compiled;
+    resetParseTree(&run->tree);
+    ParseResult tree = parseInputTree(compiled, input, length, &run->tree);
+    clearParseProfile(run->single);
+    ParseResult profiled = parseInputProfile(compiled, input, length, run->single);
+    parseInputProfile(compiled, input, length, run->total);
+    if (profiled.accepted != tree.accepted || profiled.numTokens != tree.numTokens) {
+        reportFailure(run, "parseInputProfile and parseInputTree differ", input, length);
+        return;
+    }
+    if (run->single->numParses != 1 || run->single->numAccepted != (tree.accepted ? 1 : 0) ||
+        run->single->numTokens != (unsigned long long)tree.numTokens) {
+        reportFailure(run, "wrong parse, acceptance or token counts", input, length);
+    }
+    if (!tree.accepted) return;
+    
+    countTree(run, input, length);
+    for (int p = 0; p < compiled->numProductions; p++) {
+        if (run->single->productionCounts[p] != run->productions[p]) {
+            reportFailure(run, "a production count differs from the tree", input, length);
+            break;
+        }
+    }
+    for (int c = 0; c < compiled->numNonTerminals * compiled->numTerminals; c++) {
+        if (run->single->cellCounts[c] != run->cells[c]) {
+            reportFailure(run, "a cell count differs from the tree", input, length);
+            break;
+        }
+    }
+    for (int n = 0; n < compiled->numNonTerminals; n++) {
+        bool expanded = false;
+        for (int c = 0; c < compiled->numTerminals; c++) {
+            expanded = expanded || run->cells[n * compiled->numTerminals + c] > 0;
+        }
+        if ((run->single->maxDepth[n] > 0) != expanded || run->single->maxDepth[n] > run->single->maxStackDepth) {
+            reportFailure(run, "a depth for a non-terminal that was not expanded, or deeper than the stack", input, length);
+            break;
+        }
+    }
+}
+
+// Whether b holds times a's counts, and the same depths
+bool sameProfiles(const ParseProfile* a, const ParseProfile* b, int times) {
+    if (b->numParses != times * a->numParses || b->numAccepted != times * a->numAccepted ||
+        b->numTokens != times * a->numTokens || b->maxStackDepth != a->maxStackDepth) {
+        return false;
+    }
+    for (int p = 0; p < a->numProductions; p++) {
+        if (b->productionCounts[p] != times * a->productionCounts[p]) return false;
+    }
+    for (int c = 0; c < a->numNonTerminals * a->numTerminals; c++) {
+        if (b->cellCounts[c] != times * a->cellCounts[c]) return false;
+    }
+    for (int n = 0; n < a->numNonTerminals; n++) {
+        if (b->maxDepth[n] != a->maxDepth[n]) return false;
+    }
+    return true;
+}
+
+// The total profile written to a file and read back once, then twice
+void checkRoundTrip(TestRun* run, const char* filename) {
+    ParseProfile* read = createParseProfile(run->compiled);
+    if (!writeParseProfile(filename, run->compiled, run->total) || !readParseProfile(filename, run->compiled, read)) {
+        printf("FAIL %s: the profile file could not be written or read\n", run->grammar->name);
+        run->failures++;
+    } else if (!sameProfiles(run->total, read, 1)) {
+        printf("FAIL %s: the profile read back differs from the one written\n", run->grammar->name);
+        run->failures++;
+    } else if (!readParseProfile(filename, run->compiled, read) || !sameProfiles(run->total, read, 2)) {
+        printf("FAIL %s: reading the profile again did not add its counts\n", run->grammar->name);
+        run->failures++;
+    }
+    freeParseProfile(read);
+}
+
+const char* symbolName(const CompiledTable* compiled, int symbol) {
+    return symbol < compiled->numTerminals ? compiled->terminalNames[symbol]
+                                           : compiled->nonTerminalNames[symbol - compiled->numTerminals];
+}
+
+// Whether two trees have the same nodes in the same places, symbols and productions compared by name
+bool sameTrees(const CompiledTable* a, const ParseTree* treeA, const CompiledTable* b, const ParseTree* treeB) {
+    if (treeA->numNodes != treeB->numNodes) return false;
+    for (int i = 0; i < treeA->numNodes; i++) {
+        const TreeNode* x = &treeA->nodes[i];
+        const TreeNode* y = &treeB->nodes[i];
+        if (strcmp(symbolName(a, x->symbol), symbolName(b, y->symbol)) != 0 || (x->production < 0) != (y->production < 0) ||
+            x->firstChild != y->firstChild || x->nextSibling != y->nextSibling || x->start != y->start ||
+            x->length != y->length) {
+            return false;
+        }
+        if (x->production < 0) continue;
+        int length = a->productionLength[x->production];
+        if (b->productionLength[y->production] != length) return false;
+        for (int k = 0; k < length; k++) {
+            if (strcmp(symbolName(a, a->rhsSymbols[a->productionStart[x->production] + k]),
+                       symbolName(b, b->rhsSymbols[b->productionStart[y->production] + k])) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Rows and columns hottest first by their cell counts, unused ones after; productions grouped by
+// their rows, and without conflicts each row's alternatives hottest first
+void checkHotOrder(TestRun* run, const CompiledTable* ordered, const ParseProfile* profile, bool alternatives) {
+    int numTerminals = ordered->numTerminals;
+    unsigned long long* rowHeat = calloc(ordered->numNonTerminals, sizeof(unsigned long long));
+    unsigned long long* columnHeat = calloc(numTerminals, sizeof(unsigned long long));
+    for (int n = 0; n < ordered->numNonTerminals; n++) {
+        for (int t = 0; t < numTerminals; t++) {
+            rowHeat[n] += profile->cellCounts[n * numTerminals + t];
+            columnHeat[t] += profile->cellCounts[n * numTerminals + t];
+        }
+    }
+    for (int n = 1; n < ordered->numNonTerminals; n++) {
+        if (rowHeat[n] > rowHeat[n - 1]) {
+            printf("FAIL %s: row %s is hotter than row %s before it\n", run->grammar->name, ordered->nonTerminalNames[n],
+                   ordered->nonTerminalNames[n - 1]);
+            run->failures++;
+        }
+    }
+    // $ is the table's own column, after the grammar's terminals
+    for (int t = 0, last = -1; t < numTerminals; t++) {
+        if (t == ordered->endMarker) continue;
+        if (last != -1 && columnHeat[t] > columnHeat[last]) {
+            printf("FAIL %s: column %s is hotter than column %s before it\n", run->grammar->name,
+                   ordered->terminalNames[t], ordered->terminalNames[last]);
+            run->failures++;
+        }
+        last = t;
+    }
+    for (int p = 1; p < ordered->numProductions; p++) {
+        int lhs = ordered->productionLhs[p], previous = ordered->productionLhs[p - 1];
+        if (lhs < previous || (alternatives && lhs == previous &&
+                               profile->productionCounts[p] > profile->productionCounts[p - 1])) {
+            printf("FAIL %s: production %d of %s is out of order\n", run->grammar->name, p, ordered->nonTerminalNames[lhs]);
+            run->failures++;
+        }
+    }
+    free(rowHeat);
+    free(columnHeat);
+}
+
+// The grammar laid out by the profile file as cc -P lays it out, every input parsed with both tables
+void checkLayout(TestRun* run, const char* filename) {
+    int before = run->failures;
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString(run->grammar->text), 1);
+    CompiledTable* ordered = NULL;
+    if (analysis != NULL && orderGrammarByProfile(&analysis->simplified, &analysis->parseTable, filename)) {
+        reanalyzeGrammar(analysis, 1);
+        ordered = compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    }
+    if (ordered == NULL) {
+        printf("FAIL %s: the grammar laid out by its profile did not compile\n", run->grammar->name);
+        run->failures++;
+        freeGrammarAnalysis(analysis);
+        return;
+    }
+    ParseTree tree;
+    initParseTree(&tree);
+    ParseProfile* profile = createParseProfile(ordered);
+    for (int i = 0; i < INPUTS; i++) {
+        const char* input = run->inputs[i];
+        int length = run->lengths[i];
+        ParseResult a = parseInput(run->compiled, input, length);
+        ParseResult b = parseInput(ordered, input, length);
+        if (a.accepted != b.accepted || a.errorOffset != b.errorOffset || a.numTokens != b.numTokens) {
+            reportFailure(run, "the laid-out table parses differently", input, length);
+        }
+        parseInputTree(run->compiled, input, length, &run->tree);
+        parseInputTree(ordered, input, length, &tree);
+        if (!sameTrees(run->compiled, &run->tree, ordered, &tree)) {
+            reportFailure(run, "the laid-out table builds a different tree", input, length);
+        }
+        parseInputProfile(ordered, input, length, profile);
+    }
+    
+    // The file names what it counts, so it reads into the new numbering as the new parses count
+    ParseProfile* read = createParseProfile(ordered);
+    if (!readParseProfile(filename, ordered, read) || !sameProfiles(profile, read, 1)) {
+        printf("FAIL %s: the profile read into the laid-out table differs from its parses' profile\n", run->grammar->name);
+        run->failures++;
+    }
+    checkHotOrder(run, ordered, profile, analysis->parseTable.numConflicts == 0);
+    printf("%-10s %d inputs laid out by their profile: %s\n", "", INPUTS,
+           run->failures == before ? "same parses, hottest first" : "FAILED");
+    
+    freeParseProfile(read);
+    freeParseProfile(profile);
+    freeParseTree(&tree);
+    freeCompiledTable(ordered);
+    freeGrammarAnalysis(analysis);
+}
+
+int testGrammar(const TestGrammar* grammar) {
+    TestRun run;
+    memset(&run, 0, sizeof(run));
+    run.grammar = grammar;
+    run.analysis = analyzeGrammar(readGrammarFromString(grammar->text), 1);
+    run.compiled = run.analysis == NULL ? NULL
+                 : compileParseTable(&run.analysis->simplified, &run.analysis->parseTable, run.analysis->followSets);
+    if (run.compiled == NULL) {
+        printf("FAIL %s: the grammar did not compile\n", grammar->name);
+        freeGrammarAnalysis(run.analysis);
+        return 1;
+    }
+    const CompiledTable* compiled = run.compiled;
+    initParseTree(&run.tree);
+    run.single = createParseProfile(compiled);
+    run.total = createParseProfile(compiled);
+    run.cells = malloc(compiled->numNonTerminals * compiled->numTerminals * sizeof(unsigned long long));
+    run.productions = malloc(compiled->numProductions * sizeof(unsigned long long));
+    run.tokenAt = malloc((MAX_INPUT * 3 + 3) * sizeof(int));
+    run.inputs = malloc(INPUTS * sizeof(*run.inputs));
+    run.lengths = malloc(INPUTS * sizeof(int));
+    InputGenerator generator;
+    initInputGenerator(&generator, compiled, MAX_INPUT);
+    
+    for (int i = 0; i < INPUTS; i++) {
+        int length = generateDerivation(&generator, compiled->startSymbol, run.inputs[i]);
+        if (i % 3 == 2) length = mutateInput(run.inputs[i], length, grammar->alphabet, 1 + rand() % 2);
+        run.lengths[i] = length;
+        checkInput(&run, run.inputs[i], length);
+    }
+    char filename[] = "/tmp/ll1-profile-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd == -1) {
+        printf("FAIL %s: no temporary profile file\n", grammar->name);
+        run.failures++;
+    } else {
+        close(fd);
+        checkRoundTrip(&run, filename);
+    }
+    printf("%-10s %llu parses, %llu accepted, %llu tokens: %s\n", grammar->name, run.total->numParses,
+           run.total->numAccepted, run.total->numTokens, run.failures == 0 ? "counts as the trees give them" : "FAILED");
+    if (fd != -1) {
+        checkLayout(&run, filename);
+        unlink(filename);
+    }
+    
+    freeInputGenerator(&generator);
+    free(run.cells);
+    free(run.productions);
+    free(run.tokenAt);
+    free(run.inputs);
+    free(run.lengths);
+    freeParseProfile(run.single);
+    freeParseProfile(run.total);
+    freeParseTree(&run.tree);
+    freeCompiledTable(run.compiled);
+    freeGrammarAnalysis(run.analysis);
+    return run.failures;
+}
+
+int main(void) {
+    srand(1);
+    int failures = 0;
+    for (int g = 0; g < NUM_GRAMMARS; g++) {
+        failures += testGrammar(&grammars[g]);
+    }
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ll1.h"
+#include "parser.h"
+#include "generate.h"
+
+// Error recovery tests: documents of statements derived from a grammar, some of them damaged, are
+// parsed by parseInputRecover. Every damaged statement has to get an error within its own span,
+// clean statements none, the errors have to come in input order, and the first one has to be where
+// parseInput stops. Prints every failure and exits 1 if there was one
+
+#define DOCUMENTS 2000
+#define STATEMENTS 20            // Per document
+#define MAX_STATEMENT 40         // Generated statements stop growing once this long
+#define MAX_REPORTED 10
+
+// Statements end in ; or a block's }, and the damage never touches those, so a statement's errors
+// cannot run on into the next
+static const char* const grammarText =
+    "P -> S P | ε\n"
+    "S -> i = E ; | p E ; | { P }\n"
+    "E -> E + T | T\n"
+    "T -> i | n | ( E )\n"
+    "%entry S\n";
+static const char* const damageBytes = "i=n+()p";
+
+typedef struct {
+    CompiledTable* compiled;
+    InputGenerator generator;
+    char* text;
+    int length;
+    int start[STATEMENTS + 1];   // Offset of each statement, and the document's length
+    bool damaged[STATEMENTS];
+    int numDamaged;
+    int failures;
+} TestRun;
+
+// Function prototypes
+void reportFailure(TestRun* run, const char* check, int offset);
+int damageStatement(char* statement, int length);
+void generateDocument(TestRun* run);
+void checkDocument(TestRun* run);
+
+void reportFailure(TestRun* run, const char* check, int offset) {
+    if (run->failures++ < MAX_REPORTED) {
+        printf("FAIL %s at %d in \"%.*s\"\n", check, offset, run->length, run->text);
+    }
+}
+
+// Insert, delete or replace one byte before the statement's last one, leaving ; { } alone; the new length
+int damageStatement(char* statement, int length) {
+    for (;;) {
+        int pos = rand() % length;
+        int operation = rand() % 3;
+        if (pos == length - 1 || (operation > 0 && strchr(";{}", statement[pos]) != NULL)) continue;
+        if (operation == 0) {
+            memmove(statement + pos + 1, statement + pos, length - pos);
+            statement[pos] = damageBytes[rand() % strlen(damageBytes)];
+            return length + 1;
+        }
+        if (operation == 1) {
+            memmove(statement + pos, statement + pos + 1, length - pos - 1);
+            return length - 1;
+        }
+        statement[pos] = damageBytes[rand() % strlen(damageBytes)];
+        return length;
+    }
+}
+
+// STATEMENTS derived statements, a space apart, about one in three after a clean one damaged. A
+// statement counts as damaged only if the damage made it invalid on its own. Panic mode only finds
+// its footing again at the next statement's first token, so the skipping after one damaged
+// statement could run through the damage of the next; a clean statement between them stops it
+void generateDocument(TestRun* run) {
+    char statement[3 * MAX_STATEMENT + 2];
+    run->length = 0;
+    run->numDamaged = 0;
+    for (int k = 0; k < STATEMENTS; k++) {
+        int length = generateDerivation(&run->generator, run->compiled->entryPoints[1], statement);
+        if (k > 0 && !run->damaged[k - 1] && rand() % 3 == 0) length = damageStatement(statement, length);
+        run->damaged[k] = !parseInputFrom(run->compiled, 1, statement, length).accepted;
+        if (run->damaged[k]) run->numDamaged++;
+        run->start[k] = run->length;
+        memcpy(run->text + run->length, statement, length);
+        run->length += length;
+        if (k + 1 < STATEMENTS) run->text[run->length++] = ' ';
+    }
+    run->start[STATEMENTS] = run->length;
+}
+
+// An error belongs to a statement from the statement's first byte up to the next statement's
+// first token, where a missing terminator is found
+void checkDocument(TestRun* run) {
+    ParseErrors errors;
+    ParseResult result = parseInputRecover(run->compiled, run->text, run->length, &errors);
+    ParseResult plain = parseInput(run->compiled, run->text, run->length);
+    if (result.accepted != (run->numDamaged == 0) || result.accepted != (errors.numErrors == 0)) {
+        reportFailure(run, run->numDamaged == 0 ? "errors in a clean document" : "a damaged document accepted", -1);
+        return;
+    }
+    if (!result.accepted && (errors.errors[0].offset != plain.errorOffset || result.errorOffset != plain.errorOffset)) {
+        reportFailure(run, "the first error is not where parseInput stops", errors.errors[0].offset);
+    }
+    
+    int kept = errors.numErrors < MAX_PARSE_ERRORS ? errors.numErrors : MAX_PARSE_ERRORS;
+    bool found[STATEMENTS] = {false};
+    for (int e = 0; e < kept; e++) {
+        int offset = errors.errors[e].offset;
+        if (e > 0 && offset < errors.errors[e - 1].offset) reportFailure(run, "an error out of order", offset);
+        bool inDamaged = false;
+        for (int k = 0; k < STATEMENTS; k++) {
+            if (run->damaged[k] && offset >= run->start[k] && offset <= run->start[k + 1] + (k + 1 < STATEMENTS)) {
+                found[k] = inDamaged = true;
+            }
+        }
+        if (!inDamaged) reportFailure(run, "an error in a clean statement", offset);
+    }
+    for (int k = 0; k < STATEMENTS && errors.numErrors <= MAX_PARSE_ERRORS; k++) {
+        if (run->damaged[k] && !found[k]) reportFailure(run, "no error in a damaged statement", run->start[k]);
+    }
+}
+
+int main(void) {
+    srand(1);
+    TestRun run;
+    memset(&run, 0, sizeof(run));
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString(grammarText), 1);
+    run.compiled = analysis == NULL ? NULL
+                 : compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    if (run.compiled == NULL || run.compiled->numEntryPoints < 2) {
+        printf("FAIL: the grammar did not compile with its entry point\n");
+        return 1;
+    }
+    initInputGenerator(&run.generator, run.compiled, MAX_STATEMENT);
+    run.text = malloc(STATEMENTS * (3 * MAX_STATEMENT + 2));
+    
+    int damaged = 0, clean = 0;
+    for (int d = 0; d < DOCUMENTS; d++) {
+        generateDocument(&run);
+        checkDocument(&run);
+        damaged += run.numDamaged;
+        clean += STATEMENTS - run.numDamaged;
+    }
+    printf("%-10s %d documents, %d damaged and %d clean statements: %s\n", "recovery", DOCUMENTS, damaged, clean,
+           run.failures == 0 ? "errors where the damage is" : "FAILED");
+    
+    free(run.text);
+    freeInputGenerator(&run.generator);
+    freeCompiledTable(run.compiled);
+    freeGrammarAnalysis(analysis);
+    printf(run.failures == 0 ? "All tests passed\n" : "%d failures\n", run.failures);
+    return run.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ll1.h"
+#include "registry.h"
+
+// Registry tests: a grammar is republished over and over while reader threads parse with whatever
+// version they read. Each version a reader holds has to stay whole until its read section ends,
+// however many versions replace it meanwhile, and readers must never see an older version after a
+// newer one. Run under make sanitize, a version freed too early is a use after free. Retired
+// versions are freed once no reader can hold them. Prints every failure and exits 1 if there was one
+
+#define NUM_READERS 4
+#define PUBLICATIONS 300
+#define PARSES_PER_SECTION 8
+
+// Versions alternate between two languages, told apart by the inputs both parse
+static const char* const grammarTexts[2] = {
+    "S -> a S | b\n",
+    "S -> a S | c T\nT -> d | ε\n",
+};
+static const char* const inputs[] = {"aaab", "aaac", "acd", "b", "aaaaaaaaaaaaaaab", "ad"};
+static const bool acceptedBy[2][sizeof(inputs) / sizeof(inputs[0])] = {
+    {true, false, false, true, true, false},
+    {false, true, true, false, false, false},
+};
+
+#define NUM_INPUTS (int)(sizeof(inputs) / sizeof(inputs[0]))
+
+typedef struct {
+    GrammarRegistry* registry;
+    atomic_bool* stop;
+    int sections;
+    int failures;
+} Reader;
+
+// Function prototypes
+int languageOf(const CompiledTable* compiled);
+GrammarAnalysis* analyzeText(const char* text);
+void* readGrammars(void* arg);
+int testHeldVersion(void);
+int testConcurrentReaders(void);
+
+// 0 for the first language, 1 for the second: only the second has a terminal c
+int languageOf(const CompiledTable* compiled) {
+    for (int t = 0; t < compiled->numTerminals; t++) {
+        if (strcmp(compiled->terminalNames[t], "c") == 0) return 1;
+    }
+    return 0;
+}
+
+GrammarAnalysis* analyzeText(const char* text) {
+    return analyzeGrammar(readGrammarFromString(text), 1);
+}
+
+// Read sections until told to stop, each parsing every input several times with the version read
+// at its start, and checking that the version is still the same one at the end
+void* readGrammars(void* arg) {
+    Reader* reader = (Reader*)arg;
+    int slot = registerGrammarReader(reader->registry);
+    int lastVersion = 0;
+    if (slot < 0) {
+        printf("FAIL readers: no reader slot\n");
+        reader->failures++;
+        return NULL;
+    }
+    while (!atomic_load(reader->stop)) {
+        beginGrammarRead(reader->registry, slot);
+        const GrammarVersion* grammar = readGrammar(reader->registry, 0);
+        int version = grammar->version;
+        int language = languageOf(grammar->compiled);
+        bool same = true;
+        for (int k = 0; k < PARSES_PER_SECTION; k++) {
+            for (int i = 0; i < NUM_INPUTS; i++) {
+                same = same && parseInput(grammar->compiled, inputs[i], strlen(inputs[i])).accepted == acceptedBy[language][i];
+            }
+        }
+        same = same && grammar->version == version && languageOf(grammar->compiled) == language;
+        endGrammarRead(reader->registry, slot);
+        if (!same && reader->failures++ < 10) printf("FAIL readers: version %d changed while it was held\n", version);
+        if (version < lastVersion && reader->failures++ < 10) {
+            printf("FAIL readers: version %d read after version %d\n", version, lastVersion);
+        }
+        lastVersion = version;
+        reader->sections++;
+    }
+    return NULL;
+}
+
+// A version held in a read section survives its replacement and reclamation, and is freed by the
+// first reclamation after the section ends
+int testHeldVersion(void) {
+    GrammarRegistry* registry = createGrammarRegistry();
+    int failures = 0;
+    int slot = registerGrammarReader(registry);
+    publishGrammar(registry, "g", analyzeText(grammarTexts[0]), false);
+    
+    beginGrammarRead(registry, slot);
+    const GrammarVersion* held = readGrammar(registry, 0);
+    publishGrammar(registry, "g", analyzeText(grammarTexts[1]), false);
+    publishGrammar(registry, "g", analyzeText(grammarTexts[0]), true);
+    int left = reclaimGrammars(registry);
+    // The second version stays too: it was retired after the section began, so the reader could hold it
+    if (left != 2 || !parseInput(held->compiled, "aab", 3).accepted || languageOf(held->compiled) != 0) {
+        printf("FAIL held: %d versions left while one is held, 2 expected\n", left);
+        failures++;
+    }
+    if (readGrammar(registry, 0)->version != 3 || readGrammar(registry, 1) != NULL) {
+        printf("FAIL held: the current version is not the last one published\n");
+        failures++;
+    }
+    endGrammarRead(registry, slot);
+    
+    left = reclaimGrammars(registry);
+    if (left != 0) {
+        printf("FAIL held: %d versions left after the reader left\n", left);
+        failures++;
+    }
+    freeGrammarRegistry(registry);
+    printf("%-10s %s\n", "held", failures == 0 ? "a held version outlives its replacement, and no longer" : "FAILED");
+    return failures;
+}
+
+// NUM_READERS threads reading while the main thread publishes PUBLICATIONS versions
+int testConcurrentReaders(void) {
+    GrammarRegistry* registry = createGrammarRegistry();
+    atomic_bool stop;
+    atomic_init(&stop, false);
+    Reader readers[NUM_READERS];
+    pthread_t threads[NUM_READERS];
+    int failures = 0;
+    
+    publishGrammar(registry, "g", analyzeText(grammarTexts[0]), false);
+    for (int r = 0; r < NUM_READERS; r++) {
+        readers[r] = (Reader){registry, &stop, 0, 0};
+        pthread_create(&threads[r], NULL, readGrammars, &readers[r]);
+    }
+    for (int p = 1; p <= PUBLICATIONS; p++) {
+        if (publishGrammar(registry, "g", analyzeText(grammarTexts[p % 2]), p % 3 == 0) != 0) {
+            printf("FAIL concurrent: publication %d failed\n", p);
+            failures++;
+        }
+    }
+    atomic_store(&stop, true);
+    int sections = 0;
+    for (int r = 0; r < NUM_READERS; r++) {
+        pthread_join(threads[r], NULL);
+        failures += readers[r].failures;
+        sections += readers[r].sections;
+    }
+    
+    // With every reader gone, nothing retired can be held
+    synchronizeGrammars(registry);
+    if (registry->retired != NULL) {
+        printf("FAIL concurrent: retired versions left after synchronizeGrammars\n");
+        failures++;
+    }
+    freeGrammarRegistry(registry);
+    printf("%-10s %d readers, %d sections, %d publications: %s\n", "concurrent", NUM_READERS, sections, PUBLICATIONS,
+           failures == 0 ? "every held version stayed whole" : "FAILED");
+    return failures;
+}
+
+int main(void) {
+    int failures = testHeldVersion() + testConcurrentReaders();
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
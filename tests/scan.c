@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scan.h"
+
+// Scanning tests: the block scans in scan.c (SSE2, or AVX2 when built with -mavx2) must return
+// what a plain byte loop returns, for every byte value in every position of a block and for random
+// text at every alignment and length. Each call gets a copy of exactly length bytes on the heap, so
+// a read past the end shows up under make sanitize. Prints every difference and exits 1 if there was one
+
+#define MAX_LENGTH 160           // Lengths tried, 0 up to this
+#define MAX_OFFSET 64            // Alignments tried within a buffer
+#define TEXTS 8                  // Random texts tried at each alignment and length
+#define MAX_REPORTED 10
+
+static int failures = 0;
+
+// Function prototypes
+int referenceSpaces(const char* text, int length);
+int referenceIdentifier(const char* text, int length);
+int referenceByte(const char* text, int length, char c);
+int referenceBytePair(const char* text, int length, char a, char b);
+void checkScans(const char* text, int length, char c, char a, char b);
+void randomText(char* text, int length);
+int testEveryByte(void);
+int testRandomText(void);
+
+int referenceSpaces(const char* text, int length) {
+    int i = 0;
+    while (i < length && (text[i] == ' ' || text[i] == '\t' || text[i] == '\n' || text[i] == '\v' ||
+                          text[i] == '\f' || text[i] == '\r')) {
+        i++;
+    }
+    return i;
+}
+
+int referenceIdentifier(const char* text, int length) {
+    int i = 0;
+    while (i < length && ((text[i] >= 'a' && text[i] <= 'z') || (text[i] >= 'A' && text[i] <= 'Z') ||
+                          (text[i] >= '0' && text[i] <= '9') || text[i] == '_')) {
+        i++;
+    }
+    return i;
+}
+
+int referenceByte(const char* text, int length, char c) {
+    for (int i = 0; i < length; i++) {
+        if (text[i] == c) return i;
+    }
+    return -1;
+}
+
+int referenceBytePair(const char* text, int length, char a, char b) {
+    for (int i = 0; i + 1 < length; i++) {
+        if (text[i] == a && text[i + 1] == b) return i;
+    }
+    return -1;
+}
+
+// Every scan on a heap copy of exactly length bytes, against the byte loops
+void checkScans(const char* text, int length, char c, char a, char b) {
+    char* copy = malloc(length > 0 ? length : 1);
+    memcpy(copy, text, length);
+    int got[4] = {scanSpaces(copy, length), scanIdentifier(copy, length), findByte(copy, length, c),
+                  findBytePair(copy, length, a, b)};
+    int expected[4] = {referenceSpaces(text, length), referenceIdentifier(text, length),
+                       referenceByte(text, length, c), referenceBytePair(text, length, a, b)};
+    static const char* const names[4] = {"scanSpaces", "scanIdentifier", "findByte", "findBytePair"};
+    for (int f = 0; f < 4; f++) {
+        if (got[f] != expected[f] && failures++ < MAX_REPORTED) {
+            printf("FAIL %s: %d instead of %d on %d bytes:", names[f], got[f], expected[f], length);
+            for (int i = 0; i < length; i++) {
+                printf(" %02x", (unsigned char)text[i]);
+            }
+            printf("\n");
+        }
+    }
+    free(copy);
+}
+
+// Runs of spaces, identifier bytes and the bytes searched for, with any other byte, high bytes and
+// ε's UTF-8 among them, now and then
+void randomText(char* text, int length) {
+    static const char* const classes[] = {" \t\n\v\f\r", "aZz_09Az", "->", "\xCE\xB5", "\x80\xFF\x08\x0E\x1F/@[`{"};
+    int i = 0;
+    while (i < length) {
+        const char* bytes = classes[rand() % 5];
+        int run = 1 + rand() % (rand() % 4 == 0 ? 40 : 6);
+        for (; run > 0 && i < length; run--) {
+            text[i++] = rand() % 50 == 0 ? (char)(rand() % 256) : bytes[rand() % strlen(bytes)];
+        }
+    }
+}
+
+// Each byte value at each position of a run of spaces, of identifier bytes and of other bytes, so
+// every value is classified in every lane of a block and in the tail
+int testEveryByte(void) {
+    int before = failures;
+    char text[MAX_LENGTH];
+    static const char fills[] = {' ', 'q', '.'};
+    for (int f = 0; f < 3; f++) {
+        for (int value = 0; value < 256; value++) {
+            for (int position = 0; position < 2 * MAX_OFFSET + 2; position++) {
+                memset(text, fills[f], sizeof(text));
+                text[position] = (char)value;
+                checkScans(text, sizeof(text), (char)value, (char)value, fills[f]);
+                checkScans(text, sizeof(text), (char)value, fills[f], (char)value);
+            }
+        }
+    }
+    printf("%-10s %s\n", "bytes", failures == before ? "every byte value in every position agrees" : "FAILED");
+    return failures - before;
+}
+
+// Random text at every alignment and length, pairs searched for "->" and ε
+int testRandomText(void) {
+    int before = failures;
+    char buffer[MAX_OFFSET + MAX_LENGTH];
+    for (int offset = 0; offset < MAX_OFFSET; offset++) {
+        for (int length = 0; length <= MAX_LENGTH; length++) {
+            for (int t = 0; t < TEXTS; t++) {
+                randomText(buffer + offset, length);
+                checkScans(buffer + offset, length, t % 2 == 0 ? '-' : '>', t % 2 == 0 ? '-' : '\xCE',
+                           t % 2 == 0 ? '>' : '\xB5');
+            }
+        }
+    }
+    printf("%-10s %d alignments, lengths 0 to %d: %s\n", "random", MAX_OFFSET, MAX_LENGTH,
+           failures == before ? "same as the byte loops" : "FAILED");
+    return failures - before;
+}
+
+int main(void) {
+    srand(1);
+#if defined(__AVX2__)
+    printf("Scanning 32-byte AVX2 blocks\n");
+#elif defined(__SSE2__)
+    printf("Scanning 16-byte SSE2 blocks\n");
+#else
+    printf("Scanning one byte at a time\n");
+#endif
+    testEveryByte();
+    testRandomText();
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
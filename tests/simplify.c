@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ll1.h"
+#include "parser.h"
+#include "generate.h"
+
+// Simplification tests: simplifyGrammar must keep the language. Each grammar's table is built with
+// and without simplification, and derivations of either grammar, as derived and mutated, must get
+// the same answer from both. Prints every disagreement and exits 1 if there was one
+
+#define INPUTS_PER_GRAMMAR 2000
+#define MAX_INPUT 160            // Generated inputs stop growing once this long
+#define MAX_REPORTED 10          // Failures printed per grammar; the rest are only counted
+
+typedef struct {
+    const char* name;
+    const char* text;
+    const char* alphabet;        // Bytes mutations insert or substitute
+} TestGrammar;
+
+// One grammar's tables, built from withoutLeftRecursion and from simplified
+typedef struct {
+    const TestGrammar* grammar;
+    GrammarAnalysis* analysis;
+    Set* firstSets;              // Of withoutLeftRecursion
+    Set* followSets;
+    ParseTable* table;
+    CompiledTable* unsimplified;
+    CompiledTable* simplified;
+    int failures;
+} TestRun;
+
+static const TestGrammar grammars[] = {
+    // Unit productions, an unreachable and an unproductive non-terminal
+    {"units", "S -> A b | C\nA -> a | C\nC -> c D\nD -> d | ε\nU -> u\nV -> v V\n", "abcdu"},
+    {"chain", "S -> A\nA -> B\nB -> C | x\nC -> c S d | e\n", "cdex"},
+    // Non-terminals with identical alternatives, merged
+    {"merge", "S -> X y Y | z\nX -> a X | b\nY -> a Y | b\n", "abyz"},
+    {"expression", "E -> E+T | E-T | T\nT -> T*F | T/F | F\nF -> (E) | i\n", "i+-*/()"},
+    // Merging Q into the longer name would overflow the first alternative, so they stay apart
+    {"long", "S -> c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c c Q Q @tag"
+             " | y LongNameAa\nLongNameAa -> x\nQ -> x\n", "cxy"},
+};
+
+// Function prototypes
+void reportFailure(TestRun* run, const char* check, const char* input, int length);
+bool setUpRun(TestRun* run, const TestGrammar* grammar);
+void tearDownRun(TestRun* run);
+void checkInputs(TestRun* run, const CompiledTable* from);
+int testGrammar(const TestGrammar* grammar);
+int testTaggedMerge(void);
+int testLongAlternative(void);
+
+void reportFailure(TestRun* run, const char* check, const char* input, int length) {
+    if (run->failures++ < MAX_REPORTED) {
+        printf("FAIL %s: %s on \"%.*s\"\n", run->grammar->name, check, length, input);
+    }
+}
+
+bool setUpRun(TestRun* run, const TestGrammar* grammar) {
+    memset(run, 0, sizeof(TestRun));
+    run->grammar = grammar;
+    run->analysis = analyzeGrammar(readGrammarFromString(grammar->text), 1);
+    if (run->analysis == NULL) return false;
+    
+    const Grammar* unsimplified = &run->analysis->withoutLeftRecursion;
+    run->firstSets = computeFirstSets(*unsimplified);
+    run->followSets = computeFollowSets(*unsimplified, run->firstSets);
+    run->table = malloc(sizeof(ParseTable));
+    *run->table = constructLL1Table(*unsimplified, run->firstSets, run->followSets);
+    run->unsimplified = compileParseTable(unsimplified, run->table, run->followSets);
+    run->simplified = compileParseTable(&run->analysis->simplified, &run->analysis->parseTable,
+                                        run->analysis->followSets);
+    return run->unsimplified != NULL && run->simplified != NULL;
+}
+
+void tearDownRun(TestRun* run) {
+    if (run->analysis != NULL) {
+        freeSet(run->firstSets, run->analysis->withoutLeftRecursion.numNonTerminals);
+        freeSet(run->followSets, run->analysis->withoutLeftRecursion.numNonTerminals);
+    }
+    if (run->table != NULL) freeParseTable(run->table);
+    free(run->table);
+    freeCompiledTable(run->unsimplified);
+    freeCompiledTable(run->simplified);
+    freeGrammarAnalysis(run->analysis);
+}
+
+// Derivations of from's grammar: as derived, both tables accept them (when neither has contested
+// cells, which a derivation may resolve either way); mutated, both tables give the same answer
+void checkInputs(TestRun* run, const CompiledTable* from) {
+    InputGenerator generator;
+    initInputGenerator(&generator, from, MAX_INPUT);
+    bool exact = run->unsimplified->numDecisions == 0 && run->simplified->numDecisions == 0;
+    char input[3 * MAX_INPUT];
+    for (int i = 0; i < INPUTS_PER_GRAMMAR; i++) {
+        int length = generateDerivation(&generator, from->startSymbol, input);
+        if (exact && !parseInput(run->simplified, input, length).accepted) {
+            reportFailure(run, "a derivation is rejected by the simplified table", input, length);
+        }
+        if (exact && !parseInput(run->unsimplified, input, length).accepted) {
+            reportFailure(run, "a derivation is rejected by the unsimplified table", input, length);
+        }
+        length = mutateInput(input, length, run->grammar->alphabet, 1 + rand() % 2);
+        if (parseInput(run->simplified, input, length).accepted != parseInput(run->unsimplified, input, length).accepted) {
+            reportFailure(run, "the tables disagree", input, length);
+        }
+    }
+    freeInputGenerator(&generator);
+}
+
+// Failures found on one grammar
+int testGrammar(const TestGrammar* grammar) {
+    TestRun* run = malloc(sizeof(TestRun));
+    if (!setUpRun(run, grammar)) {
+        printf("FAIL %s: the grammar did not compile\n", grammar->name);
+        tearDownRun(run);
+        free(run);
+        return 1;
+    }
+    
+    checkInputs(run, run->unsimplified);
+    checkInputs(run, run->simplified);
+    printf("%-10s %d to %d non-terminals: %s\n", grammar->name, run->unsimplified->numNonTerminals,
+           run->simplified->numNonTerminals, run->failures == 0 ? "same language" : "FAILED");
+    int failures = run->failures;
+    tearDownRun(run);
+    free(run);
+    return failures;
+}
+
+// Non-terminals with the same alternatives but different action tags must stay apart
+int testTaggedMerge(void) {
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString("S -> A y B\nA -> x @ta\nB -> x @tb\n"), 1);
+    bool apart = analysis != NULL && findNonTerminalIndex(&analysis->simplified, "A") != -1 &&
+                 findNonTerminalIndex(&analysis->simplified, "B") != -1;
+    printf("%-10s %s\n", "tags", apart ? "differently tagged non-terminals kept apart" : "FAILED: merged");
+    freeGrammarAnalysis(analysis);
+    return apart ? 0 : 1;
+}
+
+// An alternative that renaming would lengthen past MAX_PROD_LEN keeps its symbols and its tag
+int testLongAlternative(void) {
+    GrammarAnalysis* analysis = analyzeGrammar(readGrammarFromString(grammars[4].text), 1);
+    CompiledTable* compiled = analysis == NULL ? NULL
+                            : compileParseTable(&analysis->simplified, &analysis->parseTable, analysis->followSets);
+    char input[128];
+    int length = 0;
+    for (int i = 0; i < 45; i++) input[length++] = 'c';
+    input[length++] = 'x';
+    input[length++] = 'x';
+    bool ok = compiled != NULL && parseInput(compiled, input, length).accepted && compiled->numActions == 1;
+    printf("%-10s %s\n", "truncation", ok ? "long alternatives kept whole" : "FAILED: alternative cut short");
+    freeCompiledTable(compiled);
+    freeGrammarAnalysis(analysis);
+    return ok ? 0 : 1;
+}
+
+int main(void) {
+    srand(1);
+    int failures = testTaggedMerge() + testLongAlternative();
+    for (size_t g = 0; g < sizeof(grammars) / sizeof(grammars[0]); g++) {
+        failures += testGrammar(&grammars[g]);
+    }
+    printf(failures == 0 ? "All tests passed\n" : "%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}